@@ -0,0 +1,230 @@
+#include "AssetCache.h"
+
+#include "ContentHash.h"
+#include "DdsParser.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "VertexFormat.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+	string toHex(uint64_t value) {
+		char text[17];
+		snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+		return text;
+	}
+
+	size_t getMeshBytes(const MeshData& mesh) {
+		return sizeof(Vertex) * mesh.vertices.size() + mesh.packedVertices.size() + sizeof(uint32_t) * mesh.indices.size() +
+			sizeof(MeshLod) * mesh.lods.size() + sizeof(Meshlet) * mesh.meshlets.size();
+	}
+
+	size_t getChainBytes(const TextureChain& chain) {
+		size_t bytes = 0;
+		for (const auto& mip : chain)
+			bytes += mip.pixels.size();
+		return bytes;
+	}
+
+	bool loadChain(const string& path, TextureChain& chain) {
+		error_code ec;
+		if (!filesystem::is_regular_file(path, ec))
+			return false;
+		try {
+			DdsFile file(path);
+			const DdsTexture& texture = file.getTexture();
+			if (texture.format != DXGI_FORMAT_R8G8B8A8_UNORM || texture.dimension != DdsDimension::texture2d || texture.arraySize != 1)
+				return false;
+			chain.resize(texture.mipCount);
+			for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+				const DdsSurface& surface = texture.getSurface(0, mip);
+				chain[mip].width = surface.width;
+				chain[mip].height = surface.height;
+				chain[mip].pixels.assign(surface.data, surface.data + surface.size);
+			}
+			return true;
+		}
+		catch (const exception&) {
+			// a damaged entry is rebuilt and written again
+			return false;
+		}
+	}
+
+	bool saveChain(const string& path, const TextureChain& chain) {
+		vector<uint8_t> surfaces;
+		surfaces.reserve(getChainBytes(chain));
+		for (const auto& mip : chain)
+			surfaces.insert(surfaces.end(), mip.pixels.begin(), mip.pixels.end());
+
+		// like MeshCache::save, never leave a half written entry behind
+		const string tempPath = path + ".tmp";
+		error_code ec;
+		try {
+			writeDds(tempPath, DXGI_FORMAT_R8G8B8A8_UNORM, chain[0].width, chain[0].height, static_cast<uint32_t>(chain.size()), surfaces);
+		}
+		catch (const exception&) {
+			filesystem::remove(tempPath, ec);
+			return false;
+		}
+		filesystem::rename(tempPath, path, ec);
+		if (ec) {
+			filesystem::remove(tempPath, ec);
+			return false;
+		}
+		return true;
+	}
+}
+
+AssetCache::AssetCache(string directory, size_t memory_budget)
+	: m_directory(move(directory)), m_memoryBudget(memory_budget)
+{
+}
+
+shared_ptr<const MeshData> AssetCache::getMesh(const string& model_path, VertexFormat format, const function<void(MeshData&)>& build)
+{
+	const FileHash source = hashSource(model_path);
+	const string key = toHex(source.hash) + "." + getVertexFormatName(format);
+	Entry entry;
+	if (find(key, entry))
+		return entry.mesh;
+
+	// the content hash takes the place of the modification time of the mesh cache next to the model
+	const MeshCache::SourceKey sourceKey = { source.size, static_cast<int64_t>(source.hash), key };
+	const string path = m_directory + "/" + key + ".meshcache";
+	auto mesh = make_shared<MeshData>();
+	const bool stored = MeshCache::load(path, sourceKey, *mesh, format);
+	if (!stored) {
+		build(*mesh);
+		error_code ec;
+		filesystem::create_directories(m_directory, ec);
+		MeshCache::save(path, sourceKey, *mesh, format);
+	}
+
+	entry.key = key;
+	entry.bytes = getMeshBytes(*mesh);
+	entry.mesh = mesh;
+	insert(move(entry), stored);
+	return mesh;
+}
+
+shared_ptr<const TextureChain> AssetCache::getTexture(const string& image_path, MipFilter filter,
+	const function<void(TextureChain&)>& build)
+{
+	const FileHash source = hashSource(image_path);
+	const string key = toHex(source.hash) + "." + getMipFilterName(filter);
+	Entry entry;
+	if (find(key, entry))
+		return entry.texture;
+
+	const string path = m_directory + "/" + key + ".dds";
+	auto chain = make_shared<TextureChain>();
+	const bool stored = loadChain(path, *chain);
+	if (!stored) {
+		build(*chain);
+		if (chain->empty() || chain->front().width == 0)
+			throw runtime_error(image_path + ": no image to cache");
+		error_code ec;
+		filesystem::create_directories(m_directory, ec);
+		saveChain(path, *chain);
+	}
+
+	entry.key = key;
+	entry.bytes = getChainBytes(*chain);
+	entry.texture = chain;
+	insert(move(entry), stored);
+	return chain;
+}
+
+uint64_t AssetCache::hashFile(const string& path)
+{
+	return hashSource(path).hash;
+}
+
+AssetCacheStats AssetCache::getStats() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	AssetCacheStats stats = m_stats;
+	stats.entries = m_entries.size();
+	return stats;
+}
+
+void AssetCache::clearMemory()
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_entries.clear();
+	m_index.clear();
+	m_stats.memoryBytes = 0;
+}
+
+AssetCache::FileHash AssetCache::hashSource(const string& path)
+{
+	error_code ec;
+	FileHash source;
+	source.size = filesystem::file_size(path, ec);
+	if (!ec)
+		source.time = static_cast<int64_t>(filesystem::last_write_time(path, ec).time_since_epoch().count());
+	if (ec)
+		throw runtime_error("can't read " + path);
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto known = m_fileHashes.find(path);
+		if (known != m_fileHashes.end() && known->second.size == source.size && known->second.time == source.time)
+			return known->second;
+	}
+
+	MappedFile file;
+	if (!file.open(path))
+		throw runtime_error("can't read " + path);
+	source.hash = hashContent(file.data(), file.size());
+
+	lock_guard<mutex> lock(m_mutex);
+	m_fileHashes[path] = source;
+	return source;
+}
+
+bool AssetCache::find(const string& key, Entry& entry)
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto found = m_index.find(key);
+	if (found == m_index.end())
+		return false;
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+	m_stats.memoryHits++;
+	entry = *found->second;
+	return true;
+}
+
+void AssetCache::insert(Entry entry, bool stored)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (stored)
+		m_stats.diskHits++;
+	else
+		m_stats.misses++;
+
+	// another thread may have stored the same key meanwhile
+	auto found = m_index.find(entry.key);
+	if (found != m_index.end()) {
+		m_stats.memoryBytes -= found->second->bytes;
+		m_entries.erase(found->second);
+		m_index.erase(found);
+	}
+
+	m_stats.memoryBytes += entry.bytes;
+	m_entries.push_front(move(entry));
+	m_index[m_entries.front().key] = m_entries.begin();
+
+	// the newest entry stays even when it alone is over the budget
+	while (m_stats.memoryBytes > m_memoryBudget && m_entries.size() > 1) {
+		m_stats.memoryBytes -= m_entries.back().bytes;
+		m_index.erase(m_entries.back().key);
+		m_entries.pop_back();
+		m_stats.evictions++;
+	}
+}
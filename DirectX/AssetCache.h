@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Image.h"
+#include "Mesh.h"
+#include "MipGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Processed meshes and decoded textures keyed by the XXH64 of their source
+// file, so the same content is only parsed or decoded once whatever its path.
+// Entries live in a memory LRU bounded in bytes and as files in a folder,
+// meshes in the MeshCache format and textures as RGBA8 DDS with every mip.
+// Safe to use from several threads; two threads missing the same asset both
+// build it and the last one stored wins.
+
+struct AssetCacheStats
+{
+	uint64_t memoryHits = 0;
+	uint64_t diskHits = 0;
+	uint64_t misses = 0; // built by the caller
+	uint64_t evictions = 0;
+	size_t memoryBytes = 0;
+	size_t entries = 0;
+};
+
+// a full mip chain, mips[0] is the top level
+using TextureChain = std::vector<Image>;
+
+class AssetCache {
+public:
+	explicit AssetCache(std::string directory = "assetcache", size_t memory_budget = 256 << 20);
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	// The mesh of model_path processed for format, from memory, from disk or
+	// from build (which fills the mesh from model_path) in that order. Throws
+	// a runtime_error when model_path can't be read; what build throws goes
+	// through and nothing is stored.
+	std::shared_ptr<const MeshData> getMesh(const std::string& model_path, VertexFormat format,
+		const std::function<void(MeshData&)>& build);
+	// The mip chain of image_path built with filter, like getMesh.
+	std::shared_ptr<const TextureChain> getTexture(const std::string& image_path, MipFilter filter,
+		const std::function<void(TextureChain&)>& build);
+
+	// XXH64 of the file, hashed again only when its size or modification time changed
+	uint64_t hashFile(const std::string& path);
+
+	AssetCacheStats getStats() const;
+	// drops the memory entries, the files stay
+	void clearMemory();
+
+private:
+	struct Entry
+	{
+		std::string key;
+		size_t bytes = 0;
+		std::shared_ptr<const MeshData> mesh;
+		std::shared_ptr<const TextureChain> texture;
+	};
+
+	struct FileHash
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+		uint64_t hash = 0;
+	};
+
+	// size, modification time and XXH64 of a source file, throws when it can't be read
+	FileHash hashSource(const std::string& path);
+	// copies the memory entry of key and makes it the most recent one
+	bool find(const std::string& key, Entry& entry);
+	// stored: it came from the folder instead of being built
+	void insert(Entry entry, bool stored);
+
+	std::string m_directory;
+	size_t m_memoryBudget;
+	mutable std::mutex m_mutex;
+	// most recently used first
+	std::list<Entry> m_entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+	std::unordered_map<std::string, FileHash> m_fileHashes;
+	AssetCacheStats m_stats;
+};
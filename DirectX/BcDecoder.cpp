@@ -0,0 +1,669 @@
+#include "BcDecoder.h"
+#include "BcTables.h"
+#include "HalfFloat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DECODER_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const int PIXELS = 16;
+
+	enum class BlockKind { bc1, bc2, bc3, bc4, bc5, bc6h, bc7, rgba8, bgra8, bgrx8, none };
+
+	BlockKind getBlockKind(DXGI_FORMAT format) {
+		switch (format) {
+		case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB: return BlockKind::bc1;
+		case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB: return BlockKind::bc2;
+		case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB: return BlockKind::bc3;
+		case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM: return BlockKind::bc4;
+		case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM: return BlockKind::bc5;
+		case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16: return BlockKind::bc6h;
+		case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB: return BlockKind::bc7;
+		case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return BlockKind::rgba8;
+		case DXGI_FORMAT_B8G8R8A8_TYPELESS: case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: return BlockKind::bgra8;
+		case DXGI_FORMAT_B8G8R8X8_TYPELESS: case DXGI_FORMAT_B8G8R8X8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: return BlockKind::bgrx8;
+		default: return BlockKind::none;
+		}
+	}
+
+	bool isSnorm(DXGI_FORMAT format) {
+		return format == DXGI_FORMAT_BC4_SNORM || format == DXGI_FORMAT_BC5_SNORM;
+	}
+
+	// the bits of a 128-bit block, read from bit 0 up
+	class BitReader {
+	public:
+		explicit BitReader(const uint8_t* block) {
+			memcpy(m_bits, block, 16);
+		}
+
+		// count is at most 32
+		uint32_t read(int count) {
+			const int word = m_position >> 6, shift = m_position & 63;
+			uint64_t value = m_bits[word] >> shift;
+			if (word == 0 && shift + count > 64)
+				value |= m_bits[1] << (64 - shift);
+			m_position += count;
+			return uint32_t(value & ((1ull << count) - 1));
+		}
+
+	private:
+		uint64_t m_bits[2];
+		int m_position = 0;
+	};
+
+	void storePixel(uint8_t pixel[4], int r, int g, int b, int a) {
+		pixel[0] = uint8_t(r);
+		pixel[1] = uint8_t(g);
+		pixel[2] = uint8_t(b);
+		pixel[3] = uint8_t(a);
+	}
+
+#pragma region bc1 to bc5
+	void unpackColor565(uint16_t packed, int color[3]) {
+		const int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// the color half of BC1 to BC3, only BC1 has the 3 color mode with transparent black
+	void decodeColorBlock(const uint8_t* block, bool bc1, uint8_t pixels[PIXELS][4]) {
+		const uint16_t c0 = uint16_t(block[0] | block[1] << 8);
+		const uint16_t c1 = uint16_t(block[2] | block[3] << 8);
+		int a[3], b[3];
+		unpackColor565(c0, a);
+		unpackColor565(c1, b);
+
+		uint8_t palette[4][4];
+		storePixel(palette[0], a[0], a[1], a[2], 255);
+		storePixel(palette[1], b[0], b[1], b[2], 255);
+		if (c0 > c1 || !bc1) {
+			storePixel(palette[2], (2 * a[0] + b[0] + 1) / 3, (2 * a[1] + b[1] + 1) / 3, (2 * a[2] + b[2] + 1) / 3, 255);
+			storePixel(palette[3], (a[0] + 2 * b[0] + 1) / 3, (a[1] + 2 * b[1] + 1) / 3, (a[2] + 2 * b[2] + 1) / 3, 255);
+		}
+		else {
+			storePixel(palette[2], (a[0] + b[0] + 1) / 2, (a[1] + b[1] + 1) / 2, (a[2] + b[2] + 1) / 2, 255);
+			storePixel(palette[3], 0, 0, 0, 0);
+		}
+
+		uint32_t indices;
+		memcpy(&indices, block + 4, sizeof(indices));
+		for (int p = 0; p < PIXELS; p++, indices >>= 2)
+			memcpy(pixels[p], palette[indices & 3], 4);
+	}
+
+	// BC2 alpha: 4 bits per pixel
+	void decodeExplicitAlpha(const uint8_t* block, uint8_t pixels[PIXELS][4]) {
+		for (int p = 0; p < PIXELS; p++) {
+			const int alpha = block[p >> 1] >> (4 * (p & 1)) & 15;
+			pixels[p][3] = uint8_t(alpha << 4 | alpha);
+		}
+	}
+
+	uint64_t readIndices48(const uint8_t* block) {
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= uint64_t(block[2 + i]) << (8 * i);
+		return indices;
+	}
+
+	// BC3 alpha and the channels of BC4 and BC5 UNORM, written to channel of pixels
+	void decodeUnormChannel(const uint8_t* block, uint8_t pixels[PIXELS][4], int channel) {
+		const int a0 = block[0], a1 = block[1];
+		uint8_t values[8] = { uint8_t(a0), uint8_t(a1) };
+		if (a0 > a1) {
+			for (int i = 1; i <= 6; i++)
+				values[i + 1] = uint8_t(((7 - i) * a0 + i * a1 + 3) / 7);
+		}
+		else {
+			for (int i = 1; i <= 4; i++)
+				values[i + 1] = uint8_t(((5 - i) * a0 + i * a1 + 2) / 5);
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		uint64_t indices = readIndices48(block);
+		for (int p = 0; p < PIXELS; p++, indices >>= 3)
+			pixels[p][channel] = values[indices & 7];
+	}
+
+	// the channels of BC4 and BC5 SNORM, -127 and -128 are both -1
+	void decodeSnormChannel(const uint8_t* block, float pixels[PIXELS][4], int channel) {
+		const float a0 = max(float(int8_t(block[0])), -127.0f) / 127.0f;
+		const float a1 = max(float(int8_t(block[1])), -127.0f) / 127.0f;
+		float values[8] = { a0, a1 };
+		if (int8_t(block[0]) > int8_t(block[1])) {
+			for (int i = 1; i <= 6; i++)
+				values[i + 1] = ((7 - i) * a0 + i * a1) / 7.0f;
+		}
+		else {
+			for (int i = 1; i <= 4; i++)
+				values[i + 1] = ((5 - i) * a0 + i * a1) / 5.0f;
+			values[6] = -1.0f;
+			values[7] = 1.0f;
+		}
+
+		uint64_t indices = readIndices48(block);
+		for (int p = 0; p < PIXELS; p++, indices >>= 3)
+			pixels[p][channel] = values[indices & 7];
+	}
+#pragma endregion bc1 to bc5
+
+#pragma region bc7
+	struct Bc7Mode
+	{
+		int subsets;
+		int partitionBits;
+		int rotationBits;
+		int indexSelectionBits;
+		int colorBits;
+		int alphaBits;
+		int endpointPbits;     // one p-bit per endpoint
+		int sharedPbits;       // one p-bit per subset
+		int indexBits;
+		int secondaryIndexBits;
+	};
+
+	const Bc7Mode BC7_MODES[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	const int* getWeights(int index_bits) {
+		return index_bits == 2 ? BC_WEIGHTS2 : index_bits == 3 ? BC_WEIGHTS3 : BC_WEIGHTS4;
+	}
+
+	// Interpolates the 1 << index_bits palette entries between two 8-bit RGBA
+	// endpoints, two entries per register with SSE2.
+	void interpolatePalette(const int e0[4], const int e1[4], int index_bits, uint8_t palette[16][4]) {
+		const int* weights = getWeights(index_bits);
+		const int count = 1 << index_bits;
+#ifdef DECODER_SSE
+		const __m128i low = _mm_setr_epi16(short(e0[0]), short(e0[1]), short(e0[2]), short(e0[3]), short(e0[0]), short(e0[1]), short(e0[2]), short(e0[3]));
+		const __m128i high = _mm_setr_epi16(short(e1[0]), short(e1[1]), short(e1[2]), short(e1[3]), short(e1[0]), short(e1[1]), short(e1[2]), short(e1[3]));
+		const __m128i rounding = _mm_set1_epi16(32);
+		for (int i = 0; i < count; i += 2) {
+			const short w0 = short(weights[i]), w1 = short(weights[i + 1]);
+			const __m128i weight = _mm_setr_epi16(w0, w0, w0, w0, w1, w1, w1, w1);
+			const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(64), weight);
+			// at most 64 * 255 + 32, fits in 16 bits
+			const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(low, inverse), _mm_mullo_epi16(high, weight)), rounding);
+			const __m128i colors = _mm_packus_epi16(_mm_srli_epi16(sum, 6), _mm_setzero_si128());
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(palette[i]), colors);
+		}
+#else
+		for (int i = 0; i < count; i++)
+			for (int c = 0; c < 4; c++)
+				palette[i][c] = uint8_t(((64 - weights[i]) * e0[c] + weights[i] * e1[c] + 32) >> 6);
+#endif
+	}
+
+	int getSubset(const Bc7Mode& mode, int partition, int pixel) {
+		if (mode.subsets == 2)
+			return BC7_PARTITIONS2[partition] >> pixel & 1;
+		if (mode.subsets == 3)
+			return BC7_PARTITIONS3[partition] >> (2 * pixel) & 3;
+		return 0;
+	}
+
+	bool isAnchor(const Bc7Mode& mode, int partition, int pixel) {
+		if (pixel == 0)
+			return true;
+		if (mode.subsets == 2)
+			return pixel == BC7_ANCHORS2[partition];
+		if (mode.subsets == 3)
+			return pixel == BC7_ANCHORS3_SECOND[partition] || pixel == BC7_ANCHORS3_THIRD[partition];
+		return false;
+	}
+
+	// endpoint of bits bits (p-bit included) expanded to 8 bits
+	int expandBits(int value, int bits) {
+		return value << (8 - bits) | value >> (2 * bits - 8);
+	}
+
+	void decodeBc7(const uint8_t* block, uint8_t pixels[PIXELS][4]) {
+		int modeIndex = 0;
+		while (modeIndex < 8 && !(block[0] >> modeIndex & 1))
+			modeIndex++;
+		// reserved mode, decodes to transparent black
+		if (modeIndex == 8) {
+			memset(pixels, 0, PIXELS * 4);
+			return;
+		}
+		const Bc7Mode& mode = BC7_MODES[modeIndex];
+
+		BitReader bits(block);
+		bits.read(modeIndex + 1);
+		const int partition = bits.read(mode.partitionBits);
+		const int rotation = bits.read(mode.rotationBits);
+		const int indexSelection = bits.read(mode.indexSelectionBits);
+
+		// subset, endpoint, channel
+		int endpoints[3][2][4];
+		for (int c = 0; c < 3; c++)
+			for (int s = 0; s < mode.subsets; s++)
+				for (int e = 0; e < 2; e++)
+					endpoints[s][e][c] = bits.read(mode.colorBits);
+		for (int s = 0; s < mode.subsets; s++)
+			for (int e = 0; e < 2; e++)
+				endpoints[s][e][3] = bits.read(mode.alphaBits);
+
+		const int channels = mode.alphaBits ? 4 : 3;
+		int colorBits = mode.colorBits, alphaBits = mode.alphaBits;
+		if (mode.endpointPbits || mode.sharedPbits) {
+			for (int s = 0; s < mode.subsets; s++) {
+				const int shared = mode.sharedPbits ? bits.read(1) : 0;
+				for (int e = 0; e < 2; e++) {
+					const int pbit = mode.sharedPbits ? shared : bits.read(1);
+					for (int c = 0; c < channels; c++)
+						endpoints[s][e][c] = endpoints[s][e][c] << 1 | pbit;
+				}
+			}
+			colorBits++;
+			if (alphaBits)
+				alphaBits++;
+		}
+		for (int s = 0; s < mode.subsets; s++) {
+			for (int e = 0; e < 2; e++) {
+				for (int c = 0; c < 3; c++)
+					endpoints[s][e][c] = expandBits(endpoints[s][e][c], colorBits);
+				endpoints[s][e][3] = alphaBits ? expandBits(endpoints[s][e][3], alphaBits) : 255;
+			}
+		}
+
+		uint8_t indices[PIXELS], secondaryIndices[PIXELS];
+		for (int p = 0; p < PIXELS; p++)
+			indices[p] = uint8_t(bits.read(mode.indexBits - (isAnchor(mode, partition, p) ? 1 : 0)));
+		for (int p = 0; mode.secondaryIndexBits && p < PIXELS; p++)
+			secondaryIndices[p] = uint8_t(bits.read(mode.secondaryIndexBits - (p == 0 ? 1 : 0)));
+
+		// modes 4 and 5 interpolate the alpha with their second set of indices,
+		// mode 4 swaps the two sets when its index selection bit is set
+		const uint8_t* colorIndices = indices;
+		const uint8_t* alphaIndices = indices;
+		int colorIndexBits = mode.indexBits, alphaIndexBits = mode.indexBits;
+		if (mode.secondaryIndexBits) {
+			alphaIndices = secondaryIndices;
+			alphaIndexBits = mode.secondaryIndexBits;
+			if (indexSelection) {
+				swap(colorIndices, alphaIndices);
+				swap(colorIndexBits, alphaIndexBits);
+			}
+		}
+
+		uint8_t palettes[3][16][4], alphaPalette[16][4];
+		for (int s = 0; s < mode.subsets; s++)
+			interpolatePalette(endpoints[s][0], endpoints[s][1], colorIndexBits, palettes[s]);
+		if (mode.secondaryIndexBits)
+			interpolatePalette(endpoints[0][0], endpoints[0][1], alphaIndexBits, alphaPalette);
+
+		for (int p = 0; p < PIXELS; p++) {
+			memcpy(pixels[p], palettes[getSubset(mode, partition, p)][colorIndices[p]], 4);
+			if (mode.secondaryIndexBits)
+				pixels[p][3] = alphaPalette[alphaIndices[p]][3];
+			if (rotation)
+				swap(pixels[p][3], pixels[p][rotation - 1]);
+		}
+	}
+#pragma endregion bc7
+
+#pragma region bc6h
+	// endpoint w and x of region 0, y and z of region 1, per channel
+	enum Bc6hField : uint8_t { RW, RX, RY, RZ, GW, GX, GY, GZ, BW, BX, BY, BZ, D };
+
+	// bits first to last (either way round) of a field, in stream order
+	struct Bc6hBits
+	{
+		uint8_t field;
+		uint8_t first;
+		uint8_t last;
+	};
+
+	struct Bc6hMode
+	{
+		uint8_t code; // 2 or 5 mode bits
+		int regions;
+		bool transformed; // endpoints after the first are deltas
+		int endpointBits;
+		int deltaBits[3];
+		Bc6hBits layout[24]; // ends at the first unused (zero) entry
+	};
+
+	const Bc6hMode BC6H_MODES[14] = {
+		{ 0x00, 2, true, 10, { 5, 5, 5 }, { { GY, 4, 4 }, { BY, 4, 4 }, { BZ, 4, 4 }, { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 4 }, { GZ, 4, 4 },
+			{ GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 },
+			{ BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x01, 2, true, 7, { 6, 6, 6 }, { { GY, 5, 5 }, { GZ, 4, 4 }, { GZ, 5, 5 }, { RW, 0, 6 }, { BZ, 0, 0 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 6 },
+			{ BY, 5, 5 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 6 }, { BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 5 },
+			{ GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 }, { D, 0, 4 } } },
+		{ 0x02, 2, true, 11, { 5, 4, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 4 }, { RW, 10, 10 }, { GY, 0, 3 }, { GX, 0, 3 }, { GW, 10, 10 },
+			{ BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 },
+			{ D, 0, 4 } } },
+		{ 0x06, 2, true, 11, { 4, 5, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 },
+			{ GW, 10, 10 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 3 }, { BZ, 0, 0 }, { BZ, 2, 2 }, { RZ, 0, 3 },
+			{ GY, 4, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x0A, 2, true, 11, { 4, 4, 5 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { BY, 4, 4 }, { GY, 0, 3 }, { GX, 0, 3 },
+			{ GW, 10, 10 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BW, 10, 10 }, { BY, 0, 3 }, { RY, 0, 3 }, { BZ, 1, 1 }, { BZ, 2, 2 }, { RZ, 0, 3 },
+			{ BZ, 4, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x0E, 2, true, 9, { 5, 5, 5 }, { { RW, 0, 8 }, { BY, 4, 4 }, { GW, 0, 8 }, { GY, 4, 4 }, { BW, 0, 8 }, { BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 },
+			{ GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 },
+			{ BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x12, 2, true, 8, { 6, 5, 5 }, { { RW, 0, 7 }, { GZ, 4, 4 }, { BY, 4, 4 }, { GW, 0, 7 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 7 }, { BZ, 3, 3 },
+			{ BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 5 },
+			{ RZ, 0, 5 }, { D, 0, 4 } } },
+		{ 0x16, 2, true, 8, { 5, 6, 5 }, { { RW, 0, 7 }, { BZ, 0, 0 }, { BY, 4, 4 }, { GW, 0, 7 }, { GY, 5, 5 }, { GY, 4, 4 }, { BW, 0, 7 }, { GZ, 5, 5 },
+			{ BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 5 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 },
+			{ BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x1A, 2, true, 8, { 5, 5, 6 }, { { RW, 0, 7 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 7 }, { BY, 5, 5 }, { GY, 4, 4 }, { BW, 0, 7 }, { BZ, 5, 5 },
+			{ BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 4 },
+			{ BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x1E, 2, false, 6, { 6, 6, 6 }, { { RW, 0, 5 }, { GZ, 4, 4 }, { BZ, 0, 0 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 5 }, { GY, 5, 5 }, { BY, 5, 5 },
+			{ BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 5 }, { GZ, 5, 5 }, { BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 5 },
+			{ GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 }, { D, 0, 4 } } },
+		{ 0x03, 1, false, 10, { 10, 10, 10 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 9 }, { GX, 0, 9 }, { BX, 0, 9 } } },
+		{ 0x07, 1, true, 11, { 9, 9, 9 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 8 }, { RW, 10, 10 }, { GX, 0, 8 }, { GW, 10, 10 },
+			{ BX, 0, 8 }, { BW, 10, 10 } } },
+		{ 0x0B, 1, true, 12, { 8, 8, 8 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 7 }, { RW, 11, 10 }, { GX, 0, 7 }, { GW, 11, 10 },
+			{ BX, 0, 7 }, { BW, 11, 10 } } },
+		{ 0x0F, 1, true, 16, { 4, 4, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 15, 10 }, { GX, 0, 3 }, { GW, 15, 10 },
+			{ BX, 0, 3 }, { BW, 15, 10 } } },
+	};
+
+	int signExtend(int value, int bits) {
+		const int sign = 1 << (bits - 1);
+		return (value & (sign - 1)) - (value & sign);
+	}
+
+	// endpoint of bits bits to the 16-bit (17 with sign) range the indices interpolate in
+	int unquantize(int value, int bits, bool is_signed) {
+		if (!is_signed) {
+			if (bits >= 15 || value == 0)
+				return value;
+			if (value == (1 << bits) - 1)
+				return 0xFFFF;
+			return ((value << 16) + 0x8000) >> bits;
+		}
+
+		if (bits >= 16)
+			return value;
+		const bool negative = value < 0;
+		value = abs(value);
+		int unquantized;
+		if (value == 0)
+			unquantized = 0;
+		else if (value >= (1 << (bits - 1)) - 1)
+			unquantized = 0x7FFF;
+		else
+			unquantized = ((value << 15) + 0x4000) >> (bits - 1);
+		return negative ? -unquantized : unquantized;
+	}
+
+	// the interpolated value scaled to the bits of a half
+	float finishUnquantize(int value, bool is_signed) {
+		if (!is_signed)
+			return halfToFloat(uint16_t((value * 31) >> 6));
+		const int magnitude = (abs(value) * 31) >> 5;
+		return halfToFloat(uint16_t((value < 0 ? 0x8000 : 0) | magnitude));
+	}
+
+	void decodeBc6h(const uint8_t* block, bool is_signed, float pixels[PIXELS][4]) {
+		BitReader bits(block);
+		int code = bits.read(2);
+		if (code > 1)
+			code |= bits.read(3) << 2;
+
+		const Bc6hMode* mode = nullptr;
+		for (const auto& candidate : BC6H_MODES) {
+			if (candidate.code == code)
+				mode = &candidate;
+		}
+		// reserved mode, decodes to black
+		if (!mode) {
+			for (int p = 0; p < PIXELS; p++) {
+				pixels[p][0] = pixels[p][1] = pixels[p][2] = 0.0f;
+				pixels[p][3] = 1.0f;
+			}
+			return;
+		}
+
+		int fields[13] = {};
+		for (const auto& run : mode->layout) {
+			if (run.field == RW && run.last == 0)
+				break;
+			const int step = run.first <= run.last ? 1 : -1;
+			for (int bit = run.first; ; bit += step) {
+				fields[run.field] |= bits.read(1) << bit;
+				if (bit == run.last)
+					break;
+			}
+		}
+		const int partition = fields[D];
+
+		// region, endpoint, channel
+		int endpoints[2][2][3];
+		const int endpointCount = mode->regions * 2;
+		for (int c = 0; c < 3; c++) {
+			const int base = fields[c * 4];
+			endpoints[0][0][c] = is_signed ? signExtend(base, mode->endpointBits) : base;
+			for (int i = 1; i < endpointCount; i++) {
+				int value = fields[c * 4 + i];
+				if (is_signed || mode->transformed)
+					value = signExtend(value, mode->deltaBits[c]);
+				if (mode->transformed) {
+					value = (base + value) & ((1 << mode->endpointBits) - 1);
+					if (is_signed)
+						value = signExtend(value, mode->endpointBits);
+				}
+				endpoints[i / 2][i % 2][c] = value;
+			}
+		}
+		for (int i = 0; i < endpointCount; i++)
+			for (int c = 0; c < 3; c++)
+				endpoints[i / 2][i % 2][c] = unquantize(endpoints[i / 2][i % 2][c], mode->endpointBits, is_signed);
+
+		const int indexBits = mode->regions == 2 ? 3 : 4;
+		const int* weights = getWeights(indexBits);
+		for (int p = 0; p < PIXELS; p++) {
+			const int region = mode->regions == 2 ? BC7_PARTITIONS2[partition] >> p & 1 : 0;
+			const bool anchor = p == 0 || (mode->regions == 2 && p == BC7_ANCHORS2[partition]);
+			const int weight = weights[bits.read(indexBits - (anchor ? 1 : 0))];
+			for (int c = 0; c < 3; c++) {
+				const int value = ((64 - weight) * endpoints[region][0][c] + weight * endpoints[region][1][c] + 32) >> 6;
+				pixels[p][c] = finishUnquantize(value, is_signed);
+			}
+			pixels[p][3] = 1.0f;
+		}
+	}
+#pragma endregion bc6h
+
+	uint8_t toUnorm8(float value) {
+		return uint8_t(min(max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	// 8-bit pixels to [0, 1] floats, 16 values (4 pixels) at a time with SSE2
+	void toFloat(const uint8_t* source, float* destination, size_t count) {
+		size_t i = 0;
+#ifdef DECODER_SSE
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+			_mm_storeu_ps(destination + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+			_mm_storeu_ps(destination + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+			_mm_storeu_ps(destination + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+		}
+#endif
+		for (; i < count; i++)
+			destination[i] = source[i] / 255.0f;
+	}
+
+	// Calls decode(x, y, pixels) for every 4x4 block of slice z, with the rows
+	// and columns that are inside the surface
+	template <typename Decode>
+	void forEachBlock(const DdsSurface& surface, uint32_t z, size_t block_size, Decode decode) {
+		const uint8_t* slice = surface.data + size_t(z) * surface.layout.slicePitch;
+		for (size_t row = 0; row < surface.layout.rowCount; row++) {
+			const uint8_t* block = slice + row * surface.layout.rowPitch;
+			for (uint32_t x = 0; x < surface.width; x += 4, block += block_size)
+				decode(x, uint32_t(row * 4), block);
+		}
+	}
+
+	void checkDecodable(DXGI_FORMAT format, const DdsSurface& surface, uint32_t z) {
+		if (!canDecode(format))
+			throw runtime_error("can't decode DXGI format " + to_string(format));
+		if (z >= surface.depth)
+			throw runtime_error("depth slice " + to_string(z) + " is outside the surface");
+	}
+}
+
+bool canDecode(DXGI_FORMAT format)
+{
+	return getBlockKind(format) != BlockKind::none;
+}
+
+void decodeBlock(DXGI_FORMAT format, const uint8_t* block, uint8_t pixels[16][4])
+{
+	switch (getBlockKind(format)) {
+	case BlockKind::bc1:
+		decodeColorBlock(block, true, pixels);
+		break;
+	case BlockKind::bc2:
+		decodeColorBlock(block + 8, false, pixels);
+		decodeExplicitAlpha(block, pixels);
+		break;
+	case BlockKind::bc3:
+		decodeColorBlock(block + 8, false, pixels);
+		decodeUnormChannel(block, pixels, 3);
+		break;
+	case BlockKind::bc4:
+	case BlockKind::bc5:
+		if (isSnorm(format)) {
+			float values[PIXELS][4];
+			decodeBlock(format, block, values);
+			for (int p = 0; p < PIXELS; p++)
+				storePixel(pixels[p], toUnorm8(values[p][0] * 0.5f + 0.5f), toUnorm8(values[p][1] * 0.5f + 0.5f), 0, 255);
+			break;
+		}
+		for (int p = 0; p < PIXELS; p++)
+			storePixel(pixels[p], 0, 0, 0, 255);
+		decodeUnormChannel(block, pixels, 0);
+		if (getBlockKind(format) == BlockKind::bc5)
+			decodeUnormChannel(block + 8, pixels, 1);
+		break;
+	case BlockKind::bc6h: {
+		float values[PIXELS][4];
+		decodeBc6h(block, format == DXGI_FORMAT_BC6H_SF16, values);
+		for (int p = 0; p < PIXELS; p++)
+			for (int c = 0; c < 4; c++)
+				pixels[p][c] = toUnorm8(values[p][c]);
+		break;
+	}
+	case BlockKind::bc7:
+		decodeBc7(block, pixels);
+		break;
+	default:
+		throw runtime_error("DXGI format " + to_string(format) + " is not block compressed");
+	}
+}
+
+void decodeBlock(DXGI_FORMAT format, const uint8_t* block, float pixels[16][4])
+{
+	const BlockKind kind = getBlockKind(format);
+	if (kind == BlockKind::bc6h) {
+		decodeBc6h(block, format == DXGI_FORMAT_BC6H_SF16, pixels);
+	}
+	else if ((kind == BlockKind::bc4 || kind == BlockKind::bc5) && isSnorm(format)) {
+		for (int p = 0; p < PIXELS; p++) {
+			pixels[p][1] = pixels[p][2] = 0.0f;
+			pixels[p][3] = 1.0f;
+		}
+		decodeSnormChannel(block, pixels, 0);
+		if (kind == BlockKind::bc5)
+			decodeSnormChannel(block + 8, pixels, 1);
+	}
+	else {
+		uint8_t values[PIXELS][4];
+		decodeBlock(format, block, values);
+		toFloat(values[0], pixels[0], PIXELS * 4);
+	}
+}
+
+void decodeSurface(DXGI_FORMAT format, const DdsSurface& surface, uint32_t z, Image& image)
+{
+	checkDecodable(format, surface, z);
+	image.width = surface.width;
+	image.height = surface.height;
+	image.pixels.resize(size_t(image.width) * image.height * 4);
+
+	const BlockKind kind = getBlockKind(format);
+	if (kind == BlockKind::rgba8 || kind == BlockKind::bgra8 || kind == BlockKind::bgrx8) {
+		const uint8_t* slice = surface.data + size_t(z) * surface.layout.slicePitch;
+		for (uint32_t y = 0; y < image.height; y++) {
+			const uint8_t* source = slice + y * surface.layout.rowPitch;
+			uint8_t* destination = image.getPixel(0, y);
+			memcpy(destination, source, size_t(image.width) * 4);
+			if (kind == BlockKind::rgba8)
+				continue;
+			for (uint32_t x = 0; x < image.width; x++, destination += 4) {
+				swap(destination[0], destination[2]);
+				if (kind == BlockKind::bgrx8)
+					destination[3] = 255;
+			}
+		}
+		return;
+	}
+
+	const size_t blockSize = kind == BlockKind::bc1 || kind == BlockKind::bc4 ? 8 : 16;
+	forEachBlock(surface, z, blockSize, [&](uint32_t x, uint32_t y, const uint8_t* block) {
+		uint8_t pixels[PIXELS][4];
+		decodeBlock(format, block, pixels);
+		// blocks of sizes that are not a multiple of 4 stick out
+		const uint32_t columns = min(4u, image.width - x), rows = min(4u, image.height - y);
+		for (uint32_t row = 0; row < rows; row++)
+			memcpy(image.getPixel(x, y + row), pixels[row * 4], columns * 4);
+	});
+}
+
+void decodeSurface(DXGI_FORMAT format, const DdsSurface& surface, uint32_t z, FloatImage& image)
+{
+	checkDecodable(format, surface, z);
+	image.width = surface.width;
+	image.height = surface.height;
+	image.pixels.resize(size_t(image.width) * image.height * 4);
+
+	const BlockKind kind = getBlockKind(format);
+	if (kind != BlockKind::bc6h && !isSnorm(format)) {
+		Image decoded;
+		decodeSurface(format, surface, z, decoded);
+		toFloat(decoded.pixels.data(), image.pixels.data(), decoded.pixels.size());
+		return;
+	}
+
+	forEachBlock(surface, z, kind == BlockKind::bc4 ? 8 : 16, [&](uint32_t x, uint32_t y, const uint8_t* block) {
+		float pixels[PIXELS][4];
+		decodeBlock(format, block, pixels);
+		const uint32_t columns = min(4u, image.width - x), rows = min(4u, image.height - y);
+		for (uint32_t row = 0; row < rows; row++)
+			memcpy(image.getPixel(x, y + row), pixels[row * 4], columns * 4 * sizeof(float));
+	});
+}
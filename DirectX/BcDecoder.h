@@ -0,0 +1,24 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "DxgiFormat.h"
+#include "Image.h"
+
+#include <cstdint>
+
+// Decodes block compressed textures (BC1 to BC7) on the cpu, so DDS files can
+// be checked and sampled where there is no gpu. Decoded values follow the
+// D3D11 block formats; sRGB formats keep their stored (not linearized) values.
+
+// BC1 to BC7 in every variant, plus the 8-bit RGBA and BGRA formats
+bool canDecode(DXGI_FORMAT format);
+
+// Decodes one 4x4 block of a block compressed format into 16 pixels, row by
+// row. BC6H is clamped to [0, 1] and SNORM mapped from [-1, 1] in the 8-bit version.
+void decodeBlock(DXGI_FORMAT format, const uint8_t* block, uint8_t pixels[16][4]);
+void decodeBlock(DXGI_FORMAT format, const uint8_t* block, float pixels[16][4]);
+
+// Decodes depth slice z of surface. Throws a runtime_error when the format
+// can't be decoded.
+void decodeSurface(DXGI_FORMAT format, const DdsSurface& surface, uint32_t z, Image& image);
+void decodeSurface(DXGI_FORMAT format, const DdsSurface& surface, uint32_t z, FloatImage& image);
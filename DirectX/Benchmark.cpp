@@ -1,23 +1,43 @@
 #include "Benchmark.h"
 
-#include <Windows.h>
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <filesystem>
+#include <fstream>
 
 //Initialise static members
+#ifdef _WIN32
 RECT Benchmark::m_textRect;
+#endif
 string Benchmark::m_renderEngine;
 float Benchmark::m_currentFPS = 0;
 long Benchmark::m_cpuUsage = 0;
+CpuUsage Benchmark::m_processCpu;
 float Benchmark::m_time = 0;
 float Benchmark::m_meanFPS = 0;
 
-Benchmark::Benchmark(int run_time, string pc_id, string render_engine, string object_path) {
+namespace {
+	// frames recorded per second of run time, the frames past it are only counted
+	const size_t MAX_RECORDED_FPS = 10000;
+	// 16 MB of frame times at most, soak runs rely on the histograms past it
+	const size_t MAX_RECORDED_FRAMES = size_t(1) << 22;
+
+	const char* PHASE_NAMES[] = { "messages", "draw", "benchmark", "present" };
+
+	int64_t toHistogramTime(float milliseconds, TimeUnit unit) {
+		return static_cast<int64_t>(milliseconds * (unit == TimeUnit::nanoseconds ? 1000000.0f : 1000.0f) + 0.5f);
+	}
+}
+
+Benchmark::Benchmark(int run_time, string pc_id, string render_engine, string object_path, bool diagnostics_window,
+	TimeUnit histogram_unit)
+	: m_frameTimes(min(size_t(max(run_time, 1)) * MAX_RECORDED_FPS, MAX_RECORDED_FRAMES)), m_histogramUnit(histogram_unit) {
 	m_runTime = run_time;
 	m_renderEngine = render_engine;
-	InitialiseWindow();
+	InitialiseWindow(diagnostics_window);
 	InitialiseFPS();
 	InitialiseCPU();
 	InitialiseTimer();
@@ -27,13 +47,23 @@ Benchmark::Benchmark(int run_time, string pc_id, string render_engine, string ob
 Benchmark::~Benchmark() {
 	//write logfile
 	m_logger->ExportLogFile();
+	//before the logger goes, it owns the frame histogram
+	ExportFrameTimes();
 	delete m_logger;
+	if (!m_lodTimings.empty())
+		ExportLodTimings();
+	if (m_hasAssetStats)
+		ExportAssetCacheStats();
+	if (Profiler::isEnabled())
+		Profiler::writeChromeTrace("data/trace-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".json");
 
 	//CPU
+#ifdef _WIN32
 	if (m_canReadCpu)
 	{
 		PdhCloseQuery(m_queryHandle);
 	}
+#endif
 	return;
 }
 
@@ -51,6 +81,15 @@ string Benchmark::GetModelName(string model_path) {
 	return model_path.substr(model_path.find_last_of('/') + 1,
 		model_path.find_last_of('.') - (model_path.find_last_of('/') + 1));
 }
+
+unsigned long Benchmark::GetTickMilliseconds() {
+#ifdef _WIN32
+	return timeGetTime();
+#else
+	return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
 #pragma endregion Benchmark
 
 
@@ -59,11 +98,18 @@ string Benchmark::GetModelName(string model_path) {
 /// Window ///
 //////////////
 
-void Benchmark::InitialiseWindow() {
-	CreateDiagWindow(200, 200);
+void Benchmark::InitialiseWindow(bool diagnostics_window) {
+#ifdef _WIN32
+	if (diagnostics_window)
+		CreateDiagWindow(200, 200);
+#else
+	(void)diagnostics_window;
+#endif
 	m_UpdateLastTime = 0;
 }
 
+#ifdef _WIN32
+
 LRESULT CALLBACK Benchmark::WinProcc(HWND hwd, UINT msg, WPARAM wparam, LPARAM lparam) {
 	switch (msg) {
 	case WM_DESTROY:
@@ -111,6 +157,7 @@ void Benchmark::UpdateText(HWND hwnd) {
 		<< "      " << 1000 / m_currentFPS << " ms cpu frametime      " << '\n'
 		<< std::setprecision(0)
 		<< "      " << m_cpuUsage << " % cpu                " << '\n'
+		<< "      " << m_processCpu.processPercent << " % cpu proces         " << '\n'
 		<< std::setprecision(2)
 		<< "      " << m_time << " tijd verstreken          " << '\n';
 
@@ -126,6 +173,7 @@ void Benchmark::UpdateText(HWND hwnd) {
 RECT* Benchmark::getTextRect() {
 	return &m_textRect;
 }
+#endif
 
 #pragma endregion window
 
@@ -144,12 +192,12 @@ void Benchmark::InitialiseFPS() {
 void Benchmark::CalculateFPS() {
 	m_FPSCount++;
 
-	if (timeGetTime() >= (m_FPSLastTime + 1000)) //1000 reffers to frames per 'second', we count how many frames are counted in 1 seconds and diplay them every second
+	if (GetTickMilliseconds() >= (m_FPSLastTime + 1000)) //1000 reffers to frames per 'second', we count how many frames are counted in 1 seconds and diplay them every second
 	{
 		m_currentFPS = m_FPSCount;
 		m_FPSCount = 0;
 
-		m_FPSLastTime = timeGetTime();
+		m_FPSLastTime = GetTickMilliseconds();
 
 		CalculateMeanFPS();
 	}
@@ -208,6 +256,7 @@ float Benchmark::GetFPS() {
 /////////////
 
 void Benchmark::InitialiseCPU() {
+#ifdef _WIN32
 	PDH_STATUS status;
 
 	// Initialize the flag indicating whether this object can read the system cpu usage or not.
@@ -226,28 +275,35 @@ void Benchmark::InitialiseCPU() {
 	{
 		m_canReadCpu = false;
 	}
+#else
+	m_canReadCpu = false;
+#endif
 
-	m_lastSampleTime = timeGetTime();
+	m_lastSampleTime = GetTickMilliseconds();
 	m_cpuUsage = 0;
 }
 
 void Benchmark::CalculateCPU() {
-	PDH_FMT_COUNTERVALUE value;
-
-	if (m_canReadCpu)
+	if (GetTickMilliseconds() >= (m_lastSampleTime + 1000))
 	{
-		if (timeGetTime() >= (m_lastSampleTime + 1000))
-		{
-			m_lastSampleTime = timeGetTime();
+		m_lastSampleTime = GetTickMilliseconds();
+
+		// this process and the main thread, whatever else runs on the machine
+		m_cpuSampler.sample(m_processCpu);
 
+#ifdef _WIN32
+		if (m_canReadCpu)
+		{
+			PDH_FMT_COUNTERVALUE value;
 			PdhCollectQueryData(m_queryHandle);
 
 			PdhGetFormattedCounterValue(m_counterHandle, PDH_FMT_LONG, NULL, &value);
 
 			m_cpuUsage = value.longValue;
 		}
+#endif
 	}
-	else
+	if (!m_canReadCpu)
 		m_cpuUsage = -1;
 
 	return;
@@ -309,6 +365,10 @@ float Benchmark::PeekTimer() const noexcept
 void Benchmark::InitialiseLogger(string pcId, string renderEngine, string objectName)
 {
 	m_logger = new Logger(pcId, renderEngine, objectName);
+	m_frameHistogram = &m_logger->AddHistogram("frame", m_histogramUnit);
+	for (size_t i = 0; i < size_t(FramePhase::count); i++)
+		m_phaseHistograms[i] = &m_logger->AddHistogram(string("phase-") + PHASE_NAMES[i], m_histogramUnit);
+	m_lastLogTime = 0;
 	m_pcId = pcId;
 	m_renderEngine = renderEngine;
 	m_objectName = objectName;
@@ -316,12 +376,123 @@ void Benchmark::InitialiseLogger(string pcId, string renderEngine, string object
 #pragma endregion logger
 
 
+#pragma region lod
+///////////
+/// lod ///
+///////////
+void Benchmark::BeginLod(int lod, int triangle_count, float error)
+{
+	const auto now = steady_clock::now();
+	if (!m_lodTimings.empty())
+		m_lodTimings.back().seconds = duration<float>(now - m_lodStart).count();
+
+	m_lodTimings.push_back({ lod, triangle_count, error, 0, 0.0f });
+	m_lodStart = now;
+}
+
+void Benchmark::ExportLodTimings()
+{
+	m_lodTimings.back().seconds = duration<float>(steady_clock::now() - m_lodStart).count();
+
+	filesystem::create_directory("data");
+	ofstream file("data/lod-data-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv");
+
+	file << "lod;triangles;error;frames;seconds;ms-per-frame;fps";
+	for (const auto& timing : m_lodTimings) {
+		if (timing.frames == 0)
+			continue;
+		file << '\n'
+			<< timing.lod << ';'
+			<< timing.triangles << ';'
+			<< timing.error << ';'
+			<< timing.frames << ';'
+			<< timing.seconds << ';'
+			<< 1000.0f * timing.seconds / timing.frames << ';'
+			<< timing.frames / timing.seconds;
+	}
+}
+#pragma endregion lod
+
+
+#pragma region assets
+//////////////
+/// assets ///
+//////////////
+void Benchmark::SetAssetCacheStats(const AssetCacheStats& stats)
+{
+	m_assetStats = stats;
+	m_hasAssetStats = true;
+}
+
+void Benchmark::ExportAssetCacheStats()
+{
+	filesystem::create_directory("data");
+	ofstream file("data/asset-cache-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv");
+
+	file << "memory-hits;disk-hits;misses;evictions;memory-bytes;entries\n"
+		<< m_assetStats.memoryHits << ';'
+		<< m_assetStats.diskHits << ';'
+		<< m_assetStats.misses << ';'
+		<< m_assetStats.evictions << ';'
+		<< m_assetStats.memoryBytes << ';'
+		<< m_assetStats.entries;
+}
+#pragma endregion assets
+
+
+#pragma region frametimes
+///////////////////
+/// frame times ///
+///////////////////
+const FrameTimeRecorder& Benchmark::GetFrameTimes() const
+{
+	return m_frameTimes;
+}
+
+FrameTimeStats Benchmark::GetFrameTimeStats() const
+{
+	FrameTimeStats stats;
+	if (m_frameTimes.getDroppedFrames() > 0 && m_frameHistogram)
+		computeFrameTimeStats(*m_frameHistogram, m_histogramUnit == TimeUnit::nanoseconds ? 0.000001 : 0.001, stats);
+	else
+		computeFrameTimeStats(m_frameTimes.getFrameTimes(), m_frameTimes.getFrameCount(), stats);
+	return stats;
+}
+
+void Benchmark::ExportFrameTimes()
+{
+	const FrameTimeStats stats = GetFrameTimeStats();
+	exportFrameTimes(stats, stats.fromHistogram ? 0 : m_frameTimes.getDroppedFrames(),
+		m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv");
+}
+
+void Benchmark::MarkPhase(FramePhase phase) noexcept
+{
+	//the first mark only starts the clock, the startup isn't a phase
+	const auto now = steady_clock::now();
+	if (m_lastPhase != steady_clock::time_point()) {
+		const int64_t elapsed = duration_cast<nanoseconds>(now - m_lastPhase).count();
+		m_phaseHistograms[size_t(phase)]->record(m_histogramUnit == TimeUnit::nanoseconds ? elapsed : elapsed / 1000);
+	}
+	m_lastPhase = now;
+}
+#pragma endregion frametimes
+
 void Benchmark::UpdateBenchmark() {
+	PROFILE_ZONE("Benchmark::UpdateBenchmark");
+	const float frameTime = m_frameTimes.markFrame();
+	if (m_frameTimes.getFrameCount() + m_frameTimes.getDroppedFrames() > 0)
+		m_frameHistogram->record(toHistogramTime(frameTime, m_histogramUnit));
 	CalculateFPS();
-	auto time = timeGetTime();
+	if (!m_lodTimings.empty())
+		m_lodTimings.back().frames++;
+	auto time = GetTickMilliseconds();
 	if (time >= (m_UpdateLastTime + 33)) //33 millisecond delay between text updates
 	{
-		InvalidateRect(getWindowHandle(), getTextRect(), true);
+#ifdef _WIN32
+		if (m_windowHandle)
+			InvalidateRect(getWindowHandle(), getTextRect(), true);
+#endif
 		UpdateTimer();
 		CalculateCPU();
 
@@ -336,7 +507,8 @@ void Benchmark::UpdateBenchmark() {
 			m_renderEngine,
 			m_objectName,
 			m_currentFPS,
-			m_cpuUsage);
+			m_cpuUsage,
+			m_processCpu);
 		m_logger->AddLog(log);
 		m_lastLogTime = time;
 	}
@@ -1,4 +1,7 @@
 #pragma once
+// the diagnostics window and the system wide cpu counter are Windows only,
+// elsewhere the benchmark runs without them (cpu -1)
+#ifdef _WIN32
 #include <Windows.h>
 
 //fps
@@ -7,29 +10,56 @@
 //cpu
 #pragma comment(lib, "pdh.lib")
 #include <pdh.h>
+#endif
+#include "CpuSampler.h"
 
 //timer
 #include <chrono>
 
 //logger
 #include "Logger.h"
+#include <vector>
+
+//assets
+#include "AssetCache.h"
+
+//frame times
+#include "FrameStats.h"
+
+//profiler
+#include "Profiler.h"
 
 using namespace std;
 
+// parts of a frame, in the order main's loop runs them
+enum class FramePhase
+{
+	messages,
+	draw,
+	benchmark,
+	present,
+	count
+};
+
 class Benchmark {
 public:
-	Benchmark(int run_time, string pc_id, string render_engine, string object_path);
+	// without diagnostics_window nothing is shown, the frame and phase
+	// histograms record in histogram_unit
+	Benchmark(int run_time, string pc_id, string render_engine, string object_path, bool diagnostics_window = true,
+		TimeUnit histogram_unit = TimeUnit::microseconds);
 	~Benchmark(); //destructor
 
 	//benchmark
 	bool run();
 
 	//window
-	void InitialiseWindow();
+	void InitialiseWindow(bool diagnostics_window);
+#ifdef _WIN32
 	static LRESULT CALLBACK WinProcc(HWND hwd, UINT msg, WPARAM wparam, LPARAM lparam);
 	static void UpdateText(HWND hwnd);
 	HWND getWindowHandle();
 	RECT* getTextRect();
+#endif
 
 	//fps
 	void InitialiseFPS();
@@ -51,6 +81,23 @@ public:
 	//logger
 	void InitialiseLogger(string pcId, string renderEngine, string objectName);
 
+	//lod
+	void BeginLod(int lod, int triangle_count, float error);
+	void ExportLodTimings();
+
+	//assets
+	void SetAssetCacheStats(const AssetCacheStats& stats);
+	void ExportAssetCacheStats();
+
+	//frame times
+	const FrameTimeRecorder& GetFrameTimes() const;
+	// the statistics of every frame of the run: from the recorded frame times,
+	// or from the frame histogram when the recorder had to drop frames
+	FrameTimeStats GetFrameTimeStats() const;
+	void ExportFrameTimes();
+	// ends a phase of the frame, its time is the time since the previous mark
+	void MarkPhase(FramePhase phase) noexcept;
+
 	void UpdateBenchmark();
 
 private:
@@ -58,11 +105,15 @@ private:
 	int m_runTime;
 	static string m_renderEngine;
 	string GetModelName(string model_path);
+	// milliseconds since the system started, timeGetTime on Windows
+	static unsigned long GetTickMilliseconds();
 
 	//window
+#ifdef _WIN32
 	void CreateDiagWindow(int width, int height);
 	static RECT m_textRect;
-	HWND m_windowHandle;
+	HWND m_windowHandle = nullptr;
+#endif
 	float m_UpdateLastTime;
 
 	//fps
@@ -76,9 +127,14 @@ private:
 
 	//cpu
 	static long m_cpuUsage;
+	//this process and the main thread, the pdh counter is the whole system
+	static CpuUsage m_processCpu;
+	CpuSampler m_cpuSampler;
 	bool m_canReadCpu;
+#ifdef _WIN32
 	PDH_HQUERY m_queryHandle;
 	PDH_HCOUNTER m_counterHandle;
+#endif
 	unsigned long m_lastSampleTime;
 
 	//timer
@@ -90,4 +146,28 @@ private:
 	string m_pcId;
 	string m_objectName;
 	float m_lastLogTime;
+
+	//lod
+	struct LodTiming
+	{
+		int lod;
+		int triangles;
+		float error;
+		int frames;
+		float seconds;
+	};
+	vector<LodTiming> m_lodTimings;
+	std::chrono::steady_clock::time_point m_lodStart;
+
+	//assets
+	bool m_hasAssetStats = false;
+	AssetCacheStats m_assetStats;
+
+	//frame times, every frame up to run time * 10000 frames (4M at most), the rest are counted as dropped
+	FrameTimeRecorder m_frameTimes;
+	//and in histograms owned by the logger, for runs of any length
+	TimeUnit m_histogramUnit;
+	HdrHistogram* m_frameHistogram = nullptr;
+	HdrHistogram* m_phaseHistograms[size_t(FramePhase::count)] = {};
+	std::chrono::steady_clock::time_point m_lastPhase;
 };
\ No newline at end of file
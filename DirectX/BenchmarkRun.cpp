@@ -0,0 +1,160 @@
+#include "BenchmarkRun.h"
+
+#include "AssetCache.h"
+#include "Benchmark.h"
+#include "Graphics.h"
+#include "NullRenderer.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+
+bool parseRunOptions(const vector<string>& args, RunOptions& options, string& error)
+{
+	// split the "--name=value" options from the positional arguments
+	vector<string> positional;
+	map<string, string> named;
+	for (const string& arg : args) {
+		if (arg.rfind("--", 0) == 0) {
+			size_t separator = arg.find('=');
+			named[arg.substr(2, separator == string::npos ? string::npos : separator - 2)] =
+				separator == string::npos ? "" : arg.substr(separator + 1);
+		}
+		else
+			positional.push_back(arg);
+	}
+
+	if (named.count("ingest") && !parseObjIngest(named["ingest"], options.objIngest)) {
+		error = "--ingest must be stream, buffered or mapped";
+		return false;
+	}
+	if (named.count("vertex-format") && !parseVertexFormat(named["vertex-format"], options.vertexFormat)) {
+		error = "--vertex-format must be float32, unorm16_half or unorm16";
+		return false;
+	}
+	try {
+		if (named.count("texture-max-size"))
+			options.textureOptions.maxSize = stoul(named["texture-max-size"]);
+		if (named.count("texture-budget"))
+			options.textureOptions.memoryBudget = stoull(named["texture-budget"]) << 20;
+	}
+	catch (const exception&) {
+		error = "--texture-max-size (texels) and --texture-budget (MB) must be numbers";
+		return false;
+	}
+	options.clusterCulling = named.count("cluster-cull") > 0;
+	options.lodBench = named.count("lod-bench") > 0;
+	options.profile = named.count("profile") > 0;
+	options.headless = named.count("headless") > 0;
+	if (options.headless)
+		options.texturePath = HEADLESS_TEXTURE_PATH;
+
+	// no arguments runs the viking room for 20 seconds
+	if (positional.empty())
+		return true;
+	if (positional.size() != 4) {
+		error = "Please specifiy at least 4 arguments \n\nExample: ./directx.exe ManfredsPc 20 models\\object.obj textures\\texture.jpg \n\nFirst arg: refference name \nSecond arg: benchmark run time \nThird arg: path of the model \nFourth arg: path of the texture";
+		return false;
+	}
+	options.pcId = positional[0];
+	try {
+		options.runTime = stoi(positional[1]);
+	}
+	catch (const exception&) {
+		error = "the benchmark run time must be a number of seconds";
+		return false;
+	}
+	options.modelPath = positional[2];
+	options.texturePath = positional[3];
+	return true;
+}
+
+FrameTimeStats runBenchmark(RenderDevice& device, const RunOptions& options, const string& render_engine,
+	const function<bool()>& pump_messages)
+{
+	if (options.profile) {
+		Profiler::setEnabled(true);
+		Profiler::setThreadName("main");
+	}
+
+	// processed meshes and decoded textures, shared by every run that loads the same files
+	AssetCache assets;
+	Graphics graphics(device, options.modelPath, options.texturePath, options.objIngest, options.vertexFormat, &assets,
+		options.textureOptions);
+	graphics.setClusterCulling(options.clusterCulling);
+	// a frame without a gpu to wait for takes microseconds, nanoseconds keep it apart
+	Benchmark benchmark(options.runTime, options.pcId, render_engine, options.modelPath, !options.headless,
+		options.headless ? TimeUnit::nanoseconds : TimeUnit::microseconds);
+
+	const auto& lods = graphics.getLods();
+	int benchLod = -1;
+
+	// Main message loop:
+	while (benchmark.run())
+	{
+		PROFILE_ZONE("frame");
+		if (!pump_messages())
+			break;
+
+		if (options.lodBench) {
+			const int lod = (int)min(lods.size() - 1, (size_t)(benchmark.PeekTimer() * lods.size() / options.runTime));
+			if (lod != benchLod) {
+				benchLod = lod;
+				graphics.setLod(lod);
+				benchmark.BeginLod(lod, (int)(lods[lod].indexCount / 3), lods[lod].error);
+			}
+		}
+		benchmark.MarkPhase(FramePhase::messages);
+
+		const float c = sin(benchmark.PeekTimer()) / 2.0f + 0.5f;
+		device.beginFrame(c, c, c);
+
+		graphics.draw(-benchmark.PeekTimer(), 0.0f, 1.0f);
+		benchmark.MarkPhase(FramePhase::draw);
+
+		benchmark.UpdateBenchmark();
+		benchmark.MarkPhase(FramePhase::benchmark);
+
+		device.endFrame();
+		benchmark.MarkPhase(FramePhase::present);
+	}
+
+	benchmark.SetAssetCacheStats(assets.getStats());
+	return benchmark.GetFrameTimeStats();
+}
+
+int runHeadlessBenchmark(const RunOptions& options)
+{
+	try {
+		NullRenderer renderer;
+		RunOptions headless = options;
+		headless.headless = true;
+		const FrameTimeStats stats = runBenchmark(renderer, headless, "null", [] { return true; });
+
+		const string model = options.modelPath.substr(options.modelPath.find_last_of('/') + 1,
+			options.modelPath.find_last_of('.') - (options.modelPath.find_last_of('/') + 1));
+		renderer.exportStats("data/null-calls-" + options.pcId + "-null-" + model + ".csv");
+
+		const NullRenderStats& calls = renderer.getStats();
+		cout << options.modelPath << ": " << calls.frames << " frames in " << options.runTime << " s" << endl
+			<< fixed << setprecision(4)
+			<< "  mean " << stats.meanMs << " ms, p50 " << stats.p50Ms << " ms, p99 " << stats.p99Ms
+			<< " ms, p99.9 " << stats.p999Ms << " ms"
+			<< (stats.fromHistogram ? " (every frame, from the frame histogram)" : "") << endl
+			<< setprecision(0)
+			<< "  " << (calls.frames ? calls.indices / calls.frames : 0) << " indices and "
+			<< (calls.frames ? calls.mappedBytes / calls.frames : 0) << " mapped bytes per frame, "
+			<< calls.textureLevels << " texture levels uploaded" << endl;
+		return EXIT_SUCCESS;
+	}
+	catch (const exception& e) {
+		cerr << "headless run failed: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "FrameStats.h"
+#include "MeshLoader.h"
+#include "RenderDevice.h"
+#include "VertexFormat.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// A benchmark run as the command line describes it, shared by the Windows
+// main and the portable headless one:
+//   [name runtime model texture] [--ingest=stream|buffered|mapped]
+//   [--vertex-format=float32|unorm16_half|unorm16] [--texture-max-size=texels]
+//   [--texture-budget=MB] [--cluster-cull] [--lod-bench] [--profile] [--headless]
+struct RunOptions
+{
+	std::string pcId = "pcName";
+	int runTime = 20;
+	std::string modelPath = "models/viking_room.obj";
+	// headless runs default to HEADLESS_TEXTURE_PATH instead
+	std::string texturePath = "textures/viking_room.png";
+	ObjIngest objIngest = ObjIngest::mapped;
+	VertexFormat vertexFormat = VertexFormat::float32;
+	// low memory runs: skip the top mips of a .dds or .ktx2 texture, they are never read from the file
+	DdsReadOptions textureOptions;
+	bool clusterCulling = false;
+	// spreads the run time evenly over the levels of detail and logs the frame times of each
+	bool lodBench = false;
+	// records the zones of the load and of every frame, written to data/trace-<pc>-<engine>-<model>.json
+	bool profile = false;
+	// no window and no gpu, see runHeadlessBenchmark
+	bool headless = false;
+};
+
+// viking_room.png through ./directx.exe --compress-textures textures bc1, for
+// headless runs: images are decoded with WIC, .dds files on any platform
+const char* const HEADLESS_TEXTURE_PATH = "textures/viking_room.bc1.dds";
+
+// Parses the arguments after the program name into options. Returns false
+// with what is wrong in error.
+bool parseRunOptions(const std::vector<std::string>& args, RunOptions& options, std::string& error);
+
+// Loads the model and the texture onto device and runs the frame loop for
+// options.runTime seconds: messages, draw, benchmark update, present.
+// pump_messages starts every frame and ends the run by returning false.
+// Benchmark writes the logs and statistics with render_engine as the engine;
+// headless runs get no diagnostics window and histograms in nanoseconds.
+// Returns the statistics of the frame times.
+FrameTimeStats runBenchmark(RenderDevice& device, const RunOptions& options, const std::string& render_engine,
+	const std::function<bool()>& pump_messages);
+
+// runBenchmark on a NullRenderer with "null" as the engine: the cpu side of
+// every frame without a window or a gpu, on any platform. Writes the calls per
+// frame to data/null-calls-<pc>-null-<model>.csv and prints a summary.
+// Returns EXIT_SUCCESS or EXIT_FAILURE after printing why.
+int runHeadlessBenchmark(const RunOptions& options);
@@ -0,0 +1,158 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BOUNDS_SSE
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	// floats per vertex, the position is the first three
+	const size_t STRIDE = sizeof(Vertex) / sizeof(float);
+	// the centroid sums are moved into doubles every block so big meshes don't drift
+	const size_t SUM_BLOCK = 4096;
+
+#ifdef BOUNDS_SSE
+	// x, y and z of four vertices, one vertex per lane
+	inline void loadPositions(const float* p, __m128& x, __m128& y, __m128& z) {
+		__m128 a = _mm_loadu_ps(p);
+		__m128 b = _mm_loadu_ps(p + STRIDE);
+		__m128 c = _mm_loadu_ps(p + 2 * STRIDE);
+		__m128 d = _mm_loadu_ps(p + 3 * STRIDE);
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		x = a;
+		y = b;
+		z = c;
+	}
+
+	inline float horizontalMax(__m128 v) {
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+#endif
+}
+
+void computeBounds(const vector<Vertex>& vertices, MeshBounds& bounds)
+{
+	bounds = MeshBounds();
+	const size_t count = vertices.size();
+	if (count == 0)
+		return;
+
+	// every load reads x, y, z and u of one vertex, the u lane is ignored
+	const float* data = &vertices[0].pos.x;
+	float boxMin[4], boxMax[4];
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	size_t i = 0;
+
+#ifdef BOUNDS_SSE
+	__m128 vmin = _mm_loadu_ps(data);
+	__m128 vmax = vmin;
+#ifdef __AVX__
+	// two vertices per register
+	__m256 wmin = _mm256_insertf128_ps(_mm256_castps128_ps256(vmin), vmin, 1);
+	__m256 wmax = wmin;
+#endif
+	for (size_t block = 0; block < count; block += SUM_BLOCK) {
+		const size_t end = min(count, block + SUM_BLOCK);
+		__m128 vsum = _mm_setzero_ps();
+#ifdef __AVX__
+		__m256 wsum = _mm256_setzero_ps();
+		for (; i + 1 < end; i += 2) {
+			const __m256 p = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data + i * STRIDE)),
+				_mm_loadu_ps(data + (i + 1) * STRIDE), 1);
+			wmin = _mm256_min_ps(wmin, p);
+			wmax = _mm256_max_ps(wmax, p);
+			wsum = _mm256_add_ps(wsum, p);
+		}
+		vsum = _mm_add_ps(_mm256_castps256_ps128(wsum), _mm256_extractf128_ps(wsum, 1));
+#endif
+		for (; i < end; i++) {
+			const __m128 p = _mm_loadu_ps(data + i * STRIDE);
+			vmin = _mm_min_ps(vmin, p);
+			vmax = _mm_max_ps(vmax, p);
+			vsum = _mm_add_ps(vsum, p);
+		}
+
+		float blockSum[4];
+		_mm_storeu_ps(blockSum, vsum);
+		for (int axis = 0; axis < 3; axis++)
+			sum[axis] += blockSum[axis];
+	}
+#ifdef __AVX__
+	vmin = _mm_min_ps(vmin, _mm_min_ps(_mm256_castps256_ps128(wmin), _mm256_extractf128_ps(wmin, 1)));
+	vmax = _mm_max_ps(vmax, _mm_max_ps(_mm256_castps256_ps128(wmax), _mm256_extractf128_ps(wmax, 1)));
+#endif
+	_mm_storeu_ps(boxMin, vmin);
+	_mm_storeu_ps(boxMax, vmax);
+#else
+	for (int axis = 0; axis < 3; axis++)
+		boxMin[axis] = boxMax[axis] = data[axis];
+	for (size_t block = 0; block < count; block += SUM_BLOCK) {
+		const size_t end = min(count, block + SUM_BLOCK);
+		float blockSum[3] = { 0.0f, 0.0f, 0.0f };
+		for (i = block; i < end; i++) {
+			for (int axis = 0; axis < 3; axis++) {
+				const float p = data[i * STRIDE + axis];
+				boxMin[axis] = min(boxMin[axis], p);
+				boxMax[axis] = max(boxMax[axis], p);
+				blockSum[axis] += p;
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+			sum[axis] += blockSum[axis];
+	}
+#endif
+
+	for (int axis = 0; axis < 3; axis++) {
+		bounds.min[axis] = boxMin[axis];
+		bounds.max[axis] = boxMax[axis];
+		bounds.center[axis] = (boxMin[axis] + boxMax[axis]) * 0.5f;
+		bounds.centroid[axis] = static_cast<float>(sum[axis] / count);
+	}
+
+	// farthest vertex from the box center
+	const float* c = bounds.center;
+	float radius = 0.0f;
+	i = 0;
+#ifdef BOUNDS_SSE
+	const __m128 cx = _mm_set1_ps(c[0]), cy = _mm_set1_ps(c[1]), cz = _mm_set1_ps(c[2]);
+	__m128 vradius = _mm_setzero_ps();
+#ifdef __AVX__
+	const __m256 wcx = _mm256_set1_ps(c[0]), wcy = _mm256_set1_ps(c[1]), wcz = _mm256_set1_ps(c[2]);
+	__m256 wradius = _mm256_setzero_ps();
+	for (; i + 8 <= count; i += 8) {
+		__m128 x0, y0, z0, x1, y1, z1;
+		loadPositions(data + i * STRIDE, x0, y0, z0);
+		loadPositions(data + (i + 4) * STRIDE, x1, y1, z1);
+		const __m256 dx = _mm256_sub_ps(_mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1), wcx);
+		const __m256 dy = _mm256_sub_ps(_mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1), wcy);
+		const __m256 dz = _mm256_sub_ps(_mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1), wcz);
+		const __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		wradius = _mm256_max_ps(wradius, d2);
+	}
+	vradius = _mm_max_ps(_mm256_castps256_ps128(wradius), _mm256_extractf128_ps(wradius, 1));
+#endif
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		loadPositions(data + i * STRIDE, x, y, z);
+		const __m128 dx = _mm_sub_ps(x, cx);
+		const __m128 dy = _mm_sub_ps(y, cy);
+		const __m128 dz = _mm_sub_ps(z, cz);
+		const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		vradius = _mm_max_ps(vradius, d2);
+	}
+	radius = horizontalMax(vradius);
+#endif
+	for (; i < count; i++) {
+		const float* p = data + i * STRIDE;
+		const float dx = p[0] - c[0], dy = p[1] - c[1], dz = p[2] - c[2];
+		radius = max(radius, dx * dx + dy * dy + dz * dz);
+	}
+	bounds.radius = sqrtf(radius);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+// Box, bounding sphere and centroid of a vertex array in float, with SSE
+// (and AVX when the build enables it). One sweep over the vertices gives the
+// box and the centroid, a second one the sphere radius around the box center.
+// Empty arrays get empty bounds at the origin.
+void computeBounds(const std::vector<Vertex>& vertices, MeshBounds& bounds);
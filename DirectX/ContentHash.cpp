@@ -0,0 +1,79 @@
+#include "ContentHash.h"
+
+#include <cstring>
+
+namespace {
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+	const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+	uint64_t rotateLeft(uint64_t value, int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// little endian like every target of the project
+	uint64_t read64(const uint8_t* data) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint32_t read32(const uint8_t* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint64_t round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * PRIME2;
+		return rotateLeft(accumulator, 31) * PRIME1;
+	}
+
+	uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+		hash ^= round(0, accumulator);
+		return hash * PRIME1 + PRIME4;
+	}
+}
+
+uint64_t hashContent(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* cursor = static_cast<const uint8_t*>(data);
+	const uint8_t* end = cursor + size;
+	uint64_t hash;
+
+	// four independent lanes over 32 byte stripes
+	if (size >= 32) {
+		uint64_t lanes[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+		for (; cursor + 32 <= end; cursor += 32) {
+			lanes[0] = round(lanes[0], read64(cursor));
+			lanes[1] = round(lanes[1], read64(cursor + 8));
+			lanes[2] = round(lanes[2], read64(cursor + 16));
+			lanes[3] = round(lanes[3], read64(cursor + 24));
+		}
+		hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+		for (uint64_t lane : lanes)
+			hash = mergeRound(hash, lane);
+	}
+	else {
+		hash = seed + PRIME5;
+	}
+	hash += size;
+
+	for (; cursor + 8 <= end; cursor += 8)
+		hash = rotateLeft(hash ^ round(0, read64(cursor)), 27) * PRIME1 + PRIME4;
+	if (cursor + 4 <= end) {
+		hash = rotateLeft(hash ^ (read32(cursor) * PRIME1), 23) * PRIME2 + PRIME3;
+		cursor += 4;
+	}
+	for (; cursor < end; cursor++)
+		hash = rotateLeft(hash ^ (*cursor * PRIME5), 11) * PRIME1;
+
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
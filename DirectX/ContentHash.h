@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 of size bytes, the same value the reference xxHash gives, so the
+// keys of cached assets can be compared with other tools.
+uint64_t hashContent(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,151 @@
+#include "CpuSampler.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+#ifdef _WIN32
+	// FILETIME durations count 100 ns
+	double toSeconds(const FILETIME& time) {
+		return ((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+	}
+#else
+	double toSeconds(const timeval& time) {
+		return time.tv_sec + time.tv_usec * 1e-6;
+	}
+
+	// minflt, majflt and rss of /proc/self/stat, the fields after the name in parentheses
+	bool readProcStat(int64_t& minor_faults, int64_t& major_faults, int64_t& resident_pages) {
+		FILE* file = fopen("/proc/self/stat", "r");
+		if (!file)
+			return false;
+		char line[1024];
+		const bool read = fgets(line, sizeof(line), file) != nullptr;
+		fclose(file);
+		if (!read)
+			return false;
+
+		// the name may hold spaces and parentheses of its own, field 3 follows the last ')'
+		char* fields = strrchr(line, ')');
+		if (!fields)
+			return false;
+		long long values[25] = {};
+		int field = 3;
+		char* position = nullptr;
+		for (char* token = strtok_r(fields + 1, " ", &position); token && field < 25; token = strtok_r(nullptr, " ", &position))
+			values[field++] = strtoll(token, nullptr, 10);
+		if (field < 25)
+			return false;
+		minor_faults = values[10];
+		major_faults = values[12];
+		resident_pages = values[24];
+		return true;
+	}
+#endif
+
+	int64_t difference(int64_t now, int64_t before) {
+		return now < 0 || before < 0 ? -1 : now - before;
+	}
+}
+
+bool readCpuTimes(CpuTimes& times)
+{
+	times = CpuTimes();
+#ifdef _WIN32
+	FILETIME creation, exited, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel, &user))
+		return false;
+	times.processUserSeconds = toSeconds(user);
+	times.processSystemSeconds = toSeconds(kernel);
+	if (GetThreadTimes(GetCurrentThread(), &creation, &exited, &kernel, &user)) {
+		times.threadUserSeconds = toSeconds(user);
+		times.threadSystemSeconds = toSeconds(kernel);
+	}
+
+	// windows counts soft and hard faults together and has no context switch count per process
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		times.pageFaults = counters.PageFaultCount;
+		times.residentBytes = counters.WorkingSetSize;
+	}
+	return true;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return false;
+	times.processUserSeconds = toSeconds(usage.ru_utime);
+	times.processSystemSeconds = toSeconds(usage.ru_stime);
+	times.voluntarySwitches = usage.ru_nvcsw;
+	times.involuntarySwitches = usage.ru_nivcsw;
+	times.pageFaults = usage.ru_minflt + usage.ru_majflt;
+	times.majorFaults = usage.ru_majflt;
+#ifdef RUSAGE_THREAD
+	if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+		times.threadUserSeconds = toSeconds(usage.ru_utime);
+		times.threadSystemSeconds = toSeconds(usage.ru_stime);
+	}
+#endif
+
+	// getrusage has no current resident size, /proc has it with the faults
+	int64_t minorFaults, majorFaults, residentPages;
+	if (readProcStat(minorFaults, majorFaults, residentPages)) {
+		times.pageFaults = minorFaults + majorFaults;
+		times.majorFaults = majorFaults;
+		times.residentBytes = residentPages * sysconf(_SC_PAGESIZE);
+	}
+	return true;
+#endif
+}
+
+CpuSampler::CpuSampler()
+	: m_cores(max(1u, thread::hardware_concurrency()))
+{
+	m_available = readCpuTimes(m_last);
+	m_lastTime = steady_clock::now();
+}
+
+bool CpuSampler::sample(CpuUsage& usage)
+{
+	CpuTimes times;
+	if (!m_available || !readCpuTimes(times))
+		return false;
+	const auto now = steady_clock::now();
+	const double seconds = duration<double>(now - m_lastTime).count();
+
+	usage = CpuUsage();
+	usage.seconds = seconds;
+	if (seconds > 0) {
+		const double user = times.processUserSeconds - m_last.processUserSeconds;
+		const double system = times.processSystemSeconds - m_last.processSystemSeconds;
+		const double threadTime = times.threadUserSeconds - m_last.threadUserSeconds + times.threadSystemSeconds - m_last.threadSystemSeconds;
+		usage.userPercent = static_cast<float>(100.0 * user / seconds);
+		usage.systemPercent = static_cast<float>(100.0 * system / seconds);
+		usage.processPercent = usage.userPercent + usage.systemPercent;
+		usage.machinePercent = usage.processPercent / m_cores;
+		usage.threadPercent = static_cast<float>(100.0 * threadTime / seconds);
+	}
+	usage.voluntarySwitches = difference(times.voluntarySwitches, m_last.voluntarySwitches);
+	usage.involuntarySwitches = difference(times.involuntarySwitches, m_last.involuntarySwitches);
+	usage.pageFaults = difference(times.pageFaults, m_last.pageFaults);
+	usage.majorFaults = difference(times.majorFaults, m_last.majorFaults);
+	usage.residentBytes = times.residentBytes;
+
+	m_last = times;
+	m_lastTime = now;
+	return true;
+}
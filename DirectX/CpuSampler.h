@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Cpu time of this process and of one of its threads, unlike the system wide
+// "% processor time" counter other processes don't show up in it. From
+// GetProcessTimes and GetThreadTimes on Windows, getrusage and
+// /proc/self/stat on Linux. Counters a platform doesn't have are -1.
+
+// cumulative counters since the process or the thread started
+struct CpuTimes
+{
+	double processUserSeconds = 0.0;
+	double processSystemSeconds = 0.0;
+	double threadUserSeconds = 0.0;
+	double threadSystemSeconds = 0.0;
+	int64_t voluntarySwitches = -1;
+	int64_t involuntarySwitches = -1;
+	int64_t pageFaults = -1;
+	// the faults that had to read from disk
+	int64_t majorFaults = -1;
+	int64_t residentBytes = -1;
+};
+
+// Reads the counters of the process and of the calling thread, false when
+// the platform has neither.
+bool readCpuTimes(CpuTimes& times);
+
+// the counters over the interval between two samples
+struct CpuUsage
+{
+	double seconds = 0.0;
+	// 100% is one core busy the whole interval
+	float processPercent = 0.0f;
+	float userPercent = 0.0f;
+	float systemPercent = 0.0f;
+	// process time over the time of every core, comparable with the system counter
+	float machinePercent = 0.0f;
+	// the thread the sampler was created on
+	float threadPercent = 0.0f;
+	int64_t voluntarySwitches = -1;
+	int64_t involuntarySwitches = -1;
+	int64_t pageFaults = -1;
+	int64_t majorFaults = -1;
+	// at the end of the interval
+	int64_t residentBytes = -1;
+};
+
+// Samples the cpu use of the process and of the thread it is created on.
+// Call sample from that thread, the first interval starts at construction.
+class CpuSampler {
+public:
+	CpuSampler();
+
+	bool isAvailable() const { return m_available; }
+	// usage since the previous sample, false (and usage untouched) when unavailable
+	bool sample(CpuUsage& usage);
+
+private:
+	bool m_available;
+	unsigned int m_cores;
+	CpuTimes m_last;
+	std::chrono::steady_clock::time_point m_lastTime;
+};
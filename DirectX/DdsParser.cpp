@@ -0,0 +1,710 @@
+#include "DdsParser.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	// Direct3D 11 resource limits, larger headers are rejected like DDSTextureLoader does
+	const uint32_t MAX_MIP_LEVELS = 15;
+	const uint32_t MAX_ARRAY_SIZE_1D = 2048;
+	const uint32_t MAX_SIZE_1D = 16384;
+	const uint32_t MAX_ARRAY_SIZE_2D = 2048;
+	const uint32_t MAX_SIZE_2D = 16384;
+	const uint32_t MAX_SIZE_CUBE = 16384;
+	const uint32_t MAX_SIZE_3D = 2048;
+
+	// values of D3D11_RESOURCE_DIMENSION in the DX10 header
+	const uint32_t RESOURCE_DIMENSION_TEXTURE1D = 2;
+	const uint32_t RESOURCE_DIMENSION_TEXTURE2D = 3;
+	const uint32_t RESOURCE_DIMENSION_TEXTURE3D = 4;
+
+	uint32_t countMips(uint32_t width, uint32_t height, uint32_t depth) {
+		uint32_t count = 1;
+		while (width > 1 || height > 1 || depth > 1) {
+			width = max(width / 2, 1u);
+			height = max(height / 2, 1u);
+			depth = max(depth / 2, 1u);
+			count++;
+		}
+		return count;
+	}
+
+	DDS_ALPHA_MODE getAlphaMode(const DDS_HEADER& header, const DDS_HEADER_DXT10* extension) {
+		if (extension) {
+			const uint32_t mode = extension->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK;
+			if (mode >= DDS_ALPHA_MODE_STRAIGHT && mode <= DDS_ALPHA_MODE_CUSTOM)
+				return static_cast<DDS_ALPHA_MODE>(mode);
+		}
+		else if ((header.ddspf.flags & DDS_FOURCC) &&
+			(header.ddspf.fourCC == MAKEFOURCC('D', 'X', 'T', '2') || header.ddspf.fourCC == MAKEFOURCC('D', 'X', 'T', '4'))) {
+			return DDS_ALPHA_MODE_PREMULTIPLIED;
+		}
+		return DDS_ALPHA_MODE_UNKNOWN;
+	}
+}
+
+size_t getBitsPerPixel(DXGI_FORMAT format)
+{
+	switch (format) {
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+	case DXGI_FORMAT_YUY2:
+		return 32;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+	case DXGI_FORMAT_V408:
+		return 24;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_A8P8:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+	case DXGI_FORMAT_P208:
+	case DXGI_FORMAT_V208:
+		return 16;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+	case DXGI_FORMAT_NV11:
+		return 12;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return 8;
+
+	case DXGI_FORMAT_R1_UNORM:
+		return 1;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
+
+bool isBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+bool getSurfaceLayout(size_t width, size_t height, DXGI_FORMAT format, DdsSurfaceLayout& layout)
+{
+	uint64_t rowBytes = 0;
+	uint64_t rowCount = 0;
+	uint64_t sliceBytes = 0;
+
+	// bytes per 4x4 block, per pair of pixels or per chroma sample
+	uint64_t bytesPerElement = 0;
+	bool packed = false;
+	bool planar = false;
+	if (isBlockCompressed(format)) {
+		bytesPerElement = getBitsPerPixel(format) * 2;
+	}
+	else {
+		switch (format) {
+		case DXGI_FORMAT_R8G8_B8G8_UNORM:
+		case DXGI_FORMAT_G8R8_G8B8_UNORM:
+		case DXGI_FORMAT_YUY2:
+			packed = true;
+			bytesPerElement = 4;
+			break;
+		case DXGI_FORMAT_Y210:
+		case DXGI_FORMAT_Y216:
+			packed = true;
+			bytesPerElement = 8;
+			break;
+		case DXGI_FORMAT_NV12:
+		case DXGI_FORMAT_420_OPAQUE:
+		case DXGI_FORMAT_P208:
+			planar = true;
+			bytesPerElement = 2;
+			break;
+		case DXGI_FORMAT_P010:
+		case DXGI_FORMAT_P016:
+			planar = true;
+			bytesPerElement = 4;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (isBlockCompressed(format)) {
+		const uint64_t blocksWide = width > 0 ? max<uint64_t>(1, (uint64_t(width) + 3) / 4) : 0;
+		const uint64_t blocksHigh = height > 0 ? max<uint64_t>(1, (uint64_t(height) + 3) / 4) : 0;
+		rowBytes = blocksWide * bytesPerElement;
+		rowCount = blocksHigh;
+		sliceBytes = rowBytes * blocksHigh;
+	}
+	else if (packed) {
+		rowBytes = ((uint64_t(width) + 1) >> 1) * bytesPerElement;
+		rowCount = height;
+		sliceBytes = rowBytes * height;
+	}
+	else if (format == DXGI_FORMAT_NV11) {
+		// Direct3D assumes twice the rows, more than the 4:1:1 data needs
+		rowBytes = ((uint64_t(width) + 3) >> 2) * 4;
+		rowCount = uint64_t(height) * 2;
+		sliceBytes = rowBytes * rowCount;
+	}
+	else if (planar) {
+		rowBytes = ((uint64_t(width) + 1) >> 1) * bytesPerElement;
+		sliceBytes = rowBytes * height + ((rowBytes * height + 1) >> 1);
+		rowCount = height + ((uint64_t(height) + 1) >> 1);
+	}
+	else {
+		const size_t bitsPerPixel = getBitsPerPixel(format);
+		if (bitsPerPixel == 0)
+			return false;
+		rowBytes = (uint64_t(width) * bitsPerPixel + 7) / 8;
+		rowCount = height;
+		sliceBytes = rowBytes * height;
+	}
+
+	// Direct3D 11 takes 32-bit pitches
+	if (sliceBytes > UINT32_MAX || rowBytes > UINT32_MAX || rowCount > UINT32_MAX)
+		return false;
+
+	layout.rowPitch = static_cast<size_t>(rowBytes);
+	layout.rowCount = static_cast<size_t>(rowCount);
+	layout.slicePitch = static_cast<size_t>(sliceBytes);
+	return true;
+}
+
+DXGI_FORMAT getDxgiFormat(const DDS_PIXELFORMAT& pixel_format)
+{
+	const DDS_PIXELFORMAT& pf = pixel_format;
+	auto isMask = [&](uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+		return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+	};
+
+	if (pf.flags & DDS_RGB) {
+		// sRGB formats are only written with the DX10 header
+		switch (pf.RGBBitCount) {
+		case 32:
+			if (isMask(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) return DXGI_FORMAT_R8G8B8A8_UNORM;
+			if (isMask(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)) return DXGI_FORMAT_B8G8R8A8_UNORM;
+			if (isMask(0x00ff0000, 0x0000ff00, 0x000000ff, 0)) return DXGI_FORMAT_B8G8R8X8_UNORM;
+			// D3DX writes 10:10:10:2 with the red and blue masks swapped
+			if (isMask(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000)) return DXGI_FORMAT_R10G10B10A2_UNORM;
+			if (isMask(0x0000ffff, 0xffff0000, 0, 0)) return DXGI_FORMAT_R16G16_UNORM;
+			// the only 32-bit single channel format of D3D9 was R32F
+			if (isMask(0xffffffff, 0, 0, 0)) return DXGI_FORMAT_R32_FLOAT;
+			break;
+		case 16:
+			if (isMask(0x7c00, 0x03e0, 0x001f, 0x8000)) return DXGI_FORMAT_B5G5R5A1_UNORM;
+			if (isMask(0xf800, 0x07e0, 0x001f, 0)) return DXGI_FORMAT_B5G6R5_UNORM;
+			if (isMask(0x0f00, 0x00f0, 0x000f, 0xf000)) return DXGI_FORMAT_B4G4R4A4_UNORM;
+			// the X1R5G5B5, X4R4G4B4, 3:3:2 and palette formats have no DXGI format
+			break;
+		default:
+			break;
+		}
+	}
+	else if (pf.flags & DDS_LUMINANCE) {
+		if (pf.RGBBitCount == 16) {
+			if (isMask(0xffff, 0, 0, 0)) return DXGI_FORMAT_R16_UNORM;
+			if (isMask(0x00ff, 0, 0, 0xff00)) return DXGI_FORMAT_R8G8_UNORM;
+		}
+		if (pf.RGBBitCount == 8) {
+			if (isMask(0xff, 0, 0, 0)) return DXGI_FORMAT_R8_UNORM;
+			// some writers set the bit count to 8 for 8:8 luminance + alpha
+			if (isMask(0x00ff, 0, 0, 0xff00)) return DXGI_FORMAT_R8G8_UNORM;
+		}
+	}
+	else if (pf.flags & DDS_ALPHA) {
+		if (pf.RGBBitCount == 8)
+			return DXGI_FORMAT_A8_UNORM;
+	}
+	else if (pf.flags & DDS_BUMPDUDV) {
+		if (pf.RGBBitCount == 16 && isMask(0x00ff, 0xff00, 0, 0)) return DXGI_FORMAT_R8G8_SNORM;
+		if (pf.RGBBitCount == 32) {
+			if (isMask(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) return DXGI_FORMAT_R8G8B8A8_SNORM;
+			if (isMask(0x0000ffff, 0xffff0000, 0, 0)) return DXGI_FORMAT_R16G16_SNORM;
+		}
+	}
+	else if (pf.flags & DDS_FOURCC) {
+		switch (pf.fourCC) {
+		// DXT2 and DXT4 are the premultiplied alpha versions, the data is the same
+		case MAKEFOURCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+		case MAKEFOURCC('D', 'X', 'T', '2'):
+		case MAKEFOURCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+		case MAKEFOURCC('D', 'X', 'T', '4'):
+		case MAKEFOURCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+		case MAKEFOURCC('A', 'T', 'I', '1'):
+		case MAKEFOURCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+		case MAKEFOURCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+		case MAKEFOURCC('A', 'T', 'I', '2'):
+		case MAKEFOURCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+		case MAKEFOURCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+		case MAKEFOURCC('R', 'G', 'B', 'G'): return DXGI_FORMAT_R8G8_B8G8_UNORM;
+		case MAKEFOURCC('G', 'R', 'G', 'B'): return DXGI_FORMAT_G8R8_G8B8_UNORM;
+		case MAKEFOURCC('Y', 'U', 'Y', '2'): return DXGI_FORMAT_YUY2;
+		// D3DFORMAT values stored as the fourcc
+		case 36: return DXGI_FORMAT_R16G16B16A16_UNORM;  // D3DFMT_A16B16G16R16
+		case 110: return DXGI_FORMAT_R16G16B16A16_SNORM; // D3DFMT_Q16W16V16U16
+		case 111: return DXGI_FORMAT_R16_FLOAT;          // D3DFMT_R16F
+		case 112: return DXGI_FORMAT_R16G16_FLOAT;       // D3DFMT_G16R16F
+		case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+		case 114: return DXGI_FORMAT_R32_FLOAT;          // D3DFMT_R32F
+		case 115: return DXGI_FORMAT_R32G32_FLOAT;       // D3DFMT_G32R32F
+		case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+		default: break;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+namespace {
+	// Parses the headers in the first available bytes of data, a DDS file of
+	// file_size bytes, and lays out its surfaces. Surfaces past available get
+	// no data pointer, only their offset.
+	void parseLayout(const uint8_t* data, size_t available, size_t file_size, DdsTexture& texture) {
+		texture = DdsTexture();
+
+		// the headers are copied out, the file data doesn't have to be aligned
+		uint32_t magic;
+		DDS_HEADER header;
+		if (available < sizeof(magic) + sizeof(header))
+			throw runtime_error("dds: file too small for the header");
+		memcpy(&magic, data, sizeof(magic));
+		memcpy(&header, data + sizeof(magic), sizeof(header));
+		if (magic != DDS_MAGIC)
+			throw runtime_error("dds: bad magic number");
+		if (header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+			throw runtime_error("dds: bad header size");
+
+		size_t offset = sizeof(magic) + sizeof(header);
+		DDS_HEADER_DXT10 extensionHeader;
+		const DDS_HEADER_DXT10* extension = nullptr;
+		if ((header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MAKEFOURCC('D', 'X', '1', '0')) {
+			if (available < offset + sizeof(extensionHeader))
+				throw runtime_error("dds: file too small for the DX10 header");
+			memcpy(&extensionHeader, data + offset, sizeof(extensionHeader));
+			extension = &extensionHeader;
+			offset += sizeof(extensionHeader);
+		}
+
+		texture.width = header.width;
+		texture.height = header.height;
+		texture.depth = header.depth;
+		texture.mipCount = max(header.mipMapCount, 1u);
+		texture.arraySize = 1;
+		texture.alphaMode = getAlphaMode(header, extension);
+
+		if (extension) {
+			texture.arraySize = extension->arraySize;
+			if (texture.arraySize == 0)
+				throw runtime_error("dds: array size is 0");
+
+			texture.format = extension->dxgiFormat;
+			switch (texture.format) {
+			case DXGI_FORMAT_AI44:
+			case DXGI_FORMAT_IA44:
+			case DXGI_FORMAT_P8:
+			case DXGI_FORMAT_A8P8:
+				throw runtime_error("dds: palette video formats are not supported");
+			default:
+				if (getBitsPerPixel(texture.format) == 0)
+					throw runtime_error("dds: unknown DXGI format " + to_string(static_cast<uint32_t>(texture.format)));
+			}
+
+			switch (extension->resourceDimension) {
+			case RESOURCE_DIMENSION_TEXTURE1D:
+				// D3DX writes 1d textures with a height of 1
+				if ((header.flags & DDS_HEIGHT) && texture.height != 1)
+					throw runtime_error("dds: 1d texture with a height");
+				texture.dimension = DdsDimension::texture1d;
+				texture.height = texture.depth = 1;
+				break;
+			case RESOURCE_DIMENSION_TEXTURE2D:
+				if (extension->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) {
+					if (texture.arraySize > UINT32_MAX / 6)
+						throw runtime_error("dds: too many cubes");
+					texture.arraySize *= 6;
+					texture.cubemap = true;
+				}
+				texture.dimension = DdsDimension::texture2d;
+				texture.depth = 1;
+				break;
+			case RESOURCE_DIMENSION_TEXTURE3D:
+				if (!(header.flags & DDS_HEADER_FLAGS_VOLUME))
+					throw runtime_error("dds: 3d texture without the volume flag");
+				if (texture.arraySize > 1)
+					throw runtime_error("dds: 3d textures can't be arrays");
+				texture.dimension = DdsDimension::texture3d;
+				break;
+			default:
+				throw runtime_error("dds: unsupported resource dimension " + to_string(extension->resourceDimension));
+			}
+		}
+		else {
+			texture.format = getDxgiFormat(header.ddspf);
+			if (texture.format == DXGI_FORMAT_UNKNOWN)
+				throw runtime_error("dds: legacy pixel format without a DXGI format");
+
+			if (header.flags & DDS_HEADER_FLAGS_VOLUME) {
+				texture.dimension = DdsDimension::texture3d;
+			}
+			else {
+				if (header.caps2 & DDS_CUBEMAP) {
+					if ((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+						throw runtime_error("dds: partial cubemap");
+					texture.arraySize = 6;
+					texture.cubemap = true;
+				}
+				// a legacy header can't describe a 1d texture
+				texture.dimension = DdsDimension::texture2d;
+				texture.depth = 1;
+			}
+		}
+
+		if (texture.width == 0 || texture.height == 0 || texture.depth == 0)
+			throw runtime_error("dds: empty texture");
+		if (texture.mipCount > MAX_MIP_LEVELS || texture.mipCount > countMips(texture.width, texture.height, texture.depth))
+			throw runtime_error("dds: too many mip levels (" + to_string(texture.mipCount) + ")");
+
+		if (!fitsDirect3D11(texture))
+			throw runtime_error("dds: larger than Direct3D 11 allows");
+
+		// every mip level of slice 0, then of slice 1 and so on, each mip level holds all of its depth slices
+		texture.surfaces.reserve(size_t(texture.arraySize) * texture.mipCount);
+		for (uint32_t slice = 0; slice < texture.arraySize; slice++) {
+			uint32_t width = texture.width;
+			uint32_t height = texture.height;
+			uint32_t depth = texture.depth;
+			for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+				DdsSurface surface;
+				if (!getSurfaceLayout(width, height, texture.format, surface.layout))
+					throw runtime_error("dds: surface too large");
+
+				surface.size = surface.layout.slicePitch * depth;
+				if (surface.size > file_size - offset)
+					throw runtime_error("dds: file ends inside slice " + to_string(slice) + " mip " + to_string(mip));
+				surface.offset = offset;
+				surface.data = offset + surface.size <= available ? data + offset : nullptr;
+				surface.width = width;
+				surface.height = height;
+				surface.depth = depth;
+				texture.surfaces.push_back(surface);
+				offset += surface.size;
+
+				width = max(width / 2, 1u);
+				height = max(height / 2, 1u);
+				depth = max(depth / 2, 1u);
+			}
+		}
+	}
+}
+
+bool fitsDirect3D11(const DdsTexture& texture)
+{
+	if (texture.mipCount > MAX_MIP_LEVELS || texture.mipCount > countMips(texture.width, texture.height, texture.depth))
+		return false;
+	switch (texture.dimension) {
+	case DdsDimension::texture1d:
+		return texture.arraySize <= MAX_ARRAY_SIZE_1D && texture.width <= MAX_SIZE_1D;
+	case DdsDimension::texture2d: {
+		const uint32_t maxSize = texture.cubemap ? MAX_SIZE_CUBE : MAX_SIZE_2D;
+		return texture.arraySize <= MAX_ARRAY_SIZE_2D && texture.width <= maxSize && texture.height <= maxSize;
+	}
+	case DdsDimension::texture3d:
+		return texture.width <= MAX_SIZE_3D && texture.height <= MAX_SIZE_3D && texture.depth <= MAX_SIZE_3D;
+	}
+	return false;
+}
+
+uint32_t getFirstReadMip(const DdsTexture& layout, const DdsReadOptions& options)
+{
+	auto getLevelBytes = [&](uint32_t first) {
+		size_t bytes = 0;
+		for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+			for (uint32_t mip = first; mip < layout.mipCount; mip++)
+				bytes += layout.getSurface(slice, mip).size;
+		}
+		return bytes;
+	};
+	uint32_t first = 0;
+	for (; first + 1 < layout.mipCount; first++) {
+		const DdsSurface& top = layout.getSurface(0, first);
+		const bool fitsSize = options.maxSize == 0 ||
+			(top.width <= options.maxSize && top.height <= options.maxSize && top.depth <= options.maxSize);
+		if (fitsSize && (options.memoryBudget == 0 || getLevelBytes(first) <= options.memoryBudget))
+			break;
+	}
+	return first;
+}
+
+void parseDds(const uint8_t* data, size_t size, DdsTexture& texture)
+{
+	parseLayout(data, size, size, texture);
+}
+
+void readDds(const string& path, const DdsReadOptions& options, DdsStreamedTexture& streamed)
+{
+	PROFILE_ZONE("readDds");
+	streamed = DdsStreamedTexture();
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file)
+		throw runtime_error("can't open " + path);
+	streamed.fileSize = static_cast<uint64_t>(file.tellg());
+
+	// just the headers, the DX10 one when the pixel format asks for it; the surfaces only get their offsets
+	uint8_t header[sizeof(DDS_MAGIC) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)];
+	size_t headerSize = static_cast<size_t>(min<uint64_t>(sizeof(DDS_MAGIC) + sizeof(DDS_HEADER), streamed.fileSize));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(header), headerSize))
+		throw runtime_error("can't read " + path);
+	if (headerSize == sizeof(DDS_MAGIC) + sizeof(DDS_HEADER)) {
+		DDS_PIXELFORMAT pixelFormat;
+		memcpy(&pixelFormat, header + sizeof(DDS_MAGIC) + offsetof(DDS_HEADER, ddspf), sizeof(pixelFormat));
+		const size_t extensionSize = static_cast<size_t>(min<uint64_t>(sizeof(DDS_HEADER_DXT10), streamed.fileSize - headerSize));
+		if ((pixelFormat.flags & DDS_FOURCC) && pixelFormat.fourCC == MAKEFOURCC('D', 'X', '1', '0')) {
+			if (!file.read(reinterpret_cast<char*>(header + headerSize), extensionSize))
+				throw runtime_error("can't read " + path);
+			headerSize += extensionSize;
+		}
+	}
+	streamed.bytesRead = headerSize;
+
+	DdsTexture layout;
+	try {
+		parseLayout(header, headerSize, static_cast<size_t>(streamed.fileSize), layout);
+	}
+	catch (const exception& e) {
+		throw runtime_error(path + ": " + e.what());
+	}
+
+	// skip top levels while they are too large, the last one stays whatever its size
+	const uint32_t first = getFirstReadMip(layout, options);
+	size_t keptBytes = 0;
+	for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+		for (uint32_t mip = first; mip < layout.mipCount; mip++)
+			keptBytes += layout.getSurface(slice, mip).size;
+	}
+
+	// the kept levels of a slice follow each other in the file
+	streamed.skippedMips = first;
+	streamed.data.resize(keptBytes);
+	size_t cursor = 0;
+	for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+		const DdsSurface& begin = layout.getSurface(slice, first);
+		const DdsSurface& last = layout.getSurface(slice, layout.mipCount - 1);
+		const size_t bytes = last.offset + last.size - begin.offset;
+		file.seekg(static_cast<streamoff>(begin.offset));
+		if (!file.read(reinterpret_cast<char*>(streamed.data.data() + cursor), static_cast<streamsize>(bytes)))
+			throw runtime_error("can't read " + path);
+		cursor += bytes;
+	}
+	streamed.bytesRead += streamed.data.size();
+
+	DdsTexture& texture = streamed.texture;
+	texture = layout;
+	texture.mipCount = layout.mipCount - first;
+	texture.surfaces.clear();
+	cursor = 0;
+	for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+		for (uint32_t mip = first; mip < layout.mipCount; mip++) {
+			DdsSurface surface = layout.getSurface(slice, mip);
+			surface.data = streamed.data.data() + cursor;
+			cursor += surface.size;
+			texture.surfaces.push_back(surface);
+		}
+	}
+	texture.width = texture.surfaces[0].width;
+	texture.height = texture.surfaces[0].height;
+	texture.depth = texture.surfaces[0].depth;
+}
+
+void writeDds(const string& path, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mip_count,
+	const vector<uint8_t>& surfaces)
+{
+	if (width == 0 || height == 0 || mip_count == 0 || mip_count > countMips(width, height, 1))
+		throw runtime_error(path + ": bad texture size");
+
+	size_t expectedSize = 0;
+	DdsSurfaceLayout top;
+	for (uint32_t mip = 0; mip < mip_count; mip++) {
+		DdsSurfaceLayout layout;
+		if (!getSurfaceLayout(max(width >> mip, 1u), max(height >> mip, 1u), format, layout))
+			throw runtime_error(path + ": unsupported format " + to_string(static_cast<uint32_t>(format)));
+		if (mip == 0)
+			top = layout;
+		expectedSize += layout.slicePitch;
+	}
+	if (surfaces.size() != expectedSize)
+		throw runtime_error(path + ": surface data doesn't match the texture size");
+
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | (mip_count > 1 ? DDS_HEADER_FLAGS_MIPMAP : 0);
+	header.height = height;
+	header.width = width;
+	header.mipMapCount = mip_count;
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE | (mip_count > 1 ? DDS_SURFACE_FLAGS_MIPMAP : 0);
+	if (isBlockCompressed(format)) {
+		header.flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+		header.pitchOrLinearSize = static_cast<uint32_t>(top.slicePitch);
+	}
+	else {
+		header.flags |= DDS_HEADER_FLAGS_PITCH;
+		header.pitchOrLinearSize = static_cast<uint32_t>(top.rowPitch);
+	}
+
+	DDS_HEADER_DXT10 extension = {};
+	bool writeExtension = false;
+	if (format == DXGI_FORMAT_BC1_UNORM)
+		header.ddspf = DDSPF_DXT1;
+	else if (format == DXGI_FORMAT_BC3_UNORM)
+		header.ddspf = DDSPF_DXT5;
+	else {
+		header.ddspf = DDSPF_DX10;
+		extension.dxgiFormat = format;
+		extension.resourceDimension = RESOURCE_DIMENSION_TEXTURE2D;
+		extension.arraySize = 1;
+		writeExtension = true;
+	}
+
+	ofstream file(path, ios::binary);
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (writeExtension)
+		file.write(reinterpret_cast<const char*>(&extension), sizeof(extension));
+	file.write(reinterpret_cast<const char*>(surfaces.data()), surfaces.size());
+	if (!file)
+		throw runtime_error("can't write " + path);
+}
+
+DdsFile::DdsFile(const string& path) {
+	open(path);
+}
+
+void DdsFile::open(const string& path) {
+	m_texture = DdsTexture();
+	if (!m_file.open(path))
+		throw runtime_error("can't open " + path);
+	try {
+		parseDds(m_file.data(), m_file.size(), m_texture);
+	}
+	catch (const exception& e) {
+		m_file.close();
+		throw runtime_error(path + ": " + e.what());
+	}
+}
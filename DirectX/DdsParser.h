@@ -0,0 +1,141 @@
+#pragma once
+
+#include "DxgiFormat.h"
+#include "DDS.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads the layout of DDS files without Direct3D or Win32: the header checks
+// of DDSTextureLoader, the pitch of every format in DXGI_FORMAT and views of
+// every surface straight into the file data, so textures can be validated
+// wherever the asset pipeline runs.
+
+enum class DdsDimension
+{
+	texture1d,
+	texture2d,
+	texture3d
+};
+
+// Bytes of one mip level of one 2d slice
+struct DdsSurfaceLayout
+{
+	size_t rowPitch = 0;
+	size_t rowCount = 0;   // rows of pixels, or of 4x4 blocks for compressed formats
+	size_t slicePitch = 0; // bytes of one depth slice
+};
+
+// One mip level of one array slice, pointing into the file data
+struct DdsSurface
+{
+	const uint8_t* data;
+	size_t offset; // of data from the start of the file
+	size_t size;   // slicePitch * depth
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	DdsSurfaceLayout layout;
+};
+
+struct DdsTexture
+{
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	DdsDimension dimension = DdsDimension::texture2d;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t depth = 0;
+	uint32_t mipCount = 0;
+	// slices in the file, a cubemap counts 6 per cube
+	uint32_t arraySize = 0;
+	bool cubemap = false;
+	DirectX::DDS_ALPHA_MODE alphaMode = DirectX::DDS_ALPHA_MODE_UNKNOWN;
+
+	// arraySize * mipCount surfaces, every mip level of slice 0 first
+	std::vector<DdsSurface> surfaces;
+
+	const DdsSurface& getSurface(uint32_t slice, uint32_t mip) const {
+		return surfaces[slice * mipCount + mip];
+	}
+};
+
+// Bits per pixel of format, 0 when it is unknown
+size_t getBitsPerPixel(DXGI_FORMAT format);
+bool isBlockCompressed(DXGI_FORMAT format);
+
+// Pitches of a width x height surface in format, false when the format is
+// unknown or the sizes overflow 32 bits.
+bool getSurfaceLayout(size_t width, size_t height, DXGI_FORMAT format, DdsSurfaceLayout& layout);
+
+// DXGI format of a legacy (non DX10) pixel format, DXGI_FORMAT_UNKNOWN when there is none
+DXGI_FORMAT getDxgiFormat(const DirectX::DDS_PIXELFORMAT& pixel_format);
+
+// Whether the mip count, size and slices of texture are within the Direct3D 11
+// limits DDSTextureLoader checks
+bool fitsDirect3D11(const DdsTexture& texture);
+
+// Validates the DDS file in data and fills texture with its surfaces. Nothing
+// is copied: the surfaces point into data, which has to outlive texture.
+// Throws a runtime_error naming the first problem found.
+void parseDds(const uint8_t* data, size_t size, DdsTexture& texture);
+
+// Which mip levels readDds loads. The top levels are skipped until both limits
+// hold, the smallest level is always read.
+struct DdsReadOptions
+{
+	// largest width, height or depth of the first level read, 0 for no limit
+	// (the maxsize of CreateDDSTextureFromFile)
+	uint32_t maxSize = 0;
+	// most bytes of surface data to read for all slices together, 0 for no limit
+	size_t memoryBudget = 0;
+};
+
+// The part of a DDS file readDds loaded. texture describes the levels that
+// were read, as if the skipped ones had never been in the file, and its
+// surfaces point into data.
+struct DdsStreamedTexture
+{
+	DdsTexture texture;
+	uint32_t skippedMips = 0;
+	std::vector<uint8_t> data;
+	uint64_t fileSize = 0;
+	uint64_t bytesRead = 0; // headers included
+};
+
+// The first level of layout readDds keeps with options
+uint32_t getFirstReadMip(const DdsTexture& layout, const DdsReadOptions& options);
+
+// Reads the headers of path, then seeks to the levels options keep and reads
+// only those, one read per array slice. Throws a runtime_error like
+// DdsFile::open.
+void readDds(const std::string& path, const DdsReadOptions& options, DdsStreamedTexture& streamed);
+
+// Writes a 2d texture with mip_count levels to path. surfaces holds the mip
+// levels one after another, each laid out as getSurfaceLayout says. BC1 and
+// BC3 get a legacy header, every other format the DX10 one. Throws a
+// runtime_error when the data doesn't match or the file can't be written.
+void writeDds(const std::string& path, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mip_count,
+	const std::vector<uint8_t>& surfaces);
+
+// A DDS file mapped into memory, its surfaces point into the mapping
+class DdsFile {
+public:
+	DdsFile() = default;
+	// throws like open
+	explicit DdsFile(const std::string& path);
+
+	// Maps and parses the file. Throws a runtime_error when it can't be
+	// opened or is not a valid DDS file.
+	void open(const std::string& path);
+
+	const DdsTexture& getTexture() const { return m_texture; }
+	const uint8_t* getData() const { return m_file.data(); }
+	size_t getFileSize() const { return m_file.size(); }
+
+private:
+	MappedFile m_file;
+	DdsTexture m_texture;
+};
@@ -0,0 +1,187 @@
+#include "FrameStats.h"
+
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+	// frames of the same time, in ascending order of time
+	struct FrameTimeCount
+	{
+		double ms;
+		uint64_t frames;
+	};
+
+	// nearest rank: the smallest frame time that at least p of the frames don't exceed
+	float percentile(const vector<FrameTimeCount>& sorted, uint64_t total, double p) {
+		const uint64_t rank = min(max<uint64_t>(static_cast<uint64_t>(ceil(p * total)), 1), total);
+		uint64_t frames = 0;
+		for (const auto& time : sorted) {
+			frames += time.frames;
+			if (frames >= rank)
+				return static_cast<float>(time.ms);
+		}
+		return static_cast<float>(sorted.back().ms);
+	}
+
+	// frame rate of the mean of the slowest fraction of the frames
+	float lowFps(const vector<FrameTimeCount>& sorted, uint64_t total, double fraction) {
+		const uint64_t count = max<uint64_t>(1, static_cast<uint64_t>(total * fraction));
+		uint64_t left = count;
+		double sum = 0;
+		for (auto time = sorted.rbegin(); time != sorted.rend() && left > 0; ++time) {
+			const uint64_t frames = min(left, time->frames);
+			sum += time->ms * frames;
+			left -= frames;
+		}
+		return sum > 0 ? static_cast<float>(1000.0 * count / sum) : 0.0f;
+	}
+
+	void computeStats(const vector<FrameTimeCount>& sorted, FrameTimeStats& stats, size_t max_bins) {
+		uint64_t total = 0;
+		double sum = 0;
+		for (const auto& time : sorted) {
+			total += time.frames;
+			sum += time.ms * time.frames;
+		}
+		if (total == 0)
+			return;
+		const double mean = sum / total;
+		double squares = 0;
+		for (const auto& time : sorted)
+			squares += (time.ms - mean) * (time.ms - mean) * time.frames;
+
+		stats.frames = total;
+		stats.minMs = static_cast<float>(sorted.front().ms);
+		stats.maxMs = static_cast<float>(sorted.back().ms);
+		stats.meanMs = static_cast<float>(mean);
+		stats.stddevMs = static_cast<float>(sqrt(squares / total));
+		stats.p50Ms = percentile(sorted, total, 0.5);
+		stats.p90Ms = percentile(sorted, total, 0.9);
+		stats.p99Ms = percentile(sorted, total, 0.99);
+		stats.p999Ms = percentile(sorted, total, 0.999);
+		stats.low1Fps = lowFps(sorted, total, 0.01);
+		stats.low01Fps = lowFps(sorted, total, 0.001);
+
+		if (!isfinite(stats.maxMs - stats.minMs))
+			return;
+
+		// bins on multiples of the width, from the one holding the shortest frame to the one holding the longest;
+		// the narrowest 1, 2 or 5 times a power of ten milliseconds that fits them in max_bins, 1 us at least
+		max_bins = max<size_t>(max_bins, 1);
+		const double steps[] = { 1.0, 2.0, 5.0 };
+		double width = 0.0, from = 0.0;
+		size_t bins = 0;
+		for (double decade = 0.001; bins == 0 || bins > max_bins; decade *= 10) {
+			for (double step : steps) {
+				width = step * decade;
+				from = floor(stats.minMs / width) * width;
+				bins = static_cast<size_t>((stats.maxMs - from) / width) + 1;
+				if (bins <= max_bins)
+					break;
+			}
+		}
+		stats.histogram.resize(bins);
+		for (size_t i = 0; i < bins; i++)
+			stats.histogram[i] = { static_cast<float>(from + i * width), static_cast<float>(from + (i + 1) * width), 0 };
+		for (const auto& time : sorted)
+			// minMs is rounded to float, the shortest frame may sit a hair below from
+			stats.histogram[min(static_cast<size_t>(max(0.0, (time.ms - from) / width)), bins - 1)].frames += time.frames;
+	}
+}
+
+FrameTimeRecorder::FrameTimeRecorder(size_t capacity)
+	: m_frameTimes(capacity)
+{
+}
+
+float FrameTimeRecorder::markFrame() noexcept
+{
+	const auto now = steady_clock::now();
+	float milliseconds = 0.0f;
+	if (m_started) {
+		milliseconds = duration<float, milli>(now - m_last).count();
+		record(milliseconds);
+	}
+	m_started = true;
+	m_last = now;
+	return milliseconds;
+}
+
+void FrameTimeRecorder::record(float milliseconds) noexcept
+{
+	if (m_count < m_frameTimes.size())
+		m_frameTimes[m_count++] = milliseconds;
+	else
+		m_dropped++;
+}
+
+void FrameTimeRecorder::reset() noexcept
+{
+	m_count = 0;
+	m_dropped = 0;
+	m_started = false;
+}
+
+void computeFrameTimeStats(const float* frame_times, size_t count, FrameTimeStats& stats, size_t max_bins)
+{
+	stats = FrameTimeStats();
+	vector<float> times(frame_times, frame_times + count);
+	sort(times.begin(), times.end());
+
+	vector<FrameTimeCount> sorted;
+	for (float time : times) {
+		if (!sorted.empty() && sorted.back().ms == time)
+			sorted.back().frames++;
+		else
+			sorted.push_back({ time, 1 });
+	}
+	computeStats(sorted, stats, max_bins);
+}
+
+void computeFrameTimeStats(const HdrHistogram& histogram, double unit_ms, FrameTimeStats& stats, size_t max_bins)
+{
+	stats = FrameTimeStats();
+	stats.fromHistogram = true;
+
+	// every bucket at its middle, like HdrHistogram::getMean
+	vector<FrameTimeCount> sorted;
+	histogram.forEachBucket([&](int64_t lowest, int64_t highest, uint64_t count) {
+		sorted.push_back({ (lowest + highest) * 0.5 * unit_ms, count });
+	});
+	computeStats(sorted, stats, max_bins);
+}
+
+void exportFrameTimes(const FrameTimeStats& stats, uint64_t dropped, const string& suffix)
+{
+	if (stats.frames == 0)
+		return;
+
+	filesystem::create_directory("data");
+	ofstream file("data/frame-stats-" + suffix);
+	file << "frames;dropped;min-ms;max-ms;mean-ms;stddev-ms;p50-ms;p90-ms;p99-ms;p99.9-ms;1%-low-fps;0.1%-low-fps;source\n"
+		<< stats.frames << ';'
+		<< dropped << ';'
+		<< stats.minMs << ';'
+		<< stats.maxMs << ';'
+		<< stats.meanMs << ';'
+		<< stats.stddevMs << ';'
+		<< stats.p50Ms << ';'
+		<< stats.p90Ms << ';'
+		<< stats.p99Ms << ';'
+		<< stats.p999Ms << ';'
+		<< stats.low1Fps << ';'
+		<< stats.low01Fps << ';'
+		<< (stats.fromHistogram ? "hdr-histogram" : "frame-times");
+
+	ofstream histogram("data/frame-histogram-" + suffix);
+	histogram << "from-ms;to-ms;frames";
+	for (const auto& bin : stats.histogram)
+		histogram << '\n' << bin.fromMs << ';' << bin.toMs << ';' << bin.frames;
+}
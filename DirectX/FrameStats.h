@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class HdrHistogram;
+
+// Frame times of a whole run and the statistics the stutter shows up in: a
+// mean frame rate hides the long frames, the high percentiles and the 1% lows
+// don't.
+
+// Records the duration of every frame into a buffer allocated up front, so
+// recording never allocates. Frames past the capacity are only counted, as
+// getDroppedFrames, and left out of the statistics.
+class FrameTimeRecorder {
+public:
+	explicit FrameTimeRecorder(size_t capacity);
+
+	// Ends the current frame and records its duration, the time since the
+	// previous call, and returns it; the first call only starts the clock and
+	// returns 0.
+	float markFrame() noexcept;
+	// records a frame time measured elsewhere
+	void record(float milliseconds) noexcept;
+	// forgets the frames, keeps the buffer
+	void reset() noexcept;
+
+	const float* getFrameTimes() const { return m_frameTimes.data(); }
+	size_t getFrameCount() const { return m_count; }
+	uint64_t getDroppedFrames() const { return m_dropped; }
+
+private:
+	std::vector<float> m_frameTimes;
+	size_t m_count = 0;
+	uint64_t m_dropped = 0;
+	bool m_started = false;
+	std::chrono::steady_clock::time_point m_last;
+};
+
+// Frames per bin of the frame time histogram, [fromMs, toMs)
+struct FrameTimeBin
+{
+	float fromMs;
+	float toMs;
+	uint64_t frames;
+};
+
+struct FrameTimeStats
+{
+	size_t frames = 0;
+	float minMs = 0.0f;
+	float maxMs = 0.0f;
+	float meanMs = 0.0f;
+	float stddevMs = 0.0f;
+	// nearest rank percentiles of the frame time
+	float p50Ms = 0.0f;
+	float p90Ms = 0.0f;
+	float p99Ms = 0.0f;
+	float p999Ms = 0.0f;
+	// frame rate of the mean of the slowest 1% and 0.1% frames (at least one frame)
+	float low1Fps = 0.0f;
+	float low01Fps = 0.0f;
+	std::vector<FrameTimeBin> histogram;
+	// from the buckets of an HdrHistogram rather than from every frame time
+	bool fromHistogram = false;
+};
+
+// Computes the statistics of count frame times (in milliseconds). The
+// histogram covers the shortest to the longest frame in at most max_bins bins
+// of 1, 2 or 5 times a power of ten milliseconds (1 us at least), the
+// narrowest that fit. Sorts a copy, so call it after the run rather than per
+// frame.
+void computeFrameTimeStats(const float* frame_times, size_t count, FrameTimeStats& stats, size_t max_bins = 64);
+// The same from the frame times counted in histogram, recorded in units of
+// unit_ms milliseconds: every frame of a run of any length, each taken at the
+// middle of its bucket, so to the significant digits of the histogram.
+void computeFrameTimeStats(const HdrHistogram& histogram, double unit_ms, FrameTimeStats& stats, size_t max_bins = 64);
+
+// Writes the statistics to data/frame-stats-<suffix>, with the dropped frames
+// they leave out and where they come from, and their histogram to
+// data/frame-histogram-<suffix>; nothing when there was no frame.
+void exportFrameTimes(const FrameTimeStats& stats, uint64_t dropped, const std::string& suffix);
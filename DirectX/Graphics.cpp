@@ -1,302 +1,227 @@
 #include "Graphics.h"
 
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Profiler.h"
+#include "VertexFormat.h"
 
-#include <d3dcompiler.h>
-#include <DirectXMath.h>
-
-#include "WICTextureLoader.h"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
 
 
 using namespace std;
 
-#pragma region d3d11debug
-HRESULT hr;
-
-// graphics exception checking/throwing macros (some with dxgi infos)
-#define GFX_EXCEPT_NOINFO(hr) Renderer::HrException( __LINE__,__FILE__,(hr) )
-#define GFX_THROW_NOINFO(hrcall) if( FAILED( hr = (hrcall) ) ) throw Renderer::HrException( __LINE__,__FILE__,hr )
-
-#ifndef NDEBUG
-#define GFX_EXCEPT(hr) Renderer::HrException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#define GFX_THROW_INFO(hrcall) infoManager.Set(); if( FAILED( hr = (hrcall) ) ) throw GFX_EXCEPT(hr)
-#define GFX_DEVICE_REMOVED_EXCEPT(hr) Renderer::DeviceRemovedException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#else
-#define GFX_EXCEPT(hr) Renderer::HrException( __LINE__,__FILE__,(hr) )
-#define GFX_THROW_INFO(hrcall) GFX_THROW_NOINFO(hrcall)
-#define GFX_DEVICE_REMOVED_EXCEPT(hr) Renderer::DeviceRemovedException( __LINE__,__FILE__,(hr) )
-#endif
-#pragma endregion d3d11debug
+namespace {
+	// bytes of mip levels draw uploads per frame, at least one level goes up anyway
+	const size_t TEXTURE_UPLOAD_BUDGET = 4 << 20;
+}
 
+Matrix getModelToClip(const MeshBounds& bounds, float angle, float x, float z) {
+	const float scalemultiplier = bounds.radius > 0.0f ? 1.0f / bounds.radius : 1.0f;
+	return
+		matrixTranslation(-bounds.center[0], -bounds.center[1], -bounds.center[2]) *
+		matrixRotationZ(angle) *
+		matrixRotationY(0) *
+		matrixRotationX(static_cast<float>(-3.14 / 3)) *
+		matrixTranslation(x, 0.0f, z + 4.0f) *
+		matrixScaling(.4f * scalemultiplier, 0.55f * scalemultiplier, .4f * scalemultiplier);
+}
 
 //constructor
-Graphics::Graphics(Renderer& renderer, string model_path, string texture_path) {
-	m_rendererPtr = &renderer;
-	loadModel(renderer, model_path);
-	createMesh(renderer);
-	createShaders(renderer);
-	createRenderStates(renderer);
-	loadTexture(texture_path);
+Graphics::Graphics(RenderDevice& device, string model_path, string texture_path, ObjIngest obj_ingest, VertexFormat vertex_format,
+	AssetCache* assets, DdsReadOptions texture_options) {
+	PROFILE_ZONE("Graphics::Graphics");
+	m_device = &device;
+	m_assets = assets;
+	// first, so the texture decodes while the model loads
+	loadTexture(texture_path, texture_options);
+	loadModel(model_path, obj_ingest, vertex_format);
+	createMesh();
+	createShaders();
 }
 
-//destructor
-Graphics::~Graphics() {
-	m_vertexBuffer->Release();
-	m_indexBuffer->Release();
-	m_constantBuffer->Release();
-	m_vertexShader->Release();
-	m_pixelShader->Release();
-	m_inputLayout->Release();
-	m_rasterizerState->Release();
-	m_depthState->Release();
-	m_blendState->Release();
-}
+void Graphics::draw(float angle, float x, float z) {
+	PROFILE_ZONE("Graphics::draw");
 
-void Graphics::draw(Renderer* renderer, float angle, float x, float z) {
-	using namespace DirectX;
-	auto deviceContext = renderer->getDeviceContext();
+	// upload the mip levels decoded since the last frame, the texture sharpens as they arrive
+	{
+		PROFILE_ZONE("texture uploads");
+		m_textureStreamer->update(*m_device, TEXTURE_UPLOAD_BUDGET);
+		if (m_textureStreamer->getResidency(m_textureHandle) == TextureResidency::failed)
+			throw runtime_error(m_textureStreamer->getError(m_textureHandle));
+	}
 
 	// Bind the vertex buffer to pipeline
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0u;
-	deviceContext->IASetVertexBuffers(0u, 1u, &m_vertexBuffer, &stride, &offset);
-
-	// Bind index buffer
-	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT, 0u);
+	m_device->bindVertexBuffer(m_vertexBuffer, (uint32_t)getVertexSize(m_vertexFormat));
 
-	float scalemultiplier = 1 / (float)m_farestPoint;
-	XMVECTORF32 const vScale = { .4f * scalemultiplier, 0.55f * scalemultiplier, .4f * scalemultiplier};
+	// fit the bounding sphere on screen whatever the rotation
+	Matrix modelToClip, constants;
+	{
+		PROFILE_ZONE("transform");
+		modelToClip = getModelToClip(m_bounds, angle, x, z);
+
+		// compact formats: scale and move the [0, 1] positions back into the mesh bounds before the model transform
+		if (m_vertexFormat != VertexFormat::float32) {
+			const Matrix decode = matrixScaling(m_positionScale[0], m_positionScale[1], m_positionScale[2]) *
+				matrixTranslation(m_positionOffset[0], m_positionOffset[1], m_positionOffset[2]);
+			constants = matrixTranspose(decode * modelToClip);
+		}
+		else
+			constants = matrixTranspose(modelToClip);
+	}
 
-	XMMATRIX cb =
+	// write the matrix into the constant buffer
 	{
-		XMMatrixTranspose(
-			XMMatrixRotationZ(angle) *
-			XMMatrixRotationY(0) *
-			XMMatrixRotationX(-3.14 / 3) *
-			XMMatrixTranslation(x, 0.0f, z + 4.0f)
-		)
-	};
+		PROFILE_ZONE("constant buffer");
+		memcpy(m_device->map(m_constantBuffer), &constants, sizeof(constants));
+		m_device->unmap(m_constantBuffer);
+	}
 
-	auto cbFinal = XMMatrixMultiply(XMMatrixScalingFromVector(vScale), cb);
-
-	
- 	D3D11_BUFFER_DESC cbd;
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	cbd.MiscFlags = 0u;
-	cbd.ByteWidth = sizeof(cbFinal);
-	cbd.StructureByteStride = 0u;
-	D3D11_SUBRESOURCE_DATA csd = {};
-	csd.pSysMem = &cbFinal;
-
-	if(firstDraw) {
-		buffer = renderer->getDevice()->CreateBuffer(&cbd, &csd, &m_constantBuffer);
-		firstDraw = false;
+	{
+		PROFILE_ZONE("state binds");
+		m_device->bindConstantBuffer(m_constantBuffer);
+		m_device->bindTexture(m_textureHandle);
+		// shaders, input layout, render states and sampler
+		m_device->bindPipeline(m_pipeline);
 	}
 
-	D3D11_MAPPED_SUBRESOURCE resource;
-	deviceContext->Map(m_constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-	memcpy(resource.pData, csd.pSysMem, cbd.ByteWidth);
-	deviceContext->Unmap(m_constantBuffer, 0);
+	// draw, either the visible meshlets of the full detail level packed together or a whole level
+	if (m_clusterCulling && m_lod == 0 && m_culledIndexBuffer) {
+		PROFILE_ZONE("cluster culling");
+		const CullView view = makeCullView(modelToClip.m, m_pipelineDesc.cullFace, m_pipelineDesc.depthClip);
 
-	GFX_THROW_INFO(buffer);
+		m_visibleRanges.clear();
+		m_visibleMeshlets = cullMeshlets(m_meshlets, view, m_visibleRanges);
 
-	// bind constant buffer to vertex shader
-	deviceContext->VSSetConstantBuffers(0u, 1u, &m_constantBuffer);
+		const uint8_t* indices = m_indexSize == sizeof(uint16_t) ?
+			(const uint8_t*)m_narrowIndices.data() : (const uint8_t*)m_indices.data();
 
-	// bind texture to pixel shader
-	deviceContext->PSSetShaderResources(0u, 1u, &m_textureView);
-	deviceContext->PSSetSamplers(0u, 1u, &m_textSamplerState);
+		uint8_t* mapped = (uint8_t*)m_device->map(m_culledIndexBuffer);
+		uint32_t indexCount = 0;
+		for (const auto& range : m_visibleRanges) {
+			memcpy(mapped + m_indexSize * indexCount, indices + m_indexSize * range.indexOffset, m_indexSize * range.indexCount);
+			indexCount += range.indexCount;
+		}
+		m_device->unmap(m_culledIndexBuffer);
 
-	// set render states
-	deviceContext->RSSetState(m_rasterizerState);
-	deviceContext->OMSetBlendState(m_blendState, NULL, 0xffffff);
-	deviceContext->OMSetDepthStencilState(m_depthState, 1u);
+		m_device->bindIndexBuffer(m_culledIndexBuffer, m_indexSize);
+		m_device->drawIndexed(indexCount, 0u);
+	}
+	else {
+		const MeshLod& lod = m_lods[m_lod];
+		m_device->bindIndexBuffer(m_indexBuffer, m_indexSize);
+		m_device->drawIndexed(lod.indexCount, lod.indexOffset);
+	}
+}
 
-	// bind vertex layout
-	deviceContext->IASetInputLayout(m_inputLayout);
+void Graphics::loadModel(string model_path, ObjIngest obj_ingest, VertexFormat vertex_format)
+{
+	// parse the obj and bake everything the draws need
+	auto buildMesh = [&](MeshData& mesh) {
+		loadObjMesh(model_path, mesh, obj_ingest);
+		// obj face order leaves vertex reuse to chance, sort it for the post-transform cache
+		optimizeMesh(mesh);
+		buildMeshlets(mesh);
+		buildLods(mesh);
+		packVertices(mesh, vertex_format);
+	};
 
-	// bind the triangle shaders
-	deviceContext->VSSetShader(m_vertexShader, nullptr, 0u);
-	deviceContext->PSSetShader(m_pixelShader, nullptr, 0u);
+	// the asset cache knows the mesh by content when any model with the same bytes was loaded before
+	MeshData mesh;
+	if (m_assets)
+		mesh = *m_assets->getMesh(model_path, vertex_format, buildMesh);
+	else
+		buildMesh(mesh);
 
-	// set primitive topology to triangle list (groups of 3 vertices)
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// make sure no index wraps around once it is narrowed for the index buffer
+	validateIndices(mesh, getIndexSize(mesh.vertices.size()), model_path);
 
-	// draw
-	deviceContext->DrawIndexed((UINT) m_size, 0u, 0u);
-}
+	m_meshlets = move(mesh.meshlets);
+	m_lods = move(mesh.lods);
+	if (m_lods.empty())
+		m_lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
 
-void Graphics::loadModel(Renderer& renderer, string model_path)
-{
-	tinyobj::attrib_t attrib;
-	vector<tinyobj::shape_t> shapes;
-	vector<tinyobj::material_t> materials;
-	string warn, err;
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model_path.c_str()))
-		throw runtime_error("load model error " + warn + err);
-
-	unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			Vertex vertex{};
-
-			vertex.pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-
-			vertex.texCoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1 - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
-
-			if (uniqueVertices.count(vertex) == 0) {
-				updateFarestPoint(vertex.pos.x, vertex.pos.y, vertex.pos.z);
-				uniqueVertices[vertex] = static_cast<uint32_t>(m_vertices.size());
-				m_vertices.push_back(vertex);
-			}
-				m_indices.push_back(uniqueVertices[vertex]);
-		}
-	}
-}
-
-void Graphics::updateFarestPoint(int x, int y, int z) {
-	if (x < 0) negativeToPositive(&x);
-	if (y < 0) negativeToPositive(&y);
-	if (z < 0) negativeToPositive(&z);
+	m_bounds = mesh.bounds;
+	m_vertexFormat = mesh.vertexFormat;
+	getPositionDecode(mesh.bounds, m_positionScale, m_positionOffset);
 
-	if (m_farestPoint < x) m_farestPoint = x;
-	if (m_farestPoint < y) m_farestPoint = y;
-	if (m_farestPoint < z) m_farestPoint = z;
+	m_vertices = move(mesh.vertices);
+	m_indices = move(mesh.indices);
+	m_packedVertices = move(mesh.packedVertices);
 }
 
-void Graphics::negativeToPositive(int* a) {
-	int b = *a * 2;
-	*a -= b;
+const vector<MeshLod>& Graphics::getLods() const {
+	return m_lods;
 }
 
-void Graphics::loadTexture(string texture_path) {
-	wstring text;
-	for (int i = 0; i < texture_path.length(); ++i)
-		text += wchar_t(texture_path[i]);
-	const wchar_t* file = text.c_str();
-
-	GFX_THROW_INFO(DirectX::CreateWICTextureFromFile(m_rendererPtr->getDevice(), file, &m_texture, &m_textureView));
-
-	D3D11_SAMPLER_DESC sampDesc;
-	ZeroMemory(&sampDesc, sizeof(sampDesc));
-	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	sampDesc.MinLOD = 0;
-	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-	m_rendererPtr->getDevice()->CreateSamplerState(&sampDesc, &m_textSamplerState);
+size_t Graphics::getLod() const {
+	return m_lod;
 }
-	
 
-void Graphics::createMesh(Renderer& renderer) {
-	
-	// create vertex buffer
-	D3D11_BUFFER_DESC bd = {}; //vertexBufferDesc
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.CPUAccessFlags = 0u;
-	bd.MiscFlags = 0u;
-	bd.ByteWidth = sizeof(Vertex) * m_vertices.size();
-	bd.StructureByteStride = sizeof(Vertex);
+void Graphics::setLod(size_t lod) {
+	m_lod = min(lod, m_lods.size() - 1);
+}
 
-	D3D11_SUBRESOURCE_DATA sd = {};
-	sd.pSysMem = m_vertices.data();
-	GFX_THROW_INFO(renderer.getDevice()->CreateBuffer(&bd, &sd, &m_vertexBuffer));
+void Graphics::setClusterCulling(bool enabled) {
+	m_clusterCulling = enabled;
+}
 
+size_t Graphics::getVisibleMeshletCount() const {
+	return m_visibleMeshlets;
+}
 
-	m_size = m_indices.size();
-	// create index buffer
-	D3D11_BUFFER_DESC ibd = {}; //indicesBufferDesc
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.Usage = D3D11_USAGE_DEFAULT;
-	ibd.CPUAccessFlags = 0u;
-	ibd.MiscFlags = 0u;
-	ibd.ByteWidth = sizeof(unsigned short) * m_indices.size();
-	ibd.StructureByteStride = sizeof(unsigned short);
-
-	D3D11_SUBRESOURCE_DATA isd = {};
-	isd.pSysMem = m_indices.data();
-	GFX_THROW_INFO(renderer.getDevice()->CreateBuffer(&ibd, &isd, &m_indexBuffer));
+void Graphics::loadTexture(string texture_path, DdsReadOptions options) {
+	// .dds (from --compress-textures or --mip-textures) and .ktx2 files keep their mips, images get a chain built on the worker
+	m_textureStreamer = make_unique<TextureStreamer>(0, MipFilter::kaiser, m_assets, options);
+	m_textureHandle = m_textureStreamer->request(texture_path);
+}
 
+TextureResidency Graphics::getTextureResidency() const {
+	return m_textureStreamer->getResidency(m_textureHandle);
 }
 
-void Graphics::createShaders(Renderer& renderer) {
-	ifstream vsFile("shaders/triangleVertexShader.cso", ios::binary); //inputfilestream
-	vector<char> vsData = { istreambuf_iterator<char>(vsFile), istreambuf_iterator<char>() }; //creating iterator, and add byte by byte to vector, pretty slow, can be faster and more efficient.
+uint32_t Graphics::getTextureResidentMip() const {
+	return m_textureStreamer->getResidentMip(m_textureHandle);
+}
 
-	GFX_THROW_INFO(renderer.getDevice()->CreateVertexShader(vsData.data(), vsData.size(), nullptr, &m_vertexShader));
+void Graphics::createMesh() {
+	PROFILE_ZONE("Graphics::createMesh");
 
+	// create vertex buffer
+	const uint32_t vertexSize = (uint32_t)getVertexSize(m_vertexFormat);
+	const void* vertices = m_vertexFormat == VertexFormat::float32 ? (const void*)m_vertices.data() : (const void*)m_packedVertices.data();
+	m_vertexBuffer = m_device->createBuffer(BufferType::vertex, vertices, vertexSize * m_vertices.size(), vertexSize, false);
 
-	ifstream psFile("shaders/trianglePixelShader.cso", ios::binary);
-	vector<char> psData = { istreambuf_iterator<char>(psFile), istreambuf_iterator<char>() };
+	// 16-bit indices when every vertex can be addressed with them, 32-bit otherwise
+	m_indexSize = (uint32_t)getIndexSize(m_vertices.size());
+	if (m_indexSize == sizeof(uint16_t))
+		m_narrowIndices.assign(m_indices.begin(), m_indices.end());
 
-	GFX_THROW_INFO(renderer.getDevice()->CreatePixelShader(psData.data(), psData.size(), nullptr, &m_pixelShader));
+	// create index buffer
+	const void* indices = m_indexSize == sizeof(uint16_t) ? (const void*)m_narrowIndices.data() : (const void*)m_indices.data();
+	m_indexBuffer = m_device->createBuffer(BufferType::index, indices, m_indexSize * m_indices.size(), m_indexSize, false);
 
+	// room for every meshlet of the full detail level, refilled by draw when cluster culling is on
+	if (!m_meshlets.empty())
+		m_culledIndexBuffer = m_device->createBuffer(BufferType::index, nullptr, m_indexSize * m_lods[0].indexCount, m_indexSize, true);
 
-	//Create input (vertex) layouts
-	D3D11_INPUT_ELEMENT_DESC layout[] = {
-		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{"TEXTCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		//{"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-	};
+	// the model to clip matrix, rewritten by every draw
+	m_constantBuffer = m_device->createBuffer(BufferType::constant, nullptr, sizeof(Matrix), 0, true);
+}
 
-	GFX_THROW_INFO(renderer.getDevice()->CreateInputLayout(
-		layout, (UINT)std::size(layout),
-		vsData.data(), 
-		vsData.size(), 
-		&m_inputLayout));
+void Graphics::createShaders() {
+	PROFILE_ZONE("Graphics::createShaders");
+	ifstream vsFile("shaders/triangleVertexShader.cso", ios::binary); //inputfilestream
+	m_pipelineDesc.vertexShader = { istreambuf_iterator<char>(vsFile), istreambuf_iterator<char>() };
 
+	ifstream psFile("shaders/trianglePixelShader.cso", ios::binary);
+	m_pipelineDesc.pixelShader = { istreambuf_iterator<char>(psFile), istreambuf_iterator<char>() };
+
+	// the shader reads float3/float2 either way, the input assembler converts the compact formats
+	m_pipelineDesc.vertexFormat = m_vertexFormat;
+	// draw only visible back shapes, and whatever the depth
+	m_pipelineDesc.cullFace = CullFace::front;
+	m_pipelineDesc.depthClip = false;
+	m_pipeline = m_device->createPipeline(m_pipelineDesc);
 }
-
-void Graphics::createRenderStates(Renderer& renderer) {
-	// Rasterizer state
-	auto rasterizerDesc = CD3D11_RASTERIZER_DESC(
-		D3D11_FILL_SOLID,
-		D3D11_CULL_FRONT, //draw only visible back shapes
-		//D3D11_CULL_NONE, //draw all shapes
-		false,
-		0, 0, 0,
-		false, false, false, false);
-	GFX_THROW_INFO(renderer.getDevice()->CreateRasterizerState(&rasterizerDesc, &m_rasterizerState));
-
-	// Blend state
-	auto blendDesc = CD3D11_BLEND_DESC(CD3D11_DEFAULT());
-	GFX_THROW_INFO(renderer.getDevice()->CreateBlendState(&blendDesc, &m_blendState));
-
-	// Depth state
-	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-	dsDesc.DepthEnable = TRUE;
-	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
-
-	dsDesc.StencilEnable = true;
-	dsDesc.StencilReadMask = 0xFF;
-	dsDesc.StencilWriteMask = 0xFF;
-	// Stencil operations if pixel is front-facing
-	dsDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
-	dsDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_INCR;
-	dsDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
-	dsDesc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
-
-	// Stencil operations if pixel is back-facing
-	dsDesc.BackFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
-	dsDesc.BackFace.StencilDepthFailOp = D3D11_STENCIL_OP_DECR;
-	dsDesc.BackFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
-	dsDesc.BackFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
-	
-	GFX_THROW_INFO(renderer.getDevice()->CreateDepthStencilState(&dsDesc, &m_depthState));
-
-}
\ No newline at end of file
@@ -1,87 +1,88 @@
 #pragma once
 
-#include "Renderer.h"
-#include "DxgiInfoManager.h"
+#include "RenderDevice.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "Tiny_obj_loader.h"
+#include "AssetCache.h"
+
+#include "Matrix.h"
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "Meshlets.h"
+#include "TextureStreamer.h"
 
 #include <vector>
-#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <memory>
 
-#pragma region structs
-struct Vertex
-{
-	struct
-	{
-		float x;
-		float y;
-		float z;
-	} pos;
-
-	struct
-	{
-		float u;
-		float v;
-	} texCoord;
-
-	bool operator==(const Vertex& other) const {
-		return pos.x == other.pos.x && pos.y == other.pos.y && pos.z == other.pos.z;
-	}
-};
-
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<float>()(vertex.pos.x) ^ (hash<float>()(vertex.pos.y) << 1)) >> 1) ^ (hash<float>()(vertex.pos.z) << 1);
-		}
-	};
-}
-
-#pragma endregion structs
+// Model to clip space transform of the benchmark view: the bounding sphere of
+// the model centered and scaled to fit on screen whatever the rotation, spun
+// by angle about its z axis, tilted and moved to (x, 0, z + 4).
+Matrix getModelToClip(const MeshBounds& bounds, float angle, float x, float z);
 
 class Graphics {
 public:
-	Graphics(Renderer& renderer, std::string model_path, std::string texture_path);
-	~Graphics(); //destructor
-	void draw(Renderer* renderer, float angle, float x, float z);
-	void loadModel(Renderer& renderer, std::string model_path);
-	void loadTexture(std::string texture_path);
-	void createMesh(Renderer& renderer);
-	void createShaders(Renderer& renderer);
-	void createRenderStates(Renderer& renderer);
-	void negativeToPositive(int* a);
-	void updateFarestPoint(int x, int y, int z);
+	// with assets the processed mesh and texture come from (and go into) that cache,
+	// texture_options pick the levels of a .dds or .ktx2 texture that are read
+	Graphics(RenderDevice& device, std::string model_path, std::string texture_path, ObjIngest obj_ingest = ObjIngest::mapped,
+		VertexFormat vertex_format = VertexFormat::float32, AssetCache* assets = nullptr, DdsReadOptions texture_options = {});
+	void draw(float angle, float x, float z);
+	void loadModel(std::string model_path, ObjIngest obj_ingest, VertexFormat vertex_format);
+	void loadTexture(std::string texture_path, DdsReadOptions options = {});
+	void createMesh();
+	void createShaders();
+
+	// levels of detail of the model, lods[0] is the full detail mesh
+	const std::vector<MeshLod>& getLods() const;
+	size_t getLod() const;
+	// picks the level draw uses, clamped to the last one
+	void setLod(size_t lod);
+	// culls the meshlets of the full detail level on the cpu before drawing it
+	void setClusterCulling(bool enabled);
+	// meshlets drawn by the last draw call with cluster culling
+	size_t getVisibleMeshletCount() const;
+	// how much of the texture has been streamed in, draw uploads a bit more every frame
+	TextureResidency getTextureResidency() const;
+	// finest mip level on the gpu, the mip count while there is none
+	uint32_t getTextureResidentMip() const;
 
 private:
-	Renderer* m_rendererPtr = nullptr;
+	RenderDevice* m_device = nullptr;
+	AssetCache* m_assets = nullptr;
 
 	std::vector<Vertex> m_vertices;
-	std::vector<unsigned short> m_indices;
-	int m_farestPoint = 1;
+	std::vector<uint32_t> m_indices;
+	// vertex buffer contents when m_vertexFormat isn't float32
+	std::vector<uint8_t> m_packedVertices;
+	VertexFormat m_vertexFormat = VertexFormat::float32;
+	// maps the UNORM16 positions of the compact formats back into the mesh bounds
+	float m_positionScale[3] = { 1.0f, 1.0f, 1.0f };
+	float m_positionOffset[3] = { 0.0f, 0.0f, 0.0f };
+	uint32_t m_indexSize = sizeof(uint16_t);
+	std::vector<MeshLod> m_lods;
+	size_t m_lod = 0;
+	// 16-bit copy of m_indices, when the index buffer uses them
+	std::vector<uint16_t> m_narrowIndices;
 
-	bool firstDraw = true;
-	HRESULT buffer;
-	int m_size = 0;
-	ID3D11Buffer* m_vertexBuffer = nullptr;
-	ID3D11Buffer* m_indexBuffer = nullptr;
-	ID3D11Buffer* m_constantBuffer = nullptr;
-	D3D11_BUFFER_DESC* m_cbd = nullptr;
-	ID3D11VertexShader* m_vertexShader = nullptr;
-	ID3D11PixelShader* m_pixelShader = nullptr;
-	ID3D11InputLayout* m_inputLayout = nullptr;
-	ID3D11RasterizerState* m_rasterizerState = nullptr;
-	ID3D11DepthStencilState* m_depthState = nullptr;
-	ID3D11BlendState* m_blendState = nullptr;
+	// cluster culling: the surviving meshlets are copied into m_culledIndexBuffer every frame
+	std::vector<Meshlet> m_meshlets;
+	bool m_clusterCulling = false;
+	std::vector<IndexRange> m_visibleRanges;
+	size_t m_visibleMeshlets = 0;
+	// framing: the model is drawn around the center of its bounding sphere, scaled by its radius
+	MeshBounds m_bounds;
 
-	ID3D11Resource* m_texture = nullptr;
-	ID3D11ShaderResourceView* m_textureView = nullptr;
-	ID3D11SamplerState* m_textSamplerState = nullptr;;
-#ifndef NDEBUG
-	DxgiInfoManager infoManager;
-#endif
-};
\ No newline at end of file
+	BufferHandle m_vertexBuffer = 0;
+	BufferHandle m_indexBuffer = 0;
+	BufferHandle m_culledIndexBuffer = 0;
+	BufferHandle m_constantBuffer = 0;
+	// culls front faces without depth clipping, cluster culling uses the same
+	PipelineDesc m_pipelineDesc;
+	PipelineHandle m_pipeline = 0;
+
+	// the texture is decoded on worker threads and uploaded smallest mip first
+	std::unique_ptr<TextureStreamer> m_textureStreamer;
+	TextureHandle m_textureHandle = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 binary16 conversions (DXGI_FORMAT_R16_FLOAT and friends), portable
+// so the offline tools don't need DirectXPackedVector.
+
+// Rounds to the nearest half, ties to even. Too large values become infinity.
+inline uint16_t floatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const int exponent = static_cast<int>((bits >> 23) & 0xFF);
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// infinity and nan (kept quiet)
+	if (exponent == 0xFF)
+		return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+	const int halfExponent = exponent - 127 + 15;
+	if (halfExponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7C00);
+
+	// subnormal halves, the implicit one becomes part of the mantissa
+	if (halfExponent <= 0) {
+		if (halfExponent < -10)
+			return static_cast<uint16_t>(sign);
+		mantissa |= 0x800000;
+		const int shift = 14 - halfExponent;
+		uint32_t half = mantissa >> shift;
+		const uint32_t rest = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// a carry out of the mantissa correctly bumps the exponent (up to infinity)
+	uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	const uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	return static_cast<uint16_t>(sign | half);
+}
+
+inline float halfToFloat(uint16_t half) {
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1F;
+	const uint32_t mantissa = half & 0x3FF;
+
+	if (exponent == 0) {
+		const float value = ldexpf(static_cast<float>(mantissa), -24);
+		return sign ? -value : value;
+	}
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
@@ -0,0 +1,254 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+	int highestBit(uint64_t value) {
+		int bit = 0;
+		for (int shift = 32; shift > 0; shift /= 2) {
+			if (value >> shift) {
+				value >>= shift;
+				bit += shift;
+			}
+		}
+		return bit;
+	}
+}
+
+// Bucket b holds the values [2^b * half, 2^(b + 1) * half) in half sub buckets
+// of width 2^b (bucket 0 also holds [0, half) at width 1). The counts array
+// keeps bucket 0 whole and the upper half of every other bucket, the lower
+// half would duplicate the bucket below.
+HdrHistogram::HdrHistogram(int64_t highest_value, int significant_digits)
+	: m_highestValue(highest_value), m_significantDigits(significant_digits)
+{
+	if (highest_value < 2)
+		throw invalid_argument("hdr histogram: the highest value must be at least 2");
+	if (significant_digits < 1 || significant_digits > 5)
+		throw invalid_argument("hdr histogram: 1 to 5 significant digits");
+
+	// values up to 2 * 10^digits are counted one by one
+	const int64_t singleUnitRange = 2 * static_cast<int64_t>(pow(10, significant_digits));
+	const int subBucketCountMagnitude = highestBit(static_cast<uint64_t>(singleUnitRange - 1)) + 1;
+	m_subBucketHalfCountMagnitude = subBucketCountMagnitude - 1;
+	const int64_t subBucketCount = int64_t(1) << subBucketCountMagnitude;
+	m_subBucketHalfCount = subBucketCount / 2;
+	m_subBucketMask = subBucketCount - 1;
+
+	int bucketCount = 1;
+	for (int64_t smallestUntracked = subBucketCount; smallestUntracked <= highest_value; smallestUntracked <<= 1) {
+		bucketCount++;
+		if (smallestUntracked > INT64_MAX / 2)
+			break;
+	}
+	m_counts = vector<atomic<uint64_t>>(size_t(bucketCount + 1) * size_t(m_subBucketHalfCount));
+}
+
+HdrHistogram::HdrHistogram(const HdrHistogram& other)
+	: m_highestValue(other.m_highestValue), m_significantDigits(other.m_significantDigits),
+	m_subBucketHalfCountMagnitude(other.m_subBucketHalfCountMagnitude), m_subBucketHalfCount(other.m_subBucketHalfCount),
+	m_subBucketMask(other.m_subBucketMask), m_counts(other.m_counts.size())
+{
+	add(other);
+}
+
+HdrHistogram& HdrHistogram::operator=(const HdrHistogram& other)
+{
+	if (this != &other) {
+		m_highestValue = other.m_highestValue;
+		m_significantDigits = other.m_significantDigits;
+		m_subBucketHalfCountMagnitude = other.m_subBucketHalfCountMagnitude;
+		m_subBucketHalfCount = other.m_subBucketHalfCount;
+		m_subBucketMask = other.m_subBucketMask;
+		m_counts = vector<atomic<uint64_t>>(other.m_counts.size());
+		reset();
+		add(other);
+	}
+	return *this;
+}
+
+size_t HdrHistogram::getIndex(int64_t value) const
+{
+	const int bucket = highestBit(static_cast<uint64_t>(value | m_subBucketMask)) - m_subBucketHalfCountMagnitude;
+	const int64_t subBucket = value >> bucket;
+	return (size_t(bucket + 1) << m_subBucketHalfCountMagnitude) + size_t(subBucket - m_subBucketHalfCount);
+}
+
+int64_t HdrHistogram::getValueFromIndex(size_t index) const
+{
+	int bucket = static_cast<int>(index >> m_subBucketHalfCountMagnitude) - 1;
+	int64_t subBucket = static_cast<int64_t>(index & size_t(m_subBucketHalfCount - 1)) + m_subBucketHalfCount;
+	if (bucket < 0) {
+		subBucket -= m_subBucketHalfCount;
+		bucket = 0;
+	}
+	return subBucket << bucket;
+}
+
+int64_t HdrHistogram::getLowestEquivalentValue(int64_t value) const
+{
+	return getValueFromIndex(getIndex(min(max<int64_t>(value, 0), m_highestValue)));
+}
+
+int64_t HdrHistogram::getHighestEquivalentValue(int64_t value) const
+{
+	value = min(max<int64_t>(value, 0), m_highestValue);
+	const int bucket = highestBit(static_cast<uint64_t>(value | m_subBucketMask)) - m_subBucketHalfCountMagnitude;
+	return getLowestEquivalentValue(value) + (int64_t(1) << bucket) - 1;
+}
+
+void HdrHistogram::updateMinMax(int64_t min, int64_t max) noexcept
+{
+	int64_t current = m_min.load(memory_order_relaxed);
+	while (min < current && !m_min.compare_exchange_weak(current, min, memory_order_relaxed)) {
+	}
+	current = m_max.load(memory_order_relaxed);
+	while (max > current && !m_max.compare_exchange_weak(current, max, memory_order_relaxed)) {
+	}
+}
+
+void HdrHistogram::record(int64_t value, uint64_t count) noexcept
+{
+	if (value < 0)
+		value = 0;
+	if (value > m_highestValue) {
+		value = m_highestValue;
+		m_saturatedCount.fetch_add(count, memory_order_relaxed);
+	}
+	m_counts[getIndex(value)].fetch_add(count, memory_order_relaxed);
+	m_totalCount.fetch_add(count, memory_order_relaxed);
+	updateMinMax(value, value);
+}
+
+void HdrHistogram::checkCompatible(const HdrHistogram& other) const
+{
+	if (other.m_highestValue != m_highestValue || other.m_significantDigits != m_significantDigits)
+		throw invalid_argument("hdr histogram: merging histograms with different ranges or precisions");
+}
+
+void HdrHistogram::add(const HdrHistogram& other)
+{
+	checkCompatible(other);
+	// the total is the sum of the counts read, so it matches them while other is being recorded into
+	uint64_t total = 0;
+	for (size_t i = 0; i < m_counts.size(); i++) {
+		const uint64_t count = other.m_counts[i].load(memory_order_relaxed);
+		if (count) {
+			m_counts[i].fetch_add(count, memory_order_relaxed);
+			total += count;
+		}
+	}
+	m_totalCount.fetch_add(total, memory_order_relaxed);
+	m_saturatedCount.fetch_add(other.getSaturatedCount(), memory_order_relaxed);
+	if (total)
+		updateMinMax(other.m_min.load(memory_order_relaxed), other.m_max.load(memory_order_relaxed));
+}
+
+void HdrHistogram::takeInterval(HdrHistogram& interval)
+{
+	checkCompatible(interval);
+	interval.reset();
+
+	const int64_t min = m_min.exchange(INT64_MAX, memory_order_relaxed);
+	const int64_t max = m_max.exchange(0, memory_order_relaxed);
+	interval.m_saturatedCount = m_saturatedCount.exchange(0, memory_order_relaxed);
+	uint64_t total = 0;
+	size_t first = SIZE_MAX, last = 0;
+	for (size_t i = 0; i < m_counts.size(); i++) {
+		const uint64_t count = m_counts[i].exchange(0, memory_order_relaxed);
+		if (count) {
+			interval.m_counts[i].store(count, memory_order_relaxed);
+			total += count;
+			first = std::min(first, i);
+			last = i;
+		}
+	}
+	m_totalCount.fetch_sub(total, memory_order_relaxed);
+	interval.m_totalCount = total;
+
+	// a value recorded while the counts moved may have gone into the other extremes, keep them inside the buckets
+	if (total) {
+		interval.m_min = std::max(std::min(min, getHighestEquivalentValue(getValueFromIndex(first))), getValueFromIndex(first));
+		interval.m_max = std::min(std::max(max, getValueFromIndex(last)), getHighestEquivalentValue(getValueFromIndex(last)));
+	}
+}
+
+void HdrHistogram::reset() noexcept
+{
+	for (auto& count : m_counts)
+		count.store(0, memory_order_relaxed);
+	m_totalCount = 0;
+	m_saturatedCount = 0;
+	m_min = INT64_MAX;
+	m_max = 0;
+}
+
+int64_t HdrHistogram::getMin() const
+{
+	return getTotalCount() ? m_min.load(memory_order_relaxed) : 0;
+}
+
+int64_t HdrHistogram::getMax() const
+{
+	return getTotalCount() ? m_max.load(memory_order_relaxed) : 0;
+}
+
+double HdrHistogram::getMean() const
+{
+	double total = 0;
+	uint64_t count = 0;
+	forEachBucket([&](int64_t lowest, int64_t highest, uint64_t frames) {
+		total += (lowest + (highest - lowest + 1) / 2) * double(frames);
+		count += frames;
+	});
+	return count ? total / count : 0.0;
+}
+
+double HdrHistogram::getStdDeviation() const
+{
+	const double mean = getMean();
+	double squares = 0;
+	uint64_t count = 0;
+	forEachBucket([&](int64_t lowest, int64_t highest, uint64_t frames) {
+		const double deviation = (lowest + (highest - lowest + 1) / 2) - mean;
+		squares += deviation * deviation * frames;
+		count += frames;
+	});
+	return count ? sqrt(squares / count) : 0.0;
+}
+
+int64_t HdrHistogram::getValueAtPercentile(double percentile) const
+{
+	uint64_t total = 0;
+	for (const auto& count : m_counts)
+		total += count.load(memory_order_relaxed);
+	if (total == 0)
+		return 0;
+
+	percentile = min(max(percentile, 0.0), 100.0);
+	const uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(ceil(percentile / 100.0 * total)));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < m_counts.size(); i++) {
+		seen += m_counts[i].load(memory_order_relaxed);
+		if (seen >= target) {
+			const int64_t value = percentile == 0.0 ? getValueFromIndex(i) : getHighestEquivalentValue(getValueFromIndex(i));
+			return min(max(value, getMin()), getMax());
+		}
+	}
+	return getMax();
+}
+
+void HdrHistogram::forEachBucket(const function<void(int64_t lowest, int64_t highest, uint64_t count)>& visit) const
+{
+	for (size_t i = 0; i < m_counts.size(); i++) {
+		const uint64_t count = m_counts[i].load(memory_order_relaxed);
+		if (count) {
+			const int64_t value = getValueFromIndex(i);
+			visit(value, getHighestEquivalentValue(value), count);
+		}
+	}
+}
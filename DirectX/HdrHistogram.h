@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// High dynamic range histogram (after Gil Tene's HdrHistogram): counts of
+// integer values in buckets whose width grows with the value, so every value
+// is kept to a fixed number of significant digits in memory that only depends
+// on the range and the precision, however long the run. Used for the frame
+// and phase times of soak runs, in microseconds or nanoseconds.
+class HdrHistogram {
+public:
+	// Tracks values from 0 to highest_value (at least 2) with significant_digits
+	// (1 to 5) decimal digits: a value v is counted in a bucket no wider than
+	// v / 10^significant_digits. Throws an invalid_argument otherwise.
+	explicit HdrHistogram(int64_t highest_value = 3600000000, int significant_digits = 3);
+
+	// copies the counts, a snapshot when the source is still being recorded into
+	HdrHistogram(const HdrHistogram& other);
+	HdrHistogram& operator=(const HdrHistogram& other);
+
+	// Counts value count times, lock-free from any number of threads. Negative
+	// values count as 0, values above the highest as the highest one and in
+	// getSaturatedCount.
+	void record(int64_t value, uint64_t count = 1) noexcept;
+
+	// Adds the counts of other, which needs the same range and precision
+	// (throws an invalid_argument otherwise). other may still be recorded into.
+	void add(const HdrHistogram& other);
+	// Moves the counts into interval (same range and precision) and leaves this
+	// one empty, for interval snapshots of a histogram that is being recorded
+	// into: every concurrent recording ends up in exactly one of the two.
+	void takeInterval(HdrHistogram& interval);
+	// not safe while another thread records
+	void reset() noexcept;
+
+	uint64_t getTotalCount() const { return m_totalCount.load(std::memory_order_relaxed); }
+	uint64_t getSaturatedCount() const { return m_saturatedCount.load(std::memory_order_relaxed); }
+	// 0 when empty
+	int64_t getMin() const;
+	int64_t getMax() const;
+	// from the middle of every bucket
+	double getMean() const;
+	double getStdDeviation() const;
+	// Nearest rank percentile (0 to 100) as the highest value of its bucket,
+	// kept within the min and the max; 0 when empty
+
+	int64_t getValueAtPercentile(double percentile) const;
+
+	// the range of values counted in the same bucket as value
+	int64_t getLowestEquivalentValue(int64_t value) const;
+	int64_t getHighestEquivalentValue(int64_t value) const;
+
+	int64_t getHighestValue() const { return m_highestValue; }
+	int getSignificantDigits() const { return m_significantDigits; }
+	size_t getMemoryBytes() const { return sizeof(*this) + m_counts.size() * sizeof(m_counts[0]); }
+
+	// Calls visit(lowest, highest, count) for every non-empty bucket from the
+	// smallest values up, to export the histogram.
+	void forEachBucket(const std::function<void(int64_t lowest, int64_t highest, uint64_t count)>& visit) const;
+
+private:
+	size_t getIndex(int64_t value) const;
+	int64_t getValueFromIndex(size_t index) const;
+	void checkCompatible(const HdrHistogram& other) const;
+	void updateMinMax(int64_t min, int64_t max) noexcept;
+
+	int64_t m_highestValue;
+	int m_significantDigits;
+	int m_subBucketHalfCountMagnitude;
+	int64_t m_subBucketHalfCount;
+	int64_t m_subBucketMask;
+	std::vector<std::atomic<uint64_t>> m_counts;
+	std::atomic<uint64_t> m_totalCount{ 0 };
+	std::atomic<uint64_t> m_saturatedCount{ 0 };
+	std::atomic<int64_t> m_min{ INT64_MAX };
+	std::atomic<int64_t> m_max{ 0 };
+};
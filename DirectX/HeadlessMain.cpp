@@ -0,0 +1,25 @@
+#include "BenchmarkRun.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The benchmark without Windows, built by CMake next to the Visual Studio
+// project: always a headless run (see runHeadlessBenchmark), with the same
+// arguments as ./directx.exe.
+//   ./directx_headless [name runtime model texture] [--cluster-cull] [--profile] ...
+
+int main(int argc, char** argv) {
+	RunOptions options;
+	string error;
+	vector<string> args(argv + 1, argv + argc);
+	args.push_back("--headless");
+	if (!parseRunOptions(args, options, error)) {
+		cerr << error << endl;
+		return EXIT_FAILURE;
+	}
+	return runHeadlessBenchmark(options);
+}
@@ -0,0 +1,116 @@
+#include "Image.h"
+
+#include "PixelConvert.h"
+#include "Profiler.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+// the factory WICTextureLoader creates
+namespace DirectX {
+	IWICImagingFactory* _GetWIC() noexcept;
+}
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+namespace {
+	// Decoder formats converted by PixelConvert instead of a WIC format
+	// converter, premultiplied ones go through two conversions
+	struct NativeFormat
+	{
+		const GUID* format;
+		PixelConversion conversion;
+		bool unpremultiply;
+	};
+
+	const NativeFormat NATIVE_FORMATS[] = {
+		{ &GUID_WICPixelFormat24bppRGB, PixelConversion::rgbToRgba, false },
+		{ &GUID_WICPixelFormat24bppBGR, PixelConversion::bgrToRgba, false },
+		{ &GUID_WICPixelFormat32bppBGRA, PixelConversion::bgraToRgba, false },
+		{ &GUID_WICPixelFormat32bppBGR, PixelConversion::bgrxToRgba, false },
+		{ &GUID_WICPixelFormat32bppRGB, PixelConversion::rgbxToRgba, false },
+		{ &GUID_WICPixelFormat32bppPBGRA, PixelConversion::bgraToRgba, true },
+		{ &GUID_WICPixelFormat32bppPRGBA, PixelConversion::unpremultiply, false },
+		{ &GUID_WICPixelFormat48bppRGB, PixelConversion::rgb16ToRgba, false },
+		{ &GUID_WICPixelFormat64bppRGBA, PixelConversion::rgba16ToRgba, false }
+	};
+
+	const NativeFormat* findNativeFormat(const WICPixelFormatGUID& format) {
+		for (const auto& native : NATIVE_FORMATS)
+			if (memcmp(native.format, &format, sizeof(GUID)) == 0)
+				return &native;
+		return nullptr;
+	}
+}
+#endif
+
+void loadImage(const string& path, Image& image)
+{
+	PROFILE_ZONE("loadImage");
+#ifdef _WIN32
+	using Microsoft::WRL::ComPtr;
+
+	// S_FALSE or RPC_E_CHANGED_MODE when com is already up, both are fine
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	IWICImagingFactory* wic = DirectX::_GetWIC();
+	if (!wic)
+		throw runtime_error("WIC is not available");
+
+	const wstring widePath(path.begin(), path.end());
+	ComPtr<IWICBitmapDecoder> decoder;
+	ComPtr<IWICBitmapFrameDecode> frame;
+	WICPixelFormatGUID format;
+	UINT width = 0, height = 0;
+	if (FAILED(wic->CreateDecoderFromFilename(widePath.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) ||
+		FAILED(decoder->GetFrame(0, frame.GetAddressOf())) ||
+		FAILED(frame->GetSize(&width, &height)) ||
+		FAILED(frame->GetPixelFormat(&format)))
+		throw runtime_error("can't decode " + path);
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(size_t(width) * height * 4);
+	const size_t pixelCount = size_t(width) * height;
+
+	// RGBA as it is, the common formats with the pixel kernels, the rest with WIC
+	if (memcmp(&format, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0) {
+		if (FAILED(frame->CopyPixels(nullptr, width * 4, static_cast<UINT>(image.pixels.size()), image.pixels.data())))
+			throw runtime_error("can't decode " + path);
+	}
+	else if (const NativeFormat* native = findNativeFormat(format)) {
+		const size_t pixelBytes = getSourcePixelBytes(native->conversion);
+		const UINT stride = static_cast<UINT>(width * pixelBytes);
+		if (pixelBytes == 4) {
+			// same size, converted in place
+			if (FAILED(frame->CopyPixels(nullptr, stride, static_cast<UINT>(image.pixels.size()), image.pixels.data())))
+				throw runtime_error("can't decode " + path);
+			convertPixels(native->conversion, image.pixels.data(), image.pixels.data(), pixelCount);
+		}
+		else {
+			vector<uint8_t> pixels(pixelCount * pixelBytes);
+			if (FAILED(frame->CopyPixels(nullptr, stride, static_cast<UINT>(pixels.size()), pixels.data())))
+				throw runtime_error("can't decode " + path);
+			convertPixels(native->conversion, pixels.data(), image.pixels.data(), pixelCount);
+		}
+		if (native->unpremultiply)
+			convertPixels(PixelConversion::unpremultiply, image.pixels.data(), image.pixels.data(), pixelCount);
+	}
+	else {
+		ComPtr<IWICFormatConverter> converter;
+		if (FAILED(wic->CreateFormatConverter(converter.GetAddressOf())) ||
+			FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeMedianCut)) ||
+			FAILED(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(image.pixels.size()), image.pixels.data())))
+			throw runtime_error("can't decode " + path);
+	}
+#else
+	(void)image;
+	throw runtime_error("can't decode " + path + ", images are decoded with WIC");
+#endif
+}
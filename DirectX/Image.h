@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An 8-bit RGBA image on the cpu, rows from top to bottom without padding
+struct Image
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels;
+
+	uint8_t* getPixel(uint32_t x, uint32_t y) { return &pixels[(size_t(y) * width + x) * 4]; }
+	const uint8_t* getPixel(uint32_t x, uint32_t y) const { return &pixels[(size_t(y) * width + x) * 4]; }
+};
+
+// A 32-bit float RGBA image, for formats that don't fit in 8 bits (BC6H, SNORM)
+struct FloatImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<float> pixels;
+
+	float* getPixel(uint32_t x, uint32_t y) { return &pixels[(size_t(y) * width + x) * 4]; }
+	const float* getPixel(uint32_t x, uint32_t y) const { return &pixels[(size_t(y) * width + x) * 4]; }
+};
+
+// Decodes an image file (png, jpg, bmp, ...) with WIC into 8-bit RGBA. The
+// common decoder formats (24-bit RGB, BGRA, premultiplied, 16 bits per
+// channel) are converted by PixelConvert, the others by WIC.
+// Throws a runtime_error when it can't be decoded, and always off Windows.
+void loadImage(const std::string& path, Image& image);
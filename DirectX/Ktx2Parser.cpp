@@ -0,0 +1,366 @@
+#include "Ktx2Parser.h"
+
+#include "Profiler.h"
+#include "ZstdDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	// identifier, header and index, the level index follows
+	const size_t KTX2_HEADER_SIZE = 80;
+	const size_t KTX2_LEVEL_SIZE = 24;
+	// the basic data format descriptor up to its flags byte
+	const size_t KTX2_DFD_FLAGS_OFFSET = 15;
+	const uint8_t KTX2_DFD_FLAG_ALPHA_PREMULTIPLIED = 1;
+
+	enum Supercompression : uint32_t
+	{
+		SUPERCOMPRESSION_NONE = 0,
+		SUPERCOMPRESSION_BASISLZ = 1,
+		SUPERCOMPRESSION_ZSTD = 2,
+		SUPERCOMPRESSION_ZLIB = 3
+	};
+
+	struct VkFormatMapping
+	{
+		uint32_t vkFormat;
+		DXGI_FORMAT format;
+	};
+
+	// the VkFormat values with a DXGI twin, same channel order in memory
+	const VkFormatMapping VK_FORMATS[] = {
+		{ 4, DXGI_FORMAT_B5G6R5_UNORM },             // R5G6B5_UNORM_PACK16
+		{ 8, DXGI_FORMAT_B5G5R5A1_UNORM },           // A1R5G5B5_UNORM_PACK16
+		{ 9, DXGI_FORMAT_R8_UNORM },
+		{ 10, DXGI_FORMAT_R8_SNORM },
+		{ 13, DXGI_FORMAT_R8_UINT },
+		{ 14, DXGI_FORMAT_R8_SINT },
+		{ 16, DXGI_FORMAT_R8G8_UNORM },
+		{ 17, DXGI_FORMAT_R8G8_SNORM },
+		{ 20, DXGI_FORMAT_R8G8_UINT },
+		{ 21, DXGI_FORMAT_R8G8_SINT },
+		{ 37, DXGI_FORMAT_R8G8B8A8_UNORM },
+		{ 38, DXGI_FORMAT_R8G8B8A8_SNORM },
+		{ 41, DXGI_FORMAT_R8G8B8A8_UINT },
+		{ 42, DXGI_FORMAT_R8G8B8A8_SINT },
+		{ 43, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB },
+		{ 44, DXGI_FORMAT_B8G8R8A8_UNORM },
+		{ 50, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB },
+		{ 64, DXGI_FORMAT_R10G10B10A2_UNORM },       // A2B10G10R10_UNORM_PACK32
+		{ 68, DXGI_FORMAT_R10G10B10A2_UINT },        // A2B10G10R10_UINT_PACK32
+		{ 70, DXGI_FORMAT_R16_UNORM },
+		{ 71, DXGI_FORMAT_R16_SNORM },
+		{ 74, DXGI_FORMAT_R16_UINT },
+		{ 75, DXGI_FORMAT_R16_SINT },
+		{ 76, DXGI_FORMAT_R16_FLOAT },
+		{ 77, DXGI_FORMAT_R16G16_UNORM },
+		{ 78, DXGI_FORMAT_R16G16_SNORM },
+		{ 81, DXGI_FORMAT_R16G16_UINT },
+		{ 82, DXGI_FORMAT_R16G16_SINT },
+		{ 83, DXGI_FORMAT_R16G16_FLOAT },
+		{ 91, DXGI_FORMAT_R16G16B16A16_UNORM },
+		{ 92, DXGI_FORMAT_R16G16B16A16_SNORM },
+		{ 95, DXGI_FORMAT_R16G16B16A16_UINT },
+		{ 96, DXGI_FORMAT_R16G16B16A16_SINT },
+		{ 97, DXGI_FORMAT_R16G16B16A16_FLOAT },
+		{ 98, DXGI_FORMAT_R32_UINT },
+		{ 99, DXGI_FORMAT_R32_SINT },
+		{ 100, DXGI_FORMAT_R32_FLOAT },
+		{ 101, DXGI_FORMAT_R32G32_UINT },
+		{ 102, DXGI_FORMAT_R32G32_SINT },
+		{ 103, DXGI_FORMAT_R32G32_FLOAT },
+		{ 104, DXGI_FORMAT_R32G32B32_UINT },
+		{ 105, DXGI_FORMAT_R32G32B32_SINT },
+		{ 106, DXGI_FORMAT_R32G32B32_FLOAT },
+		{ 107, DXGI_FORMAT_R32G32B32A32_UINT },
+		{ 108, DXGI_FORMAT_R32G32B32A32_SINT },
+		{ 109, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ 122, DXGI_FORMAT_R11G11B10_FLOAT },        // B10G11R11_UFLOAT_PACK32
+		{ 123, DXGI_FORMAT_R9G9B9E5_SHAREDEXP },     // E5B9G9R9_UFLOAT_PACK32
+		{ 124, DXGI_FORMAT_D16_UNORM },
+		{ 126, DXGI_FORMAT_D32_FLOAT },
+		{ 131, DXGI_FORMAT_BC1_UNORM },              // BC1_RGB_UNORM_BLOCK
+		{ 132, DXGI_FORMAT_BC1_UNORM_SRGB },
+		{ 133, DXGI_FORMAT_BC1_UNORM },              // BC1_RGBA_UNORM_BLOCK
+		{ 134, DXGI_FORMAT_BC1_UNORM_SRGB },
+		{ 135, DXGI_FORMAT_BC2_UNORM },
+		{ 136, DXGI_FORMAT_BC2_UNORM_SRGB },
+		{ 137, DXGI_FORMAT_BC3_UNORM },
+		{ 138, DXGI_FORMAT_BC3_UNORM_SRGB },
+		{ 139, DXGI_FORMAT_BC4_UNORM },
+		{ 140, DXGI_FORMAT_BC4_SNORM },
+		{ 141, DXGI_FORMAT_BC5_UNORM },
+		{ 142, DXGI_FORMAT_BC5_SNORM },
+		{ 143, DXGI_FORMAT_BC6H_UF16 },
+		{ 144, DXGI_FORMAT_BC6H_SF16 },
+		{ 145, DXGI_FORMAT_BC7_UNORM },
+		{ 146, DXGI_FORMAT_BC7_UNORM_SRGB },
+		{ 1000340000, DXGI_FORMAT_B4G4R4A4_UNORM }   // A4R4G4B4_UNORM_PACK16
+	};
+
+	uint32_t readU32(const uint8_t* data) {
+		return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+	}
+
+	uint64_t readU64(const uint8_t* data) {
+		return uint64_t(readU32(data)) | uint64_t(readU32(data + 4)) << 32;
+	}
+
+	struct Ktx2Level
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// Runs job(i) for every i in [0, count) on up to num_threads threads, in
+	// order, and rethrows the first exception a job threw.
+	template <typename Job>
+	void forEachLevel(size_t count, unsigned int num_threads, Job job) {
+		num_threads = static_cast<unsigned int>(min<size_t>(num_threads, count));
+		if (num_threads <= 1) {
+			for (size_t i = 0; i < count; i++)
+				job(i);
+			return;
+		}
+
+		atomic<size_t> next(0);
+		mutex errorMutex;
+		exception_ptr error;
+		vector<thread> workers;
+		workers.reserve(num_threads);
+		for (unsigned int t = 0; t < num_threads; t++) {
+			workers.emplace_back([&]() {
+				for (size_t i = next++; i < count; i = next++) {
+					try {
+						job(i);
+					}
+					catch (...) {
+						lock_guard<mutex> lock(errorMutex);
+						if (!error)
+							error = current_exception();
+						next = count;
+					}
+				}
+			});
+		}
+		for (auto& worker : workers)
+			worker.join();
+		if (error)
+			rethrow_exception(error);
+	}
+
+	[[noreturn]] void fail(const string& path, const string& what) {
+		throw runtime_error(path + ": ktx2: " + what);
+	}
+}
+
+DXGI_FORMAT getDxgiFormatFromVk(uint32_t vk_format)
+{
+	for (const auto& mapping : VK_FORMATS) {
+		if (mapping.vkFormat == vk_format)
+			return mapping.format;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+void readKtx2(const string& path, const DdsReadOptions& options, DdsStreamedTexture& streamed, unsigned int num_threads)
+{
+	PROFILE_ZONE("readKtx2");
+	streamed = DdsStreamedTexture();
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file)
+		throw runtime_error("can't open " + path);
+	streamed.fileSize = static_cast<uint64_t>(file.tellg());
+	auto readAt = [&](uint64_t offset, void* destination, size_t bytes) {
+		file.seekg(static_cast<streamoff>(offset));
+		if (!file.read(static_cast<char*>(destination), static_cast<streamsize>(bytes)))
+			throw runtime_error("can't read " + path);
+		streamed.bytesRead += bytes;
+	};
+
+	// the header, then the level index; the level data is only read once the options picked the levels
+	uint8_t header[KTX2_HEADER_SIZE];
+	if (streamed.fileSize < sizeof(header))
+		fail(path, "file too small for the header");
+	readAt(0, header, sizeof(header));
+	if (memcmp(header, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		fail(path, "bad identifier");
+
+	const uint32_t vkFormat = readU32(header + 12);
+	const uint32_t pixelWidth = readU32(header + 20);
+	const uint32_t pixelHeight = readU32(header + 24);
+	const uint32_t pixelDepth = readU32(header + 28);
+	const uint32_t layerCount = readU32(header + 32);
+	const uint32_t faceCount = readU32(header + 36);
+	const uint32_t levelCount = readU32(header + 40);
+	const uint32_t scheme = readU32(header + 44);
+	const uint32_t dfdByteOffset = readU32(header + 48);
+	const uint32_t dfdByteLength = readU32(header + 52);
+
+	switch (scheme) {
+	case SUPERCOMPRESSION_NONE:
+	case SUPERCOMPRESSION_ZSTD:
+		break;
+	case SUPERCOMPRESSION_BASISLZ:
+		fail(path, "BasisLZ supercompression is not supported");
+	case SUPERCOMPRESSION_ZLIB:
+		fail(path, "zlib supercompression is not supported");
+	default:
+		fail(path, "unknown supercompression scheme " + to_string(scheme));
+	}
+	if (vkFormat == 0)
+		fail(path, "Basis Universal textures (VK_FORMAT_UNDEFINED) are not supported");
+
+	DdsTexture layout;
+	layout.format = getDxgiFormatFromVk(vkFormat);
+	if (layout.format == DXGI_FORMAT_UNKNOWN)
+		fail(path, "VkFormat " + to_string(vkFormat) + " has no DXGI format");
+	if (faceCount != 1 && faceCount != 6)
+		fail(path, "face count " + to_string(faceCount));
+	layout.width = pixelWidth;
+	layout.height = max(pixelHeight, 1u);
+	layout.depth = max(pixelDepth, 1u);
+	layout.mipCount = max(levelCount, 1u);
+	layout.arraySize = max(layerCount, 1u);
+	layout.cubemap = faceCount == 6;
+	if (pixelHeight == 0)
+		layout.dimension = DdsDimension::texture1d;
+	else if (pixelDepth == 0)
+		layout.dimension = DdsDimension::texture2d;
+	else
+		layout.dimension = DdsDimension::texture3d;
+
+	if (pixelWidth == 0)
+		fail(path, "empty texture");
+	if (layout.cubemap && (layout.dimension != DdsDimension::texture2d || pixelWidth != pixelHeight))
+		fail(path, "cubemap faces must be square 2d images");
+	if (layout.dimension == DdsDimension::texture3d && layout.arraySize > 1)
+		fail(path, "3d textures can't be arrays");
+	if (layout.cubemap) {
+		if (layout.arraySize > UINT32_MAX / 6)
+			fail(path, "too many cubes");
+		layout.arraySize *= 6;
+	}
+	if (!fitsDirect3D11(layout))
+		fail(path, "larger than Direct3D 11 allows");
+
+	// premultiplied alpha is a flag of the data format descriptor
+	if (dfdByteLength > KTX2_DFD_FLAGS_OFFSET && uint64_t(dfdByteOffset) + dfdByteLength <= streamed.fileSize) {
+		uint8_t descriptor[KTX2_DFD_FLAGS_OFFSET + 1];
+		readAt(dfdByteOffset, descriptor, sizeof(descriptor));
+		layout.alphaMode = (descriptor[KTX2_DFD_FLAGS_OFFSET] & KTX2_DFD_FLAG_ALPHA_PREMULTIPLIED) ?
+			DDS_ALPHA_MODE_PREMULTIPLIED : DDS_ALPHA_MODE_STRAIGHT;
+	}
+
+	vector<uint8_t> index(size_t(layout.mipCount) * KTX2_LEVEL_SIZE);
+	if (streamed.fileSize < sizeof(header) + index.size())
+		fail(path, "file too small for the level index");
+	readAt(sizeof(header), index.data(), index.size());
+
+	// one surface per slice of every level; the slices of a level are layer by layer, face by face
+	vector<Ktx2Level> levels(layout.mipCount);
+	layout.surfaces.resize(size_t(layout.arraySize) * layout.mipCount);
+	uint32_t width = layout.width;
+	uint32_t height = layout.height;
+	uint32_t depth = layout.depth;
+	for (uint32_t mip = 0; mip < layout.mipCount; mip++) {
+		Ktx2Level& level = levels[mip];
+		const uint8_t* entry = index.data() + size_t(mip) * KTX2_LEVEL_SIZE;
+		level.byteOffset = readU64(entry);
+		level.byteLength = readU64(entry + 8);
+		level.uncompressedByteLength = readU64(entry + 16);
+
+		DdsSurface surface;
+		if (!getSurfaceLayout(width, height, layout.format, surface.layout))
+			fail(path, "surface too large");
+		surface.size = surface.layout.slicePitch * depth;
+		surface.width = width;
+		surface.height = height;
+		surface.depth = depth;
+		surface.data = nullptr;
+
+		const string name = "level " + to_string(mip);
+		if (level.uncompressedByteLength != uint64_t(surface.size) * layout.arraySize)
+			fail(path, name + " holds " + to_string(level.uncompressedByteLength) + " bytes instead of " +
+				to_string(uint64_t(surface.size) * layout.arraySize));
+		if (scheme == SUPERCOMPRESSION_NONE && level.byteLength != level.uncompressedByteLength)
+			fail(path, name + " is not supercompressed but its lengths differ");
+		if (level.byteOffset > streamed.fileSize || level.byteLength > streamed.fileSize - level.byteOffset)
+			fail(path, "file ends inside " + name);
+
+		for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+			surface.offset = static_cast<size_t>(level.byteOffset) + (scheme == SUPERCOMPRESSION_NONE ? slice * surface.size : 0);
+			layout.surfaces[size_t(slice) * layout.mipCount + mip] = surface;
+		}
+
+		width = max(width / 2, 1u);
+		height = max(height / 2, 1u);
+		depth = max(depth / 2, 1u);
+	}
+
+	// the kept levels go one after another into data, the largest first
+	const uint32_t first = getFirstReadMip(layout, options);
+	vector<size_t> levelStarts(layout.mipCount, 0);
+	size_t keptBytes = 0;
+	for (uint32_t mip = first; mip < layout.mipCount; mip++) {
+		levelStarts[mip] = keptBytes;
+		keptBytes += static_cast<size_t>(levels[mip].uncompressedByteLength);
+	}
+	streamed.skippedMips = first;
+	streamed.data.resize(keptBytes);
+
+	if (scheme == SUPERCOMPRESSION_NONE) {
+		for (uint32_t mip = first; mip < layout.mipCount; mip++)
+			readAt(levels[mip].byteOffset, streamed.data.data() + levelStarts[mip], static_cast<size_t>(levels[mip].byteLength));
+	}
+	else {
+		vector<vector<uint8_t>> compressed(layout.mipCount);
+		for (uint32_t mip = first; mip < layout.mipCount; mip++) {
+			compressed[mip].resize(static_cast<size_t>(levels[mip].byteLength));
+			readAt(levels[mip].byteOffset, compressed[mip].data(), compressed[mip].size());
+		}
+		if (num_threads == 0)
+			num_threads = max(1u, thread::hardware_concurrency());
+		forEachLevel(layout.mipCount - first, num_threads, [&](size_t i) {
+			const uint32_t mip = first + static_cast<uint32_t>(i);
+			const size_t bytes = static_cast<size_t>(levels[mip].uncompressedByteLength);
+			size_t written;
+			try {
+				written = decompressZstd(compressed[mip].data(), compressed[mip].size(), streamed.data.data() + levelStarts[mip], bytes);
+			}
+			catch (const exception& e) {
+				throw runtime_error(path + ": level " + to_string(mip) + ": " + e.what());
+			}
+			if (written != bytes)
+				throw runtime_error(path + ": level " + to_string(mip) + " decompresses to " + to_string(written) + " bytes instead of " + to_string(bytes));
+		});
+	}
+
+	DdsTexture& texture = streamed.texture;
+	texture = layout;
+	texture.mipCount = layout.mipCount - first;
+	texture.surfaces.clear();
+	for (uint32_t slice = 0; slice < layout.arraySize; slice++) {
+		for (uint32_t mip = first; mip < layout.mipCount; mip++) {
+			DdsSurface surface = layout.getSurface(slice, mip);
+			surface.data = streamed.data.data() + levelStarts[mip] + slice * surface.size;
+			texture.surfaces.push_back(surface);
+		}
+	}
+	texture.width = texture.surfaces[0].width;
+	texture.height = texture.surfaces[0].height;
+	texture.depth = texture.surfaces[0].depth;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "DxgiFormat.h"
+
+#include <cstdint>
+#include <string>
+
+// Reads KTX2 files into the same DdsStreamedTexture readDds fills, so they go
+// through the upload path of .dds files. Levels may be stored as they are or
+// supercompressed with Zstandard; Basis Universal (BasisLZ, UASTC without a
+// VkFormat) and zlib are rejected.
+
+// DXGI format of a VkFormat value, DXGI_FORMAT_UNKNOWN when Direct3D 11 has no
+// matching format
+DXGI_FORMAT getDxgiFormatFromVk(uint32_t vk_format);
+
+// Reads the header and level index of path, then seeks to the levels options
+// keep and reads only those, one read per level. Supercompressed levels are
+// decompressed on num_threads threads (0 for one per core), the largest first.
+// The texture looks like the one readDds gives: slice = layer * faces + face,
+// the offsets of supercompressed surfaces are those of their compressed level.
+// Throws a runtime_error naming the file and the first problem found.
+void readKtx2(const std::string& path, const DdsReadOptions& options, DdsStreamedTexture& streamed,
+	unsigned int num_threads = 0);
@@ -9,7 +9,8 @@ Log::Log(time_t timestamp,
 	string renderEngine,
 	string objectName,
 	float frames,
-	float cpuUsage)
+	float cpuUsage,
+	CpuUsage processCpu)
 {
 	m_timestamp = timestamp;
 	m_pcId = pcId;
@@ -17,6 +18,7 @@ Log::Log(time_t timestamp,
 	m_objectName = objectName;
 	m_frames = frames;
 	m_cpuUsage = cpuUsage;
+	m_processCpu = processCpu;
 }
 
 Log::~Log()
@@ -2,6 +2,7 @@
 
 #include <ctime>
 #include <string>
+#include "CpuSampler.h"
 
 using namespace std;
 
@@ -12,7 +13,8 @@ public:
 		string renderEngine,
 		string objectName,
 		float frames,
-		float cpuUsage);
+		float cpuUsage,
+		CpuUsage processCpu = CpuUsage());
 	~Log();
 
 	time_t m_timestamp;
@@ -21,4 +23,6 @@ public:
 	string m_objectName;
 	float m_frames;
 	float m_cpuUsage;
+	// this process over the last interval, m_cpuUsage is the whole system
+	CpuUsage m_processCpu;
 };
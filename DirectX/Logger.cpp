@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 
 using namespace std;
@@ -28,7 +29,7 @@ void Logger::ExportLogFile()
 	#pragma endregion
 
 	ofstream file;
-	file.open("data\\" + getTimeTypeName(m_timeType) + "-data-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv");
+	file.open("data/" + getTimeTypeName(m_timeType) + "-data-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv");
 
 	#pragma region --- csv header ---
 	file << "timestamp" << m_separator
@@ -47,14 +48,26 @@ void Logger::ExportLogFile()
 		throw runtime_error("unhandled time type");
 		break;
 	}
-	file << m_separator << "cpu";
+	file << m_separator << "cpu"
+		<< m_separator << "process-cpu"
+		<< m_separator << "thread-cpu"
+		<< m_separator << "user-cpu"
+		<< m_separator << "system-cpu"
+		<< m_separator << "voluntary-switches"
+		<< m_separator << "involuntary-switches"
+		<< m_separator << "page-faults"
+		<< m_separator << "major-faults"
+		<< m_separator << "resident-mb";
 	#pragma endregion
 
 	//skip first logs as it's always inaccurate as the program will be in the process of booting up
 	//by the time the logs are kept it should've stabilised
+	//without the system counter (-1) the process counters tell when the first interval was sampled
 	for (size_t i = 0; i < m_logs.size(); i++)
 	{
-		if (m_logs[i].m_cpuUsage > 0 && m_logs[i].m_frames > 0)
+		const CpuUsage& process = m_logs[i].m_processCpu;
+		const bool sampled = m_logs[i].m_cpuUsage > 0 || (m_logs[i].m_cpuUsage < 0 && process.seconds > 0);
+		if (sampled && m_logs[i].m_frames > 0)
 		{
 			file << '\n';
 			file << m_logs[i].m_timestamp << m_separator
@@ -62,14 +75,59 @@ void Logger::ExportLogFile()
 				<< m_logs[i].m_renderEngine << m_separator
 				<< m_logs[i].m_objectName << m_separator
 				<< m_logs[i].m_frames << m_separator
-				<< m_logs[i].m_cpuUsage;
+				<< m_logs[i].m_cpuUsage << m_separator
+				<< process.processPercent << m_separator
+				<< process.threadPercent << m_separator
+				<< process.userPercent << m_separator
+				<< process.systemPercent << m_separator
+				<< process.voluntarySwitches << m_separator
+				<< process.involuntarySwitches << m_separator
+				<< process.pageFaults << m_separator
+				<< process.majorFaults << m_separator
+				<< (process.residentBytes < 0 ? -1 : process.residentBytes >> 20);
 		}
 	}
 
 	file.close();
+
+	for (const auto& histogram : m_histograms)
+		ExportHistogram(histogram);
+}
+
+void Logger::ExportHistogram(const NamedHistogram& named)
+{
+	const HdrHistogram& histogram = *named.histogram;
+	if (histogram.getTotalCount() == 0)
+		return;
+
+	const string unit = getTimeUnitName(named.unit);
+	const string suffix = named.name + "-" + m_pcId + "-" + m_renderEngine + "-" + m_objectName + ".csv";
+	ofstream file("data/hdr-" + suffix);
+	file << "percentile" << m_separator << unit;
+	for (double percentile : { 0.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0 })
+		file << '\n' << percentile << m_separator << histogram.getValueAtPercentile(percentile);
+	file << fixed << setprecision(1)
+		<< "\ncount" << m_separator << histogram.getTotalCount()
+		<< "\nsaturated" << m_separator << histogram.getSaturatedCount()
+		<< "\nmean" << m_separator << histogram.getMean()
+		<< "\nstddev" << m_separator << histogram.getStdDeviation();
+
+	//every non-empty bucket, summing the counts of the same bucket merges runs
+	ofstream buckets("data/hdr-buckets-" + suffix);
+	buckets << "from-" << unit << m_separator << "to-" << unit << m_separator << "count";
+	histogram.forEachBucket([&](int64_t lowest, int64_t highest, uint64_t count) {
+		buckets << '\n' << lowest << m_separator << highest << m_separator << count;
+	});
 }
 
 void Logger::AddLog(Log log)
 {
 	m_logs.push_back(log);
 }
+
+HdrHistogram& Logger::AddHistogram(string name, TimeUnit unit, int significant_digits)
+{
+	const int64_t minute = unit == TimeUnit::nanoseconds ? 60000000000 : 60000000;
+	m_histograms.push_back({ name, unit, make_unique<HdrHistogram>(minute, significant_digits) });
+	return *m_histograms.back().histogram;
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "Log.h"
+#include "HdrHistogram.h"
 
 using namespace std;
 
@@ -13,7 +16,7 @@ enum class TimeType
 	nrt
 };
 
-string getTimeTypeName(TimeType timeType) {
+inline string getTimeTypeName(TimeType timeType) {
 	switch (timeType)
 	{
 	case TimeType::rt:
@@ -21,10 +24,21 @@ string getTimeTypeName(TimeType timeType) {
 	case TimeType::nrt:
 		return "nrt";
 	default:
-		break;
+		throw runtime_error("unhandled time type");
 	}
+}
+
+// unit of the times a histogram records, named in the headers of its export
+enum class TimeUnit
+{
+	microseconds,
+	nanoseconds
 };
 
+inline const char* getTimeUnitName(TimeUnit unit) {
+	return unit == TimeUnit::nanoseconds ? "ns" : "us";
+}
+
 class Logger {
 public:
 	Logger(string pcId, string renderEngine, string objectName, TimeType timeType = TimeType::rt, char separator = ';');
@@ -32,12 +46,25 @@ public:
 
 	void ExportLogFile();
 	void AddLog(Log log);
+	// Adds a histogram of times in unit, up to a minute, that ExportLogFile
+	// writes out too: its percentiles and its buckets, so runs can be merged
+	// afterwards. The reference stays valid as long as the logger.
+	HdrHistogram& AddHistogram(string name, TimeUnit unit = TimeUnit::microseconds, int significant_digits = 3);
 
 private:
 	string m_pcId;
 	string m_renderEngine;
 	string m_objectName;
 	vector<Log> m_logs;
+	struct NamedHistogram
+	{
+		string name;
+		TimeUnit unit;
+		unique_ptr<HdrHistogram> histogram;
+	};
+	vector<NamedHistogram> m_histograms;
 	TimeType m_timeType;
 	char m_separator;
+
+	void ExportHistogram(const NamedHistogram& histogram);
 };
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path) {
+	open(path);
+}
+
+//destructor
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const string& path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_file = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	m_open = true;
+
+	// an empty file can't be mapped, but it is still a valid (empty) view
+	if (m_size == 0)
+		return true;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		return false;
+	}
+	m_mapping = mapping;
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr) {
+		close();
+		return false;
+	}
+#else
+	m_file = ::open(path.c_str(), O_RDONLY);
+	if (m_file < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(m_file, &st) != 0) {
+		close();
+		return false;
+	}
+	m_size = static_cast<size_t>(st.st_size);
+	m_open = true;
+
+	if (m_size == 0)
+		return true;
+
+	void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (view == MAP_FAILED) {
+		close();
+		return false;
+	}
+	m_data = static_cast<const uint8_t*>(view);
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	if (m_file >= 0)
+		::close(m_file);
+	m_file = -1;
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
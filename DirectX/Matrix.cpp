@@ -0,0 +1,81 @@
+#include "Matrix.h"
+
+#include <cmath>
+
+Matrix matrixIdentity()
+{
+	Matrix result = {};
+	for (int i = 0; i < 4; i++)
+		result.m[i][i] = 1.0f;
+	return result;
+}
+
+Matrix matrixMultiply(const Matrix& a, const Matrix& b)
+{
+	Matrix result = {};
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			for (int i = 0; i < 4; i++)
+				result.m[row][column] += a.m[row][i] * b.m[i][column];
+	return result;
+}
+
+Matrix matrixTranspose(const Matrix& a)
+{
+	Matrix result;
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			result.m[row][column] = a.m[column][row];
+	return result;
+}
+
+Matrix matrixTranslation(float x, float y, float z)
+{
+	Matrix result = matrixIdentity();
+	result.m[3][0] = x;
+	result.m[3][1] = y;
+	result.m[3][2] = z;
+	return result;
+}
+
+Matrix matrixScaling(float x, float y, float z)
+{
+	Matrix result = matrixIdentity();
+	result.m[0][0] = x;
+	result.m[1][1] = y;
+	result.m[2][2] = z;
+	return result;
+}
+
+Matrix matrixRotationX(float angle)
+{
+	const float c = cosf(angle), s = sinf(angle);
+	Matrix result = matrixIdentity();
+	result.m[1][1] = c;
+	result.m[1][2] = s;
+	result.m[2][1] = -s;
+	result.m[2][2] = c;
+	return result;
+}
+
+Matrix matrixRotationY(float angle)
+{
+	const float c = cosf(angle), s = sinf(angle);
+	Matrix result = matrixIdentity();
+	result.m[0][0] = c;
+	result.m[0][2] = -s;
+	result.m[2][0] = s;
+	result.m[2][2] = c;
+	return result;
+}
+
+Matrix matrixRotationZ(float angle)
+{
+	const float c = cosf(angle), s = sinf(angle);
+	Matrix result = matrixIdentity();
+	result.m[0][0] = c;
+	result.m[0][1] = s;
+	result.m[1][0] = -s;
+	result.m[1][1] = c;
+	return result;
+}
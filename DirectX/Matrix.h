@@ -0,0 +1,21 @@
+#pragma once
+
+// 4x4 float matrices for the model transform, laid out like DirectXMath's
+// XMMATRIX: row major with row vectors (p' = p * m), translation in the last
+// row, so products read left to right in the order they are applied.
+struct Matrix
+{
+	float m[4][4];
+};
+
+Matrix matrixIdentity();
+Matrix matrixMultiply(const Matrix& a, const Matrix& b);
+Matrix matrixTranspose(const Matrix& a);
+Matrix matrixTranslation(float x, float y, float z);
+Matrix matrixScaling(float x, float y, float z);
+// left handed rotations by angle radians about an axis, like XMMatrixRotationX/Y/Z
+Matrix matrixRotationX(float angle);
+Matrix matrixRotationY(float angle);
+Matrix matrixRotationZ(float angle);
+
+inline Matrix operator*(const Matrix& a, const Matrix& b) { return matrixMultiply(a, b); }
@@ -0,0 +1,23 @@
+#include "Mesh.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+unsigned int getIndexSize(size_t vertex_count) {
+	// the largest index is vertex_count - 1
+	return vertex_count <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void validateIndices(const MeshData& mesh, unsigned int index_size, const string& name) {
+	const uint64_t vertexCount = mesh.vertices.size();
+	const uint64_t maxIndex = index_size == sizeof(uint16_t) ? 0xFFFF : 0xFFFFFFFF;
+
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+		const uint32_t index = mesh.indices[i];
+		if (index >= vertexCount || index > maxIndex) {
+			throw runtime_error(name + ": index " + to_string(i) + " (" + to_string(index) + ") doesn't fit "
+				+ to_string(vertexCount) + " vertices in " + to_string(index_size * 8) + "-bit indices");
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <string>
+
+#pragma region structs
+struct Vertex
+{
+	struct
+	{
+		float x;
+		float y;
+		float z;
+	} pos;
+
+	struct
+	{
+		float u;
+		float v;
+	} texCoord;
+
+	// two vertices are the same when every attribute has the same bit pattern
+	bool operator==(const Vertex& other) const {
+		return memcmp(this, &other, sizeof(Vertex)) == 0;
+	}
+
+	uint64_t hash() const {
+		uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+		memcpy(words, this, sizeof(Vertex));
+
+		// multiply-xorshift per attribute, finished with the murmur3 64-bit mixer
+		uint64_t h = 0x9E3779B97F4A7C15ull;
+		for (uint32_t word : words) {
+			h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+		}
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+};
+
+namespace std {
+	template<> struct hash<Vertex> {
+		size_t operator()(Vertex const& vertex) const {
+			return static_cast<size_t>(vertex.hash());
+		}
+	};
+}
+
+// Layout of the vertex buffer. The compact formats store the position as
+// UNORM16 relative to the mesh bounds, the vertex shader gets it back through
+// the transform constant (see getPositionDecode).
+enum class VertexFormat
+{
+	float32,      // float3 position, float2 uv (20 bytes)
+	unorm16_half, // unorm16x4 position, half2 uv (12 bytes)
+	unorm16       // unorm16x4 position, unorm16x2 uv (12 bytes), uvs must be in [0, 1]
+};
+
+// box, bounding sphere and centroid of every vertex of a mesh (see computeBounds)
+struct MeshBounds
+{
+	float min[3] = { 0.0f, 0.0f, 0.0f };
+	float max[3] = { 0.0f, 0.0f, 0.0f };
+	// sphere around the center of the box
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	float radius = 0.0f;
+	// mean vertex position
+	float centroid[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// One level of detail: a range of MeshData::indices, drawn with the shared vertices
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error; // quadric distance of the simplified surface to the full detail one, in model units
+};
+
+// A small cluster of triangles: a range of MeshData::indices with bounds to
+// cull it with (see Meshlets.h)
+struct Meshlet
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+
+	// bounding sphere
+	float center[3];
+	float radius;
+
+	// every triangle normal lies within the cone around coneAxis, coneCutoff is
+	// the sine of its half angle (> 1 when the normals are too spread to cull)
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+// cpu side copy of a loaded model, ready to be uploaded by Graphics::createMesh
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	MeshBounds bounds;
+	// lods[0] is the full detail mesh, empty when no lods were built (see buildLods)
+	std::vector<MeshLod> lods;
+	// clusters of the full detail level, empty when none were built (see buildMeshlets)
+	std::vector<Meshlet> meshlets;
+
+	// the vertices in vertexFormat when that isn't float32, see packVertices
+	VertexFormat vertexFormat = VertexFormat::float32;
+	std::vector<uint8_t> packedVertices;
+};
+
+#pragma endregion structs
+
+// Bytes per index (2 or 4) needed to address vertex_count vertices.
+// 16-bit indices are used whenever they fit, to keep the index bandwidth low.
+unsigned int getIndexSize(size_t vertex_count);
+
+// Throws a runtime_error naming the first index that is out of range for the
+// vertex count or that doesn't fit in index_size bytes.
+void validateIndices(const MeshData& mesh, unsigned int index_size, const std::string& name);
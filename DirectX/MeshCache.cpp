@@ -0,0 +1,136 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+bool MeshCache::load(const string& cache_path, const SourceKey& key, MeshData& mesh, VertexFormat format) {
+	PROFILE_ZONE("MeshCache::load");
+	MappedFile file;
+	if (!file.open(cache_path) || file.size() < sizeof(Header))
+		return false;
+
+	Header header;
+	memcpy(&header, file.data(), sizeof(Header));
+	if (header.magic != MAGIC || header.version != VERSION)
+		return false;
+	if (header.sourceSize != key.size || header.sourceStamp != key.stamp)
+		return false;
+	if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t))
+		return false;
+	if (header.requestedFormat != static_cast<uint32_t>(format) || header.vertexFormat > static_cast<uint32_t>(VertexFormat::unorm16))
+		return false;
+	const VertexFormat vertexFormat = static_cast<VertexFormat>(header.vertexFormat);
+
+	// the stored name guards against two models sharing one cache file
+	const uint8_t* cursor = file.data() + sizeof(Header);
+	const size_t vertexBytes = getVertexSize(vertexFormat) * header.vertexCount;
+	const size_t lodBytes = sizeof(MeshLod) * header.lodCount;
+	const size_t meshletBytes = sizeof(Meshlet) * header.meshletCount;
+	const size_t indexBytes = header.indexSize * header.indexCount;
+	if (file.size() != sizeof(Header) + header.pathLength + lodBytes + meshletBytes + vertexBytes + indexBytes)
+		return false;
+	if (header.pathLength != key.name.size() || memcmp(cursor, key.name.data(), key.name.size()) != 0)
+		return false;
+	cursor += header.pathLength;
+
+	vector<MeshLod> lods(header.lodCount);
+	memcpy(lods.data(), cursor, lodBytes);
+	for (const auto& lod : lods) {
+		if (uint64_t(lod.indexOffset) + lod.indexCount > header.indexCount)
+			return false;
+	}
+	cursor += lodBytes;
+
+	vector<Meshlet> meshlets(header.meshletCount);
+	memcpy(meshlets.data(), cursor, meshletBytes);
+	for (const auto& meshlet : meshlets) {
+		if (uint64_t(meshlet.indexOffset) + meshlet.indexCount > header.indexCount)
+			return false;
+	}
+	cursor += meshletBytes;
+
+	mesh.lods = move(lods);
+	mesh.meshlets = move(meshlets);
+	mesh.bounds = header.bounds;
+	mesh.vertexFormat = vertexFormat;
+	if (vertexFormat == VertexFormat::float32) {
+		mesh.vertices.resize(header.vertexCount);
+		memcpy(mesh.vertices.data(), cursor, vertexBytes);
+		mesh.packedVertices.clear();
+	}
+	else {
+		mesh.packedVertices.assign(cursor, cursor + vertexBytes);
+		unpackVertices(mesh);
+	}
+	cursor += vertexBytes;
+
+	mesh.indices.resize(header.indexCount);
+	if (header.indexSize == sizeof(uint32_t)) {
+		memcpy(mesh.indices.data(), cursor, indexBytes);
+	}
+	else {
+		const uint16_t* narrow = reinterpret_cast<const uint16_t*>(cursor);
+		for (uint32_t i = 0; i < header.indexCount; i++)
+			mesh.indices[i] = narrow[i];
+	}
+
+	return true;
+}
+
+bool MeshCache::save(const string& cache_path, const SourceKey& key, const MeshData& mesh, VertexFormat format) {
+	PROFILE_ZONE("MeshCache::save");
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.sourceSize = key.size;
+	header.sourceStamp = key.stamp;
+	header.pathLength = static_cast<uint32_t>(key.name.size());
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.indexSize = getIndexSize(mesh.vertices.size());
+	header.bounds = mesh.bounds;
+	header.requestedFormat = static_cast<uint32_t>(format);
+	header.vertexFormat = static_cast<uint32_t>(mesh.vertexFormat);
+	header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+	header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+
+	// write to a temporary file first, so an interrupted bake never leaves a half written cache behind
+	const string tempPath = cache_path + ".tmp";
+	{
+		ofstream file(tempPath, ios::binary | ios::trunc);
+		if (!file)
+			return false;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(key.name.data(), key.name.size());
+		file.write(reinterpret_cast<const char*>(mesh.lods.data()), sizeof(MeshLod) * mesh.lods.size());
+		file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), sizeof(Meshlet) * mesh.meshlets.size());
+		if (mesh.vertexFormat == VertexFormat::float32)
+			file.write(reinterpret_cast<const char*>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+		else
+			file.write(reinterpret_cast<const char*>(mesh.packedVertices.data()), mesh.packedVertices.size());
+		if (header.indexSize == sizeof(uint32_t)) {
+			file.write(reinterpret_cast<const char*>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+		}
+		else {
+			const vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+			file.write(reinterpret_cast<const char*>(narrow.data()), sizeof(uint16_t) * narrow.size());
+		}
+		if (!file)
+			return false;
+	}
+
+	error_code ec;
+	filesystem::rename(tempPath, cache_path, ec);
+	if (ec) {
+		filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
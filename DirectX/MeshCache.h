@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstdint>
+#include <string>
+
+// Binary copy of a processed model, the format of the mesh entries of the
+// AssetCache. A cache is only used when the key of the source model still
+// matches the one it was baked from.
+class MeshCache {
+public:
+	static const uint32_t MAGIC = 0x4348534D; // "MSHC"
+	static const uint32_t VERSION = 9;
+
+	// What a cache was baked from: the size and the content hash of the .obj
+	// and the name of the entry in the AssetCache.
+	struct SourceKey
+	{
+		uint64_t size = 0;
+		int64_t stamp = 0;
+		std::string name;
+	};
+
+	// Maps the cache at cache_path and copies it into mesh. Returns false when
+	// there is no cache, when it was baked from another key or for another
+	// vertex format, in which case mesh is left untouched.
+	static bool load(const std::string& cache_path, const SourceKey& key, MeshData& mesh, VertexFormat format);
+	// Writes mesh as the cache at cache_path, packed in mesh.vertexFormat.
+	// format is the format that was asked for (see chooseVertexFormat).
+	// Returns false on io errors.
+	static bool save(const std::string& cache_path, const SourceKey& key, const MeshData& mesh, VertexFormat format);
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceStamp;
+		uint32_t pathLength; // of SourceKey::name
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t indexSize; // 2 or 4, see getIndexSize
+		uint32_t requestedFormat; // VertexFormat the cache was baked for
+		uint32_t vertexFormat;    // VertexFormat of the stored vertices
+		uint32_t lodCount;        // MeshLods stored after the source path
+		uint32_t meshletCount;    // Meshlets stored after the lods
+		MeshBounds bounds;
+	};
+};
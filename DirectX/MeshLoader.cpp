@@ -0,0 +1,68 @@
+#include "MeshLoader.h"
+
+#include "Bounds.h"
+#include "ParallelObjLoader.h"
+#include "Profiler.h"
+#include "VertexDeduplicator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+bool parseObjIngest(const string& name, ObjIngest& ingest)
+{
+	if (name == "stream") ingest = ObjIngest::stream;
+	else if (name == "buffered") ingest = ObjIngest::buffered;
+	else if (name == "mapped") ingest = ObjIngest::mapped;
+	else return false;
+	return true;
+}
+
+void loadObjMesh(const string& model_path, MeshData& mesh, ObjIngest ingest)
+{
+	PROFILE_ZONE("loadObjMesh");
+	tinyobj::attrib_t attrib;
+	vector<tinyobj::shape_t> shapes;
+	vector<tinyobj::material_t> materials;
+	string warn, err;
+
+	bool loaded = false;
+	switch (ingest) {
+	case ObjIngest::stream:
+		loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model_path.c_str());
+		break;
+	case ObjIngest::buffered:
+		loaded = LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, model_path.c_str());
+		break;
+	case ObjIngest::mapped:
+		loaded = LoadObjMapped(&attrib, &shapes, &materials, &warn, &err, model_path.c_str());
+		break;
+	}
+	if (!loaded)
+		throw runtime_error("load model error " + warn + err);
+
+	buildMesh(attrib, shapes, mesh);
+}
+
+void buildMesh(const tinyobj::attrib_t& attrib, const vector<tinyobj::shape_t>& shapes, MeshData& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	size_t indexCount = 0;
+	for (const auto& shape : shapes)
+		indexCount += shape.mesh.indices.size();
+	mesh.indices.reserve(indexCount);
+
+	VertexDeduplicator uniqueVertices(mesh.vertices, indexCount);
+
+	for (const auto& shape : shapes) {
+		for (const auto& index : shape.mesh.indices) {
+			const Vertex vertex = readObjVertex(attrib, index);
+			mesh.indices.push_back(uniqueVertices.insert(vertex));
+		}
+	}
+
+	computeBounds(mesh.vertices, mesh.bounds);
+}
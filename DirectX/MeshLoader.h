@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Tiny_obj_loader.h"
+
+#include <string>
+#include <vector>
+
+// How the text of an .obj file gets to the parser
+enum class ObjIngest
+{
+	stream,   // tinyobj::LoadObj on a std::ifstream, one std::string per line
+	buffered, // LoadObjParallel on a copy of the file in memory
+	mapped    // LoadObjParallel straight on the memory mapped file, no copies
+};
+
+// Parses an .obj file and deduplicates its vertices into mesh.
+// Throws a runtime_error when the file can't be parsed.
+void loadObjMesh(const std::string& model_path, MeshData& mesh, ObjIngest ingest = ObjIngest::mapped);
+
+// Builds the vertex/index buffers of a parsed obj, merging corners whose
+// position and texture coordinate are identical.
+void buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, MeshData& mesh);
+
+// The vertex one face corner of a parsed obj refers to.
+inline Vertex readObjVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+	Vertex vertex{};
+
+	vertex.pos = {
+		attrib.vertices[3 * index.vertex_index + 0],
+		attrib.vertices[3 * index.vertex_index + 1],
+		attrib.vertices[3 * index.vertex_index + 2]
+	};
+
+	// faces without a 'vt' get the texture origin
+	if (index.texcoord_index >= 0) {
+		vertex.texCoord = {
+			attrib.texcoords[2 * index.texcoord_index + 0],
+			1 - attrib.texcoords[2 * index.texcoord_index + 1]
+		};
+	}
+	return vertex;
+}
+
+// Parses "stream", "buffered" or "mapped". Returns false for anything else.
+bool parseObjIngest(const std::string& name, ObjIngest& ingest);
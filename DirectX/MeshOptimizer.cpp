@@ -0,0 +1,248 @@
+#include "MeshOptimizer.h"
+
+#include "Profiler.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace {
+	// Forsyth's tuning: a 32 entry LRU cache, the last triangle's vertices get
+	// a fixed score and vertices with few triangles left are boosted so they
+	// get finished off instead of being left behind as lone triangles.
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+	const uint32_t MAX_TABLE_VALENCE = 32;
+
+	struct ScoreTables
+	{
+		float cache[CACHE_SIZE];
+		float valence[MAX_TABLE_VALENCE + 1];
+
+		ScoreTables() {
+			for (int i = 0; i < CACHE_SIZE; i++) {
+				if (i < 3)
+					cache[i] = LAST_TRIANGLE_SCORE;
+				else
+					cache[i] = powf(1.0f - float(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i <= MAX_TABLE_VALENCE; i++)
+				valence[i] = VALENCE_BOOST_SCALE * powf(float(i), -VALENCE_BOOST_POWER);
+		}
+	};
+
+	float vertexScore(int cache_position, uint32_t valence) {
+		static const ScoreTables tables;
+
+		// no triangles left to draw, the vertex no longer matters
+		if (valence == 0)
+			return -1.0f;
+
+		float score = cache_position >= 0 ? tables.cache[cache_position] : 0.0f;
+		if (valence <= MAX_TABLE_VALENCE)
+			score += tables.valence[valence];
+		else
+			score += VALENCE_BOOST_SCALE * powf(float(valence), -VALENCE_BOOST_POWER);
+		return score;
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const vector<uint32_t>& indices, size_t vertex_count,
+	size_t vertex_size, unsigned int cache_size)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || vertex_count == 0)
+		return stats;
+
+	// a vertex is still in the FIFO when fewer than cache_size misses happened since it was loaded
+	const uint32_t NEVER = 0xFFFFFFFF;
+	vector<uint32_t> loadedAt(vertex_count, NEVER);
+	uint32_t misses = 0;
+	size_t referenced = 0;
+
+	const size_t LINE_SIZE = 64;
+	const size_t LINE_COUNT = 64;
+	size_t lines[LINE_COUNT];
+	size_t lineUsedAt[LINE_COUNT] = {};
+	size_t lineCount = 0;
+	size_t fetchedBytes = 0;
+	size_t time = 0;
+
+	for (uint32_t index : indices) {
+		if (loadedAt[index] != NEVER && misses - loadedAt[index] < cache_size)
+			continue;
+
+		if (loadedAt[index] == NEVER)
+			referenced++;
+		loadedAt[index] = misses++;
+
+		// the vertex shader reads the whole vertex, one 64 byte line at a time
+		const size_t first = index * vertex_size / LINE_SIZE;
+		const size_t last = ((index + 1) * vertex_size - 1) / LINE_SIZE;
+		for (size_t line = first; line <= last; line++) {
+			time++;
+			size_t slot = 0;
+			while (slot < lineCount && lines[slot] != line)
+				slot++;
+			if (slot == lineCount) {
+				fetchedBytes += LINE_SIZE;
+				if (lineCount < LINE_COUNT) {
+					lineCount++;
+				}
+				else {
+					slot = 0;
+					for (size_t i = 1; i < LINE_COUNT; i++)
+						if (lineUsedAt[i] < lineUsedAt[slot]) slot = i;
+				}
+				lines[slot] = line;
+			}
+			lineUsedAt[slot] = time;
+		}
+	}
+
+	stats.acmr = float(misses) / (indices.size() / 3);
+	stats.atvr = float(misses) / referenced;
+	stats.overfetch = float(fetchedBytes) / (referenced * vertex_size);
+	return stats;
+}
+
+void optimizeVertexCache(vector<uint32_t>& indices, size_t vertex_count)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles using each vertex, the live ones are kept at the front of each range
+	vector<uint32_t> valence(vertex_count, 0);
+	for (uint32_t index : indices)
+		valence[index]++;
+
+	vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] = offsets[v] + valence[v];
+
+	vector<uint32_t> adjacency(indices.size());
+	{
+		vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	vector<int> cachePosition(vertex_count, -1);
+	vector<float> vertexScores(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		vertexScores[v] = vertexScore(-1, valence[v]);
+
+	vector<float> triangleScores(triangleCount);
+	size_t best = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+		if (triangleScores[t] > triangleScores[best])
+			best = t;
+	}
+
+	vector<uint8_t> emitted(triangleCount, 0);
+	vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t cache[CACHE_SIZE + 3];
+	size_t cacheCount = 0;
+	size_t nextCandidate = 0;
+	const size_t NONE = ~size_t(0);
+
+	while (result.size() < indices.size()) {
+		// dead end, nothing in the cache has triangles left: restart at the first triangle not drawn yet
+		if (best == NONE) {
+			while (emitted[nextCandidate])
+				nextCandidate++;
+			best = nextCandidate;
+		}
+
+		const uint32_t* triangle = &indices[3 * best];
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[best] = 1;
+
+		// the drawn triangle's vertices move to the front of the cache
+		uint32_t newCache[CACHE_SIZE + 3];
+		size_t newCount = 0;
+		for (int i = 0; i < 3; i++)
+			newCache[newCount++] = triangle[i];
+		for (size_t i = 0; i < cacheCount; i++) {
+			if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		for (int i = 0; i < 3; i++) {
+			const uint32_t v = triangle[i];
+			uint32_t* live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < valence[v]; j++) {
+				if (live[j] == best) {
+					live[j] = live[valence[v] - 1];
+					valence[v]--;
+					break;
+				}
+			}
+		}
+
+		// rescore every vertex that moved in or out of the cache and its remaining triangles
+		for (size_t i = 0; i < newCount; i++) {
+			const uint32_t v = newCache[i];
+			cachePosition[v] = i < CACHE_SIZE ? static_cast<int>(i) : -1;
+
+			const float score = vertexScore(cachePosition[v], valence[v]);
+			const float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const uint32_t* live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < valence[v]; j++)
+				triangleScores[live[j]] += delta;
+		}
+
+		best = NONE;
+		float bestScore = 0.0f;
+		cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+		for (size_t i = 0; i < cacheCount; i++) {
+			const uint32_t v = newCache[i];
+			cache[i] = v;
+
+			const uint32_t* live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < valence[v]; j++) {
+				if (best == NONE || triangleScores[live[j]] > bestScore) {
+					best = live[j];
+					bestScore = triangleScores[live[j]];
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void optimizeVertexFetch(MeshData& mesh)
+{
+	const uint32_t UNUSED = 0xFFFFFFFF;
+	vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+	vector<Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(vertices);
+}
+
+void optimizeMesh(MeshData& mesh)
+{
+	PROFILE_ZONE("optimizeMesh");
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeVertexFetch(mesh);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache and vertex fetch optimization of indexed triangle
+// lists. Both passes only reorder data, the rendered mesh stays the same.
+
+// Simulated cost of drawing a triangle list
+struct VertexCacheStats
+{
+	float acmr = 0.0f;      // vertex shader runs per triangle (average cache miss ratio), 0.5 at best
+	float atvr = 0.0f;      // vertex shader runs per vertex (average transformed vertex ratio), 1 at best
+	float overfetch = 0.0f; // vertex buffer bytes read per vertex buffer byte, 1 at best
+};
+
+// Runs indices through a FIFO post-transform cache of cache_size entries (the
+// usual model of the vertex reuse of a GPU) and a small LRU cache of 64 byte
+// lines in front of the vertex buffer.
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count,
+	size_t vertex_size = sizeof(Vertex), unsigned int cache_size = 16);
+
+// Reorders the triangles of indices so vertices are reused while they are still
+// in the post-transform cache (Tom Forsyth's linear-speed vertex cache
+// optimisation). Triangle winding is kept.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+// Reorders the vertices in the order the indices first use them, so the vertex
+// buffer is read front to back. Unreferenced vertices are dropped.
+void optimizeVertexFetch(MeshData& mesh);
+
+// optimizeVertexCache followed by optimizeVertexFetch
+void optimizeMesh(MeshData& mesh);
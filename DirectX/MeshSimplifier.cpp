@@ -0,0 +1,460 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+#include "VertexDeduplicator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+	// border and seam edges are weighted up so their shape survives
+	const double BORDER_WEIGHT = 10.0;
+	const uint32_t NONE = 0xFFFFFFFF;
+
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 operator-(const Vector3& a, const Vector3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Vector3 cross(const Vector3& a, const Vector3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	float dot(const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	// symmetric 4x4 matrix of the summed squared plane distances
+	struct Quadric
+	{
+		double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+		double b0 = 0, b1 = 0, b2 = 0, c = 0;
+		double weight = 0;
+
+		// plane n.p + d = 0 with a unit normal
+		void addPlane(double nx, double ny, double nz, double d, double w) {
+			a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+			a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+			b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// mean squared distance of p to the planes
+		double evaluate(const Vector3& p) const {
+			const double x = p.x, y = p.y, z = p.z;
+			const double error = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0 ? max(error, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t from; // position ids
+		uint32_t to;
+	};
+
+	class Simplifier {
+	public:
+		Simplifier(const vector<Vertex>& vertices, const vector<uint32_t>& indices)
+			: m_vertexCount(vertices.size()), m_indices(indices) {
+			// uv copies of one position share their position id
+			vector<Vertex> unique;
+			VertexDeduplicator positions(unique, vertices.size());
+			m_positionOf.resize(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++) {
+				Vertex key{};
+				key.pos = vertices[i].pos;
+				m_positionOf[i] = positions.insert(key);
+			}
+			m_positions.resize(unique.size());
+			for (size_t p = 0; p < unique.size(); p++)
+				m_positions[p] = { unique[p].pos.x, unique[p].pos.y, unique[p].pos.z };
+
+			// the uv copies (wedges) of every position
+			m_wedgeOffsets.assign(unique.size() + 1, 0);
+			for (uint32_t p : m_positionOf)
+				m_wedgeOffsets[p + 1]++;
+			for (size_t p = 0; p < unique.size(); p++)
+				m_wedgeOffsets[p + 1] += m_wedgeOffsets[p];
+			m_wedges.resize(vertices.size());
+			vector<uint32_t> fill(m_wedgeOffsets.begin(), m_wedgeOffsets.end() - 1);
+			for (size_t i = 0; i < vertices.size(); i++)
+				m_wedges[fill[m_positionOf[i]]++] = static_cast<uint32_t>(i);
+
+			computeQuadrics();
+		}
+
+		float simplify(size_t target_index_count) {
+			float maxError = 0.0f;
+			while (m_indices.size() > target_index_count) {
+				const size_t before = m_indices.size();
+				if (!collapsePass(target_index_count, maxError))
+					break;
+				// only a few collapses left that don't touch each other (a long strip or locked
+				// non-manifold geometry), more passes would cost more than they remove
+				if ((before - m_indices.size()) * 200 < before)
+					break;
+			}
+			return maxError;
+		}
+
+		vector<uint32_t>& indices() { return m_indices; }
+
+	private:
+		void computeQuadrics() {
+			m_quadrics.assign(m_positions.size(), Quadric());
+
+			unordered_set<uint64_t> edges;
+			for (size_t i = 0; i < m_indices.size(); i += 3) {
+				for (int k = 0; k < 3; k++)
+					edges.insert(edgeKey(m_indices[i + k], m_indices[i + (k + 1) % 3]));
+			}
+
+			for (size_t i = 0; i < m_indices.size(); i += 3) {
+				const uint32_t p[3] = { m_positionOf[m_indices[i]], m_positionOf[m_indices[i + 1]], m_positionOf[m_indices[i + 2]] };
+				const Vector3 normal = cross(m_positions[p[1]] - m_positions[p[0]], m_positions[p[2]] - m_positions[p[0]]);
+				const double length = sqrt(double(dot(normal, normal)));
+				if (length == 0.0)
+					continue;
+
+				// triangle plane, weighted by area
+				const double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+				const double d = -(nx * m_positions[p[0]].x + ny * m_positions[p[0]].y + nz * m_positions[p[0]].z);
+				for (int k = 0; k < 3; k++)
+					m_quadrics[p[k]].addPlane(nx, ny, nz, d, length * 0.5);
+
+				// an edge without a twin in uv space is an open border or a uv seam:
+				// add the plane through it perpendicular to the triangle
+				for (int k = 0; k < 3; k++) {
+					const uint32_t a = m_indices[i + k];
+					const uint32_t b = m_indices[i + (k + 1) % 3];
+					if (edges.count(edgeKey(b, a)))
+						continue;
+
+					const Vector3 edge = m_positions[m_positionOf[b]] - m_positions[m_positionOf[a]];
+					const Vector3 side = cross(edge, normal);
+					const double sideLength = sqrt(double(dot(side, side)));
+					if (sideLength == 0.0)
+						continue;
+					const double sx = side.x / sideLength, sy = side.y / sideLength, sz = side.z / sideLength;
+					const Vector3& origin = m_positions[m_positionOf[a]];
+					const double sd = -(sx * origin.x + sy * origin.y + sz * origin.z);
+					const double weight = double(dot(edge, edge)) * BORDER_WEIGHT;
+					m_quadrics[m_positionOf[a]].addPlane(sx, sy, sz, sd, weight);
+					m_quadrics[m_positionOf[b]].addPlane(sx, sy, sz, sd, weight);
+				}
+			}
+		}
+
+		static uint64_t edgeKey(uint32_t a, uint32_t b) {
+			return (uint64_t(a) << 32) | b;
+		}
+
+		// Classifies every position for this pass: locked ones never move, border
+		// ones may only move along the border
+		void classify() {
+			const size_t positionCount = m_positions.size();
+			m_locked.assign(positionCount, 0);
+			m_border.assign(positionCount, 0);
+
+			vector<uint64_t> out, in;
+			for (uint32_t p = 0; p < positionCount; p++) {
+				out.clear();
+				in.clear();
+				forEachTriangle(p, [&](size_t t, int corner) {
+					out.push_back(m_positionOf[m_indices[3 * t + (corner + 1) % 3]]);
+					in.push_back(m_positionOf[m_indices[3 * t + (corner + 2) % 3]]);
+				});
+				sort(out.begin(), out.end());
+				sort(in.begin(), in.end());
+
+				// an edge used twice in the same direction is non-manifold
+				if (adjacent_find(out.begin(), out.end()) != out.end() || adjacent_find(in.begin(), in.end()) != in.end()) {
+					m_locked[p] = 1;
+					continue;
+				}
+
+				size_t open = 0;
+				for (uint64_t q : out)
+					open += !binary_search(in.begin(), in.end(), q);
+				for (uint64_t q : in)
+					open += !binary_search(out.begin(), out.end(), q);
+
+				if (open == 2)
+					m_border[p] = 1;
+				else if (open != 0)
+					m_locked[p] = 1;
+			}
+		}
+
+		template <typename Visit>
+		void forEachTriangle(uint32_t position, Visit visit) const {
+			for (uint32_t w = m_wedgeOffsets[position]; w < m_wedgeOffsets[position + 1]; w++) {
+				const uint32_t wedge = m_wedges[w];
+				for (uint32_t j = m_triangleOffsets[wedge]; j < m_triangleOffsets[wedge + 1]; j++) {
+					const uint32_t t = m_triangles[j];
+					const int corner = m_indices[3 * t] == wedge ? 0 : m_indices[3 * t + 1] == wedge ? 1 : 2;
+					visit(t, corner);
+				}
+			}
+		}
+
+		bool containsPosition(size_t t, uint32_t position) const {
+			return m_positionOf[m_indices[3 * t]] == position || m_positionOf[m_indices[3 * t + 1]] == position
+				|| m_positionOf[m_indices[3 * t + 2]] == position;
+		}
+
+		bool isOpenEdge(uint32_t from, uint32_t to) const {
+			size_t count = 0;
+			forEachTriangle(from, [&](size_t t, int) {
+				count += containsPosition(t, to);
+			});
+			return count == 1;
+		}
+
+		// Checks the collapse of position from onto position to and fills m_wedgeTargets
+		// with the uv copy of to that each uv copy of from turns into
+		bool canCollapse(uint32_t from, uint32_t to) {
+			if (m_locked[from] || (m_border[from] && !isOpenEdge(from, to)))
+				return false;
+
+			// every uv copy has to touch exactly one uv copy of the target,
+			// that keeps seams in place and uvs continuous
+			m_wedgeTargets.clear();
+			for (uint32_t w = m_wedgeOffsets[from]; w < m_wedgeOffsets[from + 1]; w++) {
+				const uint32_t wedge = m_wedges[w];
+				uint32_t target = NONE;
+				for (uint32_t j = m_triangleOffsets[wedge]; j < m_triangleOffsets[wedge + 1]; j++) {
+					const uint32_t* triangle = &m_indices[3 * m_triangles[j]];
+					for (int k = 0; k < 3; k++) {
+						if (m_positionOf[triangle[k]] != to)
+							continue;
+						if (target != NONE && target != triangle[k])
+							return false;
+						target = triangle[k];
+					}
+				}
+				if (target == NONE && m_triangleOffsets[wedge] != m_triangleOffsets[wedge + 1])
+					return false;
+				m_wedgeTargets.push_back(target);
+			}
+
+			// no triangle may flip and the neighbourhoods may only share the
+			// opposite corners of the collapsed triangles (the link condition)
+			const Vector3& target = m_positions[to];
+			bool flips = false;
+			size_t collapsed = 0;
+			m_neighbours.clear();
+			forEachTriangle(from, [&](size_t t, int corner) {
+				const uint32_t* triangle = &m_indices[3 * t];
+				const uint32_t b = m_positionOf[triangle[(corner + 1) % 3]];
+				const uint32_t c = m_positionOf[triangle[(corner + 2) % 3]];
+				m_neighbours.push_back(b);
+				m_neighbours.push_back(c);
+				if (b == to || c == to) {
+					collapsed++;
+					return;
+				}
+
+				const Vector3 before = cross(m_positions[b] - m_positions[from], m_positions[c] - m_positions[from]);
+				const Vector3 after = cross(m_positions[b] - target, m_positions[c] - target);
+				if (dot(before, after) <= 0.0f)
+					flips = true;
+			});
+			if (flips)
+				return false;
+
+			sort(m_neighbours.begin(), m_neighbours.end());
+			m_neighbours.erase(unique(m_neighbours.begin(), m_neighbours.end()), m_neighbours.end());
+
+			size_t shared = 0;
+			m_targetNeighbours.clear();
+			forEachTriangle(to, [&](size_t t, int corner) {
+				m_targetNeighbours.push_back(m_positionOf[m_indices[3 * t + (corner + 1) % 3]]);
+				m_targetNeighbours.push_back(m_positionOf[m_indices[3 * t + (corner + 2) % 3]]);
+			});
+			sort(m_targetNeighbours.begin(), m_targetNeighbours.end());
+			m_targetNeighbours.erase(unique(m_targetNeighbours.begin(), m_targetNeighbours.end()), m_targetNeighbours.end());
+			for (uint32_t n : m_neighbours)
+				shared += n != to && binary_search(m_targetNeighbours.begin(), m_targetNeighbours.end(), n);
+
+			m_collapsedTriangles = collapsed;
+			return shared == collapsed;
+		}
+
+		// Performs the cheapest collapses whose neighbourhoods don't overlap, then
+		// rebuilds the index buffer. Returns false when nothing could collapse.
+		bool collapsePass(size_t target_index_count, float& max_error) {
+			const size_t triangleCount = m_indices.size() / 3;
+
+			m_triangleOffsets.assign(m_vertexCount + 1, 0);
+			for (uint32_t index : m_indices)
+				m_triangleOffsets[index + 1]++;
+			for (size_t v = 0; v < m_vertexCount; v++)
+				m_triangleOffsets[v + 1] += m_triangleOffsets[v];
+			m_triangles.resize(m_indices.size());
+			vector<uint32_t> fill(m_triangleOffsets.begin(), m_triangleOffsets.end() - 1);
+			for (size_t i = 0; i < m_indices.size(); i++)
+				m_triangles[fill[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+			classify();
+
+			vector<uint64_t> edges;
+			edges.reserve(m_indices.size() * 2);
+			for (size_t i = 0; i < m_indices.size(); i += 3) {
+				for (int k = 0; k < 3; k++) {
+					const uint32_t a = m_positionOf[m_indices[i + k]];
+					const uint32_t b = m_positionOf[m_indices[i + (k + 1) % 3]];
+					edges.push_back(edgeKey(a, b));
+					edges.push_back(edgeKey(b, a));
+				}
+			}
+			sort(edges.begin(), edges.end());
+			edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+			vector<Collapse> collapses;
+			collapses.reserve(edges.size());
+			for (uint64_t edge : edges) {
+				const uint32_t from = static_cast<uint32_t>(edge >> 32);
+				const uint32_t to = static_cast<uint32_t>(edge);
+				// only valid collapses, so the cost limit below counts ones that can happen
+				if (from == to || !canCollapse(from, to))
+					continue;
+				collapses.push_back({ m_quadrics[from].evaluate(m_positions[to]), from, to });
+			}
+			sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return a.cost < b.cost;
+			});
+
+			// wedge remap of this pass, positions touched by a collapse stay put until the next one
+			vector<uint32_t> remap(m_vertexCount);
+			for (size_t v = 0; v < m_vertexCount; v++)
+				remap[v] = static_cast<uint32_t>(v);
+			vector<uint8_t> touched(m_positions.size(), 0);
+
+			size_t trianglesLeft = triangleCount;
+			const size_t targetTriangles = target_index_count / 3;
+
+			// a collapse removes about two triangles: only take the cheapest candidates that
+			// could reach the target this pass, so conflicts don't push expensive ones in early
+			const size_t wanted = (triangleCount - min(triangleCount, targetTriangles)) / 2;
+			const double costLimit = collapses.empty() ? 0.0 : collapses[min(wanted, collapses.size() - 1)].cost;
+
+			size_t performed = 0;
+			for (const Collapse& collapse : collapses) {
+				if (trianglesLeft <= targetTriangles || (performed > 0 && collapse.cost > costLimit))
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+				if (!canCollapse(collapse.from, collapse.to))
+					continue;
+
+				for (uint32_t w = m_wedgeOffsets[collapse.from]; w < m_wedgeOffsets[collapse.from + 1]; w++) {
+					if (m_wedgeTargets[w - m_wedgeOffsets[collapse.from]] != NONE)
+						remap[m_wedges[w]] = m_wedgeTargets[w - m_wedgeOffsets[collapse.from]];
+				}
+				m_quadrics[collapse.to].add(m_quadrics[collapse.from]);
+				max_error = max(max_error, float(sqrt(collapse.cost)));
+
+				touched[collapse.from] = 1;
+				touched[collapse.to] = 1;
+				for (uint32_t n : m_neighbours)
+					touched[n] = 1;
+
+				trianglesLeft -= min(trianglesLeft, m_collapsedTriangles);
+				performed++;
+			}
+
+			if (performed == 0)
+				return false;
+
+			size_t write = 0;
+			for (size_t i = 0; i < m_indices.size(); i += 3) {
+				const uint32_t a = remap[m_indices[i]];
+				const uint32_t b = remap[m_indices[i + 1]];
+				const uint32_t c = remap[m_indices[i + 2]];
+				const uint32_t pa = m_positionOf[a], pb = m_positionOf[b], pc = m_positionOf[c];
+				if (pa == pb || pb == pc || pa == pc)
+					continue;
+				m_indices[write++] = a;
+				m_indices[write++] = b;
+				m_indices[write++] = c;
+			}
+			m_indices.resize(write);
+			return true;
+		}
+
+		size_t m_vertexCount;
+		vector<uint32_t> m_indices;
+
+		vector<uint32_t> m_positionOf; // vertex -> position id
+		vector<Vector3> m_positions;
+		vector<uint32_t> m_wedgeOffsets; // position id -> range of m_wedges
+		vector<uint32_t> m_wedges;
+		vector<Quadric> m_quadrics;
+
+		// rebuilt every pass
+		vector<uint32_t> m_triangleOffsets; // vertex -> range of m_triangles
+		vector<uint32_t> m_triangles;
+		vector<uint8_t> m_locked;
+		vector<uint8_t> m_border;
+
+		// scratch of canCollapse
+		vector<uint32_t> m_wedgeTargets;
+		vector<uint32_t> m_neighbours;
+		vector<uint32_t> m_targetNeighbours;
+		size_t m_collapsedTriangles = 0;
+	};
+}
+
+float simplifyMesh(const vector<Vertex>& vertices, const vector<uint32_t>& indices,
+	size_t target_index_count, vector<uint32_t>& result)
+{
+	Simplifier simplifier(vertices, indices);
+	const float error = simplifier.simplify(target_index_count);
+	result.swap(simplifier.indices());
+	return error;
+}
+
+void buildLods(MeshData& mesh, unsigned int lod_count, float ratio)
+{
+	PROFILE_ZONE("buildLods");
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+
+	// a level that is off by more than a tenth of the model isn't worth drawing
+	float extent = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+		extent = max(extent, mesh.bounds.max[axis] - mesh.bounds.min[axis]);
+	const float maxError = extent * 0.1f;
+
+	vector<uint32_t> previous = mesh.indices;
+	float error = 0.0f;
+	for (unsigned int level = 1; level < lod_count; level++) {
+		const size_t target = static_cast<size_t>(previous.size() / 3 * ratio) * 3;
+
+		vector<uint32_t> lod;
+		// every level starts from the one before, the errors add up
+		error += simplifyMesh(mesh.vertices, previous, target, lod);
+
+		// stalled: locked borders and seams don't let the mesh get much smaller
+		if (lod.empty() || lod.size() > previous.size() * 0.9f || error > maxError)
+			break;
+
+		optimizeVertexCache(lod, mesh.vertices.size());
+		mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), error });
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		previous.swap(lod);
+	}
+}
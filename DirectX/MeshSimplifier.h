@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric (Garland-Heckbert) simplification by half edge
+// collapses: a vertex only ever moves onto one of its neighbours, so every
+// level of detail reuses the vertex buffer of the full mesh.
+//
+// Uv seams and open borders are kept: their edges carry extra quadrics, a
+// seam vertex only slides along its seam (every uv copy of it has to land on a
+// uv copy of the target) and border vertices only collapse along the border.
+
+// Simplifies the triangle list indices down to about target_index_count
+// indices into result. Stops earlier when no collapse is possible anymore.
+// Returns the largest collapse error, in model units.
+float simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t target_index_count, std::vector<uint32_t>& result);
+
+// Appends up to lod_count - 1 simplified levels to mesh.indices, each with
+// about ratio times the triangles of the previous one, and fills mesh.lods.
+// Levels are dropped once simplification stalls or the error passes a tenth
+// of the model size. Run after optimizeMesh: each level is optimized for the
+// vertex cache, the vertex order is left alone.
+void buildLods(MeshData& mesh, unsigned int lod_count = 4, float ratio = 0.5f);
@@ -0,0 +1,387 @@
+#include "Meshlets.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+	const uint32_t NONE = 0xFFFFFFFF;
+
+	void normalize(float v[3]) {
+		const float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if (length > 0.0f) {
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	}
+
+	Meshlet makeMeshlet(const MeshData& mesh, size_t offset, size_t count) {
+		Meshlet meshlet = {};
+		meshlet.indexOffset = static_cast<uint32_t>(offset);
+		meshlet.indexCount = static_cast<uint32_t>(count);
+
+		// sphere around the box of the vertices
+		float boxMin[3] = { INFINITY, INFINITY, INFINITY };
+		float boxMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t i = offset; i < offset + count; i++) {
+			const Vertex& vertex = mesh.vertices[mesh.indices[i]];
+			const float p[3] = { vertex.pos.x, vertex.pos.y, vertex.pos.z };
+			for (int axis = 0; axis < 3; axis++) {
+				boxMin[axis] = min(boxMin[axis], p[axis]);
+				boxMax[axis] = max(boxMax[axis], p[axis]);
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+			meshlet.center[axis] = (boxMin[axis] + boxMax[axis]) * 0.5f;
+
+		float radius = 0.0f;
+		for (size_t i = offset; i < offset + count; i++) {
+			const Vertex& vertex = mesh.vertices[mesh.indices[i]];
+			const float dx = vertex.pos.x - meshlet.center[0];
+			const float dy = vertex.pos.y - meshlet.center[1];
+			const float dz = vertex.pos.z - meshlet.center[2];
+			radius = max(radius, dx * dx + dy * dy + dz * dz);
+		}
+		meshlet.radius = sqrtf(radius);
+
+		// normal cone: the mean normal and the widest angle to it
+		vector<float> normals;
+		normals.reserve(count);
+		float axisSum[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = offset; i < offset + count; i += 3) {
+			const Vertex& a = mesh.vertices[mesh.indices[i]];
+			const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+			const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+			const float e1[3] = { b.pos.x - a.pos.x, b.pos.y - a.pos.y, b.pos.z - a.pos.z };
+			const float e2[3] = { c.pos.x - a.pos.x, c.pos.y - a.pos.y, c.pos.z - a.pos.z };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f)
+				continue;
+			normalize(n);
+			normals.insert(normals.end(), n, n + 3);
+			for (int axis = 0; axis < 3; axis++)
+				axisSum[axis] += n[axis];
+		}
+		normalize(axisSum);
+
+		float minDot = 1.0f;
+		for (size_t i = 0; i < normals.size(); i += 3)
+			minDot = min(minDot, normals[i] * axisSum[0] + normals[i + 1] * axisSum[1] + normals[i + 2] * axisSum[2]);
+
+		for (int axis = 0; axis < 3; axis++)
+			meshlet.coneAxis[axis] = axisSum[axis];
+		// normals spread over a half sphere or more can always face the camera
+		meshlet.coneCutoff = normals.empty() || minDot <= 0.0f ? 2.0f : sqrtf(1.0f - minDot * minDot);
+		return meshlet;
+	}
+
+	// solves the 3x3 system a * x = b with Cramer's rule, false when it is singular
+	bool solve(const double a[3][3], const double b[3], double x[3]) {
+		auto determinant = [](const double m[3][3]) {
+			return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+				- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+				+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		};
+
+		const double d = determinant(a);
+		if (fabs(d) < 1e-12)
+			return false;
+		for (int column = 0; column < 3; column++) {
+			double m[3][3];
+			for (int row = 0; row < 3; row++)
+				for (int k = 0; k < 3; k++)
+					m[row][k] = k == column ? b[row] : a[row][k];
+			x[column] = determinant(m) / d;
+		}
+		return true;
+	}
+}
+
+void buildMeshlets(MeshData& mesh, size_t max_vertices, size_t max_triangles)
+{
+	PROFILE_ZONE("buildMeshlets");
+	mesh.meshlets.clear();
+	const size_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+	max_vertices = max<size_t>(max_vertices, 3);
+	max_triangles = max<size_t>(max_triangles, 1);
+
+	// the same id for every vertex at the same position, so triangles on both
+	// sides of a uv seam or a normal split are neighbours
+	vector<uint32_t> position(mesh.vertices.size());
+	{
+		vector<uint32_t> sorted(mesh.vertices.size());
+		for (size_t v = 0; v < sorted.size(); v++)
+			sorted[v] = static_cast<uint32_t>(v);
+		auto key = [&](uint32_t v) {
+			const Vertex& vertex = mesh.vertices[v];
+			return make_tuple(vertex.pos.x, vertex.pos.y, vertex.pos.z);
+		};
+		sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+		for (size_t i = 0; i < sorted.size(); i++)
+			position[sorted[i]] = i > 0 && key(sorted[i]) == key(sorted[i - 1]) ? position[sorted[i - 1]] : sorted[i];
+	}
+
+	// the triangles around every position
+	vector<uint32_t> firstTriangle(mesh.vertices.size() + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		firstTriangle[position[mesh.indices[i]] + 1]++;
+	for (size_t v = 0; v < mesh.vertices.size(); v++)
+		firstTriangle[v + 1] += firstTriangle[v];
+	vector<uint32_t> vertexTriangles(triangleCount * 3);
+	{
+		vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			vertexTriangles[filled[position[mesh.indices[i]]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// unit normal, centroid and area of every triangle
+	struct Triangle
+	{
+		float normal[3];
+		float centroid[3];
+	};
+	vector<Triangle> triangles(triangleCount);
+	double totalArea = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		const Vertex& a = mesh.vertices[mesh.indices[t * 3]];
+		const Vertex& b = mesh.vertices[mesh.indices[t * 3 + 1]];
+		const Vertex& c = mesh.vertices[mesh.indices[t * 3 + 2]];
+		const float e1[3] = { b.pos.x - a.pos.x, b.pos.y - a.pos.y, b.pos.z - a.pos.z };
+		const float e2[3] = { c.pos.x - a.pos.x, c.pos.y - a.pos.y, c.pos.z - a.pos.z };
+		Triangle& triangle = triangles[t];
+		triangle.normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		triangle.normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		triangle.normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		totalArea += 0.5 * sqrt(triangle.normal[0] * triangle.normal[0] + triangle.normal[1] * triangle.normal[1] + triangle.normal[2] * triangle.normal[2]);
+		normalize(triangle.normal);
+		triangle.centroid[0] = (a.pos.x + b.pos.x + c.pos.x) / 3.0f;
+		triangle.centroid[1] = (a.pos.y + b.pos.y + c.pos.y) / 3.0f;
+		triangle.centroid[2] = (a.pos.z + b.pos.z + c.pos.z) / 3.0f;
+	}
+	// radius of a full meshlet of average triangles laid flat, to weigh distances against
+	const float expectedRadius = max(static_cast<float>(sqrt(totalArea / triangleCount * max_triangles / 3.14159265)), 1e-6f);
+
+	// Grows every meshlet from the first triangle left in index order (so in
+	// vertex cache order) over the triangles that share a position with it,
+	// like meshoptimizer's builder: each step takes the one that adds few
+	// vertices and stays close to the mean normal and the centre of the
+	// meshlet, so the cones stay tight and the spheres small. A meshlet ends
+	// when it is full or none of its neighbours fits.
+	vector<bool> emitted(triangleCount, false);
+	vector<uint32_t> owner(mesh.vertices.size(), NONE);
+	// the meshlet whose candidates each triangle is in
+	vector<uint32_t> candidate(triangleCount, NONE);
+	vector<uint32_t> candidates;
+	vector<uint32_t> order;
+	order.reserve(triangleCount * 3);
+	vector<IndexRange> ranges;
+	size_t seed = 0;
+	uint32_t current = 0;
+
+	while (true) {
+		while (seed < triangleCount && emitted[seed])
+			seed++;
+		if (seed == triangleCount)
+			break;
+
+		const size_t start = order.size();
+		size_t vertexCount = 0;
+		float normalSum[3] = { 0.0f, 0.0f, 0.0f };
+		float centroidSum[3] = { 0.0f, 0.0f, 0.0f };
+		candidates.clear();
+		uint32_t next = static_cast<uint32_t>(seed);
+
+		while (next != NONE) {
+			const uint32_t* corners = &mesh.indices[size_t(next) * 3];
+			emitted[next] = true;
+			order.insert(order.end(), corners, corners + 3);
+			for (int k = 0; k < 3; k++) {
+				if (owner[corners[k]] != current) {
+					owner[corners[k]] = current;
+					vertexCount++;
+				}
+				normalSum[k] += triangles[next].normal[k];
+				centroidSum[k] += triangles[next].centroid[k];
+				const uint32_t around = position[corners[k]];
+				for (uint32_t i = firstTriangle[around]; i < firstTriangle[around + 1]; i++) {
+					const uint32_t neighbour = vertexTriangles[i];
+					if (!emitted[neighbour] && candidate[neighbour] != current) {
+						candidate[neighbour] = current;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+			const size_t meshletTriangles = (order.size() - start) / 3;
+			if (meshletTriangles >= max_triangles)
+				break;
+
+			float axis[3] = { normalSum[0], normalSum[1], normalSum[2] };
+			normalize(axis);
+			const float center[3] = { centroidSum[0] / meshletTriangles, centroidSum[1] / meshletTriangles, centroidSum[2] / meshletTriangles };
+
+			next = NONE;
+			float bestCost = INFINITY;
+			size_t kept = 0;
+			for (uint32_t triangleIndex : candidates) {
+				if (emitted[triangleIndex])
+					continue;
+				candidates[kept++] = triangleIndex;
+
+				const uint32_t* vertices = &mesh.indices[size_t(triangleIndex) * 3];
+				size_t added = 0;
+				for (int k = 0; k < 3; k++) {
+					const bool repeated = (k > 0 && vertices[k] == vertices[0]) || (k > 1 && vertices[k] == vertices[1]);
+					added += !repeated && owner[vertices[k]] != current;
+				}
+				if (vertexCount + added > max_vertices)
+					continue;
+
+				// past 90 degrees from the mean normal no cone holds both, leave it to another meshlet
+				const Triangle& triangle = triangles[triangleIndex];
+				const float spread = 1.0f - (triangle.normal[0] * axis[0] + triangle.normal[1] * axis[1] + triangle.normal[2] * axis[2]);
+				if (spread > 1.0f)
+					continue;
+				const float d[3] = { triangle.centroid[0] - center[0], triangle.centroid[1] - center[1], triangle.centroid[2] - center[2] };
+				const float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) / expectedRadius;
+				const float cost = added + spread * 2.0f + distance;
+				if (cost < bestCost) {
+					bestCost = cost;
+					next = triangleIndex;
+				}
+			}
+			candidates.resize(kept);
+		}
+
+		ranges.push_back({ static_cast<uint32_t>(start), static_cast<uint32_t>(order.size() - start) });
+		current++;
+	}
+
+	// the full detail level in meshlet order, so every meshlet is a range of it
+	copy(order.begin(), order.end(), mesh.indices.begin());
+	mesh.meshlets.reserve(ranges.size());
+	for (const auto& range : ranges)
+		mesh.meshlets.push_back(makeMeshlet(mesh, range.indexOffset, range.indexCount));
+}
+
+CullView makeCullView(const float transform[4][4], CullFace cull_face, bool depth_clip)
+{
+	CullView view = {};
+	view.cullFace = cull_face;
+
+	// clip coordinate j of p is dot(p, column j): planes are sums of columns (Gribb-Hartmann)
+	auto column = [&](int j, float sign, float plane[4]) {
+		for (int i = 0; i < 4; i++)
+			plane[i] = transform[i][3] + sign * transform[i][j];
+	};
+	column(0, 1.0f, view.planes[0]);  // left, -w <= x
+	column(0, -1.0f, view.planes[1]); // right, x <= w
+	column(1, 1.0f, view.planes[2]);  // bottom
+	column(1, -1.0f, view.planes[3]); // top
+	for (int i = 0; i < 4; i++)
+		view.planes[4][i] = transform[i][2]; // near, 0 <= z
+	column(2, -1.0f, view.planes[5]); // far, z <= w
+
+	// unit normals, so sphere radii can be compared against the distances
+	for (auto& plane : view.planes) {
+		const float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+			for (int i = 0; i < 4; i++)
+				plane[i] /= length;
+	}
+
+	if (!depth_clip) {
+		for (int p = 4; p < 6; p++) {
+			for (int i = 0; i < 3; i++)
+				view.planes[p][i] = 0.0f;
+			view.planes[p][3] = 1.0f;
+		}
+	}
+
+	view.orthographic = transform[0][3] == 0.0f && transform[1][3] == 0.0f && transform[2][3] == 0.0f;
+	if (view.orthographic) {
+		// the model space direction that only moves along clip z
+		double linear[3][3];
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				linear[j][i] = transform[i][j];
+		const double forward[3] = { 0.0, 0.0, 1.0 };
+		double direction[3];
+		if (solve(linear, forward, direction)) {
+			for (int i = 0; i < 3; i++)
+				view.viewDirection[i] = static_cast<float>(direction[i]);
+			normalize(view.viewDirection);
+		}
+		else
+			view.cullFace = CullFace::none;
+	}
+	else {
+		// the eye is the point that projects to x = y = w = 0
+		const int columns[3] = { 0, 1, 3 };
+		double a[3][3], b[3], eye[3];
+		for (int row = 0; row < 3; row++) {
+			for (int i = 0; i < 3; i++)
+				a[row][i] = transform[i][columns[row]];
+			b[row] = -transform[3][columns[row]];
+		}
+		if (solve(a, b, eye)) {
+			for (int i = 0; i < 3; i++)
+				view.eye[i] = static_cast<float>(eye[i]);
+		}
+		else
+			view.cullFace = CullFace::none;
+	}
+
+	return view;
+}
+
+size_t cullMeshlets(const vector<Meshlet>& meshlets, const CullView& view, vector<IndexRange>& visible)
+{
+	// front faces have their normals pointing away from the camera, so back face culling tests the flipped cones
+	const float coneSign = view.cullFace == CullFace::back ? -1.0f : 1.0f;
+
+	size_t visibleCount = 0;
+	for (const Meshlet& meshlet : meshlets) {
+		const float* c = meshlet.center;
+
+		bool outside = false;
+		for (const auto& plane : view.planes) {
+			if (plane[0] * c[0] + plane[1] * c[1] + plane[2] * c[2] + plane[3] < -meshlet.radius) {
+				outside = true;
+				break;
+			}
+		}
+		if (outside)
+			continue;
+
+		// every triangle faces the culled side when the view direction stays inside the cone
+		if (view.cullFace != CullFace::none && meshlet.coneCutoff <= 1.0f) {
+			const float axis[3] = { coneSign * meshlet.coneAxis[0], coneSign * meshlet.coneAxis[1], coneSign * meshlet.coneAxis[2] };
+			bool culled;
+			if (view.orthographic) {
+				culled = axis[0] * view.viewDirection[0] + axis[1] * view.viewDirection[1] + axis[2] * view.viewDirection[2] >= meshlet.coneCutoff;
+			}
+			else {
+				const float d[3] = { c[0] - view.eye[0], c[1] - view.eye[1], c[2] - view.eye[2] };
+				const float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				culled = d[0] * axis[0] + d[1] * axis[1] + d[2] * axis[2] >= meshlet.coneCutoff * distance + meshlet.radius;
+			}
+			if (culled)
+				continue;
+		}
+
+		visibleCount++;
+		if (!visible.empty() && visible.back().indexOffset + visible.back().indexCount == meshlet.indexOffset)
+			visible.back().indexCount += meshlet.indexCount;
+		else
+			visible.push_back({ meshlet.indexOffset, meshlet.indexCount });
+	}
+	return visibleCount;
+}
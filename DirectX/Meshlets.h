@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits the full detail mesh into small clusters of triangles (meshlets) with
+// bounds, so whole clusters can be rejected on the cpu before drawing.
+
+// the usual mesh shader sized clusters
+const size_t MAX_MESHLET_VERTICES = 64;
+const size_t MAX_MESHLET_TRIANGLES = 124;
+
+// Groups the triangles of the full detail level of mesh.indices into meshlets
+// of neighbouring triangles facing about the same way, fills mesh.meshlets and
+// rewrites that level in meshlet order, so every meshlet is a range of it. Run
+// after optimizeMesh: the meshlets are seeded in its vertex cache order, and
+// each one is a compact patch of at most max_vertices vertices.
+void buildMeshlets(MeshData& mesh, size_t max_vertices = MAX_MESHLET_VERTICES, size_t max_triangles = MAX_MESHLET_TRIANGLES);
+
+// Which side of the triangles the rasterizer throws away. Front faces are
+// clockwise on screen, as in Direct3D, so in its left-handed clip space their
+// (b - a) x (c - a) normal points away from the camera: the outside of a
+// counterclockwise obj model is its back, which is why Graphics culls fronts.
+enum class CullFace
+{
+	none,
+	front,
+	back
+};
+
+// What the clusters are tested against, in the model space of the mesh
+struct CullView
+{
+	float planes[6][4];     // frustum planes, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+	bool orthographic;
+	float eye[3];           // camera position, perspective views
+	float viewDirection[3]; // unit direction the camera looks in, orthographic views
+	CullFace cullFace;
+};
+
+// Builds the view of a model to clip space matrix (row vectors, p * transform,
+// D3D clip space with 0 <= z <= w). Affine matrices are orthographic views.
+// Without depth_clip the near and far planes keep everything, like a
+// rasterizer state with DepthClipEnable off.
+CullView makeCullView(const float transform[4][4], CullFace cull_face, bool depth_clip = true);
+
+// A range of MeshData::indices to draw
+struct IndexRange
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+};
+
+// Appends the index ranges of the meshlets that are inside the frustum and not
+// facing away entirely to visible, merging meshlets that follow each other.
+// Returns the number of visible meshlets.
+size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const CullView& view, std::vector<IndexRange>& visible);
@@ -0,0 +1,269 @@
+#include "MipGenerator.h"
+
+#include "PixelConvert.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPS_SSE
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const double PI = 3.14159265358979323846;
+	// in texels of the smaller level
+	const double KAISER_RADIUS = 3.0;
+	const double KAISER_ALPHA = 4.0;
+	// levels with fewer texels are filtered on the calling thread
+	const size_t PARALLEL_TEXELS = 64 * 64;
+
+	// RGBA floats, rows from top to bottom
+	struct LinearImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		vector<float> pixels;
+
+		float* getRow(uint32_t y) { return &pixels[size_t(y) * width * 4]; }
+		const float* getRow(uint32_t y) const { return &pixels[size_t(y) * width * 4]; }
+	};
+
+	// The source texels every texel of the smaller level reads along one axis
+	// (taps of them, wrapped) and their weights, which sum to 1
+	struct Kernel
+	{
+		uint32_t taps = 0;
+		vector<uint32_t> sources;
+		vector<float> weights;
+	};
+
+	// modified Bessel function of the first kind, order 0
+	double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < 1e-12 * sum)
+				break;
+		}
+		return sum;
+	}
+
+	double kaiser(double x) {
+		if (fabs(x) >= KAISER_RADIUS)
+			return 0.0;
+		const double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+		const double t = x / KAISER_RADIUS;
+		return sinc * besselI0(KAISER_ALPHA * sqrt(1.0 - t * t)) / besselI0(KAISER_ALPHA);
+	}
+
+	void buildKernel(uint32_t source_size, uint32_t size, MipFilter filter, Kernel& kernel) {
+		// a side that is already 1 texel wide stays as it is
+		if (source_size == size) {
+			kernel.taps = 1;
+			kernel.sources.resize(size);
+			kernel.weights.assign(size, 1.0f);
+			for (uint32_t i = 0; i < size; i++)
+				kernel.sources[i] = i;
+			return;
+		}
+
+		const double scale = double(source_size) / size;
+		const double support = (filter == MipFilter::box ? 0.5 : KAISER_RADIUS) * scale;
+		kernel.taps = static_cast<uint32_t>(ceil(2.0 * support)) + 1;
+		kernel.sources.resize(size_t(size) * kernel.taps);
+		kernel.weights.resize(size_t(size) * kernel.taps);
+
+		vector<double> weights(kernel.taps);
+		for (uint32_t i = 0; i < size; i++) {
+			const double center = (i + 0.5) * scale;
+			const int64_t first = static_cast<int64_t>(floor(center - support));
+			double sum = 0.0;
+			for (uint32_t k = 0; k < kernel.taps; k++) {
+				const double texel = double(first + k);
+				if (filter == MipFilter::box)
+					weights[k] = max(0.0, min(texel + 1.0, center + support) - max(texel, center - support));
+				else
+					weights[k] = kaiser((texel + 0.5 - center) / scale);
+				sum += weights[k];
+			}
+
+			for (uint32_t k = 0; k < kernel.taps; k++) {
+				const int64_t source = (first + k) % source_size;
+				kernel.sources[size_t(i) * kernel.taps + k] = static_cast<uint32_t>(source < 0 ? source + source_size : source);
+				kernel.weights[size_t(i) * kernel.taps + k] = static_cast<float>(weights[k] / sum);
+			}
+		}
+	}
+
+	// Calls work(row) for every row in [0, rows), on up to num_threads threads
+	// that take the rows one at a time.
+	template <typename Work>
+	void forEachRow(uint32_t rows, unsigned int num_threads, Work work) {
+		num_threads = min<unsigned int>(num_threads, rows);
+		if (num_threads <= 1) {
+			for (uint32_t row = 0; row < rows; row++)
+				work(row);
+			return;
+		}
+
+		atomic<uint32_t> nextRow(0);
+		vector<thread> workers;
+		workers.reserve(num_threads);
+		for (unsigned int i = 0; i < num_threads; i++) {
+			workers.emplace_back([&]() {
+				for (uint32_t row = nextRow++; row < rows; row = nextRow++)
+					work(row);
+			});
+		}
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	// texels along x, one RGBA texel per register
+	void filterRow(const float* source, const Kernel& kernel, uint32_t width, float* destination) {
+		const uint32_t* sources = kernel.sources.data();
+		const float* weights = kernel.weights.data();
+		for (uint32_t x = 0; x < width; x++, sources += kernel.taps, weights += kernel.taps, destination += 4) {
+#ifdef MIPS_SSE
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < kernel.taps; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + size_t(sources[k]) * 4), _mm_set1_ps(weights[k])));
+			_mm_storeu_ps(destination, sum);
+#else
+			float sum[4] = {};
+			for (uint32_t k = 0; k < kernel.taps; k++)
+				for (int c = 0; c < 4; c++)
+					sum[c] += source[size_t(sources[k]) * 4 + c] * weights[k];
+			for (int c = 0; c < 4; c++)
+				destination[c] = sum[c];
+#endif
+		}
+	}
+
+	// whole rows along y, the rows are contiguous so 8 floats (2 texels) go at a time with AVX
+	void filterColumns(const LinearImage& source, const uint32_t* sources, const float* weights, uint32_t taps, float* destination) {
+		const size_t count = size_t(source.width) * 4;
+		size_t i = 0;
+#ifdef __AVX__
+		for (; i + 8 <= count; i += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for (uint32_t k = 0; k < taps; k++)
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(source.getRow(sources[k]) + i), _mm256_set1_ps(weights[k])));
+			_mm256_storeu_ps(destination + i, sum);
+		}
+#endif
+#ifdef MIPS_SSE
+		for (; i + 4 <= count; i += 4) {
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < taps; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source.getRow(sources[k]) + i), _mm_set1_ps(weights[k])));
+			_mm_storeu_ps(destination + i, sum);
+		}
+#endif
+		for (; i < count; i++) {
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < taps; k++)
+				sum += source.getRow(sources[k])[i] * weights[k];
+			destination[i] = sum;
+		}
+	}
+
+	void downsample(const LinearImage& source, MipFilter filter, unsigned int num_threads, LinearImage& level) {
+		level.width = max(1u, source.width / 2);
+		level.height = max(1u, source.height / 2);
+		level.pixels.resize(size_t(level.width) * level.height * 4);
+		if (size_t(source.width) * source.height < PARALLEL_TEXELS)
+			num_threads = 1;
+
+		Kernel horizontal, vertical;
+		buildKernel(source.width, level.width, filter, horizontal);
+		buildKernel(source.height, level.height, filter, vertical);
+
+		// x first into rows of the new width, then y
+		LinearImage rows;
+		rows.width = level.width;
+		rows.height = source.height;
+		rows.pixels.resize(size_t(rows.width) * rows.height * 4);
+		forEachRow(source.height, num_threads, [&](uint32_t y) {
+			filterRow(source.getRow(y), horizontal, level.width, rows.getRow(y));
+		});
+		forEachRow(level.height, num_threads, [&](uint32_t y) {
+			const size_t offset = size_t(y) * vertical.taps;
+			filterColumns(rows, &vertical.sources[offset], &vertical.weights[offset], vertical.taps, level.getRow(y));
+		});
+	}
+
+	void toLinearImage(const Image& image, bool srgb, LinearImage& linear) {
+		linear.width = image.width;
+		linear.height = image.height;
+		linear.pixels.resize(image.pixels.size());
+		convertPixels(srgb ? PixelConversion::srgbToLinear : PixelConversion::rgbaToFloat, image.pixels.data(), linear.pixels.data(),
+			image.pixels.size() / 4);
+	}
+
+	void toImage(const LinearImage& linear, bool srgb, unsigned int num_threads, Image& image) {
+		image.width = linear.width;
+		image.height = linear.height;
+		image.pixels.resize(linear.pixels.size());
+		if (image.pixels.size() / 4 < PARALLEL_TEXELS)
+			num_threads = 1;
+		const PixelConversion conversion = srgb ? PixelConversion::linearToSrgb : PixelConversion::floatToRgba;
+		forEachRow(image.height, num_threads, [&](uint32_t y) {
+			convertPixels(conversion, linear.getRow(y), image.getPixel(0, y), image.width);
+		});
+	}
+}
+
+bool parseMipFilter(const string& name, MipFilter& filter)
+{
+	if (name == "box")
+		filter = MipFilter::box;
+	else if (name == "kaiser")
+		filter = MipFilter::kaiser;
+	else
+		return false;
+	return true;
+}
+
+const char* getMipFilterName(MipFilter filter)
+{
+	return filter == MipFilter::box ? "box" : "kaiser";
+}
+
+uint32_t getMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1) {
+		width = max(1u, width / 2);
+		height = max(1u, height / 2);
+		count++;
+	}
+	return count;
+}
+
+void generateMips(const Image& image, MipFilter filter, bool srgb, vector<Image>& mips, unsigned int num_threads)
+{
+	PROFILE_ZONE("generateMips");
+	mips.clear();
+	if (image.width == 0 || image.height == 0)
+		return;
+	if (num_threads == 0)
+		num_threads = max(1u, thread::hardware_concurrency());
+
+	// every level is filtered from the float level above, so rounding doesn't add up down the chain
+	LinearImage level, next;
+	toLinearImage(image, srgb, level);
+	mips.resize(getMipCount(image.width, image.height) - 1);
+	for (auto& mip : mips) {
+		downsample(level, filter, num_threads, next);
+		toImage(next, srgb, num_threads, mip);
+		swap(level, next);
+	}
+}
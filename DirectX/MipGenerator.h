@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Image.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds mip chains on the cpu, so textures can ship every level in their DDS
+// file and loading them is a plain upload instead of a GenerateMips call.
+
+enum class MipFilter
+{
+	box,   // area average of the texels a mip texel covers
+	kaiser // Kaiser windowed sinc (radius 3, alpha 4), sharper than box
+};
+
+// "box" or "kaiser"
+bool parseMipFilter(const std::string& name, MipFilter& filter);
+const char* getMipFilterName(MipFilter filter);
+
+// levels of a full chain down to 1x1, the top level included
+uint32_t getMipCount(uint32_t width, uint32_t height);
+
+// Fills mips with every level below image, each half the size of the one above
+// (rounded down, at least 1), so mips[0] is level 1. With srgb the colors are
+// filtered in linear light (alpha always is linear). The edges wrap like the
+// sampler Graphics binds. The rows of every level are shared out to
+// num_threads threads, 0 uses every core.
+void generateMips(const Image& image, MipFilter filter, bool srgb, std::vector<Image>& mips,
+	unsigned int num_threads = 0);
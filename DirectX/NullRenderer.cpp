@@ -0,0 +1,168 @@
+#include "NullRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+
+const char* getNullBindName(NullBind bind)
+{
+	static const char* const names[] = { "vertex-buffer", "index-buffer", "constant-buffer", "texture", "pipeline" };
+	static_assert(sizeof(names) / sizeof(names[0]) == size_t(NullBind::count), "a name for every bind");
+	return bind < NullBind::count ? names[size_t(bind)] : "unknown";
+}
+
+void NullRenderer::beginFrame(float red, float green, float blue)
+{
+	// the depth and the color target are cleared, the viewport set
+	m_clearColor[0] = red;
+	m_clearColor[1] = green;
+	m_clearColor[2] = blue;
+	m_clearColor[3] = 1.0f;
+	m_stats.clears += 2;
+}
+
+void NullRenderer::endFrame()
+{
+	m_stats.frames++;
+}
+
+BufferHandle NullRenderer::createBuffer(BufferType type, const void* data, size_t bytes, uint32_t stride, bool dynamic)
+{
+	(void)stride;
+	if (!data && !dynamic)
+		throw runtime_error("null renderer: a static buffer needs its contents");
+
+	m_buffers.push_back({ type, dynamic, false, vector<uint8_t>(bytes) });
+	if (data && bytes)
+		memcpy(m_buffers.back().memory.data(), data, bytes);
+	m_stats.bufferCreates++;
+	m_stats.bufferBytes += bytes;
+	return BufferHandle(m_buffers.size());
+}
+
+NullRenderer::Buffer& NullRenderer::getBuffer(BufferHandle buffer)
+{
+	if (buffer == 0 || buffer > m_buffers.size())
+		throw runtime_error("null renderer: unknown buffer " + to_string(buffer));
+	return m_buffers[buffer - 1];
+}
+
+void* NullRenderer::map(BufferHandle buffer)
+{
+	Buffer& mapped = getBuffer(buffer);
+	if (!mapped.dynamic || mapped.mapped)
+		throw runtime_error("null renderer: buffer " + to_string(buffer) + " can't be mapped");
+	mapped.mapped = true;
+	m_stats.maps++;
+	m_stats.mappedBytes += mapped.memory.size();
+	return mapped.memory.data();
+}
+
+void NullRenderer::unmap(BufferHandle buffer)
+{
+	getBuffer(buffer).mapped = false;
+}
+
+PipelineHandle NullRenderer::createPipeline(const PipelineDesc& desc)
+{
+	(void)desc;
+	m_stats.pipelineCreates++;
+	return ++m_pipelineCount;
+}
+
+void NullRenderer::bindVertexBuffer(BufferHandle buffer, uint32_t stride)
+{
+	(void)stride;
+	if (getBuffer(buffer).type != BufferType::vertex)
+		throw runtime_error("null renderer: buffer " + to_string(buffer) + " isn't a vertex buffer");
+	m_stats.binds[size_t(NullBind::vertexBuffer)]++;
+}
+
+void NullRenderer::bindIndexBuffer(BufferHandle buffer, uint32_t index_size)
+{
+	if (getBuffer(buffer).type != BufferType::index || (index_size != 2 && index_size != 4))
+		throw runtime_error("null renderer: buffer " + to_string(buffer) + " isn't an index buffer");
+	m_indexBuffer = buffer;
+	m_indexSize = index_size;
+	m_stats.binds[size_t(NullBind::indexBuffer)]++;
+}
+
+void NullRenderer::bindConstantBuffer(BufferHandle buffer)
+{
+	if (getBuffer(buffer).type != BufferType::constant)
+		throw runtime_error("null renderer: buffer " + to_string(buffer) + " isn't a constant buffer");
+	m_stats.binds[size_t(NullBind::constantBuffer)]++;
+}
+
+void NullRenderer::bindTexture(TextureHandle texture)
+{
+	(void)texture;
+	m_stats.binds[size_t(NullBind::texture)]++;
+}
+
+void NullRenderer::bindPipeline(PipelineHandle pipeline)
+{
+	if (pipeline == 0 || pipeline > m_pipelineCount)
+		throw runtime_error("null renderer: unknown pipeline " + to_string(pipeline));
+	m_stats.binds[size_t(NullBind::pipeline)]++;
+}
+
+void NullRenderer::drawIndexed(uint32_t index_count, uint32_t index_offset)
+{
+	const Buffer& indices = getBuffer(m_indexBuffer);
+	if ((uint64_t(index_offset) + index_count) * m_indexSize > indices.memory.size() || indices.mapped)
+		throw runtime_error("null renderer: the draw reads past the index buffer");
+	m_stats.draws++;
+	m_stats.indices += index_count;
+}
+
+void NullRenderer::createTexture(TextureHandle texture, const TextureInfo& info)
+{
+	(void)info;
+	m_textures.push_back(texture);
+	m_stats.textureCreates++;
+}
+
+void NullRenderer::uploadLevel(TextureHandle texture, const TextureLevel& level)
+{
+	if (find(m_textures.begin(), m_textures.end(), texture) == m_textures.end())
+		throw runtime_error("null renderer: level uploaded to unknown texture " + to_string(texture));
+	if (m_textureMemory.size() < level.data.size())
+		m_textureMemory.resize(level.data.size());
+	if (!level.data.empty())
+		memcpy(m_textureMemory.data(), level.data.data(), level.data.size());
+	m_stats.textureLevels++;
+	m_stats.textureBytes += level.data.size();
+}
+
+bool NullRenderer::exportStats(const string& path) const
+{
+	ofstream file(path);
+	if (!file)
+		return false;
+
+	const double frames = m_stats.frames ? double(m_stats.frames) : 1.0;
+	auto row = [&](const string& call, uint64_t count) {
+		file << '\n' << call << ';' << count << ';' << count / frames;
+	};
+	file << fixed << setprecision(3) << "call;count;per-frame";
+	row("present", m_stats.frames);
+	row("clear", m_stats.clears);
+	for (size_t i = 0; i < size_t(NullBind::count); i++)
+		row(string("bind-") + getNullBindName(NullBind(i)), m_stats.binds[i]);
+	row("map", m_stats.maps);
+	row("mapped-bytes", m_stats.mappedBytes);
+	row("draw-indexed", m_stats.draws);
+	row("indices", m_stats.indices);
+	row("create-buffer", m_stats.bufferCreates);
+	row("buffer-bytes", m_stats.bufferBytes);
+	row("create-pipeline", m_stats.pipelineCreates);
+	row("create-texture", m_stats.textureCreates);
+	row("upload-level", m_stats.textureLevels);
+	row("texture-bytes", m_stats.textureBytes);
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "RenderDevice.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A RenderDevice without a gpu for headless runs: the calls are counted and
+// checked, the data that would be mapped or uploaded is copied into memory,
+// but nothing is drawn. The cpu cost of a frame can then be measured on any
+// machine. Misuse (unknown handles, maps of static buffers, draws past the
+// index buffer) throws a runtime_error.
+
+// what Graphics::draw binds every frame
+enum class NullBind
+{
+	vertexBuffer,
+	indexBuffer,
+	constantBuffer,
+	texture,
+	pipeline,
+	count
+};
+
+const char* getNullBindName(NullBind bind);
+
+struct NullRenderStats
+{
+	uint64_t frames = 0;
+	uint64_t clears = 0;
+	uint64_t binds[size_t(NullBind::count)] = {};
+	uint64_t maps = 0;
+	uint64_t mappedBytes = 0;
+	uint64_t draws = 0;
+	uint64_t indices = 0;
+	uint64_t bufferCreates = 0;
+	uint64_t bufferBytes = 0;
+	uint64_t pipelineCreates = 0;
+	uint64_t textureCreates = 0;
+	uint64_t textureLevels = 0;
+	uint64_t textureBytes = 0;
+};
+
+class NullRenderer : public RenderDevice {
+public:
+	void beginFrame(float red, float green, float blue) override;
+	void endFrame() override;
+
+	BufferHandle createBuffer(BufferType type, const void* data, size_t bytes, uint32_t stride, bool dynamic) override;
+	void* map(BufferHandle buffer) override;
+	void unmap(BufferHandle buffer) override;
+	PipelineHandle createPipeline(const PipelineDesc& desc) override;
+
+	void bindVertexBuffer(BufferHandle buffer, uint32_t stride) override;
+	void bindIndexBuffer(BufferHandle buffer, uint32_t index_size) override;
+	void bindConstantBuffer(BufferHandle buffer) override;
+	void bindTexture(TextureHandle texture) override;
+	void bindPipeline(PipelineHandle pipeline) override;
+	void drawIndexed(uint32_t index_count, uint32_t index_offset) override;
+
+	// TextureUploadSink, the levels are copied like UpdateSubresource does
+	void createTexture(TextureHandle texture, const TextureInfo& info) override;
+	void uploadLevel(TextureHandle texture, const TextureLevel& level) override;
+
+	const NullRenderStats& getStats() const { return m_stats; }
+	// Writes the calls per frame to path as "call;count;per-frame" rows.
+	// Returns false when the file can't be written.
+	bool exportStats(const std::string& path) const;
+
+private:
+	struct Buffer
+	{
+		BufferType type;
+		bool dynamic;
+		bool mapped;
+		std::vector<uint8_t> memory;
+	};
+
+	Buffer& getBuffer(BufferHandle buffer);
+
+	NullRenderStats m_stats;
+	float m_clearColor[4] = {};
+	std::vector<Buffer> m_buffers;
+	PipelineHandle m_pipelineCount = 0;
+	// the index buffer of the next draw and the size of its indices
+	BufferHandle m_indexBuffer = 0;
+	uint32_t m_indexSize = 0;
+	std::vector<TextureHandle> m_textures;
+	std::vector<uint8_t> m_textureMemory;
+};
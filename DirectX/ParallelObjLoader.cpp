@@ -0,0 +1,731 @@
+#include "ParallelObjLoader.h"
+#include "MappedFile.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "Tiny_obj_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace tinyobj;
+
+namespace {
+	// chunks smaller than this aren't worth a thread of their own
+	const size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+	struct RawIndex
+	{
+		int v;
+		int vt;
+		int vn;
+	};
+
+	struct Face
+	{
+		uint32_t first; // into Chunk::rawIndices
+		uint32_t count;
+		// number of v/vt/vn records seen in the chunk before this face, to resolve relative indices
+		uint32_t vCount;
+		uint32_t vtCount;
+		uint32_t vnCount;
+	};
+
+	enum class DirectiveType { usemtl, mtllib, group, object, smoothing };
+
+	// every record that changes the shape/material/smoothing state, kept in file order
+	struct Directive
+	{
+		DirectiveType type;
+		uint32_t facePos; // number of faces of the chunk before this record
+		uint32_t line;    // line number inside the chunk
+		string text;      // the record itself, starting at its keyword
+	};
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+
+		// pass 1: tokenize
+		vector<real_t> v;
+		vector<real_t> vc;
+		vector<real_t> vn;
+		vector<real_t> vt;
+		vector<RawIndex> rawIndices;
+		vector<Face> faces;
+		vector<Directive> directives;
+		uint32_t lineCount = 0;
+		bool foundAllColors = true;
+		bool unsupported = false;
+
+		// global offsets, filled in between the passes
+		size_t vBase = 0;
+		size_t vtBase = 0;
+		size_t vnBase = 0;
+		unsigned int smoothingStart = 0;
+
+		// pass 2: triangulate
+		vector<index_t> triangles;       // 3 per triangle
+		vector<unsigned int> smoothing;  // 1 per triangle
+		vector<uint32_t> faceTriangle;   // first triangle of every face, plus an end marker
+		vector<bool> degenerate;         // per face, true for faces with less than 3 corners
+	};
+
+	inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+	inline bool isLineEnd(char c) { return c == '\r' || c == '\n'; }
+
+	inline const char* skipSpace(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) p++;
+		return p;
+	}
+
+	// end of the current token, same delimiters as tinyobj (" \t\r")
+	inline const char* tokenEnd(const char* p, const char* end) {
+		while (p < end && !isSpace(*p) && *p != '\r') p++;
+		return p;
+	}
+
+	// tinyobj::parseReal bounded to one line
+	inline real_t parseReal(const char*& p, const char* end, double default_value = 0.0) {
+		p = skipSpace(p, end);
+		const char* e = tokenEnd(p, end);
+		double val = default_value;
+		tryParseDouble(p, e, &val);
+		p = e;
+		return static_cast<real_t>(val);
+	}
+
+	inline bool parseReal(const char*& p, const char* end, real_t* out) {
+		p = skipSpace(p, end);
+		const char* e = tokenEnd(p, end);
+		double val;
+		const bool ok = tryParseDouble(p, e, &val);
+		if (ok)
+			*out = static_cast<real_t>(val);
+		p = e;
+		return ok;
+	}
+
+	// atoi bounded to one line
+	inline int parseIndex(const char* p, const char* end) {
+		while (p < end && (isSpace(*p) || *p == '\r' || *p == '\v' || *p == '\f')) p++;
+		bool negative = false;
+		if (p < end && (*p == '+' || *p == '-')) {
+			negative = *p == '-';
+			p++;
+		}
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+		return negative ? -value : value;
+	}
+
+	inline const char* skipIndex(const char* p, const char* end) {
+		while (p < end && *p != '/' && !isSpace(*p) && *p != '\r') p++;
+		return p;
+	}
+
+	// tinyobj::parseTriple bounded to one line: i, i/j/k, i//k, i/j
+	// Indices are kept raw (0 = not present), false when one of them is zero.
+	inline bool parseRawTriple(const char*& p, const char* end, RawIndex* ri) {
+		ri->v = ri->vt = ri->vn = 0;
+		ri->v = parseIndex(p, end);
+		p = skipIndex(p, end);
+		if (ri->v == 0)
+			return false;
+		if (p >= end || *p != '/')
+			return true;
+		p++;
+
+		// i//k
+		if (p < end && *p == '/') {
+			p++;
+			ri->vn = parseIndex(p, end);
+			p = skipIndex(p, end);
+			return ri->vn != 0;
+		}
+
+		// i/j/k or i/j
+		ri->vt = parseIndex(p, end);
+		p = skipIndex(p, end);
+		if (ri->vt == 0)
+			return false;
+		if (p >= end || *p != '/')
+			return true;
+		p++;
+
+		// i/j/k
+		ri->vn = parseIndex(p, end);
+		p = skipIndex(p, end);
+		return ri->vn != 0;
+	}
+
+	void addDirective(Chunk& chunk, DirectiveType type, const char* token, const char* lineEnd) {
+		Directive directive;
+		directive.type = type;
+		directive.facePos = static_cast<uint32_t>(chunk.faces.size());
+		directive.line = chunk.lineCount;
+		directive.text.assign(token, lineEnd);
+		chunk.directives.push_back(move(directive));
+	}
+
+	// pass 1: tokenizes every line of a chunk, mirrors the record checks of tinyobj::LoadObj
+	void tokenizeChunk(Chunk& chunk) {
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end && !chunk.unsupported) {
+			const char* lineBegin = p;
+			while (p < end && !isLineEnd(*p)) p++;
+			const char* lineEnd = p;
+			// "\r\n", "\n" and "\r" all end one line, like tinyobj's safeGetline
+			if (p < end && *p == '\r') p++;
+			if (p < end && *p == '\n' && (p == lineEnd || p[-1] == '\r')) p++;
+			chunk.lineCount++;
+
+			const char* token = skipSpace(lineBegin, lineEnd);
+			if (token == lineEnd || token[0] == '#' || token[0] == '\0')
+				continue;
+
+			const size_t length = lineEnd - token;
+			const char c0 = token[0];
+			const char c1 = length > 1 ? token[1] : '\0';
+			const char c2 = length > 2 ? token[2] : '\0';
+
+			// vertex
+			if (c0 == 'v' && isSpace(c1)) {
+				const char* t = token + 2;
+				real_t x = parseReal(t, lineEnd);
+				real_t y = parseReal(t, lineEnd);
+				real_t z = parseReal(t, lineEnd);
+				real_t r, g, b;
+				const bool foundColor = parseReal(t, lineEnd, &r) && parseReal(t, lineEnd, &g) && parseReal(t, lineEnd, &b);
+				if (!foundColor)
+					r = g = b = 1.0;
+				chunk.foundAllColors &= foundColor;
+
+				chunk.v.push_back(x);
+				chunk.v.push_back(y);
+				chunk.v.push_back(z);
+				chunk.vc.push_back(r);
+				chunk.vc.push_back(g);
+				chunk.vc.push_back(b);
+				continue;
+			}
+
+			// normal
+			if (c0 == 'v' && c1 == 'n' && isSpace(c2)) {
+				const char* t = token + 3;
+				chunk.vn.push_back(parseReal(t, lineEnd));
+				chunk.vn.push_back(parseReal(t, lineEnd));
+				chunk.vn.push_back(parseReal(t, lineEnd));
+				continue;
+			}
+
+			// texcoord
+			if (c0 == 'v' && c1 == 't' && isSpace(c2)) {
+				const char* t = token + 3;
+				chunk.vt.push_back(parseReal(t, lineEnd));
+				chunk.vt.push_back(parseReal(t, lineEnd));
+				continue;
+			}
+
+			// skin weights, lines, points and tags are left to tinyobj
+			if ((c0 == 'v' && c1 == 'w' && isSpace(c2)) || ((c0 == 'l' || c0 == 'p' || c0 == 't') && isSpace(c1))) {
+				chunk.unsupported = true;
+				break;
+			}
+
+			// face
+			if (c0 == 'f' && isSpace(c1)) {
+				const char* t = skipSpace(token + 2, lineEnd);
+
+				Face face;
+				face.first = static_cast<uint32_t>(chunk.rawIndices.size());
+				face.vCount = static_cast<uint32_t>(chunk.v.size() / 3);
+				face.vtCount = static_cast<uint32_t>(chunk.vt.size() / 2);
+				face.vnCount = static_cast<uint32_t>(chunk.vn.size() / 3);
+
+				while (t < lineEnd) {
+					RawIndex ri;
+					// zero is an invalid index, tinyobj reports it as an error
+					if (!parseRawTriple(t, lineEnd, &ri)) {
+						chunk.unsupported = true;
+						break;
+					}
+					chunk.rawIndices.push_back(ri);
+					while (t < lineEnd && (isSpace(*t) || *t == '\r')) t++;
+				}
+
+				face.count = static_cast<uint32_t>(chunk.rawIndices.size()) - face.first;
+				if (face.count > 4)
+					chunk.unsupported = true;
+				chunk.faces.push_back(face);
+				continue;
+			}
+
+			if (length >= 6 && strncmp(token, "usemtl", 6) == 0) {
+				addDirective(chunk, DirectiveType::usemtl, token, lineEnd);
+				continue;
+			}
+
+			if (length >= 7 && strncmp(token, "mtllib", 6) == 0 && isSpace(token[6])) {
+				addDirective(chunk, DirectiveType::mtllib, token, lineEnd);
+				continue;
+			}
+
+			if (c0 == 'g' && isSpace(c1)) {
+				addDirective(chunk, DirectiveType::group, token, lineEnd);
+				continue;
+			}
+
+			if (c0 == 'o' && isSpace(c1)) {
+				addDirective(chunk, DirectiveType::object, token, lineEnd);
+				continue;
+			}
+
+			if (c0 == 's' && isSpace(c1)) {
+				addDirective(chunk, DirectiveType::smoothing, token, lineEnd);
+				continue;
+			}
+
+			// Ignore unknown command.
+		}
+	}
+
+	// tinyobj's fixIndex, relative indices count back from the number of records seen so far
+	inline bool resolveIndex(int idx, size_t count, int* out) {
+		if (idx > 0) *out = idx - 1;
+		else if (idx < 0) *out = static_cast<int>(count) + idx;
+		else return false;
+		return true;
+	}
+
+	unsigned int parseSmoothing(const string& text, unsigned int current) {
+		const char* token = text.c_str() + 2;
+		token += strspn(token, " \t");
+		if (token[0] == '\0')
+			return current;
+		if (token[0] == '\r' || token[1] == '\n')
+			return current;
+		if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' && token[2] == 'f')
+			return 0;
+		int smGroupId = parseInt(&token);
+		return smGroupId < 0 ? 0 : static_cast<unsigned int>(smGroupId);
+	}
+
+	// pass 2: resolves the indices of a chunk against the global attributes and triangulates its faces
+	void triangulateChunk(Chunk& chunk, const vector<real_t>& v) {
+		chunk.faceTriangle.reserve(chunk.faces.size() + 1);
+		chunk.degenerate.resize(chunk.faces.size(), false);
+		chunk.triangles.reserve(chunk.rawIndices.size());
+
+		unsigned int smoothing = chunk.smoothingStart;
+		size_t nextDirective = 0;
+
+		for (size_t f = 0; f < chunk.faces.size() && !chunk.unsupported; f++) {
+			while (nextDirective < chunk.directives.size() && chunk.directives[nextDirective].facePos <= f) {
+				if (chunk.directives[nextDirective].type == DirectiveType::smoothing)
+					smoothing = parseSmoothing(chunk.directives[nextDirective].text, smoothing);
+				nextDirective++;
+			}
+
+			const Face& face = chunk.faces[f];
+			chunk.faceTriangle.push_back(static_cast<uint32_t>(chunk.triangles.size() / 3));
+
+			const size_t vCount = chunk.vBase + face.vCount;
+			const size_t vtCount = chunk.vtBase + face.vtCount;
+			const size_t vnCount = chunk.vnBase + face.vnCount;
+
+			index_t corners[4];
+			for (uint32_t k = 0; k < face.count; k++) {
+				const RawIndex& ri = chunk.rawIndices[face.first + k];
+				index_t& idx = corners[k];
+				idx.vertex_index = idx.texcoord_index = idx.normal_index = -1;
+				resolveIndex(ri.v, vCount, &idx.vertex_index);
+				if (ri.vt) resolveIndex(ri.vt, vtCount, &idx.texcoord_index);
+				if (ri.vn) resolveIndex(ri.vn, vnCount, &idx.normal_index);
+
+				// forward references and out of range indices are left to tinyobj's own handling
+				if (idx.vertex_index < 0 || static_cast<size_t>(idx.vertex_index) >= vCount
+					|| (ri.vt && (idx.texcoord_index < 0 || static_cast<size_t>(idx.texcoord_index) >= vtCount))
+					|| (ri.vn && (idx.normal_index < 0 || static_cast<size_t>(idx.normal_index) >= vnCount))) {
+					chunk.unsupported = true;
+					break;
+				}
+			}
+			if (chunk.unsupported)
+				break;
+
+			if (face.count < 3) {
+				chunk.degenerate[f] = true;
+				continue;
+			}
+
+			if (face.count == 3) {
+				chunk.triangles.insert(chunk.triangles.end(), corners, corners + 3);
+				chunk.smoothing.push_back(smoothing);
+				continue;
+			}
+
+			// quad: split along the shorter diagonal, like tinyobj
+			const real_t* p0 = &v[3 * corners[0].vertex_index];
+			const real_t* p1 = &v[3 * corners[1].vertex_index];
+			const real_t* p2 = &v[3 * corners[2].vertex_index];
+			const real_t* p3 = &v[3 * corners[3].vertex_index];
+			const real_t e02x = p2[0] - p0[0], e02y = p2[1] - p0[1], e02z = p2[2] - p0[2];
+			const real_t e13x = p3[0] - p1[0], e13y = p3[1] - p1[1], e13z = p3[2] - p1[2];
+			const real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+			const real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+			if (sqr02 < sqr13) {
+				const index_t quad[6] = { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] };
+				chunk.triangles.insert(chunk.triangles.end(), quad, quad + 6);
+			}
+			else {
+				const index_t quad[6] = { corners[0], corners[1], corners[3], corners[1], corners[2], corners[3] };
+				chunk.triangles.insert(chunk.triangles.end(), quad, quad + 6);
+			}
+			chunk.smoothing.push_back(smoothing);
+			chunk.smoothing.push_back(smoothing);
+		}
+
+		chunk.faceTriangle.push_back(static_cast<uint32_t>(chunk.triangles.size() / 3));
+	}
+
+	// runs job(i) for every i in [0, count) on its own thread
+	template <typename Job>
+	void parallelFor(size_t count, Job job) {
+		if (count == 1) {
+			job(0);
+			return;
+		}
+		vector<thread> workers;
+		workers.reserve(count);
+		for (size_t i = 0; i < count; i++)
+			workers.emplace_back(job, i);
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	// the faces collected since the last flush, as triangle ranges of the chunks
+	struct PendingRange
+	{
+		const Chunk* chunk;
+		uint32_t firstFace;
+		uint32_t endFace;
+	};
+
+	// tinyobj's exportGroupsToShape for the pending faces
+	bool exportPending(shape_t* shape, vector<PendingRange>& pending, int material_id,
+		const string& name, string* warn) {
+		if (pending.empty())
+			return false;
+
+		shape->name = name;
+		for (const auto& range : pending) {
+			const Chunk& chunk = *range.chunk;
+			for (uint32_t f = range.firstFace; f < range.endFace; f++) {
+				if (chunk.degenerate[f]) {
+					if (warn)
+						(*warn) += "Degenerated face found\n.";
+					continue;
+				}
+				for (uint32_t t = chunk.faceTriangle[f]; t < chunk.faceTriangle[f + 1]; t++) {
+					shape->mesh.indices.push_back(chunk.triangles[3 * t + 0]);
+					shape->mesh.indices.push_back(chunk.triangles[3 * t + 1]);
+					shape->mesh.indices.push_back(chunk.triangles[3 * t + 2]);
+					shape->mesh.num_face_vertices.push_back(3);
+					shape->mesh.material_ids.push_back(material_id);
+					shape->mesh.smoothing_group_ids.push_back(chunk.smoothing[t]);
+				}
+			}
+		}
+		shape->mesh.tags.clear();
+		pending.clear();
+		return true;
+	}
+
+	bool fallbackToTinyObj(attrib_t* attrib, vector<shape_t>* shapes, vector<material_t>* materials,
+		string* warn, string* err, const char* data, size_t size, MaterialFileReader& matFileReader,
+		bool default_vcols_fallback) {
+		istringstream stream(string(data, size));
+		return LoadObj(attrib, shapes, materials, warn, err, &stream, &matFileReader, true, default_vcols_fallback);
+	}
+}
+
+bool LoadObjParallel(attrib_t* attrib, vector<shape_t>* shapes, vector<material_t>* materials,
+	string* warn, string* err, const char* filename, const char* mtl_basedir,
+	unsigned int num_threads, bool default_vcols_fallback) {
+	ifstream file(filename, ios::binary | ios::ate);
+	if (!file) {
+		if (err) {
+			stringstream errss;
+			errss << "Cannot open file [" << filename << "]" << endl;
+			(*err) = errss.str();
+		}
+		return false;
+	}
+
+	vector<char> data(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(data.data(), data.size());
+
+	return LoadObjParallelFromMemory(attrib, shapes, materials, warn, err, data.data(), data.size(),
+		mtl_basedir, num_threads, default_vcols_fallback);
+}
+
+bool LoadObjMapped(attrib_t* attrib, vector<shape_t>* shapes, vector<material_t>* materials,
+	string* warn, string* err, const char* filename, const char* mtl_basedir,
+	unsigned int num_threads, bool default_vcols_fallback) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		if (err) {
+			stringstream errss;
+			errss << "Cannot open file [" << filename << "]" << endl;
+			(*err) = errss.str();
+		}
+		return false;
+	}
+
+	return LoadObjParallelFromMemory(attrib, shapes, materials, warn, err, reinterpret_cast<const char*>(file.data()),
+		file.size(), mtl_basedir, num_threads, default_vcols_fallback);
+}
+
+bool LoadObjParallelFromMemory(attrib_t* attrib, vector<shape_t>* shapes, vector<material_t>* materials,
+	string* warn, string* err, const char* data, size_t size,
+	const char* mtl_basedir, unsigned int num_threads, bool default_vcols_fallback) {
+	attrib->vertices.clear();
+	attrib->normals.clear();
+	attrib->texcoords.clear();
+	attrib->colors.clear();
+	shapes->clear();
+
+	string baseDir = mtl_basedir ? mtl_basedir : "";
+	if (!baseDir.empty()) {
+#ifndef _WIN32
+		const char dirsep = '/';
+#else
+		const char dirsep = '\\';
+#endif
+		if (baseDir[baseDir.length() - 1] != dirsep) baseDir += dirsep;
+	}
+	MaterialFileReader matFileReader(baseDir);
+
+	if (num_threads == 0)
+		num_threads = max(1u, thread::hardware_concurrency());
+
+	#pragma region split
+	// cut the file into line aligned chunks, one per thread
+	const size_t chunkCount = max<size_t>(1, min<size_t>(num_threads, size / MIN_CHUNK_SIZE));
+	vector<Chunk> chunks(chunkCount);
+	const char* cursor = data;
+	const char* end = data + size;
+	for (size_t i = 0; i < chunkCount; i++) {
+		const char* chunkEnd = i + 1 == chunkCount ? end : max(cursor, data + size * (i + 1) / chunkCount);
+		while (chunkEnd < end && !isLineEnd(chunkEnd[-1])) chunkEnd++;
+		// keep "\r\n" together
+		if (chunkEnd < end && chunkEnd[-1] == '\r' && chunkEnd[0] == '\n') chunkEnd++;
+		chunks[i].begin = cursor;
+		chunks[i].end = chunkEnd;
+		cursor = chunkEnd;
+	}
+	#pragma endregion split
+
+	parallelFor(chunkCount, [&](size_t i) { tokenizeChunk(chunks[i]); });
+
+	for (const auto& chunk : chunks)
+		if (chunk.unsupported)
+			return fallbackToTinyObj(attrib, shapes, materials, warn, err, data, size, matFileReader, default_vcols_fallback);
+
+	#pragma region stitch attributes
+	size_t vTotal = 0, vtTotal = 0, vnTotal = 0;
+	bool foundAllColors = true;
+	unsigned int smoothing = 0;
+	for (auto& chunk : chunks) {
+		chunk.vBase = vTotal;
+		chunk.vtBase = vtTotal;
+		chunk.vnBase = vnTotal;
+		vTotal += chunk.v.size() / 3;
+		vtTotal += chunk.vt.size() / 2;
+		vnTotal += chunk.vn.size() / 3;
+		foundAllColors &= chunk.foundAllColors;
+
+		// the smoothing group carries over from the end of the previous chunk
+		chunk.smoothingStart = smoothing;
+		for (const auto& directive : chunk.directives)
+			if (directive.type == DirectiveType::smoothing)
+				smoothing = parseSmoothing(directive.text, smoothing);
+	}
+
+	vector<real_t> v(vTotal * 3);
+	vector<real_t> vt(vtTotal * 2);
+	vector<real_t> vn(vnTotal * 3);
+	vector<real_t> vc;
+	const bool keepColors = foundAllColors || default_vcols_fallback;
+	if (keepColors)
+		vc.resize(vTotal * 3);
+
+	parallelFor(chunkCount, [&](size_t i) {
+		Chunk& chunk = chunks[i];
+		copy(chunk.v.begin(), chunk.v.end(), v.begin() + chunk.vBase * 3);
+		copy(chunk.vt.begin(), chunk.vt.end(), vt.begin() + chunk.vtBase * 2);
+		copy(chunk.vn.begin(), chunk.vn.end(), vn.begin() + chunk.vnBase * 3);
+		if (keepColors)
+			copy(chunk.vc.begin(), chunk.vc.end(), vc.begin() + chunk.vBase * 3);
+		vector<real_t>().swap(chunk.v);
+		vector<real_t>().swap(chunk.vt);
+		vector<real_t>().swap(chunk.vn);
+		vector<real_t>().swap(chunk.vc);
+	});
+	#pragma endregion stitch attributes
+
+	parallelFor(chunkCount, [&](size_t i) { triangulateChunk(chunks[i], v); });
+
+	for (const auto& chunk : chunks)
+		if (chunk.unsupported)
+			return fallbackToTinyObj(attrib, shapes, materials, warn, err, data, size, matFileReader, default_vcols_fallback);
+
+	#pragma region stitch shapes
+	// replay the state changing records in file order, flushing faces into shapes like tinyobj::LoadObj
+	map<string, int> material_map;
+	int material = -1;
+	string name;
+	shape_t shape;
+	vector<PendingRange> pending;
+	size_t lineBase = 0;
+
+	for (const auto& chunk : chunks) {
+		uint32_t face = 0;
+		for (const auto& directive : chunk.directives) {
+			if (directive.facePos > face) {
+				pending.push_back({ &chunk, face, directive.facePos });
+				face = directive.facePos;
+			}
+
+			const size_t lineNum = lineBase + directive.line;
+			const char* token = directive.text.c_str();
+
+			switch (directive.type) {
+			case DirectiveType::usemtl: {
+				token += 6;
+				string namebuf = parseString(&token);
+
+				int newMaterialId = -1;
+				auto it = material_map.find(namebuf);
+				if (it != material_map.end())
+					newMaterialId = it->second;
+				else if (warn)
+					(*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
+
+				if (newMaterialId != material) {
+					exportPending(&shape, pending, material, name, warn);
+					pending.clear();
+					material = newMaterialId;
+				}
+				break;
+			}
+			case DirectiveType::mtllib: {
+				token += 7;
+
+				vector<string> filenames;
+				SplitString(string(token), ' ', '\\', filenames);
+
+				if (filenames.empty()) {
+					if (warn) {
+						stringstream ss;
+						ss << "Looks like empty filename for mtllib. Use default "
+							"material (line " << lineNum << ".)\n";
+						(*warn) += ss.str();
+					}
+				}
+				else {
+					bool found = false;
+					for (size_t s = 0; s < filenames.size(); s++) {
+						string warn_mtl;
+						string err_mtl;
+						bool ok = matFileReader(filenames[s].c_str(), materials, &material_map, &warn_mtl, &err_mtl);
+						if (warn && !warn_mtl.empty())
+							(*warn) += warn_mtl;
+						if (err && !err_mtl.empty())
+							(*err) += err_mtl;
+						if (ok) {
+							found = true;
+							break;
+						}
+					}
+					if (!found && warn)
+						(*warn) += "Failed to load material file(s). Use default material.\n";
+				}
+				break;
+			}
+			case DirectiveType::group: {
+				exportPending(&shape, pending, material, name, warn);
+				if (shape.mesh.indices.size() > 0)
+					shapes->push_back(shape);
+				shape = shape_t();
+				pending.clear();
+
+				vector<string> names;
+				while (!IS_NEW_LINE(token[0])) {
+					names.push_back(parseString(&token));
+					token += strspn(token, " \t\r");
+				}
+
+				if (names.size() < 2) {
+					if (warn) {
+						stringstream ss;
+						ss << "Empty group name. line: " << lineNum << "\n";
+						(*warn) += ss.str();
+						name = "";
+					}
+				}
+				else {
+					stringstream ss;
+					ss << names[1];
+					for (size_t i = 2; i < names.size(); i++)
+						ss << " " << names[i];
+					name = ss.str();
+				}
+				break;
+			}
+			case DirectiveType::object:
+				exportPending(&shape, pending, material, name, warn);
+				if (shape.mesh.indices.size() > 0)
+					shapes->push_back(shape);
+				pending.clear();
+				shape = shape_t();
+				name = string(token + 2);
+				break;
+			case DirectiveType::smoothing:
+				// already applied per face while triangulating
+				break;
+			}
+		}
+
+		if (chunk.faces.size() > face)
+			pending.push_back({ &chunk, face, static_cast<uint32_t>(chunk.faces.size()) });
+		lineBase += chunk.lineCount;
+	}
+
+	bool ret = exportPending(&shape, pending, material, name, warn);
+	if (ret || shape.mesh.indices.size())
+		shapes->push_back(shape);
+	#pragma endregion stitch shapes
+
+	attrib->vertices.swap(v);
+	attrib->vertex_weights.clear();
+	attrib->normals.swap(vn);
+	attrib->texcoords.swap(vt);
+	attrib->texcoord_ws.clear();
+	attrib->colors.swap(vc);
+	attrib->skin_weights.clear();
+
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Tiny_obj_loader.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Multithreaded drop-in for tinyobj::LoadObj (always triangulating).
+//
+// The file is split into line aligned chunks that are parsed concurrently
+// (v/vt/vn/f records), after which the chunks are stitched together: relative
+// indices are resolved against the global attribute counts and faces are
+// grouped into shapes exactly the way LoadObj does. The output matches LoadObj
+// for the same input. Files using records this parser doesn't handle (l, p, t,
+// vw, polygons with more than 4 corners, or faces with forward or out of
+// range indices) are handed to tinyobj::LoadObj instead.
+//
+// num_threads = 0 uses one thread per hardware core.
+bool LoadObjParallel(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+	std::vector<tinyobj::material_t>* materials, std::string* warn,
+	std::string* err, const char* filename,
+	const char* mtl_basedir = NULL, unsigned int num_threads = 0,
+	bool default_vcols_fallback = true);
+
+// Same as LoadObjParallel, but maps the file into memory and tokenizes straight
+// from the mapped pages instead of reading it into a buffer first.
+bool LoadObjMapped(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+	std::vector<tinyobj::material_t>* materials, std::string* warn,
+	std::string* err, const char* filename,
+	const char* mtl_basedir = NULL, unsigned int num_threads = 0,
+	bool default_vcols_fallback = true);
+
+// Same as LoadObjParallel, but parses obj text that is already in memory.
+bool LoadObjParallelFromMemory(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+	std::vector<tinyobj::material_t>* materials, std::string* warn,
+	std::string* err, const char* data, size_t size,
+	const char* mtl_basedir = NULL, unsigned int num_threads = 0,
+	bool default_vcols_fallback = true);
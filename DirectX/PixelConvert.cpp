@@ -0,0 +1,512 @@
+#include "PixelConvert.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIXELS_SSE
+#include <immintrin.h>
+#endif
+// pshufb, MSVC has no switch for SSSE3 alone so it comes with AVX there
+#if defined(PIXELS_SSE) && (defined(__SSSE3__) || defined(__AVX__))
+#define PIXELS_SSSE3
+#endif
+
+#ifdef PIXELS_SSE
+#define PIXEL_KERNEL(kernel) kernel
+#else
+#define PIXEL_KERNEL(kernel) nullptr
+#endif
+
+using namespace std;
+
+namespace {
+	// A linear value times SRGB_BUCKETS picks its bucket. Thresholds are at least
+	// 1 / (12.92 * 255) apart, wider than a bucket, so a bucket holds at most one.
+	const int SRGB_BUCKETS = 4096;
+	// rgb16ToRgba goes through a buffer of 8-bit RGB this many pixels long
+	const size_t CHUNK_PIXELS = 256;
+
+	struct SrgbTables
+	{
+		float toLinear[256];
+		// linear value half way between code i and i + 1, to round in sRGB space,
+		// and one past 1 so the last code never moves up
+		float thresholds[256];
+		// code at the start of every bucket
+		uint8_t codes[SRGB_BUCKETS + 1];
+
+		SrgbTables() {
+			auto decode = [](double value) {
+				return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+			};
+			for (int i = 0; i < 256; i++)
+				toLinear[i] = static_cast<float>(decode(i / 255.0));
+			for (int i = 0; i < 255; i++)
+				thresholds[i] = static_cast<float>(decode((i + 0.5) / 255.0));
+			thresholds[255] = 2.0f;
+			for (int i = 0, code = 0; i <= SRGB_BUCKETS; i++) {
+				while (thresholds[code] <= float(i) / SRGB_BUCKETS)
+					code++;
+				codes[i] = static_cast<uint8_t>(code);
+			}
+		}
+	};
+
+	const SrgbTables& getSrgbTables() {
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// NaN becomes 0 like with _mm_max_ps(value, 0)
+	inline float clampUnit(float value) {
+		return value > 0.0f ? min(value, 1.0f) : 0.0f;
+	}
+
+	// same as counting the thresholds up to value, without a search
+	inline uint8_t encodeSrgb(const SrgbTables& tables, float value) {
+		const uint8_t code = tables.codes[static_cast<int>(value * SRGB_BUCKETS)];
+		return code + (value >= tables.thresholds[code]);
+	}
+
+	// value * 255 / 65535 rounded, exact for every 16-bit value
+	inline uint8_t narrow16(uint16_t value) {
+		return static_cast<uint8_t>((value * 255u + 32895u) >> 16);
+	}
+
+	/// plain loops ///
+
+	void expandRgb(const uint8_t* source, uint8_t* destination, size_t count, bool bgr) {
+		for (size_t i = 0; i < count; i++, source += 3, destination += 4) {
+			destination[0] = source[bgr ? 2 : 0];
+			destination[1] = source[1];
+			destination[2] = source[bgr ? 0 : 2];
+			destination[3] = 255;
+		}
+	}
+
+	void swizzle(const uint8_t* source, uint8_t* destination, size_t count, bool opaque) {
+		for (size_t i = 0; i < count; i++, source += 4, destination += 4) {
+			const uint8_t red = source[0], green = source[1], blue = source[2], alpha = source[3];
+			destination[0] = blue;
+			destination[1] = green;
+			destination[2] = red;
+			destination[3] = opaque ? 255 : alpha;
+		}
+	}
+
+	void rgbToRgba(const uint8_t* source, uint8_t* destination, size_t count) { expandRgb(source, destination, count, false); }
+	void bgrToRgba(const uint8_t* source, uint8_t* destination, size_t count) { expandRgb(source, destination, count, true); }
+	void bgraToRgba(const uint8_t* source, uint8_t* destination, size_t count) { swizzle(source, destination, count, false); }
+	void bgrxToRgba(const uint8_t* source, uint8_t* destination, size_t count) { swizzle(source, destination, count, true); }
+
+	void rgbxToRgba(const uint8_t* source, uint8_t* destination, size_t count) {
+		for (size_t i = 0; i < count; i++, source += 4, destination += 4) {
+			for (int c = 0; c < 3; c++)
+				destination[c] = source[c];
+			destination[3] = 255;
+		}
+	}
+
+	void premultiply(const uint8_t* source, uint8_t* destination, size_t count) {
+		for (size_t i = 0; i < count; i++, source += 4, destination += 4) {
+			const unsigned int alpha = source[3];
+			for (int c = 0; c < 3; c++) {
+				// c * alpha / 255 rounded
+				const unsigned int t = source[c] * alpha + 128;
+				destination[c] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+			}
+			destination[3] = static_cast<uint8_t>(alpha);
+		}
+	}
+
+	void unpremultiply(const uint8_t* source, uint8_t* destination, size_t count) {
+		for (size_t i = 0; i < count; i++, source += 4, destination += 4) {
+			const uint8_t alpha = source[3];
+			if (alpha == 0) {
+				for (int c = 0; c < 4; c++)
+					destination[c] = 0;
+				continue;
+			}
+			const float scale = 255.0f / alpha;
+			for (int c = 0; c < 3; c++)
+				destination[c] = static_cast<uint8_t>(min(255, static_cast<int>(source[c] * scale + 0.5f)));
+			destination[3] = alpha;
+		}
+	}
+
+	void rgb16ToRgba(const uint8_t* source, uint8_t* destination, size_t count) {
+		const uint16_t* channels = reinterpret_cast<const uint16_t*>(source);
+		for (size_t i = 0; i < count; i++, channels += 3, destination += 4) {
+			for (int c = 0; c < 3; c++)
+				destination[c] = narrow16(channels[c]);
+			destination[3] = 255;
+		}
+	}
+
+	void rgba16ToRgba(const uint8_t* source, uint8_t* destination, size_t count) {
+		const uint16_t* channels = reinterpret_cast<const uint16_t*>(source);
+		for (size_t i = 0; i < count * 4; i++)
+			destination[i] = narrow16(channels[i]);
+	}
+
+	void rgbaToFloat(const uint8_t* source, uint8_t* destination, size_t count) {
+		float* values = reinterpret_cast<float*>(destination);
+		for (size_t i = 0; i < count * 4; i++)
+			values[i] = source[i] / 255.0f;
+	}
+
+	void floatToRgba(const uint8_t* source, uint8_t* destination, size_t count) {
+		const float* values = reinterpret_cast<const float*>(source);
+		for (size_t i = 0; i < count * 4; i++)
+			destination[i] = static_cast<uint8_t>(clampUnit(values[i]) * 255.0f + 0.5f);
+	}
+
+	void srgbToLinear(const uint8_t* source, uint8_t* destination, size_t count) {
+		const SrgbTables& tables = getSrgbTables();
+		float* values = reinterpret_cast<float*>(destination);
+		for (size_t i = 0; i < count * 4; i += 4) {
+			for (int c = 0; c < 3; c++)
+				values[i + c] = tables.toLinear[source[i + c]];
+			values[i + 3] = source[i + 3] / 255.0f;
+		}
+	}
+
+	void linearToSrgb(const uint8_t* source, uint8_t* destination, size_t count) {
+		const SrgbTables& tables = getSrgbTables();
+		const float* values = reinterpret_cast<const float*>(source);
+		for (size_t i = 0; i < count * 4; i += 4) {
+			for (int c = 0; c < 3; c++)
+				destination[i + c] = encodeSrgb(tables, clampUnit(values[i + c]));
+			destination[i + 3] = static_cast<uint8_t>(clampUnit(values[i + 3]) * 255.0f + 0.5f);
+		}
+	}
+
+	/// kernels, they convert what they can and return the pixels done ///
+
+#ifdef PIXELS_SSE
+	// red and blue of four RGBA pixels swapped with shifts, green and alpha stay
+	inline __m128i swapRedBlue4(__m128i pixels) {
+		const __m128i redBlue = _mm_and_si128(pixels, _mm_set1_epi32(0x00ff00ff));
+		const __m128i greenAlpha = _mm_andnot_si128(_mm_set1_epi32(0x00ff00ff), pixels);
+		return _mm_or_si128(greenAlpha, _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16)));
+	}
+
+	// v * 255 / 65535 rounded for eight 16-bit values: the high half of v * 255,
+	// plus the carry of adding 32895 to the low half
+	inline __m128i narrow16x8(__m128i values) {
+		const __m128i factor = _mm_set1_epi16(255);
+		const __m128i low = _mm_mullo_epi16(values, factor);
+		const __m128i high = _mm_mulhi_epu16(values, factor);
+		// low >= 32641 unsigned, compared signed with the sign bit flipped
+		const __m128i carry = _mm_cmpgt_epi16(_mm_xor_si128(low, _mm_set1_epi16(-0x8000)), _mm_set1_epi16(32640 - 0x8000));
+		return _mm_sub_epi16(high, carry);
+	}
+
+	inline __m128i clampUnit(__m128 values) {
+		return _mm_castps_si128(_mm_min_ps(_mm_max_ps(values, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+	}
+
+	// four float pixels to 8-bit, rounded
+	inline __m128i encodeLinear(const float* values) {
+		__m128i words[4];
+		for (int k = 0; k < 4; k++) {
+			const __m128 clamped = _mm_castsi128_ps(clampUnit(_mm_loadu_ps(values + 4 * k)));
+			words[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+		}
+		return _mm_packus_epi16(_mm_packs_epi32(words[0], words[1]), _mm_packs_epi32(words[2], words[3]));
+	}
+
+	size_t expandRgbSse(const uint8_t* source, uint8_t* destination, size_t count, bool bgr) {
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+		size_t i = 0;
+#ifdef __AVX2__
+		// two times four pixels, every load reads 4 bytes past them
+		const __m256i spread = bgr ?
+			_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i wideAlpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+		for (; i + 10 <= count; i += 8) {
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 12));
+			const __m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, spread), wideAlpha));
+		}
+#endif
+		// four pixels per 16-byte load, so 6 pixels must be left
+		for (; i + 6 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+#ifdef PIXELS_SSSE3
+			const __m128i spread = bgr ?
+				_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+				_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(pixels, spread), alpha);
+#else
+			// the byte after every pixel is the first one of the next, alpha overwrites it
+			const __m128i first = _mm_unpacklo_epi32(pixels, _mm_srli_si128(pixels, 3));
+			const __m128i second = _mm_unpacklo_epi32(_mm_srli_si128(pixels, 6), _mm_srli_si128(pixels, 9));
+			__m128i rgba = _mm_or_si128(_mm_unpacklo_epi64(first, second), alpha);
+			if (bgr)
+				rgba = swapRedBlue4(rgba);
+#endif
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), rgba);
+		}
+		return i;
+	}
+
+	size_t swizzleSse(const uint8_t* source, uint8_t* destination, size_t count, bool opaque) {
+		size_t i = 0;
+#ifdef __AVX2__
+		const __m256i redBlueMask = _mm256_set1_epi32(0x00ff00ff);
+		const __m256i wideAlpha = _mm256_set1_epi32(opaque ? static_cast<int>(0xff000000) : 0);
+		for (; i + 8 <= count; i += 8) {
+			const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			const __m256i redBlue = _mm256_and_si256(pixels, redBlueMask);
+			const __m256i swapped = _mm256_or_si256(_mm256_andnot_si256(redBlueMask, pixels),
+				_mm256_or_si256(_mm256_slli_epi32(redBlue, 16), _mm256_srli_epi32(redBlue, 16)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_or_si256(swapped, wideAlpha));
+		}
+#endif
+		const __m128i alpha = _mm_set1_epi32(opaque ? static_cast<int>(0xff000000) : 0);
+		for (; i + 4 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(swapRedBlue4(pixels), alpha));
+		}
+		return i;
+	}
+
+	size_t rgbToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) { return expandRgbSse(source, destination, count, false); }
+	size_t bgrToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) { return expandRgbSse(source, destination, count, true); }
+	size_t bgraToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) { return swizzleSse(source, destination, count, false); }
+	size_t bgrxToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) { return swizzleSse(source, destination, count, true); }
+
+	size_t rgbxToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(pixels, alpha));
+		}
+		return i;
+	}
+
+	size_t premultiplySse(const uint8_t* source, uint8_t* destination, size_t count) {
+		size_t i = 0;
+#ifdef __AVX2__
+		const __m256i wideZero = _mm256_setzero_si256();
+		const __m256i wideRounding = _mm256_set1_epi16(128);
+		const __m256i wideAlpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+		for (; i + 8 <= count; i += 8) {
+			const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			__m256i halves[2] = { _mm256_unpacklo_epi8(pixels, wideZero), _mm256_unpackhi_epi8(pixels, wideZero) };
+			for (auto& half : halves) {
+				const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(half, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(half, alpha), wideRounding);
+				half = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+			}
+			const __m256i colors = _mm256_andnot_si256(wideAlpha, _mm256_packus_epi16(halves[0], halves[1]));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_or_si256(colors, _mm256_and_si256(pixels, wideAlpha)));
+		}
+#endif
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(128);
+		const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000));
+		for (; i + 4 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			// two pixels of 16-bit channels per half, alpha spread over the four lanes of its pixel
+			__m128i halves[2] = { _mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero) };
+			for (auto& half : halves) {
+				const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(half, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				const __m128i t = _mm_add_epi16(_mm_mullo_epi16(half, alpha), rounding);
+				half = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+			}
+			const __m128i colors = _mm_andnot_si128(alphaMask, _mm_packus_epi16(halves[0], halves[1]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(colors, _mm_and_si128(pixels, alphaMask)));
+		}
+		return i;
+	}
+
+	size_t unpremultiplySse(const uint8_t* source, uint8_t* destination, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000));
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			const __m128i alphas = _mm_and_si128(pixels, alphaMask);
+			// opaque pixels, most of them in most images, stay as they are
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(alphas, alphaMask)) == 0xffff) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), pixels);
+				continue;
+			}
+
+			// one pixel of floats per register, 255 / alpha like the plain loop
+			const __m128i words[2] = { _mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero) };
+			__m128i values[4];
+			for (int k = 0; k < 4; k++) {
+				const __m128 channels = _mm_cvtepi32_ps(k % 2 == 0 ? _mm_unpacklo_epi16(words[k / 2], zero) : _mm_unpackhi_epi16(words[k / 2], zero));
+				const __m128 scale = _mm_div_ps(_mm_set1_ps(255.0f), _mm_shuffle_ps(channels, channels, _MM_SHUFFLE(3, 3, 3, 3)));
+				values[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels, scale), _mm_set1_ps(0.5f)));
+			}
+			// the packs saturate at 255, pixels without alpha become 0 and alpha comes back as it was
+			const __m128i colors = _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3]));
+			const __m128i visible = _mm_andnot_si128(_mm_cmpeq_epi32(alphas, zero), _mm_set1_epi32(0x00ffffff));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(_mm_and_si128(colors, visible), alphas));
+		}
+		return i;
+	}
+
+	size_t rgba16ToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 8));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 8 + 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_packus_epi16(narrow16x8(low), narrow16x8(high)));
+		}
+		return i;
+	}
+
+	// the channels are narrowed 16 at a time into 8-bit RGB, then expanded
+	size_t rgb16ToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		alignas(16) uint8_t rgb[CHUNK_PIXELS * 3];
+		size_t i = 0;
+		while (count - i >= 16) {
+			const size_t pixels = min(CHUNK_PIXELS, (count - i) & ~size_t(15));
+			const uint8_t* channels = source + i * 6;
+			for (size_t c = 0; c < pixels * 3; c += 16) {
+				const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(channels + c * 2));
+				const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(channels + c * 2 + 16));
+				_mm_store_si128(reinterpret_cast<__m128i*>(rgb + c), _mm_packus_epi16(narrow16x8(low), narrow16x8(high)));
+			}
+			const size_t done = rgbToRgbaSse(rgb, destination + i * 4, pixels);
+			rgbToRgba(rgb + done * 3, destination + (i + done) * 4, pixels - done);
+			i += pixels;
+		}
+		return i;
+	}
+
+	size_t rgbaToFloatSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(255.0f);
+		float* values = reinterpret_cast<float*>(destination);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			const __m128i words[2] = { _mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero) };
+			for (int k = 0; k < 4; k++) {
+				const __m128i channels = k % 2 == 0 ? _mm_unpacklo_epi16(words[k / 2], zero) : _mm_unpackhi_epi16(words[k / 2], zero);
+				_mm_storeu_ps(values + (i + k) * 4, _mm_div_ps(_mm_cvtepi32_ps(channels), scale));
+			}
+		}
+		return i;
+	}
+
+	size_t floatToRgbaSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		const float* values = reinterpret_cast<const float*>(source);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), encodeLinear(values + i * 4));
+		return i;
+	}
+
+	// the alpha lanes are encoded like floatToRgba, the colors get their bucket
+	// here and look up their codes one by one
+	size_t linearToSrgbSse(const uint8_t* source, uint8_t* destination, size_t count) {
+		const SrgbTables& tables = getSrgbTables();
+		const float* values = reinterpret_cast<const float*>(source);
+		alignas(16) float clamped[16];
+		alignas(16) int32_t buckets[16];
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i linear = encodeLinear(values + i * 4);
+			for (int k = 0; k < 4; k++) {
+				const __m128 unit = _mm_castsi128_ps(clampUnit(_mm_loadu_ps(values + (i + k) * 4)));
+				_mm_store_ps(clamped + 4 * k, unit);
+				_mm_store_si128(reinterpret_cast<__m128i*>(buckets + 4 * k), _mm_cvttps_epi32(_mm_mul_ps(unit, _mm_set1_ps(float(SRGB_BUCKETS)))));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), linear);
+			for (int k = 0; k < 16; k++) {
+				if (k % 4 == 3)
+					continue;
+				const uint8_t code = tables.codes[buckets[k]];
+				destination[i * 4 + k] = code + (clamped[k] >= tables.thresholds[code]);
+			}
+		}
+		return i;
+	}
+#endif
+
+	struct Conversion
+	{
+		const char* name;
+		size_t sourceBytes;
+		size_t destinationBytes;
+		void (*convert)(const uint8_t* source, uint8_t* destination, size_t count);
+		// nullptr when the plain loop is as fast (table lookups)
+		size_t (*kernel)(const uint8_t* source, uint8_t* destination, size_t count);
+	};
+
+	const Conversion CONVERSIONS[PIXEL_CONVERSION_COUNT] = {
+		{ "rgb-to-rgba", 3, 4, rgbToRgba, PIXEL_KERNEL(rgbToRgbaSse) },
+		{ "bgr-to-rgba", 3, 4, bgrToRgba, PIXEL_KERNEL(bgrToRgbaSse) },
+		{ "bgra-to-rgba", 4, 4, bgraToRgba, PIXEL_KERNEL(bgraToRgbaSse) },
+		{ "bgrx-to-rgba", 4, 4, bgrxToRgba, PIXEL_KERNEL(bgrxToRgbaSse) },
+		{ "rgbx-to-rgba", 4, 4, rgbxToRgba, PIXEL_KERNEL(rgbxToRgbaSse) },
+		{ "premultiply", 4, 4, premultiply, PIXEL_KERNEL(premultiplySse) },
+		{ "unpremultiply", 4, 4, unpremultiply, PIXEL_KERNEL(unpremultiplySse) },
+		{ "rgb16-to-rgba", 6, 4, rgb16ToRgba, PIXEL_KERNEL(rgb16ToRgbaSse) },
+		{ "rgba16-to-rgba", 8, 4, rgba16ToRgba, PIXEL_KERNEL(rgba16ToRgbaSse) },
+		{ "rgba-to-float", 4, 16, rgbaToFloat, PIXEL_KERNEL(rgbaToFloatSse) },
+		{ "float-to-rgba", 16, 4, floatToRgba, PIXEL_KERNEL(floatToRgbaSse) },
+		{ "srgb-to-linear", 4, 16, srgbToLinear, nullptr },
+		{ "linear-to-srgb", 16, 4, linearToSrgb, PIXEL_KERNEL(linearToSrgbSse) }
+	};
+}
+
+const char* getPixelConversionName(PixelConversion conversion)
+{
+	return CONVERSIONS[static_cast<int>(conversion)].name;
+}
+
+bool parsePixelConversion(const string& name, PixelConversion& conversion)
+{
+	for (int i = 0; i < PIXEL_CONVERSION_COUNT; i++) {
+		if (name == CONVERSIONS[i].name) {
+			conversion = static_cast<PixelConversion>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t getSourcePixelBytes(PixelConversion conversion)
+{
+	return CONVERSIONS[static_cast<int>(conversion)].sourceBytes;
+}
+
+size_t getDestinationPixelBytes(PixelConversion conversion)
+{
+	return CONVERSIONS[static_cast<int>(conversion)].destinationBytes;
+}
+
+void convertPixels(PixelConversion conversion, const void* source, void* destination, size_t count, bool simd)
+{
+	const Conversion& entry = CONVERSIONS[static_cast<int>(conversion)];
+	const uint8_t* from = static_cast<const uint8_t*>(source);
+	uint8_t* to = static_cast<uint8_t*>(destination);
+	// the kernels leave the last few pixels to the plain loop
+	const size_t done = simd && entry.kernel ? entry.kernel(from, to, count) : 0;
+	entry.convert(from + done * entry.sourceBytes, to + done * entry.destinationBytes, count - done);
+}
+
+const char* getPixelKernelsName()
+{
+#if defined(__AVX2__)
+	return "avx2";
+#elif defined(PIXELS_SSSE3)
+	return "ssse3";
+#elif defined(PIXELS_SSE)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Conversions between the pixel formats images are decoded in and the 8-bit
+// RGBA (or float RGBA) the texture code works with. Every conversion has a
+// plain C++ loop and an SSE2 kernel (SSSE3 and AVX2 when the compiler targets
+// them) that gives the same bytes, loadImage runs them instead of a WIC
+// format converter for the common formats.
+
+enum class PixelConversion
+{
+	rgbToRgba,      // 24-bit RGB, alpha 255
+	bgrToRgba,      // 24-bit BGR, alpha 255
+	bgraToRgba,     // swaps red and blue, works both ways
+	bgrxToRgba,     // 32-bit BGR with an unused byte, alpha 255
+	rgbxToRgba,     // 32-bit RGB with an unused byte, alpha 255
+	premultiply,    // RGBA to premultiplied RGBA
+	unpremultiply,  // premultiplied RGBA to RGBA, colors without alpha become 0
+	rgb16ToRgba,    // 48-bit RGB, 16 bits per channel rounded to 8, alpha 255
+	rgba16ToRgba,   // 64-bit RGBA, 16 bits per channel rounded to 8
+	rgbaToFloat,    // RGBA to float RGBA in [0, 1]
+	floatToRgba,    // float RGBA clamped to [0, 1] and rounded
+	srgbToLinear,   // RGBA with sRGB colors to float RGBA in linear light, alpha stays linear
+	linearToSrgb    // back, rounded in sRGB space
+};
+
+const int PIXEL_CONVERSION_COUNT = static_cast<int>(PixelConversion::linearToSrgb) + 1;
+
+const char* getPixelConversionName(PixelConversion conversion);
+bool parsePixelConversion(const std::string& name, PixelConversion& conversion);
+// bytes of one pixel before and after the conversion
+size_t getSourcePixelBytes(PixelConversion conversion);
+size_t getDestinationPixelBytes(PixelConversion conversion);
+
+// Converts count pixels. Conversions that keep the pixel size may convert in
+// place (source == destination), the others need separate buffers. simd false
+// runs the plain loops, which the kernels must match byte for byte.
+void convertPixels(PixelConversion conversion, const void* source, void* destination, size_t count, bool simd = true);
+
+// the instruction sets the kernels were compiled for, "scalar" without any
+const char* getPixelKernelsName();
@@ -0,0 +1,214 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+atomic<bool> Profiler::m_enabled{ false };
+
+namespace {
+	const size_t CHUNK_EVENTS = 4096;
+	const size_t MAX_CHUNKS = Profiler::MAX_THREAD_EVENTS / CHUNK_EVENTS;
+
+	// Written by its thread only. The events go into chunks allocated as they
+	// fill and never moved, count is published after the event, so the trace
+	// can be written while the thread keeps recording.
+	struct ThreadBuffer
+	{
+		uint32_t id = 0;
+		string name;
+		atomic<ProfileEvent*> chunks[MAX_CHUNKS] = {};
+		atomic<size_t> count{ 0 };
+		atomic<uint64_t> dropped{ 0 };
+
+		~ThreadBuffer() {
+			for (auto& chunk : chunks)
+				delete[] chunk.load();
+		}
+	};
+
+	// the buffers outlive their threads so the zones of finished workers end up in the trace too
+	struct Registry
+	{
+		mutex access;
+		vector<unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	Registry& getRegistry() {
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* t_buffer = nullptr;
+
+	ThreadBuffer& getThreadBuffer() {
+		if (!t_buffer) {
+			Registry& registry = getRegistry();
+			lock_guard<mutex> lock(registry.access);
+			registry.buffers.push_back(make_unique<ThreadBuffer>());
+			t_buffer = registry.buffers.back().get();
+			t_buffer->id = static_cast<uint32_t>(registry.buffers.size() - 1);
+		}
+		return *t_buffer;
+	}
+
+	void writeJsonString(ostream& out, const string& text) {
+		out << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				out << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out << escaped;
+			}
+			else
+				out << c;
+		}
+		out << '"';
+	}
+
+	// nanoseconds as the microseconds of the trace format
+	void writeMicroseconds(ostream& out, int64_t nanoseconds) {
+		char text[32];
+		snprintf(text, sizeof(text), "%lld.%03d", static_cast<long long>(nanoseconds / 1000), static_cast<int>(nanoseconds % 1000));
+		out << text;
+	}
+}
+
+void Profiler::setEnabled(bool enabled) noexcept
+{
+	m_enabled.store(enabled, memory_order_relaxed);
+}
+
+int64_t Profiler::now() noexcept
+{
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char* name, int64_t start_ns, int64_t end_ns) noexcept
+{
+	ThreadBuffer* buffer = t_buffer;
+	if (!buffer) {
+		try {
+			buffer = &getThreadBuffer();
+		}
+		catch (const exception&) {
+			return;
+		}
+	}
+
+	const size_t count = buffer->count.load(memory_order_relaxed);
+	if (count >= MAX_THREAD_EVENTS) {
+		buffer->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+	auto& slot = buffer->chunks[count / CHUNK_EVENTS];
+	ProfileEvent* chunk = slot.load(memory_order_relaxed);
+	if (!chunk) {
+		chunk = new (nothrow) ProfileEvent[CHUNK_EVENTS];
+		if (!chunk) {
+			buffer->dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+		slot.store(chunk, memory_order_release);
+	}
+	chunk[count % CHUNK_EVENTS] = { name, start_ns, end_ns };
+	buffer->count.store(count + 1, memory_order_release);
+}
+
+void Profiler::setThreadName(const string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	lock_guard<mutex> lock(getRegistry().access);
+	buffer.name = name;
+}
+
+bool Profiler::writeChromeTrace(const string& path)
+{
+	Registry& registry = getRegistry();
+	lock_guard<mutex> lock(registry.access);
+
+	// the events of each thread up to what it had published, the trace starts at the first zone
+	vector<vector<ProfileEvent>> events(registry.buffers.size());
+	int64_t origin = INT64_MAX;
+	for (size_t i = 0; i < registry.buffers.size(); i++) {
+		const ThreadBuffer& buffer = *registry.buffers[i];
+		const size_t count = buffer.count.load(memory_order_acquire);
+		events[i].reserve(count);
+		for (size_t j = 0; j < count; j++)
+			events[i].push_back(buffer.chunks[j / CHUNK_EVENTS].load(memory_order_acquire)[j % CHUNK_EVENTS]);
+		// zones are recorded as they close, the enclosing ones after what they hold
+		sort(events[i].begin(), events[i].end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+			return a.startNs != b.startNs ? a.startNs < b.startNs : a.endNs > b.endNs;
+		});
+		if (!events[i].empty())
+			origin = min(origin, events[i].front().startNs);
+	}
+
+	ofstream file(path);
+	if (!file)
+		return false;
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	for (size_t i = 0; i < registry.buffers.size(); i++) {
+		const ThreadBuffer& buffer = *registry.buffers[i];
+		if (!buffer.name.empty()) {
+			file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id << ",\"args\":{\"name\":";
+			writeJsonString(file, buffer.name);
+			file << "}}";
+			first = false;
+		}
+		for (const auto& event : events[i]) {
+			file << (first ? "\n" : ",\n") << "{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id << ",\"ts\":";
+			writeMicroseconds(file, event.startNs - origin);
+			file << ",\"dur\":";
+			writeMicroseconds(file, event.endNs - event.startNs);
+			file << '}';
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
+
+uint64_t Profiler::getEventCount()
+{
+	Registry& registry = getRegistry();
+	lock_guard<mutex> lock(registry.access);
+	uint64_t count = 0;
+	for (const auto& buffer : registry.buffers)
+		count += buffer->count.load(memory_order_relaxed);
+	return count;
+}
+
+uint64_t Profiler::getDroppedEvents()
+{
+	Registry& registry = getRegistry();
+	lock_guard<mutex> lock(registry.access);
+	uint64_t dropped = 0;
+	for (const auto& buffer : registry.buffers)
+		dropped += buffer->dropped.load(memory_order_relaxed);
+	return dropped;
+}
+
+void Profiler::reset()
+{
+	Registry& registry = getRegistry();
+	lock_guard<mutex> lock(registry.access);
+	for (auto& buffer : registry.buffers) {
+		buffer->count.store(0, memory_order_relaxed);
+		buffer->dropped.store(0, memory_order_relaxed);
+	}
+}
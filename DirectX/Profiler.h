@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped cpu zones for the frame loop and the load path, written out as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev) to see where a frame goes.
+//
+//	void Graphics::draw(...) {
+//		PROFILE_ZONE("Graphics::draw");
+//		...
+//	}
+//
+// Every thread records into buffers of its own without locks, the names are
+// string literals and only their pointer is kept. Zones cost one relaxed load
+// while the profiler is disabled (the default).
+
+struct ProfileEvent
+{
+	const char* name;
+	// steady clock nanoseconds
+	int64_t startNs;
+	int64_t endNs;
+};
+
+class Profiler {
+public:
+	static bool isEnabled() noexcept { return m_enabled.load(std::memory_order_relaxed); }
+	// zones opened while enabled are recorded even if it is disabled before they close
+	static void setEnabled(bool enabled) noexcept;
+
+	static int64_t now() noexcept;
+	// Appends a zone to the buffer of the calling thread; once that holds
+	// MAX_THREAD_EVENTS the zone is only counted as dropped.
+	static void record(const char* name, int64_t start_ns, int64_t end_ns) noexcept;
+	// names the calling thread in the trace
+	static void setThreadName(const std::string& name);
+
+	// Writes every zone recorded so far as Chrome trace events, one track per
+	// thread. Zones still being recorded by other threads are either in it
+	// whole or not at all. Returns false when the file can't be written.
+	static bool writeChromeTrace(const std::string& path);
+	static uint64_t getEventCount();
+	static uint64_t getDroppedEvents();
+	// forgets the zones, keeps the buffers; not safe while another thread records
+	static void reset();
+
+	static const size_t MAX_THREAD_EVENTS = size_t(1) << 22;
+
+private:
+	static std::atomic<bool> m_enabled;
+};
+
+// Records the time from its construction to its destruction as a zone.
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) noexcept
+		: m_name(Profiler::isEnabled() ? name : nullptr), m_startNs(m_name ? Profiler::now() : 0) {}
+	~ProfileZone() {
+		if (m_name)
+			Profiler::record(m_name, m_startNs, Profiler::now());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* m_name;
+	int64_t m_startNs;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// zone until the end of the enclosing scope, name must be a string literal
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)("" name)
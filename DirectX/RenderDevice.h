@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Meshlets.h"
+#include "TextureStreamer.h"
+#include "VertexFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The device and context calls Graphics makes, so the same Graphics and frame
+// loop run on Direct3D 11 (Renderer) or on nothing at all (NullRenderer).
+// Resources are referred to by handles and live as long as the device. The
+// textures come in through the TextureUploadSink half, from a TextureStreamer.
+
+// 0 is no buffer or pipeline
+using BufferHandle = uint32_t;
+using PipelineHandle = uint32_t;
+
+enum class BufferType
+{
+	vertex,
+	index,
+	constant
+};
+
+// Shaders and state of a draw. The rest is the same for every pipeline of the
+// benchmark: triangle lists, solid fill, no blending, a less depth test with
+// the stencil counting depth failures, a trilinear wrap sampler in slot 0.
+struct PipelineDesc
+{
+	// compiled shaders, the .cso files of the shaders folder
+	std::vector<char> vertexShader;
+	std::vector<char> pixelShader;
+	// what the input assembler reads, the shader always gets float3 and float2
+	VertexFormat vertexFormat = VertexFormat::float32;
+	CullFace cullFace = CullFace::front;
+	bool depthClip = true;
+};
+
+class RenderDevice : public TextureUploadSink {
+public:
+	// clears the targets to the color and sets the viewport
+	virtual void beginFrame(float red, float green, float blue) = 0;
+	// presents the frame
+	virtual void endFrame() = 0;
+
+	// A buffer of bytes with data as its contents. Dynamic buffers are written
+	// with map, data may be null for them.
+	virtual BufferHandle createBuffer(BufferType type, const void* data, size_t bytes, uint32_t stride, bool dynamic) = 0;
+	// Returns the memory of a dynamic buffer to write until unmap, the old
+	// contents are discarded (D3D11_MAP_WRITE_DISCARD).
+	virtual void* map(BufferHandle buffer) = 0;
+	virtual void unmap(BufferHandle buffer) = 0;
+	virtual PipelineHandle createPipeline(const PipelineDesc& desc) = 0;
+
+	virtual void bindVertexBuffer(BufferHandle buffer, uint32_t stride) = 0;
+	// index_size is 2 or 4 bytes
+	virtual void bindIndexBuffer(BufferHandle buffer, uint32_t index_size) = 0;
+	// to the vertex shader, slot 0
+	virtual void bindConstantBuffer(BufferHandle buffer) = 0;
+	// to the pixel shader, slot 0; nothing while the texture hasn't been created
+	virtual void bindTexture(TextureHandle texture) = 0;
+	virtual void bindPipeline(PipelineHandle pipeline) = 0;
+	virtual void drawIndexed(uint32_t index_count, uint32_t index_offset) = 0;
+};
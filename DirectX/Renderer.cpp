@@ -1,6 +1,7 @@
 #include "Renderer.h"
-#include "Graphics.h"
+#include "Profiler.h"
 #include "dxerr.h"
+#include <iterator>
 #include <sstream>
 
 
@@ -26,6 +27,7 @@ D3D_FEATURE_LEVEL g_featureLevel = D3D_FEATURE_LEVEL_11_0;
 
 
 Renderer::Renderer(Window& window) {
+	PROFILE_ZONE("Renderer::Renderer");
 	createDevice(window);
 	createRenderTarget();
 	createStensilState();
@@ -33,6 +35,21 @@ Renderer::Renderer(Window& window) {
 
 //destructor
 Renderer::~Renderer() {
+	for (auto buffer : m_buffers)
+		if (buffer) buffer->Release();
+	for (auto& pipeline : m_pipelines) {
+		pipeline.vertexShader->Release();
+		pipeline.pixelShader->Release();
+		pipeline.inputLayout->Release();
+		pipeline.rasterizerState->Release();
+		pipeline.blendState->Release();
+		pipeline.depthState->Release();
+		pipeline.samplerState->Release();
+	}
+	for (auto& texture : m_textures) {
+		texture.second.view->Release();
+		texture.second.texture->Release();
+	}
 	m_device->Release();
 	m_deviceContext->Release();
 	m_renderTargetView->Release();
@@ -115,6 +132,7 @@ void Renderer::createStensilState() {
 }
 
 void Renderer::beginFrame(float red, float green, float blue) {
+	PROFILE_ZONE("Renderer::beginFrame");
 
 	// Set the background color
 	const float clearColor[] = { .25f, .5f, 1, 1 };
@@ -136,6 +154,7 @@ void Renderer::beginFrame(float red, float green, float blue) {
 }
 
 void Renderer::endFrame() {
+	PROFILE_ZONE("Renderer::endFrame");
 
 	HRESULT hr;
 #ifndef NDEBUG
@@ -159,6 +178,183 @@ ID3D11DeviceContext* Renderer::getDeviceContext() {
 	return m_deviceContext;
 }
 
+#pragma region resources
+BufferHandle Renderer::createBuffer(BufferType type, const void* data, size_t bytes, uint32_t stride, bool dynamic) {
+	HRESULT hr;
+	D3D11_BUFFER_DESC desc = {};
+	desc.BindFlags = type == BufferType::vertex ? D3D11_BIND_VERTEX_BUFFER :
+		type == BufferType::index ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_CONSTANT_BUFFER;
+	desc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	desc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0u;
+	desc.MiscFlags = 0u;
+	desc.ByteWidth = (UINT)bytes;
+	desc.StructureByteStride = stride;
+
+	D3D11_SUBRESOURCE_DATA sd = {};
+	sd.pSysMem = data;
+	ID3D11Buffer* buffer = nullptr;
+	GFX_THROW_INFO(m_device->CreateBuffer(&desc, data ? &sd : nullptr, &buffer));
+	m_buffers.push_back(buffer);
+	return (BufferHandle)m_buffers.size();
+}
+
+void* Renderer::map(BufferHandle buffer) {
+	HRESULT hr;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	GFX_THROW_INFO(m_deviceContext->Map(m_buffers[buffer - 1], 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+	return mapped.pData;
+}
+
+void Renderer::unmap(BufferHandle buffer) {
+	m_deviceContext->Unmap(m_buffers[buffer - 1], 0);
+}
+
+PipelineHandle Renderer::createPipeline(const PipelineDesc& desc) {
+	HRESULT hr;
+	Pipeline pipeline;
+	GFX_THROW_INFO(m_device->CreateVertexShader(desc.vertexShader.data(), desc.vertexShader.size(), nullptr, &pipeline.vertexShader));
+	GFX_THROW_INFO(m_device->CreatePixelShader(desc.pixelShader.data(), desc.pixelShader.size(), nullptr, &pipeline.pixelShader));
+
+	// the shader reads float3/float2 either way, the input assembler converts the compact formats
+	DXGI_FORMAT positionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+	DXGI_FORMAT texCoordFormat = DXGI_FORMAT_R32G32_FLOAT;
+	if (desc.vertexFormat != VertexFormat::float32) {
+		positionFormat = DXGI_FORMAT_R16G16B16A16_UNORM;
+		texCoordFormat = desc.vertexFormat == VertexFormat::unorm16 ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT;
+	}
+
+	//Create input (vertex) layouts
+	D3D11_INPUT_ELEMENT_DESC layout[] = {
+		{"POSITION", 0, positionFormat, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"TEXTCOORD", 0, texCoordFormat, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	};
+	GFX_THROW_INFO(m_device->CreateInputLayout(layout, (UINT)std::size(layout),
+		desc.vertexShader.data(), desc.vertexShader.size(), &pipeline.inputLayout));
+
+	// Rasterizer state
+	auto rasterizerDesc = CD3D11_RASTERIZER_DESC(
+		D3D11_FILL_SOLID,
+		desc.cullFace == CullFace::front ? D3D11_CULL_FRONT : desc.cullFace == CullFace::back ? D3D11_CULL_BACK : D3D11_CULL_NONE,
+		false,
+		0, 0, 0,
+		desc.depthClip, false, false, false);
+	GFX_THROW_INFO(m_device->CreateRasterizerState(&rasterizerDesc, &pipeline.rasterizerState));
+
+	// Blend state
+	auto blendDesc = CD3D11_BLEND_DESC(CD3D11_DEFAULT());
+	GFX_THROW_INFO(m_device->CreateBlendState(&blendDesc, &pipeline.blendState));
+
+	// Depth state
+	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+	dsDesc.DepthEnable = TRUE;
+	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+
+	dsDesc.StencilEnable = true;
+	dsDesc.StencilReadMask = 0xFF;
+	dsDesc.StencilWriteMask = 0xFF;
+	// Stencil operations if pixel is front-facing
+	dsDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+	dsDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_INCR;
+	dsDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+	dsDesc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+
+	// Stencil operations if pixel is back-facing
+	dsDesc.BackFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+	dsDesc.BackFace.StencilDepthFailOp = D3D11_STENCIL_OP_DECR;
+	dsDesc.BackFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+	dsDesc.BackFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+	GFX_THROW_INFO(m_device->CreateDepthStencilState(&dsDesc, &pipeline.depthState));
+
+	// trilinear with wrap addressing
+	D3D11_SAMPLER_DESC sampDesc = {};
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sampDesc.MinLOD = 0;
+	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	GFX_THROW_INFO(m_device->CreateSamplerState(&sampDesc, &pipeline.samplerState));
+
+	m_pipelines.push_back(pipeline);
+	return (PipelineHandle)m_pipelines.size();
+}
+
+void Renderer::createTexture(TextureHandle texture, const TextureInfo& info) {
+	HRESULT hr;
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = info.width;
+	desc.Height = info.height;
+	desc.MipLevels = info.mipCount;
+	desc.ArraySize = 1;
+	desc.Format = info.format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	Texture created;
+	GFX_THROW_INFO(m_device->CreateTexture2D(&desc, nullptr, &created.texture));
+	created.mipCount = info.mipCount;
+	GFX_THROW_INFO(m_device->CreateShaderResourceView(created.texture, nullptr, &created.view));
+	m_textures[texture] = created;
+}
+
+void Renderer::uploadLevel(TextureHandle texture, const TextureLevel& level) {
+	const Texture& uploaded = m_textures.at(texture);
+	m_deviceContext->UpdateSubresource(uploaded.texture, D3D11CalcSubresource(level.mip, 0, uploaded.mipCount), nullptr,
+		level.data.data(), (UINT)level.rowPitch, 0);
+	// the sampler only reads the levels that are there
+	m_deviceContext->SetResourceMinLOD(uploaded.texture, (FLOAT)level.mip);
+}
+#pragma endregion resources
+
+#pragma region binds
+void Renderer::bindVertexBuffer(BufferHandle buffer, uint32_t stride) {
+	UINT offset = 0u;
+	m_deviceContext->IASetVertexBuffers(0u, 1u, &m_buffers[buffer - 1], &stride, &offset);
+}
+
+void Renderer::bindIndexBuffer(BufferHandle buffer, uint32_t index_size) {
+	m_deviceContext->IASetIndexBuffer(m_buffers[buffer - 1], index_size == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0u);
+}
+
+void Renderer::bindConstantBuffer(BufferHandle buffer) {
+	m_deviceContext->VSSetConstantBuffers(0u, 1u, &m_buffers[buffer - 1]);
+}
+
+void Renderer::bindTexture(TextureHandle texture) {
+	// nothing to sample until the streamer created it
+	auto found = m_textures.find(texture);
+	ID3D11ShaderResourceView* view = found != m_textures.end() ? found->second.view : nullptr;
+	m_deviceContext->PSSetShaderResources(0u, 1u, &view);
+}
+
+void Renderer::bindPipeline(PipelineHandle pipeline) {
+	const Pipeline& bound = m_pipelines[pipeline - 1];
+	m_deviceContext->PSSetSamplers(0u, 1u, &bound.samplerState);
+
+	// set render states
+	m_deviceContext->RSSetState(bound.rasterizerState);
+	m_deviceContext->OMSetBlendState(bound.blendState, NULL, 0xffffff);
+	m_deviceContext->OMSetDepthStencilState(bound.depthState, 1u);
+
+	// bind vertex layout
+	m_deviceContext->IASetInputLayout(bound.inputLayout);
+
+	// bind the triangle shaders
+	m_deviceContext->VSSetShader(bound.vertexShader, nullptr, 0u);
+	m_deviceContext->PSSetShader(bound.pixelShader, nullptr, 0u);
+
+	// set primitive topology to triangle list (groups of 3 vertices)
+	m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void Renderer::drawIndexed(uint32_t index_count, uint32_t index_offset) {
+	m_deviceContext->DrawIndexed(index_count, index_offset, 0u);
+}
+#pragma endregion binds
+
 // Graphics exception stuff
 Renderer::HrException::HrException(int line, const char* file, HRESULT hr, std::vector<std::string> infoMsgs) noexcept:Exception(line, file), hr(hr)
 {
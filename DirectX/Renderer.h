@@ -2,18 +2,38 @@
 
 #include "ChiliWin.h"
 #include "DxgiInfoManager.h"
+#include "RenderDevice.h"
 #include "Window.h"
 #include <d3d11.h>
+#include <map>
+#include <vector>
 
-class Renderer {
+// The Direct3D 11 RenderDevice: a device and a swap chain on the window.
+class Renderer : public RenderDevice {
 public:
 	Renderer(Window& window);
 	~Renderer(); //destructor
-	void beginFrame(float red, float green, float blue);
-	void endFrame();
+	void beginFrame(float red, float green, float blue) override;
+	void endFrame() override;
 	ID3D11Device* getDevice();
 	ID3D11DeviceContext* getDeviceContext();
 
+	BufferHandle createBuffer(BufferType type, const void* data, size_t bytes, uint32_t stride, bool dynamic) override;
+	void* map(BufferHandle buffer) override;
+	void unmap(BufferHandle buffer) override;
+	PipelineHandle createPipeline(const PipelineDesc& desc) override;
+
+	void bindVertexBuffer(BufferHandle buffer, uint32_t stride) override;
+	void bindIndexBuffer(BufferHandle buffer, uint32_t index_size) override;
+	void bindConstantBuffer(BufferHandle buffer) override;
+	void bindTexture(TextureHandle texture) override;
+	void bindPipeline(PipelineHandle pipeline) override;
+	void drawIndexed(uint32_t index_count, uint32_t index_offset) override;
+
+	// TextureUploadSink: every level is allocated up front and filled in smallest first
+	void createTexture(TextureHandle texture, const TextureInfo& info) override;
+	void uploadLevel(TextureHandle texture, const TextureLevel& level) override;
+
 	class Exception : public ChiliException
 	{
 		using ChiliException::ChiliException;
@@ -61,6 +81,27 @@ private:
 	ID3D11Texture2D* m_depthStencilTexture = nullptr;
 	ID3D11DepthStencilView* m_depthStencilView = nullptr;
 
+	// the resources behind the handles, handle - 1 indexes the vectors
+	std::vector<ID3D11Buffer*> m_buffers;
+	struct Pipeline
+	{
+		ID3D11VertexShader* vertexShader = nullptr;
+		ID3D11PixelShader* pixelShader = nullptr;
+		ID3D11InputLayout* inputLayout = nullptr;
+		ID3D11RasterizerState* rasterizerState = nullptr;
+		ID3D11BlendState* blendState = nullptr;
+		ID3D11DepthStencilState* depthState = nullptr;
+		ID3D11SamplerState* samplerState = nullptr;
+	};
+	std::vector<Pipeline> m_pipelines;
+	struct Texture
+	{
+		ID3D11Texture2D* texture = nullptr;
+		ID3D11ShaderResourceView* view = nullptr;
+		UINT mipCount = 0;
+	};
+	std::map<TextureHandle, Texture> m_textures;
+
 #ifndef NDEBUG
 	DxgiInfoManager infoManager;
 #endif
@@ -0,0 +1,288 @@
+#include "TextureAtlas.h"
+
+#include "Bounds.h"
+#include "MeshLoader.h"
+#include "VertexDeduplicator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+	// the largest 2d texture Direct3D 11 creates
+	const uint32_t MAX_ATLAS_SIZE = 16384;
+	// rects start and end on multiples of this, so no 4x4 block of a compressed atlas mixes two images
+	const uint32_t ATLAS_ALIGNMENT = 4;
+	// side of the tile of a material without a texture, before the padding
+	const uint32_t COLOR_TILE_SIZE = 4;
+
+	// the top edge of the packed rects over [x, x + width)
+	struct SkylineSegment
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	// Places the rects in order into width x height, false when one doesn't fit
+	bool packSkyline(vector<AtlasRect>& rects, const vector<size_t>& order, uint32_t width, uint32_t height) {
+		vector<SkylineSegment> skyline = { { 0, 0, width } };
+		for (size_t index : order) {
+			AtlasRect& rect = rects[index];
+
+			// the rect rests on the highest segment below it, keep the position where its top is lowest
+			size_t best = SIZE_MAX;
+			uint32_t bestTop = UINT32_MAX;
+			uint32_t bestY = 0;
+			for (size_t i = 0; i < skyline.size() && rect.width <= width - skyline[i].x; i++) {
+				uint32_t y = 0;
+				for (size_t j = i, covered = 0; covered < rect.width; covered += skyline[j].width, j++)
+					y = max(y, skyline[j].y);
+				if (rect.height > height - y)
+					continue;
+				if (y + rect.height < bestTop) {
+					best = i;
+					bestTop = y + rect.height;
+					bestY = y;
+				}
+			}
+			if (best == SIZE_MAX)
+				return false;
+			rect.x = skyline[best].x;
+			rect.y = bestY;
+
+			// the rect's top replaces the segments it covers, a partly covered one keeps its right end
+			const uint32_t end = rect.x + rect.width;
+			size_t j = best;
+			while (j < skyline.size() && skyline[j].x < end) {
+				const uint32_t segmentEnd = skyline[j].x + skyline[j].width;
+				if (segmentEnd > end) {
+					skyline[j].width = segmentEnd - end;
+					skyline[j].x = end;
+					break;
+				}
+				skyline.erase(skyline.begin() + j);
+			}
+			if (rect.width > 0)
+				skyline.insert(skyline.begin() + best, { rect.x, bestTop, rect.width });
+
+			for (size_t k = 0; k + 1 < skyline.size();) {
+				if (skyline[k].y == skyline[k + 1].y) {
+					skyline[k].width += skyline[k + 1].width;
+					skyline.erase(skyline.begin() + k + 1);
+				}
+				else {
+					k++;
+				}
+			}
+		}
+		return true;
+	}
+
+	uint32_t alignUp(uint32_t value) {
+		return (value + ATLAS_ALIGNMENT - 1) / ATLAS_ALIGNMENT * ATLAS_ALIGNMENT;
+	}
+
+	Image makeColorTile(const float color[3]) {
+		Image tile;
+		tile.width = tile.height = COLOR_TILE_SIZE;
+		tile.pixels.resize(size_t(COLOR_TILE_SIZE) * COLOR_TILE_SIZE * 4);
+		for (size_t i = 0; i < tile.pixels.size(); i += 4) {
+			for (int c = 0; c < 3; c++)
+				tile.pixels[i + c] = static_cast<uint8_t>(lround(min(max(color[c], 0.0f), 1.0f) * 255.0f));
+			tile.pixels[i + 3] = 255;
+		}
+		return tile;
+	}
+}
+
+bool packAtlas(vector<AtlasRect>& rects, uint32_t max_size, uint32_t& width, uint32_t& height)
+{
+	uint64_t area = 0;
+	uint32_t widest = 1, tallest = 1;
+	for (const auto& rect : rects) {
+		area += uint64_t(rect.width) * rect.height;
+		widest = max(widest, rect.width);
+		tallest = max(tallest, rect.height);
+	}
+	if (widest > max_size || tallest > max_size)
+		return false;
+
+	// tallest first, the rows of the skyline stay level that way
+	vector<size_t> order(rects.size());
+	iota(order.begin(), order.end(), size_t(0));
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return rects[a].height != rects[b].height ? rects[a].height > rects[b].height : rects[a].width > rects[b].width;
+	});
+
+	// every power of two width from the widest rect on, each as tall as the
+	// rects reach; the one with the shortest longest side wins, then the
+	// smallest, so the atlas stays close to square
+	vector<AtlasRect> trial;
+	uint64_t bestSide = UINT64_MAX, bestArea = UINT64_MAX;
+	width = height = 0;
+	for (uint64_t trialWidth = 1; trialWidth <= max_size && trialWidth <= bestSide; trialWidth *= 2) {
+		if (trialWidth < widest)
+			continue;
+		trial = rects;
+		if (!packSkyline(trial, order, static_cast<uint32_t>(trialWidth), max_size))
+			continue;
+		uint32_t top = 1;
+		for (const auto& rect : trial)
+			top = max(top, rect.y + rect.height);
+		const uint64_t side = max<uint64_t>(trialWidth, top);
+		if (side < bestSide || (side == bestSide && trialWidth * top < bestArea)) {
+			bestSide = side;
+			bestArea = trialWidth * top;
+			width = static_cast<uint32_t>(trialWidth);
+			height = top;
+			swap(rects, trial);
+		}
+	}
+	return bestSide != UINT64_MAX;
+}
+
+void buildAtlas(const vector<const Image*>& images, uint32_t padding, Image& atlas, vector<AtlasRegion>& regions)
+{
+	vector<AtlasRect> rects(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		const Image& image = *images[i];
+		if (image.width == 0 || image.height == 0)
+			throw runtime_error("atlas: empty image");
+		if (image.width > MAX_ATLAS_SIZE || image.height > MAX_ATLAS_SIZE)
+			throw runtime_error("atlas: image larger than " + to_string(MAX_ATLAS_SIZE));
+		rects[i].width = alignUp(image.width + 2 * padding);
+		rects[i].height = alignUp(image.height + 2 * padding);
+	}
+
+	uint32_t width, height;
+	if (!packAtlas(rects, MAX_ATLAS_SIZE, width, height))
+		throw runtime_error("atlas: the images don't fit into " + to_string(MAX_ATLAS_SIZE) + " x " + to_string(MAX_ATLAS_SIZE));
+
+	atlas.width = width;
+	atlas.height = height;
+	atlas.pixels.assign(size_t(width) * height * 4, 0);
+	regions.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		const Image& image = *images[i];
+		const AtlasRect& rect = rects[i];
+
+		// the gutter (and the alignment beyond it) repeats the nearest edge texel
+		for (uint32_t y = 0; y < rect.height; y++) {
+			const int64_t sourceY = min<int64_t>(max<int64_t>(int64_t(y) - padding, 0), image.height - 1);
+			const uint8_t* source = image.getPixel(0, static_cast<uint32_t>(sourceY));
+			uint8_t* row = atlas.getPixel(rect.x, rect.y + y);
+			for (uint32_t x = 0; x < padding; x++)
+				memcpy(row + 4 * x, source, 4);
+			memcpy(row + 4 * padding, source, size_t(image.width) * 4);
+			for (uint32_t x = padding + image.width; x < rect.width; x++)
+				memcpy(row + 4 * x, source + 4 * (image.width - 1), 4);
+		}
+
+		regions[i].offset[0] = float(rect.x + padding) / width;
+		regions[i].offset[1] = float(rect.y + padding) / height;
+		regions[i].scale[0] = float(image.width) / width;
+		regions[i].scale[1] = float(image.height) / height;
+	}
+}
+
+void buildMaterialAtlas(const vector<tinyobj::material_t>& materials, const string& base_dir, uint32_t padding,
+	MaterialAtlas& atlas)
+{
+	// every texture once, however many materials use it, then a color tile per untextured material and the white one
+	vector<Image> images;
+	images.reserve(materials.size() + 1);
+	vector<size_t> imageOf(materials.size() + 1);
+	map<string, size_t> loaded;
+	for (size_t i = 0; i < materials.size(); i++) {
+		const string& name = materials[i].diffuse_texname;
+		if (name.empty()) {
+			imageOf[i] = images.size();
+			images.push_back(makeColorTile(materials[i].diffuse));
+			continue;
+		}
+
+		const string path = (filesystem::path(base_dir) / name).string();
+		auto found = loaded.find(path);
+		if (found == loaded.end()) {
+			images.emplace_back();
+			loadImage(path, images.back());
+			found = loaded.emplace(path, images.size() - 1).first;
+		}
+		imageOf[i] = found->second;
+	}
+	const float white[3] = { 1.0f, 1.0f, 1.0f };
+	imageOf[materials.size()] = images.size();
+	images.push_back(makeColorTile(white));
+
+	vector<const Image*> sources;
+	for (const auto& image : images)
+		sources.push_back(&image);
+	vector<AtlasRegion> imageRegions;
+	buildAtlas(sources, padding, atlas.image, imageRegions);
+
+	atlas.regions.resize(imageOf.size());
+	for (size_t i = 0; i < imageOf.size(); i++)
+		atlas.regions[i] = imageRegions[imageOf[i]];
+	atlas.textureCount = loaded.size();
+}
+
+void buildAtlasMesh(const tinyobj::attrib_t& attrib, const vector<tinyobj::shape_t>& shapes, const MaterialAtlas& atlas,
+	MeshData& mesh, size_t* clamped_faces)
+{
+	if (atlas.regions.empty())
+		throw runtime_error("atlas: no regions");
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	size_t indexCount = 0;
+	for (const auto& shape : shapes)
+		indexCount += shape.mesh.indices.size();
+	mesh.indices.reserve(indexCount);
+
+	VertexDeduplicator uniqueVertices(mesh.vertices, indexCount);
+
+	size_t clamped = 0;
+	for (const auto& shape : shapes) {
+		for (size_t face = 0; face * 3 + 2 < shape.mesh.indices.size(); face++) {
+			const int material = face < shape.mesh.material_ids.size() ? shape.mesh.material_ids[face] : -1;
+			const AtlasRegion& region = material >= 0 && size_t(material) + 1 < atlas.regions.size() ?
+				atlas.regions[material] : atlas.regions.back();
+
+			Vertex corners[3];
+			for (int c = 0; c < 3; c++)
+				corners[c] = readObjVertex(attrib, shape.mesh.indices[face * 3 + c]);
+
+			// the atlas doesn't repeat: move the face by whole tiles so it starts in [0, 1]
+			bool clamp = false;
+			for (int axis = 0; axis < 2; axis++) {
+				auto coordinate = [axis](Vertex& vertex) -> float& { return axis == 0 ? vertex.texCoord.u : vertex.texCoord.v; };
+				const float shift = floor(min({ coordinate(corners[0]), coordinate(corners[1]), coordinate(corners[2]) }));
+				for (auto& corner : corners) {
+					float value = coordinate(corner) - shift;
+					if (value > 1.0f) {
+						value = 1.0f;
+						clamp = true;
+					}
+					coordinate(corner) = region.offset[axis] + value * region.scale[axis];
+				}
+			}
+			if (clamp)
+				clamped++;
+
+			for (const auto& corner : corners)
+				mesh.indices.push_back(uniqueVertices.insert(corner));
+		}
+	}
+
+	computeBounds(mesh.vertices, mesh.bounds);
+	if (clamped_faces)
+		*clamped_faces = clamped;
+}
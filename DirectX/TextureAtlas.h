@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Image.h"
+#include "Mesh.h"
+#include "Tiny_obj_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Packs the diffuse textures of the materials of an .obj into one atlas and
+// moves the texture coordinates of every face into the part of its material,
+// so a model with several materials renders with one texture and one draw.
+
+// A rectangle of the atlas, in texels
+struct AtlasRect
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Where one image ended up, in texture coordinates (v down, like Vertex::texCoord):
+// a coordinate in [0, 1] of the image goes to offset + coordinate * scale
+struct AtlasRegion
+{
+	float offset[2] = { 0.0f, 0.0f };
+	float scale[2] = { 1.0f, 1.0f };
+};
+
+// Places rects (their width and height are read, x and y written) without
+// overlaps into an atlas a power of two wide and as tall as the rects reach,
+// the one closest to square, no side larger than max_size. Skyline bottom-left:
+// the tallest rects go first, each where its top stays lowest. Returns false
+// when they don't fit.
+bool packAtlas(std::vector<AtlasRect>& rects, uint32_t max_size, uint32_t& width, uint32_t& height);
+
+// Copies images into one atlas, each surrounded by padding texels of its own
+// edge so the bilinear taps and the smaller mips don't pick up its neighbours.
+// regions[i] is where images[i] went. Throws a runtime_error when they don't
+// fit into 16384 x 16384.
+void buildAtlas(const std::vector<const Image*>& images, uint32_t padding, Image& atlas, std::vector<AtlasRegion>& regions);
+
+// The atlas of the diffuse textures of a model: regions[i] belongs to
+// materials[i], the last one to faces without a material
+struct MaterialAtlas
+{
+	Image image;
+	std::vector<AtlasRegion> regions;
+	size_t textureCount = 0; // distinct images loaded
+};
+
+// Loads the diffuse_texname of every material (relative to base_dir, each file
+// once) and packs them with buildAtlas. Materials without a texture get a
+// small tile of their diffuse color, faces without a material a white one.
+// Throws a runtime_error when an image can't be loaded.
+void buildMaterialAtlas(const std::vector<tinyobj::material_t>& materials, const std::string& base_dir, uint32_t padding,
+	MaterialAtlas& atlas);
+
+// buildMesh with the texture coordinates of every face moved into the region
+// of its material. Repeating coordinates are shifted by whole tiles until the
+// face starts in [0, 1]; faces that still span more than one tile are clamped
+// into it and counted in clamped_faces.
+void buildAtlasMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+	const MaterialAtlas& atlas, MeshData& mesh, size_t* clamped_faces = nullptr);
@@ -0,0 +1,891 @@
+#include "TextureCompressor.h"
+#include "BcTables.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define COMPRESSOR_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const int PIXELS = 16;
+
+	// a 4x4 block as floats, one array per channel so four pixels fit in a register
+	struct Block
+	{
+		alignas(16) float channels[4][PIXELS];
+	};
+
+	// the colors an encoded block can decode to, RGBA
+	struct Palette
+	{
+		float colors[16][4];
+		int count;
+	};
+
+	float clampColor(float value) {
+		return min(max(value, 0.0f), 255.0f);
+	}
+
+	void loadBlock(const Image& image, uint32_t block_x, uint32_t block_y, Block& block) {
+		for (uint32_t y = 0; y < 4; y++) {
+			const uint32_t sourceY = min(block_y * 4 + y, image.height - 1);
+			for (uint32_t x = 0; x < 4; x++) {
+				const uint8_t* pixel = image.getPixel(min(block_x * 4 + x, image.width - 1), sourceY);
+				for (int c = 0; c < 4; c++)
+					block.channels[c][y * 4 + x] = pixel[c];
+			}
+		}
+	}
+
+	// Picks the closest palette color for every pixel, comparing the channels
+	// [first, first + channel_count). Fills in the index and squared error of every pixel.
+	void assignIndices(const Block& block, const Palette& palette, int first, int channel_count,
+		uint8_t indices[PIXELS], float errors[PIXELS]) {
+#ifdef COMPRESSOR_SSE
+		// four pixels at a time against one palette color
+		for (int p = 0; p < PIXELS; p += 4) {
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int i = 0; i < palette.count; i++) {
+				__m128 distance = _mm_setzero_ps();
+				for (int c = first; c < first + channel_count; c++) {
+					const __m128 d = _mm_sub_ps(_mm_load_ps(&block.channels[c][p]), _mm_set1_ps(palette.colors[i][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+				}
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)), _mm_andnot_si128(closer, bestIndex));
+			}
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+			_mm_storeu_ps(&errors[p], best);
+			for (int k = 0; k < 4; k++)
+				indices[p + k] = static_cast<uint8_t>(lanes[k]);
+		}
+#else
+		for (int p = 0; p < PIXELS; p++) {
+			errors[p] = FLT_MAX;
+			for (int i = 0; i < palette.count; i++) {
+				float distance = 0.0f;
+				for (int c = first; c < first + channel_count; c++) {
+					const float d = block.channels[c][p] - palette.colors[i][c];
+					distance += d * d;
+				}
+				if (distance < errors[p]) {
+					errors[p] = distance;
+					indices[p] = static_cast<uint8_t>(i);
+				}
+			}
+		}
+#endif
+	}
+
+	float sumErrors(const float errors[PIXELS], uint16_t mask) {
+		float sum = 0.0f;
+		for (int p = 0; p < PIXELS; p++) {
+			if (mask >> p & 1)
+				sum += errors[p];
+		}
+		return sum;
+	}
+
+	// Mean and principal axis (power iteration on the covariance) of the pixels in
+	// mask over the channels [first, first + channel_count). The axis stays zero when
+	// all pixels are the same.
+	void principalAxis(const Block& block, uint16_t mask, int first, int channel_count, float mean[4], float axis[4]) {
+		const int last = first + channel_count;
+		int count = 0;
+		for (int c = 0; c < 4; c++)
+			mean[c] = axis[c] = 0.0f;
+		for (int p = 0; p < PIXELS; p++) {
+			if (mask >> p & 1) {
+				count++;
+				for (int c = first; c < last; c++)
+					mean[c] += block.channels[c][p];
+			}
+		}
+		if (count == 0)
+			return;
+		for (int c = first; c < last; c++)
+			mean[c] /= count;
+
+		float covariance[4][4] = {};
+		for (int p = 0; p < PIXELS; p++) {
+			if (!(mask >> p & 1))
+				continue;
+			for (int i = first; i < last; i++)
+				for (int j = first; j < last; j++)
+					covariance[i][j] += (block.channels[i][p] - mean[i]) * (block.channels[j][p] - mean[j]);
+		}
+
+		// start along the channel that varies the most
+		int start = first;
+		for (int c = first; c < last; c++) {
+			if (covariance[c][c] > covariance[start][start])
+				start = c;
+		}
+		if (covariance[start][start] <= 0.0f)
+			return;
+		axis[start] = 1.0f;
+
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[4] = {};
+			for (int i = first; i < last; i++)
+				for (int j = first; j < last; j++)
+					next[i] += covariance[i][j] * axis[j];
+			float length = 0.0f;
+			for (int c = first; c < last; c++)
+				length += next[c] * next[c];
+			length = sqrtf(length);
+			if (length == 0.0f)
+				break;
+			for (int c = first; c < last; c++)
+				axis[c] = next[c] / length;
+		}
+	}
+
+	// endpoints at the extremes of the pixels projected on their principal axis
+	void fitEndpoints(const Block& block, uint16_t mask, int first, int channel_count, float e0[4], float e1[4]) {
+		float mean[4], axis[4];
+		principalAxis(block, mask, first, channel_count, mean, axis);
+
+		float low = 0.0f, high = 0.0f;
+		for (int p = 0; p < PIXELS; p++) {
+			if (!(mask >> p & 1))
+				continue;
+			float t = 0.0f;
+			for (int c = first; c < first + channel_count; c++)
+				t += (block.channels[c][p] - mean[c]) * axis[c];
+			low = min(low, t);
+			high = max(high, t);
+		}
+		for (int c = 0; c < 4; c++) {
+			e0[c] = clampColor(mean[c] + low * axis[c]);
+			e1[c] = clampColor(mean[c] + high * axis[c]);
+		}
+	}
+
+	// Least squares endpoints for the indices the pixels in mask got, weights[i]
+	// is how far palette entry i lies from e0 towards e1.
+	void refineEndpoints(const Block& block, uint16_t mask, const uint8_t indices[PIXELS], const float* weights,
+		int first, int channel_count, float e0[4], float e1[4]) {
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ap[4] = {}, bp[4] = {};
+		for (int p = 0; p < PIXELS; p++) {
+			if (!(mask >> p & 1))
+				continue;
+			const float b = weights[indices[p]];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = first; c < first + channel_count; c++) {
+				ap[c] += a * block.channels[c][p];
+				bp[c] += b * block.channels[c][p];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return;
+		for (int c = first; c < first + channel_count; c++) {
+			e0[c] = clampColor((ap[c] * bb - bp[c] * ab) / determinant);
+			e1[c] = clampColor((bp[c] * aa - ap[c] * ab) / determinant);
+		}
+	}
+
+#pragma region bc1
+	uint16_t packColor565(const float color[4]) {
+		const int r = static_cast<int>(lroundf(clampColor(color[0]) * 31.0f / 255.0f));
+		const int g = static_cast<int>(lroundf(clampColor(color[1]) * 63.0f / 255.0f));
+		const int b = static_cast<int>(lroundf(clampColor(color[2]) * 31.0f / 255.0f));
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	void unpackColor565(uint16_t packed, int color[3]) {
+		const int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// the palette a decoder builds from two 565 endpoints, index 3 of the 3 color
+	// mode (transparent black) is left out
+	void makeColorPalette(uint16_t c0, uint16_t c1, bool three_color, Palette& palette) {
+		int a[3], b[3];
+		unpackColor565(c0, a);
+		unpackColor565(c1, b);
+		for (int c = 0; c < 3; c++) {
+			palette.colors[0][c] = float(a[c]);
+			palette.colors[1][c] = float(b[c]);
+			if (three_color) {
+				palette.colors[2][c] = float((a[c] + b[c] + 1) / 2);
+			}
+			else {
+				palette.colors[2][c] = float((2 * a[c] + b[c] + 1) / 3);
+				palette.colors[3][c] = float((a[c] + 2 * b[c] + 1) / 3);
+			}
+		}
+		palette.count = three_color ? 3 : 4;
+	}
+
+	struct ColorFit
+	{
+		uint16_t c0;
+		uint16_t c1;
+		uint8_t indices[PIXELS];
+		float errors[PIXELS]; // rgb
+		float error;          // of the pixels in the fitted mask
+	};
+
+	// Fits the 565 endpoints of a BC1 color block to the pixels in mask, in the
+	// 4 color or the 3 color mode, refining them up to refinements times.
+	void fitColorBlock(const Block& block, uint16_t mask, bool three_color, int refinements, ColorFit& fit) {
+		static const float FOUR_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float THREE_COLOR_WEIGHTS[3] = { 0.0f, 1.0f, 0.5f };
+
+		float e0[4], e1[4];
+		fitEndpoints(block, mask, 0, 3, e0, e1);
+
+		fit.error = FLT_MAX;
+		for (int pass = 0; pass <= refinements; pass++) {
+			ColorFit candidate;
+			candidate.c0 = packColor565(e0);
+			candidate.c1 = packColor565(e1);
+			Palette palette;
+			makeColorPalette(candidate.c0, candidate.c1, three_color, palette);
+			assignIndices(block, palette, 0, 3, candidate.indices, candidate.errors);
+			candidate.error = sumErrors(candidate.errors, mask);
+			if (candidate.error >= fit.error)
+				break;
+			fit = candidate;
+			if (fit.error == 0.0f)
+				break;
+			refineEndpoints(block, mask, fit.indices, three_color ? THREE_COLOR_WEIGHTS : FOUR_COLOR_WEIGHTS, 0, 3, e0, e1);
+		}
+	}
+
+	// The endpoint order selects the mode: c0 > c1 is the 4 color mode
+	void writeColorBlock(const ColorFit& fit, bool three_color, uint16_t transparent, uint8_t* out) {
+		uint16_t c0 = fit.c0, c1 = fit.c1;
+		uint8_t indices[PIXELS];
+		memcpy(indices, fit.indices, PIXELS);
+
+		if (!three_color) {
+			if (c0 < c1) {
+				swap(c0, c1);
+				for (auto& index : indices)
+					index ^= 1;
+			}
+			else if (c0 == c1) {
+				// decodes in the 3 color mode, where only index 0 is still c0
+				memset(indices, 0, PIXELS);
+			}
+		}
+		else {
+			if (c0 > c1) {
+				swap(c0, c1);
+				for (auto& index : indices)
+					index = index < 2 ? index ^ 1 : index;
+			}
+			for (int p = 0; p < PIXELS; p++) {
+				if (transparent >> p & 1)
+					indices[p] = 3;
+			}
+		}
+
+		uint32_t bits = 0;
+		for (int p = 0; p < PIXELS; p++)
+			bits |= uint32_t(indices[p]) << (2 * p);
+		out[0] = uint8_t(c0);
+		out[1] = uint8_t(c0 >> 8);
+		out[2] = uint8_t(c1);
+		out[3] = uint8_t(c1 >> 8);
+		memcpy(out + 4, &bits, sizeof(bits));
+	}
+
+	int getRefinements(CompressionQuality quality) {
+		return quality == CompressionQuality::fast ? 0 : quality == CompressionQuality::normal ? 2 : 4;
+	}
+
+	void encodeBc1(const Block& block, CompressionQuality quality, uint8_t* out, float errors[PIXELS]) {
+		// pixels below half alpha become the transparent black of the 3 color mode
+		uint16_t transparent = 0;
+		for (int p = 0; p < PIXELS; p++) {
+			if (block.channels[3][p] < 128.0f)
+				transparent |= 1 << p;
+		}
+
+		const int refinements = getRefinements(quality);
+		bool threeColor = transparent != 0;
+		ColorFit fit;
+		fitColorBlock(block, ~transparent & 0xFFFF, threeColor, refinements, fit);
+		if (!threeColor && quality == CompressionQuality::high) {
+			ColorFit threeColorFit;
+			fitColorBlock(block, 0xFFFF, true, refinements, threeColorFit);
+			if (threeColorFit.error < fit.error) {
+				fit = threeColorFit;
+				threeColor = true;
+			}
+		}
+		writeColorBlock(fit, threeColor, transparent, out);
+
+		for (int p = 0; p < PIXELS; p++) {
+			if (transparent >> p & 1) {
+				errors[p] = 0.0f;
+				for (int c = 0; c < 4; c++)
+					errors[p] += block.channels[c][p] * block.channels[c][p];
+			}
+			else {
+				const float alpha = 255.0f - block.channels[3][p];
+				errors[p] = fit.errors[p] + alpha * alpha;
+			}
+		}
+	}
+#pragma endregion bc1
+
+#pragma region bc3
+	// the 8 alpha values a decoder builds from two endpoints: a0 > a1 interpolates
+	// 6 values between them, otherwise 4 and adds 0 and 255
+	void makeAlphaPalette(int a0, int a1, Palette& palette) {
+		int values[8] = { a0, a1 };
+		if (a0 > a1) {
+			for (int i = 1; i <= 6; i++)
+				values[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+		else {
+			for (int i = 1; i <= 4; i++)
+				values[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+			values[6] = 0;
+			values[7] = 255;
+		}
+		for (int i = 0; i < 8; i++)
+			palette.colors[i][3] = float(values[i]);
+		palette.count = 8;
+	}
+
+	struct AlphaFit
+	{
+		int a0;
+		int a1;
+		uint8_t indices[PIXELS];
+		float errors[PIXELS];
+		float error;
+	};
+
+	void fitAlphaBlock(const Block& block, bool six_values, int refinements, AlphaFit& fit) {
+		static const float EIGHT_VALUE_WEIGHTS[8] = { 0.0f, 1.0f, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+		static const float SIX_VALUE_WEIGHTS[6] = { 0.0f, 1.0f, 1 / 5.0f, 2 / 5.0f, 3 / 5.0f, 4 / 5.0f };
+
+		// the 6 value mode has 0 and 255 for free, the endpoints only need to cover the rest
+		float low = 255.0f, high = 0.0f;
+		for (int p = 0; p < PIXELS; p++) {
+			const float alpha = block.channels[3][p];
+			if (six_values && (alpha == 0.0f || alpha == 255.0f))
+				continue;
+			low = min(low, alpha);
+			high = max(high, alpha);
+		}
+		if (low > high)
+			low = high = 0.0f;
+		float e0 = six_values ? low : high;
+		float e1 = six_values ? high : low;
+
+		fit.error = FLT_MAX;
+		for (int pass = 0; pass <= refinements; pass++) {
+			AlphaFit candidate;
+			candidate.a0 = static_cast<int>(lroundf(e0));
+			candidate.a1 = static_cast<int>(lroundf(e1));
+			if (!six_values && candidate.a0 == candidate.a1) {
+				// equal endpoints would select the 6 value mode
+				if (candidate.a0 < 255)
+					candidate.a0++;
+				else
+					candidate.a1--;
+			}
+			if ((candidate.a0 > candidate.a1) == six_values) {
+				swap(candidate.a0, candidate.a1);
+				swap(e0, e1);
+			}
+
+			Palette palette;
+			makeAlphaPalette(candidate.a0, candidate.a1, palette);
+			assignIndices(block, palette, 3, 1, candidate.indices, candidate.errors);
+			candidate.error = sumErrors(candidate.errors, 0xFFFF);
+			if (candidate.error >= fit.error)
+				break;
+			fit = candidate;
+			if (fit.error == 0.0f)
+				break;
+
+			// the fixed 0 and 255 of the 6 value mode don't move with the endpoints
+			uint16_t interpolated = 0;
+			for (int p = 0; p < PIXELS; p++) {
+				if (!six_values || fit.indices[p] < 6)
+					interpolated |= 1 << p;
+			}
+			float a0[4] = { 0.0f, 0.0f, 0.0f, e0 }, a1[4] = { 0.0f, 0.0f, 0.0f, e1 };
+			refineEndpoints(block, interpolated, fit.indices, six_values ? SIX_VALUE_WEIGHTS : EIGHT_VALUE_WEIGHTS, 3, 1, a0, a1);
+			e0 = a0[3];
+			e1 = a1[3];
+		}
+	}
+
+	void encodeAlphaBlock(const Block& block, CompressionQuality quality, uint8_t* out, float errors[PIXELS]) {
+		const int refinements = getRefinements(quality);
+		AlphaFit fit;
+		fitAlphaBlock(block, false, refinements, fit);
+		if (quality == CompressionQuality::high) {
+			AlphaFit sixValueFit;
+			fitAlphaBlock(block, true, refinements, sixValueFit);
+			if (sixValueFit.error < fit.error)
+				fit = sixValueFit;
+		}
+
+		uint64_t bits = 0;
+		for (int p = 0; p < PIXELS; p++)
+			bits |= uint64_t(fit.indices[p]) << (3 * p);
+		out[0] = uint8_t(fit.a0);
+		out[1] = uint8_t(fit.a1);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = uint8_t(bits >> (8 * i));
+		memcpy(errors, fit.errors, sizeof(fit.errors));
+	}
+
+	void encodeBc3(const Block& block, CompressionQuality quality, uint8_t* out, float errors[PIXELS]) {
+		float alphaErrors[PIXELS];
+		encodeAlphaBlock(block, quality, out, alphaErrors);
+
+		// the color half of BC3 always decodes in the 4 color mode
+		ColorFit fit;
+		fitColorBlock(block, 0xFFFF, false, getRefinements(quality), fit);
+		writeColorBlock(fit, false, 0, out + 8);
+
+		for (int p = 0; p < PIXELS; p++)
+			errors[p] = fit.errors[p] + alphaErrors[p];
+	}
+#pragma endregion bc3
+
+#pragma region bc7
+	// how many mode 1 partitions get a full fit after the cheap estimate
+	const int MODE1_CANDIDATES = 4;
+
+	class BitWriter {
+	public:
+		explicit BitWriter(uint8_t* data) : m_data(data) {
+			memset(m_data, 0, 16);
+		}
+
+		void write(uint32_t value, int bits) {
+			for (int i = 0; i < bits; i++, m_position++)
+				m_data[m_position >> 3] |= uint8_t((value >> i & 1) << (m_position & 7));
+		}
+
+	private:
+		uint8_t* m_data;
+		int m_position = 0;
+	};
+
+	int interpolate(int e0, int e1, int weight) {
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// 8-bit value of an endpoint code of bits bits followed by its p-bit
+	int expandEndpoint(int code, int bits, int pbit) {
+		const int value = code << 1 | pbit;
+		const int width = bits + 1;
+		return (value << (8 - width)) | (value >> (2 * width - 8));
+	}
+
+	// the code that comes closest to value with the given p-bit
+	int quantizeEndpoint(float value, int bits, int pbit) {
+		const int maxCode = (1 << bits) - 1;
+		const int guess = static_cast<int>(lroundf((value * ((2 << bits) - 1) / 255.0f - pbit) / 2.0f));
+		int best = 0;
+		float bestError = FLT_MAX;
+		for (int code = max(guess - 1, 0); code <= min(guess + 1, maxCode); code++) {
+			const float error = fabsf(expandEndpoint(code, bits, pbit) - value);
+			if (error < bestError) {
+				bestError = error;
+				best = code;
+			}
+		}
+		return best;
+	}
+
+	// mode 6: one subset, 7-bit RGBA endpoints with a p-bit each and 4-bit indices
+	struct Mode6Fit
+	{
+		int endpoints[2][4];
+		int pbits[2];
+		uint8_t indices[PIXELS];
+		float errors[PIXELS];
+		float error;
+	};
+
+	void fitMode6(const Block& block, int refinements, bool search_pbits, Mode6Fit& fit) {
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+			weights[i] = BC_WEIGHTS4[i] / 64.0f;
+
+		float e[2][4];
+		fitEndpoints(block, 0xFFFF, 0, 4, e[0], e[1]);
+
+		fit.error = FLT_MAX;
+		for (int pass = 0; pass <= refinements; pass++) {
+			// every p-bit combination, or for each endpoint the p-bit that rounds it best
+			int combinations[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+			int combinationCount = 4;
+			if (!search_pbits) {
+				for (int endpoint = 0; endpoint < 2; endpoint++) {
+					float pbitError[2] = { 0.0f, 0.0f };
+					for (int pbit = 0; pbit < 2; pbit++) {
+						for (int c = 0; c < 4; c++) {
+							const float d = expandEndpoint(quantizeEndpoint(e[endpoint][c], 7, pbit), 7, pbit) - e[endpoint][c];
+							pbitError[pbit] += d * d;
+						}
+					}
+					combinations[0][endpoint] = pbitError[1] < pbitError[0] ? 1 : 0;
+				}
+				combinationCount = 1;
+			}
+
+			const float previousError = fit.error;
+			for (int combination = 0; combination < combinationCount; combination++) {
+				Mode6Fit candidate;
+				int decoded[2][4];
+				for (int endpoint = 0; endpoint < 2; endpoint++) {
+					candidate.pbits[endpoint] = combinations[combination][endpoint];
+					for (int c = 0; c < 4; c++) {
+						candidate.endpoints[endpoint][c] = quantizeEndpoint(e[endpoint][c], 7, candidate.pbits[endpoint]);
+						decoded[endpoint][c] = expandEndpoint(candidate.endpoints[endpoint][c], 7, candidate.pbits[endpoint]);
+					}
+				}
+
+				Palette palette;
+				palette.count = 16;
+				for (int i = 0; i < 16; i++)
+					for (int c = 0; c < 4; c++)
+						palette.colors[i][c] = float(interpolate(decoded[0][c], decoded[1][c], BC_WEIGHTS4[i]));
+				assignIndices(block, palette, 0, 4, candidate.indices, candidate.errors);
+				candidate.error = sumErrors(candidate.errors, 0xFFFF);
+				if (candidate.error < fit.error)
+					fit = candidate;
+			}
+
+			if (fit.error >= previousError || fit.error == 0.0f)
+				break;
+			refineEndpoints(block, 0xFFFF, fit.indices, weights, 0, 4, e[0], e[1]);
+		}
+	}
+
+	void writeMode6(Mode6Fit fit, uint8_t* out) {
+		// pixel 0 stores its index without the top bit, so it has to be below 8
+		if (fit.indices[0] >= 8) {
+			swap(fit.endpoints[0], fit.endpoints[1]);
+			swap(fit.pbits[0], fit.pbits[1]);
+			for (auto& index : fit.indices)
+				index = 15 - index;
+		}
+
+		BitWriter bits(out);
+		bits.write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+			for (int endpoint = 0; endpoint < 2; endpoint++)
+				bits.write(fit.endpoints[endpoint][c], 7);
+		bits.write(fit.pbits[0], 1);
+		bits.write(fit.pbits[1], 1);
+		bits.write(fit.indices[0], 3);
+		for (int p = 1; p < PIXELS; p++)
+			bits.write(fit.indices[p], 4);
+	}
+
+	// mode 1: two subsets picked from 64 partitions, 6-bit RGB endpoints with a
+	// p-bit shared per subset and 3-bit indices, opaque only
+	struct Mode1Fit
+	{
+		int partition;
+		int endpoints[2][2][3]; // subset, endpoint, channel
+		int pbits[2];
+		uint8_t indices[PIXELS];
+		float errors[PIXELS];
+		float error;
+	};
+
+	// squared distance of the pixels in mask to their principal axis line, a cheap
+	// guess of how well one subset can be fitted
+	float estimateLineError(const Block& block, uint16_t mask) {
+		float mean[4], axis[4];
+		principalAxis(block, mask, 0, 3, mean, axis);
+		float error = 0.0f;
+		for (int p = 0; p < PIXELS; p++) {
+			if (!(mask >> p & 1))
+				continue;
+			float d[3], t = 0.0f, length = 0.0f;
+			for (int c = 0; c < 3; c++) {
+				d[c] = block.channels[c][p] - mean[c];
+				t += d[c] * axis[c];
+				length += d[c] * d[c];
+			}
+			error += length - t * t;
+		}
+		return error;
+	}
+
+	void fitMode1(const Block& block, int partition, int refinements, Mode1Fit& fit) {
+		float weights[8];
+		for (int i = 0; i < 8; i++)
+			weights[i] = BC_WEIGHTS3[i] / 64.0f;
+
+		fit.partition = partition;
+		fit.error = 0.0f;
+		for (int subset = 0; subset < 2; subset++) {
+			const uint16_t mask = subset ? BC7_PARTITIONS2[partition] : uint16_t(~BC7_PARTITIONS2[partition]);
+			float e[2][4];
+			fitEndpoints(block, mask, 0, 3, e[0], e[1]);
+
+			float best = FLT_MAX;
+			uint8_t bestIndices[PIXELS];
+			for (int pass = 0; pass <= refinements; pass++) {
+				const float previousBest = best;
+				for (int pbit = 0; pbit < 2; pbit++) {
+					int codes[2][3], decoded[2][3];
+					for (int endpoint = 0; endpoint < 2; endpoint++) {
+						for (int c = 0; c < 3; c++) {
+							codes[endpoint][c] = quantizeEndpoint(e[endpoint][c], 6, pbit);
+							decoded[endpoint][c] = expandEndpoint(codes[endpoint][c], 6, pbit);
+						}
+					}
+
+					Palette palette;
+					palette.count = 8;
+					for (int i = 0; i < 8; i++)
+						for (int c = 0; c < 3; c++)
+							palette.colors[i][c] = float(interpolate(decoded[0][c], decoded[1][c], BC_WEIGHTS3[i]));
+					uint8_t indices[PIXELS];
+					float errors[PIXELS];
+					assignIndices(block, palette, 0, 3, indices, errors);
+					const float error = sumErrors(errors, mask);
+					if (error < best) {
+						best = error;
+						memcpy(fit.endpoints[subset], codes, sizeof(codes));
+						fit.pbits[subset] = pbit;
+						memcpy(bestIndices, indices, PIXELS);
+						for (int p = 0; p < PIXELS; p++) {
+							if (mask >> p & 1) {
+								fit.indices[p] = indices[p];
+								fit.errors[p] = errors[p];
+							}
+						}
+					}
+				}
+
+				if (best >= previousBest || best == 0.0f)
+					break;
+				refineEndpoints(block, mask, bestIndices, weights, 0, 3, e[0], e[1]);
+			}
+			fit.error += best;
+		}
+	}
+
+	void writeMode1(Mode1Fit fit, uint8_t* out) {
+		// the anchor pixel of each subset stores its index without the top bit
+		const int anchors[2] = { 0, BC7_ANCHORS2[fit.partition] };
+		for (int subset = 0; subset < 2; subset++) {
+			if (fit.indices[anchors[subset]] < 4)
+				continue;
+			swap(fit.endpoints[subset][0], fit.endpoints[subset][1]);
+			for (int p = 0; p < PIXELS; p++) {
+				if ((BC7_PARTITIONS2[fit.partition] >> p & 1) == subset)
+					fit.indices[p] = 7 - fit.indices[p];
+			}
+		}
+
+		BitWriter bits(out);
+		bits.write(1 << 1, 2);
+		bits.write(fit.partition, 6);
+		for (int c = 0; c < 3; c++)
+			for (int subset = 0; subset < 2; subset++)
+				for (int endpoint = 0; endpoint < 2; endpoint++)
+					bits.write(fit.endpoints[subset][endpoint][c], 6);
+		bits.write(fit.pbits[0], 1);
+		bits.write(fit.pbits[1], 1);
+		for (int p = 0; p < PIXELS; p++)
+			bits.write(fit.indices[p], p == anchors[0] || p == anchors[1] ? 2 : 3);
+	}
+
+	void encodeBc7(const Block& block, CompressionQuality quality, uint8_t* out, float errors[PIXELS]) {
+		const int refinements = getRefinements(quality);
+		const bool high = quality == CompressionQuality::high;
+
+		Mode6Fit mode6;
+		fitMode6(block, refinements, high, mode6);
+
+		bool opaque = true;
+		for (int p = 0; p < PIXELS; p++)
+			opaque = opaque && block.channels[3][p] == 255.0f;
+
+		if (high && opaque && mode6.error > 0.0f) {
+			// fully fit only the partitions whose subsets lie closest to a line each
+			pair<float, int> estimates[64];
+			for (int partition = 0; partition < 64; partition++) {
+				estimates[partition] = { estimateLineError(block, uint16_t(~BC7_PARTITIONS2[partition])) +
+					estimateLineError(block, BC7_PARTITIONS2[partition]), partition };
+			}
+			partial_sort(estimates, estimates + MODE1_CANDIDATES, estimates + 64);
+
+			Mode1Fit best;
+			best.error = FLT_MAX;
+			for (int i = 0; i < MODE1_CANDIDATES; i++) {
+				Mode1Fit candidate;
+				fitMode1(block, estimates[i].second, refinements, candidate);
+				if (candidate.error < best.error)
+					best = candidate;
+			}
+
+			if (best.error < mode6.error) {
+				writeMode1(best, out);
+				memcpy(errors, best.errors, sizeof(best.errors));
+				return;
+			}
+		}
+
+		writeMode6(mode6, out);
+		memcpy(errors, mode6.errors, sizeof(mode6.errors));
+	}
+#pragma endregion bc7
+}
+
+bool parseBlockFormat(const string& name, BlockFormat& format)
+{
+	if (name == "bc1")
+		format = BlockFormat::bc1;
+	else if (name == "bc3")
+		format = BlockFormat::bc3;
+	else if (name == "bc7")
+		format = BlockFormat::bc7;
+	else
+		return false;
+	return true;
+}
+
+const char* getBlockFormatName(BlockFormat format)
+{
+	switch (format) {
+	case BlockFormat::bc1: return "bc1";
+	case BlockFormat::bc3: return "bc3";
+	default: return "bc7";
+	}
+}
+
+bool parseCompressionQuality(const string& name, CompressionQuality& quality)
+{
+	if (name == "fast")
+		quality = CompressionQuality::fast;
+	else if (name == "normal")
+		quality = CompressionQuality::normal;
+	else if (name == "high")
+		quality = CompressionQuality::high;
+	else
+		return false;
+	return true;
+}
+
+const char* getCompressionQualityName(CompressionQuality quality)
+{
+	switch (quality) {
+	case CompressionQuality::fast: return "fast";
+	case CompressionQuality::normal: return "normal";
+	default: return "high";
+	}
+}
+
+DXGI_FORMAT getBlockDxgiFormat(BlockFormat format)
+{
+	switch (format) {
+	case BlockFormat::bc1: return DXGI_FORMAT_BC1_UNORM;
+	case BlockFormat::bc3: return DXGI_FORMAT_BC3_UNORM;
+	default: return DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+size_t getBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::bc1 ? 8 : 16;
+}
+
+double compressImage(const Image& image, BlockFormat format, CompressionQuality quality,
+	vector<uint8_t>& blocks, unsigned int num_threads)
+{
+	const uint32_t blocksWide = (image.width + 3) / 4;
+	const uint32_t blocksHigh = (image.height + 3) / 4;
+	const size_t blockSize = getBlockSize(format);
+	blocks.assign(size_t(blocksWide) * blocksHigh * blockSize, 0);
+	if (blocksWide == 0 || blocksHigh == 0)
+		return 0.0;
+
+	if (num_threads == 0)
+		num_threads = max(1u, thread::hardware_concurrency());
+	num_threads = min(num_threads, blocksHigh);
+
+	// rows of blocks are handed out one at a time, threads that get cheap rows take more of them
+	atomic<uint32_t> nextRow(0);
+	vector<double> threadErrors(num_threads, 0.0);
+	auto work = [&](unsigned int thread_index) {
+		Block block;
+		float errors[PIXELS];
+		double error = 0.0;
+		for (uint32_t row = nextRow++; row < blocksHigh; row = nextRow++) {
+			for (uint32_t column = 0; column < blocksWide; column++) {
+				loadBlock(image, column, row, block);
+				uint8_t* out = &blocks[(size_t(row) * blocksWide + column) * blockSize];
+				switch (format) {
+				case BlockFormat::bc1: encodeBc1(block, quality, out, errors); break;
+				case BlockFormat::bc3: encodeBc3(block, quality, out, errors); break;
+				case BlockFormat::bc7: encodeBc7(block, quality, out, errors); break;
+				}
+
+				// the repeated pixels of edge blocks don't count
+				for (int p = 0; p < PIXELS; p++) {
+					if (column * 4 + p % 4 < image.width && row * 4 + p / 4 < image.height)
+						error += errors[p];
+				}
+			}
+		}
+		threadErrors[thread_index] = error;
+	};
+
+	if (num_threads == 1) {
+		work(0);
+	}
+	else {
+		vector<thread> workers;
+		workers.reserve(num_threads);
+		for (unsigned int i = 0; i < num_threads; i++)
+			workers.emplace_back(work, i);
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	double error = 0.0;
+	for (double threadError : threadErrors)
+		error += threadError;
+	return error;
+}
+
+float getPsnr(double squared_error, size_t sample_count)
+{
+	if (squared_error <= 0.0)
+		return numeric_limits<float>::infinity();
+	return static_cast<float>(10.0 * log10(255.0 * 255.0 * sample_count / squared_error));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "DxgiFormat.h"
+#include "Image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Block compression of RGBA8 images into BC1, BC3 and BC7 on the cpu, so
+// textures can be shipped as DDS files instead of being decoded by WIC into
+// uncompressed RGBA8 at load time.
+
+enum class BlockFormat
+{
+	bc1, // rgb + 1-bit alpha, 8 bytes per 4x4 block
+	bc3, // rgb + interpolated alpha, 16 bytes per block
+	bc7  // rgba, modes 6 and 1, 16 bytes per block
+};
+
+// How hard the encoder searches for endpoints
+enum class CompressionQuality
+{
+	fast,   // principal axis endpoints only
+	normal, // refined by least squares
+	high    // more refinement, also the 3-color BC1 mode, the 6-value BC3 alpha mode and the 2 subset BC7 mode 1
+};
+
+// "bc1", "bc3" or "bc7"
+bool parseBlockFormat(const std::string& name, BlockFormat& format);
+const char* getBlockFormatName(BlockFormat format);
+// "fast", "normal" or "high"
+bool parseCompressionQuality(const std::string& name, CompressionQuality& quality);
+const char* getCompressionQualityName(CompressionQuality quality);
+
+DXGI_FORMAT getBlockDxgiFormat(BlockFormat format);
+// bytes per 4x4 block
+size_t getBlockSize(BlockFormat format);
+
+// Compresses image into blocks, row by row of 4x4 blocks (edge blocks repeat
+// the last row and column). Block rows are shared out to num_threads threads,
+// 0 uses every core. Returns the summed squared RGBA error of the decoded
+// pixels against the image.
+double compressImage(const Image& image, BlockFormat format, CompressionQuality quality,
+	std::vector<uint8_t>& blocks, unsigned int num_threads = 0);
+
+// Peak signal to noise ratio in dB of squared_error summed over sample_count 8-bit samples
+float getPsnr(double squared_error, size_t sample_count);
@@ -0,0 +1,71 @@
+#include "TextureSampler.h"
+#include "BcDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SAMPLER_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	// texel index wrapped into [0, size)
+	uint32_t wrap(int64_t index, uint32_t size) {
+		const int64_t wrapped = index % size;
+		return static_cast<uint32_t>(wrapped < 0 ? wrapped + size : wrapped);
+	}
+}
+
+TextureSampler::TextureSampler(const DdsTexture& texture, uint32_t slice) {
+	m_mips.resize(texture.mipCount);
+	for (uint32_t mip = 0; mip < texture.mipCount; mip++)
+		decodeSurface(texture.format, texture.getSurface(slice, mip), 0, m_mips[mip]);
+}
+
+void TextureSampler::sampleBilinear(float u, float v, uint32_t mip, float color[4]) const {
+	const FloatImage& image = m_mips[mip];
+	// texel centers sit at half coordinates
+	const float x = u * image.width - 0.5f;
+	const float y = v * image.height - 0.5f;
+	const float left = floorf(x), top = floorf(y);
+	const float fx = x - left, fy = y - top;
+	const uint32_t x0 = wrap(static_cast<int64_t>(left), image.width), x1 = wrap(static_cast<int64_t>(left) + 1, image.width);
+	const uint32_t y0 = wrap(static_cast<int64_t>(top), image.height), y1 = wrap(static_cast<int64_t>(top) + 1, image.height);
+
+#ifdef SAMPLER_SSE
+	// all four channels of a texel in one register
+	const __m128 topRow = _mm_add_ps(_mm_loadu_ps(image.getPixel(x0, y0)),
+		_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(image.getPixel(x1, y0)), _mm_loadu_ps(image.getPixel(x0, y0))), _mm_set1_ps(fx)));
+	const __m128 bottomRow = _mm_add_ps(_mm_loadu_ps(image.getPixel(x0, y1)),
+		_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(image.getPixel(x1, y1)), _mm_loadu_ps(image.getPixel(x0, y1))), _mm_set1_ps(fx)));
+	_mm_storeu_ps(color, _mm_add_ps(topRow, _mm_mul_ps(_mm_sub_ps(bottomRow, topRow), _mm_set1_ps(fy))));
+#else
+	const float* t00 = image.getPixel(x0, y0);
+	const float* t10 = image.getPixel(x1, y0);
+	const float* t01 = image.getPixel(x0, y1);
+	const float* t11 = image.getPixel(x1, y1);
+	for (int c = 0; c < 4; c++) {
+		const float topRow = t00[c] + (t10[c] - t00[c]) * fx;
+		const float bottomRow = t01[c] + (t11[c] - t01[c]) * fx;
+		color[c] = topRow + (bottomRow - topRow) * fy;
+	}
+#endif
+}
+
+void TextureSampler::sampleTrilinear(float u, float v, float lod, float color[4]) const {
+	const uint32_t last = getMipCount() - 1;
+	lod = min(max(lod, 0.0f), float(last));
+	const uint32_t mip = min(static_cast<uint32_t>(lod), last);
+	const float blend = lod - mip;
+	sampleBilinear(u, v, mip, color);
+	if (blend == 0.0f || mip == last)
+		return;
+
+	float next[4];
+	sampleBilinear(u, v, mip + 1, next);
+	for (int c = 0; c < 4; c++)
+		color[c] += (next[c] - color[c]) * blend;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "Image.h"
+
+#include <cstdint>
+#include <vector>
+
+// Samples a texture on the cpu like the D3D11 sampler Graphics binds (linear
+// min, mag and mip filter, wrap addressing), as the reference for what the
+// gpu should show.
+class TextureSampler {
+public:
+	// Decodes every mip level of slice (the first depth slice of volumes).
+	// Throws a runtime_error when the format can't be decoded.
+	explicit TextureSampler(const DdsTexture& texture, uint32_t slice = 0);
+
+	uint32_t getMipCount() const { return static_cast<uint32_t>(m_mips.size()); }
+	const FloatImage& getMip(uint32_t mip) const { return m_mips[mip]; }
+
+	// bilinear sample of one mip level, u and v wrap around
+	void sampleBilinear(float u, float v, uint32_t mip, float color[4]) const;
+	// blends the bilinear samples of the two mip levels around lod, which is
+	// clamped to the mip chain
+	void sampleTrilinear(float u, float v, float lod, float color[4]) const;
+
+private:
+	std::vector<FloatImage> m_mips;
+};
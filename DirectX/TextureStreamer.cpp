@@ -0,0 +1,243 @@
+#include "TextureStreamer.h"
+
+#include "AssetCache.h"
+#include "Image.h"
+#include "Ktx2Parser.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+	bool hasExtension(const string& path, const string& extension) {
+		return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+}
+
+TextureStreamer::TextureStreamer(unsigned int num_threads, MipFilter filter, AssetCache* assets, DdsReadOptions dds_options)
+	: m_filter(filter), m_assets(assets), m_ddsOptions(dds_options)
+{
+	if (num_threads == 0)
+		num_threads = max(2u, thread::hardware_concurrency()) - 1;
+	m_workers.reserve(num_threads);
+	for (unsigned int i = 0; i < num_threads; i++)
+		m_workers.emplace_back(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobReady.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+TextureHandle TextureStreamer::request(const string& path)
+{
+	TextureHandle texture;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		texture = static_cast<TextureHandle>(m_textures.size());
+		m_textures.emplace_back();
+		m_textures.back().path = path;
+		m_jobs.push_back(texture);
+	}
+	m_jobReady.notify_one();
+	return texture;
+}
+
+size_t TextureStreamer::update(TextureUploadSink& sink, size_t max_bytes)
+{
+	size_t levels = 0, bytes = 0;
+	for (;;) {
+		TextureHandle texture;
+		TextureLevel level;
+		TextureInfo info;
+		bool create;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (m_levels.empty() || (levels > 0 && bytes + m_levels.front().second.data.size() > max_bytes))
+				break;
+			texture = m_levels.front().first;
+			level = move(m_levels.front().second);
+			m_levels.pop_front();
+			create = !m_textures[texture].created;
+			m_textures[texture].created = true;
+			info = m_textures[texture].info;
+		}
+
+		// outside the lock, the workers keep going while the sink uploads
+		if (create)
+			sink.createTexture(texture, info);
+		sink.uploadLevel(texture, level);
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_textures[texture].residentMip = level.mip;
+			m_textures[texture].residency = level.mip == 0 ? TextureResidency::resident : TextureResidency::partial;
+		}
+		levels++;
+		bytes += level.data.size();
+	}
+	return levels;
+}
+
+TextureResidency TextureStreamer::getResidency(TextureHandle texture) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_textures.at(texture).residency;
+}
+
+uint32_t TextureStreamer::getResidentMip(TextureHandle texture) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	const Texture& entry = m_textures.at(texture);
+	return entry.created ? entry.residentMip : entry.info.mipCount;
+}
+
+TextureInfo TextureStreamer::getInfo(TextureHandle texture) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_textures.at(texture).info;
+}
+
+void TextureStreamer::getFileBytes(TextureHandle texture, uint64_t& read, uint64_t& size) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	read = m_textures.at(texture).bytesRead;
+	size = m_textures.at(texture).fileSize;
+}
+
+string TextureStreamer::getError(TextureHandle texture) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_textures.at(texture).error;
+}
+
+void TextureStreamer::waitDecoded()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_decoded.wait(lock, [this]() { return m_jobs.empty() && m_busyWorkers == 0; });
+}
+
+void TextureStreamer::work()
+{
+	if (Profiler::isEnabled())
+		Profiler::setThreadName("texture streamer");
+	unique_lock<mutex> lock(m_mutex);
+	for (;;) {
+		m_jobReady.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+		if (m_stopping)
+			return;
+
+		const TextureHandle texture = m_jobs.front();
+		m_jobs.pop_front();
+		m_textures[texture].residency = TextureResidency::decoding;
+		const string path = m_textures[texture].path;
+		m_busyWorkers++;
+		lock.unlock();
+
+		string error;
+		try {
+			decode(texture, path);
+		}
+		catch (const exception& e) {
+			error = e.what();
+		}
+
+		lock.lock();
+		if (!error.empty()) {
+			m_textures[texture].residency = TextureResidency::failed;
+			m_textures[texture].error = error;
+		}
+		m_busyWorkers--;
+		if (m_jobs.empty() && m_busyWorkers == 0)
+			m_decoded.notify_all();
+	}
+}
+
+void TextureStreamer::decode(TextureHandle texture, const string& path)
+{
+	PROFILE_ZONE("TextureStreamer::decode");
+	// queues the chain smallest level first
+	uint64_t bytesRead = 0, fileSize = 0;
+	auto publish = [&](const TextureInfo& info, vector<TextureLevel>& levels) {
+		lock_guard<mutex> lock(m_mutex);
+		m_textures[texture].info = info;
+		m_textures[texture].residentMip = info.mipCount;
+		m_textures[texture].bytesRead = bytesRead;
+		m_textures[texture].fileSize = fileSize;
+		for (auto& level : levels)
+			m_levels.emplace_back(texture, move(level));
+	};
+
+	TextureInfo info;
+	vector<TextureLevel> levels;
+	if (hasExtension(path, ".dds") || hasExtension(path, ".ktx2")) {
+		// only the levels the options keep are read from the file
+		DdsStreamedTexture streamed;
+		if (hasExtension(path, ".dds"))
+			readDds(path, m_ddsOptions, streamed);
+		else
+			readKtx2(path, m_ddsOptions, streamed);
+		const DdsTexture& dds = streamed.texture;
+		if (dds.dimension != DdsDimension::texture2d || dds.arraySize != 1 || dds.cubemap)
+			throw runtime_error(path + ": only single 2d textures can be streamed");
+		info = { dds.format, dds.width, dds.height, dds.mipCount, streamed.skippedMips };
+		bytesRead = streamed.bytesRead;
+		fileSize = streamed.fileSize;
+
+		levels.resize(dds.mipCount);
+		for (uint32_t mip = 0; mip < dds.mipCount; mip++) {
+			const DdsSurface& surface = dds.getSurface(0, mip);
+			TextureLevel& level = levels[dds.mipCount - 1 - mip];
+			level.mip = mip;
+			level.width = surface.width;
+			level.height = surface.height;
+			level.rowPitch = surface.layout.rowPitch;
+			level.data.assign(surface.data, surface.data + surface.size);
+		}
+		publish(info, levels);
+		return;
+	}
+
+	// images have no mips, the chain is built here before anything can go out
+	auto build = [&](TextureChain& chain) {
+		chain.resize(1);
+		loadImage(path, chain[0]);
+		vector<Image> mips;
+		generateMips(chain[0], m_filter, true, mips, 1);
+		move(mips.begin(), mips.end(), back_inserter(chain));
+	};
+	shared_ptr<const TextureChain> chain;
+	if (m_assets) {
+		chain = m_assets->getTexture(path, m_filter, build);
+	}
+	else {
+		auto built = make_shared<TextureChain>();
+		build(*built);
+		chain = built;
+	}
+	info = { DXGI_FORMAT_R8G8B8A8_UNORM, (*chain)[0].width, (*chain)[0].height, static_cast<uint32_t>(chain->size()) };
+	bytesRead = fileSize = filesystem::file_size(path);
+
+	levels.resize(info.mipCount);
+	for (uint32_t mip = 0; mip < info.mipCount; mip++) {
+		const Image& source = (*chain)[mip];
+		TextureLevel& level = levels[info.mipCount - 1 - mip];
+		level.mip = mip;
+		level.width = source.width;
+		level.height = source.height;
+		level.rowPitch = size_t(source.width) * 4;
+		level.data = source.pixels;
+	}
+	publish(info, levels);
+}
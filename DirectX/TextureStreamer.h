@@ -0,0 +1,133 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "DxgiFormat.h"
+#include "MipGenerator.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Loads textures on worker threads and hands their mip levels to the renderer
+// smallest first, so something can be drawn right away and sharpens as the
+// bigger levels arrive. The decoding and scheduling don't touch Direct3D: the
+// levels go to a TextureUploadSink, which Graphics implements with D3D11 and
+// the tools with a counter.
+
+class AssetCache;
+
+using TextureHandle = uint32_t;
+
+enum class TextureResidency
+{
+	queued,   // waiting for a worker
+	decoding, // on a worker, or decoded levels wait for update
+	partial,  // the sink has the smaller levels
+	resident, // the sink has every level
+	failed    // see getError
+};
+
+// Layout of the full mip chain of a texture
+struct TextureInfo
+{
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	// top levels of a .dds or .ktx2 left out by the DdsReadOptions, the texture starts below them
+	uint32_t skippedMips = 0;
+};
+
+// One decoded mip level, rows of pixels (or of 4x4 blocks) rowPitch bytes apart
+struct TextureLevel
+{
+	uint32_t mip = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	size_t rowPitch = 0;
+	std::vector<uint8_t> data;
+};
+
+// Receives the textures of a TextureStreamer, on the thread that calls update.
+class TextureUploadSink {
+public:
+	virtual ~TextureUploadSink() = default;
+	// once per texture, before its first level
+	virtual void createTexture(TextureHandle texture, const TextureInfo& info) = 0;
+	// levels come from the smallest (mipCount - 1) to mip 0, each one makes
+	// the texture resident down to its mip
+	virtual void uploadLevel(TextureHandle texture, const TextureLevel& level) = 0;
+};
+
+class TextureStreamer {
+public:
+	// num_threads decode workers, 0 uses every core but one. Images get a mip
+	// chain built with filter, DDS and KTX2 files keep theirs and only the
+	// levels dds_options keep are read. With assets the chains of images are looked up
+	// there before decoding.
+	explicit TextureStreamer(unsigned int num_threads = 0, MipFilter filter = MipFilter::kaiser, AssetCache* assets = nullptr,
+		DdsReadOptions dds_options = {});
+	// waits for the textures being decoded, drops the queued ones
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Queues a .dds or .ktx2 (a single 2d texture) or an image file WIC can decode.
+	// Failures show up in getResidency and getError.
+	TextureHandle request(const std::string& path);
+
+	// Hands the decoded levels to sink in the order they were decoded, until
+	// max_bytes are uploaded (always at least one level). Call it from the
+	// thread that owns the sink, once per frame. Returns the levels uploaded.
+	size_t update(TextureUploadSink& sink, size_t max_bytes = SIZE_MAX);
+
+	TextureResidency getResidency(TextureHandle texture) const;
+	// finest level the sink has, the mip count while it has none
+	uint32_t getResidentMip(TextureHandle texture) const;
+	// the full chain, 0 until the texture is decoded
+	TextureInfo getInfo(TextureHandle texture) const;
+	// bytes read from the file (a .dds or .ktx2 may be read in part) and its size
+	void getFileBytes(TextureHandle texture, uint64_t& read, uint64_t& size) const;
+	std::string getError(TextureHandle texture) const;
+
+	// blocks until every requested texture is decoded or failed, its levels
+	// may still wait for update
+	void waitDecoded();
+
+private:
+	struct Texture
+	{
+		std::string path;
+		TextureInfo info;
+		TextureResidency residency = TextureResidency::queued;
+		uint32_t residentMip = 0;
+		bool created = false;
+		uint64_t bytesRead = 0;
+		uint64_t fileSize = 0;
+		std::string error;
+	};
+
+	void work();
+	void decode(TextureHandle texture, const std::string& path);
+
+	MipFilter m_filter;
+	AssetCache* m_assets;
+	DdsReadOptions m_ddsOptions;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_decoded;
+	std::deque<TextureHandle> m_jobs;
+	// levels of every texture in the order the workers finished them
+	std::deque<std::pair<TextureHandle, TextureLevel>> m_levels;
+	std::vector<Texture> m_textures;
+	unsigned int m_busyWorkers = 0;
+	bool m_stopping = false;
+	std::vector<std::thread> m_workers;
+};
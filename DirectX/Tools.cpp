@@ -0,0 +1,1370 @@
+#include "Tools.h"
+#include "AssetCache.h"
+#include "BcDecoder.h"
+#include "DdsParser.h"
+#include "Ktx2Parser.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MipGenerator.h"
+#include "Meshlets.h"
+#include "ParallelObjLoader.h"
+#include "PixelConvert.h"
+#include "Profiler.h"
+#include "TextureSampler.h"
+#include "TextureAtlas.h"
+#include "TextureStreamer.h"
+#include "TextureCompressor.h"
+#include "VertexDeduplicator.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+	// Lists the .obj (or other extension) files of a folder, spelled "<dir>/<file>.obj" like
+	// the model paths Graphics::loadModel gets (the mesh cache is keyed on that path).
+	bool listModels(const string& models_dir, vector<string>& models, const char* extension = ".obj") {
+		string dir = models_dir;
+		while (dir.size() > 1 && (dir.back() == '/' || dir.back() == '\\'))
+			dir.pop_back();
+
+		error_code ec;
+		if (!filesystem::is_directory(dir, ec)) {
+			cerr << dir << " is not a directory" << endl;
+			return false;
+		}
+
+		for (const auto& entry : filesystem::directory_iterator(dir)) {
+			if (entry.is_regular_file() && entry.path().extension() == extension)
+				models.push_back(dir + "/" + entry.path().filename().string());
+		}
+		sort(models.begin(), models.end());
+		return true;
+	}
+
+	// the images of a folder WIC can decode
+	bool listImages(const string& textures_dir, vector<string>& images) {
+		for (const char* extension : { ".png", ".jpg", ".jpeg", ".bmp", ".tif" }) {
+			if (!listModels(textures_dir, images, extension))
+				return false;
+		}
+		sort(images.begin(), images.end());
+		return true;
+	}
+
+	// highest resident memory the process reached so far, in bytes
+	size_t peakMemoryBytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters = {};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+
+	// parses and processes an obj like Graphics does on an asset cache miss
+	void processMesh(const string& model_path, VertexFormat vertex_format, MeshData& mesh) {
+		loadObjMesh(model_path, mesh);
+		optimizeMesh(mesh);
+		buildMeshlets(mesh);
+		buildLods(mesh);
+		validateIndices(mesh, getIndexSize(mesh.vertices.size()), model_path);
+		packVertices(mesh, vertex_format);
+	}
+
+	// best wall clock time of a few runs, in seconds
+	template <typename Job>
+	double bestOf(int runs, Job job) {
+		double best = 0;
+		for (int i = 0; i < runs; i++) {
+			const auto start = steady_clock::now();
+			job();
+			const duration<double> elapsed = steady_clock::now() - start;
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+		return best;
+	}
+}
+
+int Tools::bakeMeshCaches(const string& models_dir, VertexFormat vertex_format) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	// the cache the benchmark loads its meshes from
+	AssetCache cache;
+	int failed = 0;
+	for (const auto& modelPath : models) {
+		const auto start = steady_clock::now();
+		try {
+			const uint64_t built = cache.getStats().misses;
+			const auto mesh = cache.getMesh(modelPath, vertex_format, [&](MeshData& processed) { processMesh(modelPath, vertex_format, processed); });
+			const duration<float, milli> elapsed = steady_clock::now() - start;
+			cout << fixed << setprecision(1)
+				<< modelPath << ": " << mesh->vertices.size() << " " << getVertexFormatName(mesh->vertexFormat) << " vertices, "
+				<< mesh->indices.size() << " " << getIndexSize(mesh->vertices.size()) * 8 << "-bit indices, "
+				<< mesh->meshlets.size() << " meshlets, " << mesh->lods.size() << " lods, "
+				<< (cache.getStats().misses > built ? "baked" : "up to date") << " (" << elapsed.count() << " ms)" << endl;
+		}
+		catch (const exception& e) {
+			cerr << modelPath << ": " << e.what() << endl;
+			failed++;
+		}
+	}
+
+	const AssetCacheStats stats = cache.getStats();
+	cout << stats.misses << " mesh caches written, " << stats.diskHits << " up to date, " << failed << " failed" << endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+	bool sameIndex(const tinyobj::index_t& a, const tinyobj::index_t& b) {
+		return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+	}
+
+	// Whether two parses of an obj are the same: every attribute array, and per shape the
+	// name, every index triple and the size, material and smoothing group of every face.
+	// vertex_weights and texcoord_ws are left out, LoadObj swaps whatever the attrib held
+	// before into them.
+	bool sameObj(const tinyobj::attrib_t& attrib, const vector<tinyobj::shape_t>& shapes,
+		const tinyobj::attrib_t& reference, const vector<tinyobj::shape_t>& reference_shapes) {
+		if (attrib.vertices != reference.vertices || attrib.normals != reference.normals
+			|| attrib.texcoords != reference.texcoords || attrib.colors != reference.colors
+			|| shapes.size() != reference_shapes.size())
+			return false;
+
+		for (size_t i = 0; i < shapes.size(); i++) {
+			const tinyobj::mesh_t& mesh = shapes[i].mesh;
+			const tinyobj::mesh_t& referenceMesh = reference_shapes[i].mesh;
+			if (shapes[i].name != reference_shapes[i].name
+				|| mesh.indices.size() != referenceMesh.indices.size()
+				|| mesh.num_face_vertices != referenceMesh.num_face_vertices
+				|| mesh.material_ids != referenceMesh.material_ids
+				|| mesh.smoothing_group_ids != referenceMesh.smoothing_group_ids)
+				return false;
+			if (!equal(mesh.indices.begin(), mesh.indices.end(), referenceMesh.indices.begin(), sameIndex))
+				return false;
+		}
+		return true;
+	}
+}
+
+int Tools::benchmarkObjParser(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	const int runs = 5;
+	const unsigned int maxThreads = max(1u, thread::hardware_concurrency());
+	vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	int mismatches = 0;
+	cout << fixed << setprecision(1);
+	for (const auto& modelPath : models) {
+		const double megabytes = filesystem::file_size(modelPath) / (1024.0 * 1024.0);
+
+		tinyobj::attrib_t reference;
+		vector<tinyobj::shape_t> referenceShapes;
+		vector<tinyobj::material_t> referenceMaterials;
+		string warn, err;
+		const double baseline = bestOf(runs, [&]() {
+			referenceMaterials.clear();
+			tinyobj::LoadObj(&reference, &referenceShapes, &referenceMaterials, &warn, &err, modelPath.c_str());
+		});
+
+		cout << modelPath << " (" << setprecision(2) << megabytes << " MB)" << setprecision(1) << endl
+			<< "  LoadObj            " << setw(8) << megabytes / baseline << " MB/s" << endl;
+
+		for (unsigned int threads : threadCounts) {
+			tinyobj::attrib_t attrib;
+			vector<tinyobj::shape_t> shapes;
+			vector<tinyobj::material_t> materials;
+			const double elapsed = bestOf(runs, [&]() {
+				materials.clear();
+				LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str(), NULL, threads);
+			});
+
+			// both parsers have to agree on everything the mesh loader reads
+			bool same = sameObj(attrib, shapes, reference, referenceShapes) && materials.size() == referenceMaterials.size();
+			for (size_t i = 0; same && i < materials.size(); i++)
+				same = materials[i].name == referenceMaterials[i].name && materials[i].diffuse_texname == referenceMaterials[i].diffuse_texname;
+			if (!same)
+				mismatches++;
+
+			cout << "  LoadObjParallel x" << left << setw(2) << threads << right
+				<< setw(7) << megabytes / elapsed << " MB/s  "
+				<< setprecision(2) << baseline / elapsed << "x" << setprecision(1)
+				<< (same ? "" : "  MISMATCH") << endl;
+		}
+	}
+
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::analyzeMeshOptimizer(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	cout << fixed << setprecision(3);
+	for (const auto& modelPath : models) {
+		MeshData mesh;
+		try {
+			loadObjMesh(modelPath, mesh);
+		}
+		catch (const exception& e) {
+			cerr << modelPath << ": " << e.what() << endl;
+			continue;
+		}
+
+		const VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+		const auto start = steady_clock::now();
+		optimizeMesh(mesh);
+		const duration<float, milli> elapsed = steady_clock::now() - start;
+		const VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		cout << modelPath << " (" << mesh.indices.size() / 3 << " triangles, "
+			<< mesh.vertices.size() << " vertices, optimized in " << setprecision(1) << elapsed.count() << " ms)" << endl
+			<< setprecision(3)
+			<< "  ACMR      " << setw(6) << before.acmr << " -> " << setw(6) << after.acmr << endl
+			<< "  ATVR      " << setw(6) << before.atvr << " -> " << setw(6) << after.atvr << endl
+			<< "  overfetch " << setw(6) << before.overfetch << " -> " << setw(6) << after.overfetch << endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::benchmarkClusterCulling(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	const int views = 64;
+	const int runs = 20;
+	for (const auto& modelPath : models) {
+		MeshData mesh;
+		try {
+			loadObjMesh(modelPath, mesh);
+		}
+		catch (const exception& e) {
+			cerr << modelPath << ": " << e.what() << endl;
+			continue;
+		}
+		optimizeMesh(mesh);
+
+		const auto start = steady_clock::now();
+		buildMeshlets(mesh);
+		const duration<float, milli> buildTime = steady_clock::now() - start;
+
+		// orthographic views like the benchmark's: the model spun around y and tilted,
+		// its bounding sphere fitted into clip space and pushed half way into the depth range
+		const float* center = mesh.bounds.center;
+		const float scale = mesh.bounds.radius > 0.0f ? 0.5f / mesh.bounds.radius : 1.0f;
+		vector<CullView> cullViews;
+		for (int i = 0; i < views; i++) {
+			const float yaw = 6.2831853f * i / views;
+			const float pitch = -1.0471976f;
+			const float cy = cosf(yaw), sy = sinf(yaw), cp = cosf(pitch), sp = sinf(pitch);
+			// rotation around y, then around x (row vectors)
+			const float rotation[3][3] = {
+				{ cy, sy * sp, -sy * cp },
+				{ 0.0f, cp, sp },
+				{ sy, -cy * sp, cy * cp },
+			};
+			float transform[4][4] = {};
+			for (int row = 0; row < 3; row++)
+				for (int column = 0; column < 3; column++)
+					transform[row][column] = rotation[row][column] * scale;
+			for (int column = 0; column < 3; column++) {
+				float moved = 0.0f;
+				for (int row = 0; row < 3; row++)
+					moved -= center[row] * transform[row][column];
+				transform[3][column] = moved + (column == 2 ? 0.5f : 0.0f);
+			}
+			transform[3][3] = 1.0f;
+			// the face the benchmark culls
+			cullViews.push_back(makeCullView(transform, CullFace::front));
+		}
+
+		size_t visibleMeshlets = 0;
+		size_t visibleIndices = 0;
+		vector<IndexRange> ranges;
+		const double cullTime = bestOf(runs, [&]() {
+			visibleMeshlets = 0;
+			visibleIndices = 0;
+			for (const auto& view : cullViews) {
+				ranges.clear();
+				visibleMeshlets += cullMeshlets(mesh.meshlets, view, ranges);
+				for (const auto& range : ranges)
+					visibleIndices += range.indexCount;
+			}
+		});
+
+		size_t meshletVertices = 0;
+		vector<uint32_t> seen(mesh.vertices.size(), 0xFFFFFFFF);
+		for (size_t m = 0; m < mesh.meshlets.size(); m++) {
+			const Meshlet& meshlet = mesh.meshlets[m];
+			for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+				if (seen[mesh.indices[i]] != m) {
+					seen[mesh.indices[i]] = static_cast<uint32_t>(m);
+					meshletVertices++;
+				}
+			}
+		}
+
+		const size_t meshletCount = max<size_t>(mesh.meshlets.size(), 1);
+		cout << fixed << setprecision(1)
+			<< modelPath << ": " << mesh.meshlets.size() << " meshlets (avg "
+			<< float(meshletVertices) / meshletCount << " vertices, "
+			<< float(mesh.indices.size() / 3) / meshletCount << " triangles) built in " << buildTime.count() << " ms" << endl
+			<< "  culling " << 1e9 * cullTime / (views * meshletCount) << " ns/meshlet, "
+			<< 100.0f * visibleMeshlets / (views * meshletCount) << "% of the meshlets and "
+			<< 100.0f * visibleIndices / (views * max<size_t>(mesh.indices.size(), 1)) << "% of the triangles kept" << endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::analyzeLods(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	for (const auto& modelPath : models) {
+		MeshData mesh;
+		try {
+			loadObjMesh(modelPath, mesh);
+		}
+		catch (const exception& e) {
+			cerr << modelPath << ": " << e.what() << endl;
+			continue;
+		}
+
+		optimizeMesh(mesh);
+		const auto start = steady_clock::now();
+		buildLods(mesh);
+		const duration<float, milli> elapsed = steady_clock::now() - start;
+
+		float extent = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+			extent = max(extent, mesh.bounds.max[axis] - mesh.bounds.min[axis]);
+
+		cout << fixed << setprecision(1)
+			<< modelPath << " (" << mesh.lods.size() << " lods built in " << elapsed.count() << " ms)" << endl;
+		for (size_t i = 0; i < mesh.lods.size(); i++) {
+			const MeshLod& lod = mesh.lods[i];
+			cout << "  lod " << i << setw(9) << lod.indexCount / 3 << " triangles  error "
+				<< scientific << setprecision(2) << lod.error << " ("
+				<< (extent > 0.0f ? lod.error / extent : 0.0f) << " of the extent)" << fixed << endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::analyzeVertexFormats(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	const VertexFormat formats[] = { VertexFormat::unorm16_half, VertexFormat::unorm16 };
+	for (const auto& modelPath : models) {
+		MeshData mesh;
+		try {
+			loadObjMesh(modelPath, mesh);
+		}
+		catch (const exception& e) {
+			cerr << modelPath << ": " << e.what() << endl;
+			continue;
+		}
+
+		float extent = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+			extent = max(extent, mesh.bounds.max[axis] - mesh.bounds.min[axis]);
+
+		const size_t fullBytes = sizeof(Vertex) * mesh.vertices.size();
+		cout << modelPath << " (" << mesh.vertices.size() << " vertices, float32 " << fullBytes << " bytes)" << endl;
+		for (VertexFormat format : formats) {
+			MeshData packed;
+			packed.vertices = mesh.vertices;
+			packed.bounds = mesh.bounds;
+			packVertices(packed, format);
+			unpackVertices(packed);
+
+			// worst per component difference, the position one also relative to the largest bounds axis
+			float positionError = 0.0f;
+			float texCoordError = 0.0f;
+			for (size_t i = 0; i < mesh.vertices.size(); i++) {
+				const Vertex& a = mesh.vertices[i];
+				const Vertex& b = packed.vertices[i];
+				positionError = max({ positionError, fabsf(a.pos.x - b.pos.x), fabsf(a.pos.y - b.pos.y), fabsf(a.pos.z - b.pos.z) });
+				texCoordError = max({ texCoordError, fabsf(a.texCoord.u - b.texCoord.u), fabsf(a.texCoord.v - b.texCoord.v) });
+			}
+
+			const size_t bytes = getVertexSize(packed.vertexFormat) * mesh.vertices.size();
+			cout << "  " << left << setw(13) << getVertexFormatName(format) << right;
+			if (packed.vertexFormat != format)
+				cout << "uvs outside [0, 1], falls back to " << getVertexFormatName(packed.vertexFormat) << endl << setw(15) << "";
+			cout << setw(9) << bytes << " bytes (-" << fixed << setprecision(1) << 100.0 * (fullBytes - bytes) / fullBytes << "%)"
+				<< scientific << setprecision(2)
+				<< "  position error " << positionError << " (" << (extent > 0.0f ? positionError / extent : 0.0f) << " of the extent)"
+				<< "  uv error " << texCoordError << endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::measureObjIngest(const string& model_path, const string& mode) {
+	ObjIngest ingest;
+	if (!parseObjIngest(mode, ingest)) {
+		cerr << "unknown ingest mode " << mode << ", use stream, buffered or mapped" << endl;
+		return EXIT_FAILURE;
+	}
+
+	const size_t peakBefore = peakMemoryBytes();
+	const int runs = 5;
+	size_t vertexCount = 0;
+	const double elapsed = bestOf(runs, [&]() {
+		MeshData mesh;
+		loadObjMesh(model_path, mesh, ingest);
+		vertexCount = mesh.vertices.size();
+	});
+	const size_t peakAfter = peakMemoryBytes();
+
+	const double megabytes = filesystem::file_size(model_path) / (1024.0 * 1024.0);
+	cout << fixed << setprecision(2)
+		<< model_path << " [" << mode << "] " << vertexCount << " vertices" << endl
+		<< "  wall clock  " << elapsed * 1000.0 << " ms (" << megabytes / elapsed << " MB/s)" << endl
+		<< "  peak memory " << peakAfter / (1024.0 * 1024.0) << " MB (+"
+		<< (peakAfter - peakBefore) / (1024.0 * 1024.0) << " MB while loading)" << endl;
+	return EXIT_SUCCESS;
+}
+
+namespace {
+	// the position-only hash and compare Vertex used before it compared every attribute
+	struct LegacyVertexHash {
+		size_t operator()(Vertex const& vertex) const {
+			return ((hash<float>()(vertex.pos.x) ^ (hash<float>()(vertex.pos.y) << 1)) >> 1) ^ (hash<float>()(vertex.pos.z) << 1);
+		}
+	};
+	struct LegacyVertexEqual {
+		bool operator()(const Vertex& a, const Vertex& b) const {
+			return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z;
+		}
+	};
+}
+
+int Tools::benchmarkVertexDedup(const string& models_dir) {
+	vector<string> models;
+	if (!listModels(models_dir, models))
+		return EXIT_FAILURE;
+
+	const int runs = 10;
+	cout << fixed << setprecision(1);
+	for (const auto& modelPath : models) {
+		tinyobj::attrib_t attrib;
+		vector<tinyobj::shape_t> shapes;
+		vector<tinyobj::material_t> materials;
+		string warn, err;
+		if (!LoadObjMapped(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str())) {
+			cerr << modelPath << ": " << warn << err << endl;
+			continue;
+		}
+
+		// the face corners in the order the loader sees them
+		vector<Vertex> corners;
+		for (const auto& shape : shapes)
+			for (const auto& index : shape.mesh.indices)
+				corners.push_back(readObjVertex(attrib, index));
+
+		size_t legacyCount = 0;
+		const double legacy = bestOf(runs, [&]() {
+			vector<Vertex> vertices;
+			vector<uint32_t> indices;
+			unordered_map<Vertex, uint32_t, LegacyVertexHash, LegacyVertexEqual> uniqueVertices;
+			for (const auto& vertex : corners) {
+				if (uniqueVertices.count(vertex) == 0) {
+					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+					vertices.push_back(vertex);
+				}
+				indices.push_back(uniqueVertices[vertex]);
+			}
+			legacyCount = vertices.size();
+		});
+
+		size_t mapCount = 0;
+		const double map = bestOf(runs, [&]() {
+			vector<Vertex> vertices;
+			vector<uint32_t> indices;
+			indices.reserve(corners.size());
+			unordered_map<Vertex, uint32_t> uniqueVertices;
+			uniqueVertices.reserve(corners.size());
+			for (const auto& vertex : corners) {
+				auto it = uniqueVertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+				if (it.second)
+					vertices.push_back(vertex);
+				indices.push_back(it.first->second);
+			}
+			mapCount = vertices.size();
+		});
+
+		size_t tableCount = 0;
+		const double table = bestOf(runs, [&]() {
+			vector<Vertex> vertices;
+			vector<uint32_t> indices;
+			indices.reserve(corners.size());
+			VertexDeduplicator uniqueVertices(vertices, corners.size());
+			for (const auto& vertex : corners)
+				indices.push_back(uniqueVertices.insert(vertex));
+			tableCount = vertices.size();
+		});
+
+		const double perCorner = 1e9 / corners.size();
+		cout << modelPath << " (" << corners.size() << " corners)" << endl
+			<< "  unordered_map, position only  " << setw(7) << legacy * perCorner << " ns/corner  "
+			<< legacyCount << " vertices" << endl
+			<< "  unordered_map, all attributes " << setw(7) << map * perCorner << " ns/corner  "
+			<< mapCount << " vertices" << endl
+			<< "  VertexDeduplicator            " << setw(7) << table * perCorner << " ns/corner  "
+			<< tableCount << " vertices  " << setprecision(2) << legacy / table << "x" << setprecision(1) << endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::checkDdsFiles(const string& textures_dir) {
+	vector<string> textures;
+	if (!listModels(textures_dir, textures, ".dds"))
+		return EXIT_FAILURE;
+
+	int invalid = 0;
+	for (const auto& texturePath : textures) {
+		DdsFile file;
+		try {
+			file.open(texturePath);
+		}
+		catch (const exception& e) {
+			cerr << e.what() << endl;
+			invalid++;
+			continue;
+		}
+
+		const DdsTexture& texture = file.getTexture();
+		size_t surfaceBytes = 0;
+		for (const auto& surface : texture.surfaces)
+			surfaceBytes += surface.size;
+		cout << texturePath << ": DXGI format " << texture.format << ", " << texture.width << "x" << texture.height;
+		if (texture.dimension == DdsDimension::texture3d)
+			cout << "x" << texture.depth;
+		cout << (texture.cubemap ? " cubemap" : "") << ", " << texture.mipCount << " mips, " << texture.arraySize << " slices, "
+			<< surfaceBytes << " of " << file.getFileSize() << " bytes in surfaces" << endl;
+
+		// damaged copies: cut off before every surface end and with every header bit flipped,
+		// each has to be rejected or parse into surfaces that stay inside the copy
+		vector<uint8_t> bytes(file.getData(), file.getData() + file.getFileSize());
+		size_t rejected = 0;
+		size_t escaped = 0;
+		auto parseDamaged = [&](size_t size) {
+			DdsTexture damaged;
+			try {
+				parseDds(bytes.data(), size, damaged);
+			}
+			catch (const runtime_error&) {
+				rejected++;
+				return;
+			}
+			for (const auto& surface : damaged.surfaces) {
+				if (surface.data < bytes.data() || surface.data + surface.size > bytes.data() + size)
+					escaped++;
+			}
+		};
+
+		for (const auto& surface : texture.surfaces)
+			parseDamaged(surface.data + surface.size - file.getData() - 1);
+		const size_t headerBytes = min(bytes.size(), texture.surfaces.empty() ? bytes.size() : size_t(texture.surfaces[0].data - file.getData()));
+		for (size_t bit = 0; bit < headerBytes * 8; bit++) {
+			bytes[bit / 8] ^= 1 << (bit % 8);
+			parseDamaged(bytes.size());
+			bytes[bit / 8] ^= 1 << (bit % 8);
+		}
+
+		cout << "  " << texture.surfaces.size() + headerBytes * 8 << " damaged copies, " << rejected << " rejected";
+		if (escaped > 0) {
+			cout << ", " << escaped << " surfaces outside the file";
+			invalid++;
+		}
+		cout << endl;
+	}
+
+	cout << textures.size() - invalid << " valid, " << invalid << " invalid" << endl;
+	return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::benchmarkBlockCompression(const string& textures_dir) {
+	vector<string> images;
+	if (!listImages(textures_dir, images))
+		return EXIT_FAILURE;
+
+	const int runs = 3;
+	const BlockFormat formats[] = { BlockFormat::bc1, BlockFormat::bc3, BlockFormat::bc7 };
+	const CompressionQuality qualities[] = { CompressionQuality::fast, CompressionQuality::normal, CompressionQuality::high };
+	for (const auto& imagePath : images) {
+		Image image;
+		try {
+			loadImage(imagePath, image);
+		}
+		catch (const exception& e) {
+			cerr << e.what() << endl;
+			continue;
+		}
+
+		const size_t blockCount = size_t((image.width + 3) / 4) * ((image.height + 3) / 4);
+		cout << imagePath << ": " << image.width << "x" << image.height << ", " << blockCount << " blocks" << endl;
+		for (BlockFormat format : formats) {
+			for (CompressionQuality quality : qualities) {
+				vector<uint8_t> blocks;
+				double error = 0.0;
+				const double seconds = bestOf(runs, [&]() {
+					error = compressImage(image, format, quality, blocks);
+				});
+
+				// the PSNR of what a decoder makes of the blocks, which has to match the encoder's own error
+				DdsSurface surface;
+				getSurfaceLayout(image.width, image.height, getBlockDxgiFormat(format), surface.layout);
+				surface.data = blocks.data();
+				surface.offset = 0;
+				surface.size = blocks.size();
+				surface.width = image.width;
+				surface.height = image.height;
+				surface.depth = 1;
+				Image decoded;
+				decodeSurface(getBlockDxgiFormat(format), surface, 0, decoded);
+				double decodedError = 0.0;
+				for (size_t i = 0; i < image.pixels.size(); i++) {
+					const double difference = double(decoded.pixels[i]) - image.pixels[i];
+					decodedError += difference * difference;
+				}
+
+				cout << fixed << setprecision(2)
+					<< "  " << getBlockFormatName(format) << " " << setw(6) << left << getCompressionQualityName(quality) << right
+					<< setw(10) << blockCount / seconds / 1e6 << " Mblocks/s, "
+					<< getPsnr(decodedError, image.pixels.size()) << " dB RGBA PSNR";
+				if (fabs(decodedError - error) > 1e-3 * decodedError + 1.0)
+					cout << " (the encoder estimated " << getPsnr(error, image.pixels.size()) << " dB)";
+				cout << endl;
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::compressTextures(const string& textures_dir, BlockFormat format, CompressionQuality quality, MipFilter filter) {
+	vector<string> images;
+	if (!listImages(textures_dir, images))
+		return EXIT_FAILURE;
+
+	int failed = 0;
+	for (const auto& imagePath : images) {
+		try {
+			Image image;
+			loadImage(imagePath, image);
+
+			// every level of the chain, one after the other like writeDds wants them
+			const auto start = steady_clock::now();
+			vector<Image> mips;
+			generateMips(image, filter, true, mips);
+			vector<uint8_t> surfaces, blocks;
+			const double error = compressImage(image, format, quality, surfaces);
+			for (const auto& mip : mips) {
+				compressImage(mip, format, quality, blocks);
+				surfaces.insert(surfaces.end(), blocks.begin(), blocks.end());
+			}
+			const duration<float, milli> compressTime = steady_clock::now() - start;
+
+			const string ddsPath = filesystem::path(imagePath).replace_extension(string(".") + getBlockFormatName(format) + ".dds").string();
+			writeDds(ddsPath, getBlockDxgiFormat(format), image.width, image.height, uint32_t(mips.size() + 1), surfaces);
+			cout << fixed << setprecision(2) << ddsPath << ": " << mips.size() + 1 << " mips, " << surfaces.size() << " bytes in "
+				<< compressTime.count() << " ms, " << getPsnr(error, image.pixels.size()) << " dB RGBA PSNR on the top level" << endl;
+		}
+		catch (const exception& e) {
+			cerr << imagePath << ": " << e.what() << endl;
+			failed++;
+		}
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::generateMipTextures(const string& textures_dir, MipFilter filter) {
+	vector<string> images;
+	if (!listImages(textures_dir, images))
+		return EXIT_FAILURE;
+
+	int failed = 0;
+	for (const auto& imagePath : images) {
+		try {
+			Image image;
+			loadImage(imagePath, image);
+
+			const auto start = steady_clock::now();
+			vector<Image> mips;
+			generateMips(image, filter, true, mips);
+			const duration<float, milli> mipTime = steady_clock::now() - start;
+
+			vector<uint8_t> surfaces = image.pixels;
+			for (const auto& mip : mips)
+				surfaces.insert(surfaces.end(), mip.pixels.begin(), mip.pixels.end());
+			const string ddsPath = filesystem::path(imagePath).replace_extension(".mips.dds").string();
+			writeDds(ddsPath, DXGI_FORMAT_R8G8B8A8_UNORM, image.width, image.height, uint32_t(mips.size() + 1), surfaces);
+			cout << fixed << setprecision(2) << ddsPath << ": " << mips.size() + 1 << " mips in " << mipTime.count() << " ms" << endl;
+		}
+		catch (const exception& e) {
+			cerr << imagePath << ": " << e.what() << endl;
+			failed++;
+		}
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::benchmarkMipGeneration(const string& textures_dir) {
+	vector<string> images;
+	if (!listImages(textures_dir, images))
+		return EXIT_FAILURE;
+
+	const int runs = 3;
+	const unsigned int cores = max(1u, thread::hardware_concurrency());
+	for (const auto& imagePath : images) {
+		Image image;
+		try {
+			loadImage(imagePath, image);
+		}
+		catch (const exception& e) {
+			cerr << e.what() << endl;
+			continue;
+		}
+
+		const double megapixels = double(image.width) * image.height / 1e6;
+		cout << imagePath << ": " << image.width << "x" << image.height << ", " << getMipCount(image.width, image.height) << " mips" << endl;
+		for (MipFilter filter : { MipFilter::box, MipFilter::kaiser }) {
+			for (bool srgb : { false, true }) {
+				cout << "  " << setw(6) << left << getMipFilterName(filter) << right << (srgb ? " srgb  " : " linear");
+				for (unsigned int threads : { 1u, cores }) {
+					vector<Image> mips;
+					const double seconds = bestOf(runs, [&]() {
+						generateMips(image, filter, srgb, mips, threads);
+					});
+					cout << fixed << setprecision(2) << setw(10) << 1e3 * seconds / megapixels << " ms/MP on " << threads << " threads";
+				}
+				cout << endl;
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Tools::benchmarkPixelConversions(unsigned int megapixels) {
+	const size_t count = size_t(max(1u, megapixels)) << 20;
+	const int runs = 5;
+	mt19937 random(1);
+	cout << count << " pixels, kernels for " << getPixelKernelsName() << endl;
+
+	int mismatches = 0;
+	for (int i = 0; i < PIXEL_CONVERSION_COUNT; i++) {
+		const PixelConversion conversion = static_cast<PixelConversion>(i);
+		// random bytes, or floats a bit past [0, 1] so the clamps run
+		vector<uint8_t> source(count * getSourcePixelBytes(conversion));
+		if (getSourcePixelBytes(conversion) == 16) {
+			uniform_real_distribution<float> values(-0.1f, 1.1f);
+			float* floats = reinterpret_cast<float*>(source.data());
+			for (size_t k = 0; k < count * 4; k++)
+				floats[k] = values(random);
+		}
+		else {
+			for (auto& byte : source)
+				byte = static_cast<uint8_t>(random());
+		}
+
+		vector<uint8_t> plain(count * getDestinationPixelBytes(conversion)), simd(plain.size());
+		const double plainTime = bestOf(runs, [&]() {
+			convertPixels(conversion, source.data(), plain.data(), count, false);
+		});
+		const double simdTime = bestOf(runs, [&]() {
+			convertPixels(conversion, source.data(), simd.data(), count, true);
+		});
+		const bool matches = plain == simd;
+		if (!matches)
+			mismatches++;
+
+		cout << "  " << setw(15) << left << getPixelConversionName(conversion) << right << fixed << setprecision(0)
+			<< setw(8) << count / plainTime / 1e6 << " MP/s plain" << setw(8) << count / simdTime / 1e6 << " MP/s kernels"
+			<< setprecision(2) << setw(8) << plainTime / simdTime << "x"
+			<< setw(8) << source.size() / simdTime / 1e9 << " GB/s read" << (matches ? "" : "  MISMATCH") << endl;
+	}
+
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::packModelAtlas(const string& model_path) {
+	try {
+		tinyobj::attrib_t attrib;
+		vector<tinyobj::shape_t> shapes;
+		vector<tinyobj::material_t> materials;
+		string warn, err;
+		const string baseDir = filesystem::path(model_path).parent_path().string();
+		if (!LoadObjMapped(&attrib, &shapes, &materials, &warn, &err, model_path.c_str(), baseDir.c_str()))
+			throw runtime_error("load model error " + warn + err);
+
+		// a gutter of 8 texels keeps the images apart down to the 8x smaller mip
+		const auto start = steady_clock::now();
+		MaterialAtlas atlas;
+		buildMaterialAtlas(materials, baseDir, 8, atlas);
+		MeshData mesh;
+		size_t clampedFaces = 0;
+		buildAtlasMesh(attrib, shapes, atlas, mesh, &clampedFaces);
+		const duration<float, milli> packTime = steady_clock::now() - start;
+
+		vector<Image> mips;
+		generateMips(atlas.image, MipFilter::kaiser, true, mips);
+		vector<uint8_t> surfaces = atlas.image.pixels;
+		for (const auto& mip : mips)
+			surfaces.insert(surfaces.end(), mip.pixels.begin(), mip.pixels.end());
+		const string ddsPath = filesystem::path(model_path).replace_extension(".atlas.dds").string();
+		writeDds(ddsPath, DXGI_FORMAT_R8G8B8A8_UNORM, atlas.image.width, atlas.image.height, uint32_t(mips.size() + 1), surfaces);
+
+		// v is flipped back the way readObjVertex flips it, so loading the obj gives these vertices again
+		const string objPath = filesystem::path(model_path).replace_extension(".atlas.obj").string();
+		ofstream obj(objPath);
+		obj << setprecision(9) << "# " << model_path << " with its textures packed into " << ddsPath << "\n";
+		for (const auto& vertex : mesh.vertices)
+			obj << "v " << vertex.pos.x << " " << vertex.pos.y << " " << vertex.pos.z << "\n";
+		for (const auto& vertex : mesh.vertices)
+			obj << "vt " << vertex.texCoord.u << " " << 1 - vertex.texCoord.v << "\n";
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			obj << "f";
+			for (size_t c = 0; c < 3; c++)
+				obj << " " << mesh.indices[i + c] + 1 << "/" << mesh.indices[i + c] + 1;
+			obj << "\n";
+		}
+		if (!obj.flush())
+			throw runtime_error("can't write " + objPath);
+
+		cout << fixed << setprecision(2) << model_path << ": " << materials.size() << " materials, " << atlas.textureCount
+			<< " textures in a " << atlas.image.width << "x" << atlas.image.height << " atlas, " << clampedFaces
+			<< " faces clamped to one tile, " << packTime.count() << " ms" << endl;
+		cout << "wrote " << ddsPath << " and " << objPath << endl;
+		return EXIT_SUCCESS;
+	}
+	catch (const exception& e) {
+		cerr << model_path << ": " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+}
+
+int Tools::benchmarkAtlasPacking(unsigned int count) {
+	struct Distribution
+	{
+		const char* name;
+		function<AtlasRect(mt19937&)> make;
+	};
+	auto powerOfTwo = [](mt19937& random, int low, int high) {
+		return 1u << uniform_int_distribution<int>(low, high)(random);
+	};
+	const Distribution distributions[] = {
+		// square and 2:1 textures from 32 to 512 texels
+		{ "textures", [&](mt19937& random) {
+			const uint32_t size = powerOfTwo(random, 5, 9);
+			return random() % 2 ? AtlasRect{ 0, 0, size, size } : AtlasRect{ 0, 0, size, size / 2 };
+		} },
+		{ "mixed", [](mt19937& random) {
+			uniform_int_distribution<uint32_t> side(8, 300);
+			return AtlasRect{ 0, 0, side(random), side(random) };
+		} },
+		// glyphs and sprites, narrow and tall
+		{ "narrow", [](mt19937& random) {
+			return AtlasRect{ 0, 0, uniform_int_distribution<uint32_t>(4, 32)(random), uniform_int_distribution<uint32_t>(16, 128)(random) };
+		} }
+	};
+
+	const int runs = 5;
+	int failed = 0;
+	for (const auto& distribution : distributions) {
+		mt19937 random(1);
+		vector<AtlasRect> sizes(count);
+		uint64_t area = 0;
+		for (auto& rect : sizes) {
+			rect = distribution.make(random);
+			area += uint64_t(rect.width) * rect.height;
+		}
+
+		vector<AtlasRect> rects;
+		uint32_t width = 0, height = 0;
+		bool packed = false;
+		const double seconds = bestOf(runs, [&]() {
+			rects = sizes;
+			packed = packAtlas(rects, 16384, width, height);
+		});
+
+		// every rect inside the atlas, no two overlapping
+		bool valid = packed;
+		for (size_t i = 0; valid && i < rects.size(); i++) {
+			const AtlasRect& a = rects[i];
+			valid = a.x + a.width <= width && a.y + a.height <= height;
+			for (size_t j = i + 1; valid && j < rects.size(); j++) {
+				const AtlasRect& b = rects[j];
+				valid = a.x + a.width <= b.x || b.x + b.width <= a.x || a.y + a.height <= b.y || b.y + b.height <= a.y;
+			}
+		}
+		if (!valid)
+			failed++;
+
+		cout << "  " << setw(9) << left << distribution.name << right << fixed << setprecision(0) << setw(10) << count / seconds
+			<< " rects/s, " << width << "x" << height << setprecision(1) << ", " << 100.0 * area / (uint64_t(width) * height)
+			<< "% used" << (valid ? "" : (packed ? ", OVERLAPS" : ", doesn't fit")) << endl;
+	}
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::benchmarkProfiler(unsigned int zones) {
+	zones = std::min<unsigned int>(std::max(zones, 1u), static_cast<unsigned int>(Profiler::MAX_THREAD_EVENTS));
+	const int runs = 5;
+	const bool wasEnabled = Profiler::isEnabled();
+	auto perZone = [&](double seconds) { return 1e9 * seconds / zones; };
+
+	// the clock alone, a zone reads it twice
+	volatile int64_t sink = 0;
+	const double clock = bestOf(runs, [&]() {
+		for (unsigned int i = 0; i < zones; i++)
+			sink = Profiler::now();
+	});
+
+	Profiler::setEnabled(false);
+	const double disabled = bestOf(runs, [&]() {
+		for (unsigned int i = 0; i < zones; i++) {
+			PROFILE_ZONE("disabled");
+		}
+	});
+
+	// from an empty buffer each run, the chunks are allocated in the first one
+	Profiler::setEnabled(true);
+	const double enabled = bestOf(runs, [&]() {
+		Profiler::reset();
+		for (unsigned int i = 0; i < zones; i++) {
+			PROFILE_ZONE("enabled");
+		}
+	});
+
+	// a zone holding three, the shape of a frame
+	const double nested = bestOf(runs, [&]() {
+		Profiler::reset();
+		for (unsigned int i = 0; i < zones / 4; i++) {
+			PROFILE_ZONE("outer");
+			{ PROFILE_ZONE("inner 1"); }
+			{ PROFILE_ZONE("inner 2"); }
+			{ PROFILE_ZONE("inner 3"); }
+		}
+	});
+
+	// every core recording at once, each into its own buffer
+	const unsigned int threadCount = std::max(2u, thread::hardware_concurrency());
+	const double parallel = bestOf(runs, [&]() {
+		Profiler::reset();
+		vector<thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+			threads.emplace_back([&]() {
+				for (unsigned int i = 0; i < zones; i++) {
+					PROFILE_ZONE("parallel");
+				}
+			});
+		for (auto& worker : threads)
+			worker.join();
+	});
+	const uint64_t recorded = Profiler::getEventCount();
+	const uint64_t dropped = Profiler::getDroppedEvents();
+	Profiler::reset();
+	Profiler::setEnabled(wasEnabled);
+
+	cout << zones << " zones" << endl << fixed << setprecision(1)
+		<< "  clock read   " << setw(7) << perZone(clock) << " ns" << endl
+		<< "  disabled     " << setw(7) << perZone(disabled) << " ns/zone" << endl
+		<< "  enabled      " << setw(7) << perZone(enabled) << " ns/zone" << endl
+		<< "  nested       " << setw(7) << perZone(nested) << " ns/zone" << endl
+		<< "  " << setw(2) << threadCount << " threads   " << setw(7) << perZone(parallel) << " ns/zone per thread, "
+		<< recorded << " recorded, " << dropped << " dropped" << endl;
+	return recorded == uint64_t(threadCount) * zones && dropped == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::streamDdsFiles(const string& textures_dir, const DdsReadOptions& options) {
+	vector<string> textures;
+	if (!listModels(textures_dir, textures, ".dds"))
+		return EXIT_FAILURE;
+
+	const int runs = 5;
+	int failed = 0;
+	uint64_t totalRead = 0, totalSize = 0;
+	for (const auto& texturePath : textures) {
+		try {
+			DdsStreamedTexture streamed;
+			const double seconds = bestOf(runs, [&]() {
+				readDds(texturePath, options, streamed);
+			});
+
+			// every level read has to match the same level of the mapped file
+			DdsFile file(texturePath);
+			const DdsTexture& full = file.getTexture();
+			const DdsTexture& texture = streamed.texture;
+			bool matches = texture.mipCount + streamed.skippedMips == full.mipCount;
+			for (uint32_t slice = 0; matches && slice < texture.arraySize; slice++) {
+				for (uint32_t mip = 0; matches && mip < texture.mipCount; mip++) {
+					const DdsSurface& read = texture.getSurface(slice, mip);
+					const DdsSurface& mapped = full.getSurface(slice, mip + streamed.skippedMips);
+					matches = read.size == mapped.size && memcmp(read.data, mapped.data, read.size) == 0;
+				}
+			}
+
+			cout << fixed << setprecision(1) << texturePath << ": " << texture.width << "x" << texture.height << ", "
+				<< texture.mipCount << " of " << full.mipCount << " mips, " << streamed.bytesRead << " of "
+				<< streamed.fileSize << " bytes read (" << 100.0 * streamed.bytesRead / streamed.fileSize << "%) in "
+				<< setprecision(3) << 1e3 * seconds << " ms" << (matches ? "" : ", DIFFERS from the file") << endl;
+			totalRead += streamed.bytesRead;
+			totalSize += streamed.fileSize;
+			if (!matches)
+				failed++;
+		}
+		catch (const exception& e) {
+			cerr << e.what() << endl;
+			failed++;
+		}
+	}
+
+	if (totalSize > 0)
+		cout << fixed << setprecision(1) << totalRead << " of " << totalSize << " bytes read (" << 100.0 * totalRead / totalSize << "%)" << endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::benchmarkKtx2Files(const string& textures_dir) {
+	vector<string> textures;
+	if (!listModels(textures_dir, textures, ".ktx2"))
+		return EXIT_FAILURE;
+
+	const int runs = 5;
+	const unsigned int cores = max(1u, thread::hardware_concurrency());
+	int failed = 0;
+	for (const auto& texturePath : textures) {
+		try {
+			DdsStreamedTexture streamed;
+			const double serial = bestOf(runs, [&]() {
+				readKtx2(texturePath, {}, streamed, 1);
+			});
+			const double parallel = bestOf(runs, [&]() {
+				readKtx2(texturePath, {}, streamed, cores);
+			});
+
+			const DdsTexture& texture = streamed.texture;
+			cout << fixed << setprecision(1) << texturePath << ": DXGI format " << texture.format << ", " << texture.width
+				<< "x" << texture.height << ", " << texture.mipCount << " mips, " << texture.arraySize << " slices, "
+				<< streamed.fileSize << " bytes stored, " << streamed.data.size() << " decompressed ("
+				<< 100.0 * streamed.fileSize / max<size_t>(streamed.data.size(), 1) << "%), " << setprecision(3)
+				<< 1e3 * serial << " ms on 1 thread, " << 1e3 * parallel << " ms on " << cores << " (" << setprecision(0)
+				<< streamed.data.size() / parallel / 1e6 << " MB/s)" << endl;
+		}
+		catch (const exception& e) {
+			cerr << e.what() << endl;
+			failed++;
+		}
+	}
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::decodeDdsFiles(const string& textures_dir) {
+	vector<string> textures;
+	if (!listModels(textures_dir, textures, ".dds"))
+		return EXIT_FAILURE;
+
+	const int runs = 5;
+	int failed = 0;
+	for (const auto& texturePath : textures) {
+		try {
+			DdsFile file(texturePath);
+			const DdsTexture& texture = file.getTexture();
+			if (!canDecode(texture.format)) {
+				cout << texturePath << ": DXGI format " << texture.format << " can't be decoded, skipped" << endl;
+				continue;
+			}
+
+			// every depth slice of every surface
+			Image decoded;
+			size_t pixels = 0;
+			const double seconds = bestOf(runs, [&]() {
+				pixels = 0;
+				for (const auto& surface : texture.surfaces) {
+					for (uint32_t z = 0; z < surface.depth; z++) {
+						decodeSurface(texture.format, surface, z, decoded);
+						pixels += decoded.pixels.size() / 4;
+					}
+				}
+			});
+
+			// FNV-1a of all decoded pixels, so runs on different machines can be compared
+			uint64_t hash = 14695981039346656037ull;
+			for (const auto& surface : texture.surfaces) {
+				for (uint32_t z = 0; z < surface.depth; z++) {
+					decodeSurface(texture.format, surface, z, decoded);
+					for (uint8_t value : decoded.pixels)
+						hash = (hash ^ value) * 1099511628211ull;
+				}
+			}
+			cout << fixed << setprecision(1) << texturePath << ": DXGI format " << texture.format << ", "
+				<< pixels << " pixels decoded at " << pixels / seconds / 1e6 << " Mpixels/s, hash "
+				<< hex << setw(16) << setfill('0') << hash << dec << setfill(' ') << endl;
+
+			// every mip level against its box filtered parent: a bilinear sample
+			// between 4 texels of the level above is their average
+			TextureSampler sampler(texture);
+			if (sampler.getMipCount() > 1) {
+				cout << "  mips against the level above (RMS of 255):";
+				for (uint32_t mip = 1; mip < sampler.getMipCount(); mip++) {
+					const FloatImage& level = sampler.getMip(mip);
+					double squaredError = 0.0;
+					for (uint32_t y = 0; y < level.height; y++) {
+						for (uint32_t x = 0; x < level.width; x++) {
+							float parent[4];
+							sampler.sampleBilinear((x + 0.5f) / level.width, (y + 0.5f) / level.height, mip - 1, parent);
+							for (int c = 0; c < 4; c++) {
+								const double difference = 255.0 * (level.getPixel(x, y)[c] - parent[c]);
+								squaredError += difference * difference;
+							}
+						}
+					}
+					cout << " " << sqrt(squaredError / (size_t(level.width) * level.height * 4));
+				}
+				cout << endl;
+			}
+
+			// a diagonal sweep through the texture and the mip chain
+			const int samples = 1 << 20;
+			volatile float sink = 0.0f;
+			const double sampleSeconds = bestOf(runs, [&]() {
+				float color[4], sum = 0.0f;
+				for (int i = 0; i < samples; i++) {
+					const float t = i * (1.0f / samples);
+					sampler.sampleTrilinear(t * 7.0f, t * 13.0f, t * sampler.getMipCount(), color);
+					sum += color[0];
+				}
+				sink = sum;
+			});
+			cout << "  trilinear sampling " << samples / sampleSeconds / 1e6 << " Msamples/s" << endl;
+		}
+		catch (const exception& e) {
+			cerr << texturePath << ": " << e.what() << endl;
+			failed++;
+		}
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+	// Stands in for the gpu: remembers when the levels of every texture arrive
+	// and checks they come smallest first.
+	class RecordingSink : public TextureUploadSink {
+	public:
+		struct Record
+		{
+			steady_clock::time_point firstLevel;
+			steady_clock::time_point lastLevel;
+			uint32_t expectedMip = 0;
+			size_t bytes = 0;
+			bool outOfOrder = false;
+		};
+
+		void createTexture(TextureHandle texture, const TextureInfo& info) override {
+			if (m_records.size() <= texture)
+				m_records.resize(texture + 1);
+			m_records[texture].expectedMip = info.mipCount;
+		}
+
+		void uploadLevel(TextureHandle texture, const TextureLevel& level) override {
+			Record& record = m_records[texture];
+			const auto now = steady_clock::now();
+			if (record.bytes == 0)
+				record.firstLevel = now;
+			record.lastLevel = now;
+			record.bytes += level.data.size();
+			record.outOfOrder |= level.mip + 1 != record.expectedMip;
+			record.expectedMip = level.mip;
+		}
+
+		const Record& getRecord(TextureHandle texture) const { return m_records[texture]; }
+
+	private:
+		vector<Record> m_records;
+	};
+}
+
+int Tools::streamTextures(const string& textures_dir) {
+	vector<string> textures;
+	if (!listImages(textures_dir, textures) || !listModels(textures_dir, textures, ".dds") ||
+		!listModels(textures_dir, textures, ".ktx2"))
+		return EXIT_FAILURE;
+
+	// 60 frames a second with the upload budget of Graphics
+	const auto frameTime = microseconds(16667);
+	const size_t uploadBudget = 4 << 20;
+
+	TextureStreamer streamer;
+	RecordingSink sink;
+	const auto start = steady_clock::now();
+	vector<TextureHandle> handles;
+	for (const auto& texturePath : textures)
+		handles.push_back(streamer.request(texturePath));
+
+	// the frames update runs in until every texture is resident or failed
+	int frames = 0;
+	for (;;) {
+		streamer.update(sink, uploadBudget);
+		frames++;
+		bool done = true;
+		for (TextureHandle handle : handles) {
+			const TextureResidency residency = streamer.getResidency(handle);
+			done &= residency == TextureResidency::resident || residency == TextureResidency::failed;
+		}
+		if (done)
+			break;
+		this_thread::sleep_for(frameTime);
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < textures.size(); i++) {
+		const TextureHandle handle = handles[i];
+		if (streamer.getResidency(handle) == TextureResidency::failed) {
+			cerr << streamer.getError(handle) << endl;
+			failed++;
+			continue;
+		}
+
+		const TextureInfo info = streamer.getInfo(handle);
+		const RecordingSink::Record& record = sink.getRecord(handle);
+		const duration<double, milli> firstLevel = record.firstLevel - start;
+		const duration<double, milli> lastLevel = record.lastLevel - start;
+		cout << fixed << setprecision(1) << textures[i] << ": " << info.width << "x" << info.height << ", DXGI format "
+			<< info.format << ", " << info.mipCount << " mips, " << record.bytes << " bytes, smallest mip after "
+			<< firstLevel.count() << " ms, resident after " << lastLevel.count() << " ms" << endl;
+		if (record.outOfOrder) {
+			cerr << textures[i] << ": mips were not uploaded smallest first" << endl;
+			failed++;
+		}
+	}
+	cout << frames << " frames until every texture was resident" << endl;
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Tools::benchmarkAssetCache(const string& models_dir, const string& textures_dir) {
+	vector<string> models, images;
+	if (!listModels(models_dir, models) || (!textures_dir.empty() && !listImages(textures_dir, images)))
+		return EXIT_FAILURE;
+	if (models.empty()) {
+		cerr << models_dir << " has no .obj" << endl;
+		return EXIT_FAILURE;
+	}
+
+	// a folder of its own, so the first pass really starts cold
+	const filesystem::path directory = filesystem::temp_directory_path() / "asset-cache-bench";
+	error_code ec;
+	filesystem::remove_all(directory, ec);
+
+	// a copy of the first model under another name, it must be found by its content
+	const string copyPath = (directory / "copy.obj").string();
+	filesystem::create_directories(directory, ec);
+	filesystem::copy_file(models[0], copyPath, ec);
+
+	auto loadAll = [&](AssetCache& cache, bool with_copy) {
+		for (const auto& modelPath : models)
+			cache.getMesh(modelPath, VertexFormat::float32, [&](MeshData& mesh) { processMesh(modelPath, VertexFormat::float32, mesh); });
+		if (with_copy)
+			cache.getMesh(copyPath, VertexFormat::float32, [&](MeshData& mesh) { processMesh(copyPath, VertexFormat::float32, mesh); });
+		for (const auto& imagePath : images) {
+			try {
+				cache.getTexture(imagePath, MipFilter::kaiser, [&](TextureChain& chain) {
+					chain.resize(1);
+					loadImage(imagePath, chain[0]);
+					vector<Image> mips;
+					generateMips(chain[0], MipFilter::kaiser, true, mips);
+					move(mips.begin(), mips.end(), back_inserter(chain));
+				});
+			}
+			catch (const exception& e) {
+				cerr << e.what() << endl;
+			}
+		}
+	};
+
+	auto report = [](const char* pass, double seconds, const AssetCacheStats& before, const AssetCacheStats& after) {
+		cout << fixed << setprecision(2) << setw(24) << left << pass << right << setw(10) << 1e3 * seconds << " ms, "
+			<< after.memoryHits - before.memoryHits << " memory hits, " << after.diskHits - before.diskHits << " disk hits, "
+			<< after.misses - before.misses << " misses, " << after.entries << " entries in "
+			<< after.memoryBytes / (1024.0 * 1024.0) << " MB" << endl;
+	};
+
+	try {
+		AssetCache cache((directory / "cache").string());
+		AssetCacheStats before = cache.getStats();
+		double seconds = bestOf(1, [&]() { loadAll(cache, true); });
+		report("cold", seconds, before, cache.getStats());
+
+		before = cache.getStats();
+		seconds = bestOf(1, [&]() { loadAll(cache, false); });
+		report("again, from memory", seconds, before, cache.getStats());
+
+		// a new process would start like this
+		AssetCache reopened((directory / "cache").string());
+		before = reopened.getStats();
+		seconds = bestOf(1, [&]() { loadAll(reopened, false); });
+		report("new cache, from disk", seconds, before, reopened.getStats());
+	}
+	catch (const exception& e) {
+		cerr << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	filesystem::remove_all(directory, ec);
+	return EXIT_SUCCESS;
+}
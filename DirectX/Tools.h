@@ -0,0 +1,88 @@
+#pragma once
+
+#include "DdsParser.h"
+#include "Mesh.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+#include <string>
+
+// Command line tools that work on the assets without opening a window.
+namespace Tools {
+	// Parses and optimizes every .obj in models_dir for vertex_format into the
+	// asset cache, unless the cache already has it.
+	int bakeMeshCaches(const std::string& models_dir, VertexFormat vertex_format = VertexFormat::float32);
+	// Prints the parse throughput (MB/s) of tinyobj::LoadObj and LoadObjParallel
+	// per thread count for every .obj in models_dir.
+	int benchmarkObjParser(const std::string& models_dir);
+	// Times the vertex deduplication of every .obj in models_dir with the old
+	// position-only std::unordered_map and with VertexDeduplicator.
+	int benchmarkVertexDedup(const std::string& models_dir);
+	// Prints the simulated vertex cache and vertex fetch cost (ACMR, ATVR,
+	// overfetch) of every .obj in models_dir before and after optimizeMesh.
+	int analyzeMeshOptimizer(const std::string& models_dir);
+	// Splits every .obj in models_dir into meshlets and times the cpu cluster
+	// culling from a ring of views around the model.
+	int benchmarkClusterCulling(const std::string& models_dir);
+	// Builds the levels of detail of every .obj in models_dir and prints their
+	// triangle counts, simplification errors and build time.
+	int analyzeLods(const std::string& models_dir);
+	// Prints the vertex buffer size and the worst reconstruction error of every
+	// vertex format for every .obj in models_dir.
+	int analyzeVertexFormats(const std::string& models_dir);
+	// Validates every .dds in textures_dir, prints its layout and checks that
+	// truncated and bit flipped copies of it are rejected or stay in bounds.
+	int checkDdsFiles(const std::string& textures_dir);
+	// Reads every .dds in textures_dir with readDds, keeping the levels options
+	// allow, checks them against the whole file and prints the bytes read.
+	int streamDdsFiles(const std::string& textures_dir, const DdsReadOptions& options);
+	// Reads every .ktx2 in textures_dir with readKtx2 on one thread and on
+	// every core and prints its layout, the stored and decompressed bytes and
+	// the decompression throughput.
+	int benchmarkKtx2Files(const std::string& textures_dir);
+	// Decodes every surface of every .dds in textures_dir on the cpu and prints
+	// the throughput, a hash of the pixels, how far each mip level is from its
+	// box filtered parent and the trilinear sampling rate.
+	int decodeDdsFiles(const std::string& textures_dir);
+	// Compresses every image in textures_dir into each block format at each
+	// quality and prints the blocks per second and the PSNR of the decoded blocks.
+	int benchmarkBlockCompression(const std::string& textures_dir);
+	// Compresses every image in textures_dir with its full mip chain into
+	// <name>.<format>.dds next to it.
+	int compressTextures(const std::string& textures_dir, BlockFormat format, CompressionQuality quality,
+		MipFilter filter = MipFilter::kaiser);
+	// Writes every image in textures_dir with its full mip chain as RGBA8 into
+	// <name>.mips.dds next to it.
+	int generateMipTextures(const std::string& textures_dir, MipFilter filter);
+	// Times the mip chain generation of every image in textures_dir for each
+	// filter, in linear and in sRGB space, on one and on every core.
+	int benchmarkMipGeneration(const std::string& textures_dir);
+	// Packs the diffuse textures of the materials of model_path into one atlas
+	// and writes it with its mip chain as <model>.atlas.dds, and the model with
+	// its texture coordinates moved into the atlas as <model>.atlas.obj, so
+	// both render with one texture and one draw.
+	int packModelAtlas(const std::string& model_path);
+	// Packs count random rectangles of a few size distributions with packAtlas
+	// and prints the rectangles per second, the atlas size and how much of it
+	// they fill.
+	int benchmarkAtlasPacking(unsigned int count = 1024);
+	// Times zones opened and closed count times with the profiler disabled,
+	// enabled, nested and on every core at once, and prints the cost of one.
+	int benchmarkProfiler(unsigned int zones = 1000000);
+	// Runs every PixelConvert conversion over megapixels random pixels with the
+	// plain loops and with the kernels, checks that they give the same bytes
+	// and prints the pixels per second of both.
+	int benchmarkPixelConversions(unsigned int megapixels = 16);
+	// Streams every image and .dds in textures_dir through TextureStreamer
+	// into a sink that stands in for the gpu, one update per 60 Hz frame, and
+	// prints when the smallest and the full mip level of each arrived.
+	int streamTextures(const std::string& textures_dir);
+	// Loads every .obj in models_dir and every image in textures_dir (when not
+	// empty) through a fresh AssetCache, then again from its memory and from a
+	// new cache on the same folder, and prints the time and hits of each pass.
+	int benchmarkAssetCache(const std::string& models_dir, const std::string& textures_dir);
+	// Loads model_path with one ingest mode ("stream", "buffered" or "mapped")
+	// and prints the wall clock time and the peak memory of the process.
+	// Run it once per mode, the peak can't be reset inside one process.
+	int measureObjIngest(const std::string& model_path, const std::string& mode);
+}
@@ -0,0 +1,58 @@
+#include "VertexDeduplicator.h"
+
+using namespace std;
+
+VertexDeduplicator::VertexDeduplicator(vector<Vertex>& vertices, size_t expected_count)
+	: m_vertices(vertices) {
+	// at most half full when every inserted vertex turns out to be unique
+	size_t capacity = 16;
+	while (capacity < expected_count * 2)
+		capacity *= 2;
+
+	m_slots.assign(capacity, Slot{ 0, EMPTY });
+	m_mask = capacity - 1;
+	m_vertices.reserve(expected_count);
+}
+
+uint32_t VertexDeduplicator::insert(const Vertex& vertex, bool* added) {
+	const uint64_t h = vertex.hash();
+	const uint32_t tag = static_cast<uint32_t>(h >> 32);
+
+	for (size_t i = static_cast<size_t>(h) & m_mask;; i = (i + 1) & m_mask) {
+		Slot& slot = m_slots[i];
+		if (slot.index == EMPTY) {
+			slot.hash = tag;
+			slot.index = static_cast<uint32_t>(m_vertices.size());
+			m_vertices.push_back(vertex);
+			if (added) *added = true;
+
+			// only reached when more vertices are inserted than announced
+			if (m_vertices.size() * 2 > m_slots.size()) {
+				const uint32_t index = slot.index;
+				grow();
+				return index;
+			}
+			return slot.index;
+		}
+		if (slot.hash == tag && m_vertices[slot.index] == vertex) {
+			if (added) *added = false;
+			return slot.index;
+		}
+	}
+}
+
+void VertexDeduplicator::grow() {
+	vector<Slot> old;
+	old.swap(m_slots);
+	m_slots.assign(old.size() * 2, Slot{ 0, EMPTY });
+	m_mask = m_slots.size() - 1;
+
+	for (const Slot& slot : old) {
+		if (slot.index == EMPTY)
+			continue;
+		size_t i = static_cast<size_t>(m_vertices[slot.index].hash()) & m_mask;
+		while (m_slots[i].index != EMPTY)
+			i = (i + 1) & m_mask;
+		m_slots[i] = slot;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+// Open addressing (linear probing) hash table that maps every distinct vertex
+// to its slot in a vertex array. The table is sized up front from the expected
+// vertex count and only grows when more vertices are inserted than announced.
+class VertexDeduplicator {
+public:
+	// expected_count is the number of vertices that will be inserted (the index count)
+	VertexDeduplicator(std::vector<Vertex>& vertices, size_t expected_count);
+
+	// Returns the index of vertex in the vertex array, appending it when it is new.
+	uint32_t insert(const Vertex& vertex, bool* added = nullptr);
+
+private:
+	static const uint32_t EMPTY = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		uint32_t hash;  // upper bits of the vertex hash, to skip most full compares
+		uint32_t index; // into m_vertices, EMPTY for free slots
+	};
+
+	void grow();
+
+	std::vector<Vertex>& m_vertices;
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+};
@@ -0,0 +1,123 @@
+#include "VertexFormat.h"
+#include "HalfFloat.h"
+#include "Profiler.h"
+
+
+using namespace std;
+
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must match the input layout");
+
+namespace {
+	const float UNORM16_MAX = 65535.0f;
+
+	uint16_t toUnorm16(float value) {
+		if (!(value > 0.0f)) return 0;
+		if (value >= 1.0f) return 0xFFFF;
+		return static_cast<uint16_t>(value * UNORM16_MAX + 0.5f);
+	}
+}
+
+bool parseVertexFormat(const string& name, VertexFormat& format)
+{
+	if (name == "float32") format = VertexFormat::float32;
+	else if (name == "unorm16_half") format = VertexFormat::unorm16_half;
+	else if (name == "unorm16") format = VertexFormat::unorm16;
+	else return false;
+	return true;
+}
+
+const char* getVertexFormatName(VertexFormat format)
+{
+	switch (format) {
+	case VertexFormat::unorm16_half: return "unorm16_half";
+	case VertexFormat::unorm16: return "unorm16";
+	default: return "float32";
+	}
+}
+
+size_t getVertexSize(VertexFormat format)
+{
+	return format == VertexFormat::float32 ? sizeof(Vertex) : sizeof(PackedVertex);
+}
+
+VertexFormat chooseVertexFormat(const MeshData& mesh, VertexFormat format)
+{
+	if (format != VertexFormat::unorm16)
+		return format;
+
+	for (const auto& vertex : mesh.vertices) {
+		if (vertex.texCoord.u < 0.0f || vertex.texCoord.u > 1.0f || vertex.texCoord.v < 0.0f || vertex.texCoord.v > 1.0f)
+			return VertexFormat::unorm16_half;
+	}
+	return format;
+}
+
+void getPositionDecode(const MeshBounds& bounds, float scale[3], float offset[3])
+{
+	for (int axis = 0; axis < 3; axis++) {
+		scale[axis] = bounds.max[axis] - bounds.min[axis];
+		offset[axis] = bounds.min[axis];
+	}
+}
+
+void packVertices(MeshData& mesh, VertexFormat format)
+{
+	PROFILE_ZONE("packVertices");
+	mesh.vertexFormat = chooseVertexFormat(mesh, format);
+	mesh.packedVertices.clear();
+	if (mesh.vertexFormat == VertexFormat::float32)
+		return;
+
+	// flat axes (a plane) all land on 0
+	float scale[3], offset[3], encode[3];
+	getPositionDecode(mesh.bounds, scale, offset);
+	for (int axis = 0; axis < 3; axis++)
+		encode[axis] = scale[axis] > 0.0f ? 1.0f / scale[axis] : 0.0f;
+
+	mesh.packedVertices.resize(sizeof(PackedVertex) * mesh.vertices.size());
+	PackedVertex* packed = reinterpret_cast<PackedVertex*>(mesh.packedVertices.data());
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const Vertex& vertex = mesh.vertices[i];
+		const float p[3] = { vertex.pos.x, vertex.pos.y, vertex.pos.z };
+		for (int axis = 0; axis < 3; axis++)
+			packed[i].pos[axis] = toUnorm16((p[axis] - offset[axis]) * encode[axis]);
+		packed[i].pos[3] = 0;
+
+		if (mesh.vertexFormat == VertexFormat::unorm16) {
+			packed[i].texCoord[0] = toUnorm16(vertex.texCoord.u);
+			packed[i].texCoord[1] = toUnorm16(vertex.texCoord.v);
+		}
+		else {
+			packed[i].texCoord[0] = floatToHalf(vertex.texCoord.u);
+			packed[i].texCoord[1] = floatToHalf(vertex.texCoord.v);
+		}
+	}
+}
+
+void unpackVertices(MeshData& mesh)
+{
+	if (mesh.vertexFormat == VertexFormat::float32)
+		return;
+
+	float scale[3], offset[3];
+	getPositionDecode(mesh.bounds, scale, offset);
+
+	const size_t count = mesh.packedVertices.size() / sizeof(PackedVertex);
+	const PackedVertex* packed = reinterpret_cast<const PackedVertex*>(mesh.packedVertices.data());
+	mesh.vertices.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		Vertex& vertex = mesh.vertices[i];
+		vertex.pos.x = offset[0] + packed[i].pos[0] / UNORM16_MAX * scale[0];
+		vertex.pos.y = offset[1] + packed[i].pos[1] / UNORM16_MAX * scale[1];
+		vertex.pos.z = offset[2] + packed[i].pos[2] / UNORM16_MAX * scale[2];
+
+		if (mesh.vertexFormat == VertexFormat::unorm16) {
+			vertex.texCoord.u = packed[i].texCoord[0] / UNORM16_MAX;
+			vertex.texCoord.v = packed[i].texCoord[1] / UNORM16_MAX;
+		}
+		else {
+			vertex.texCoord.u = halfToFloat(packed[i].texCoord[0]);
+			vertex.texCoord.v = halfToFloat(packed[i].texCoord[1]);
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Vertex of the unorm16_half and unorm16 formats (12 bytes). pos[3] only pads
+// the position to the 4 components DXGI has a 16-bit format for.
+struct PackedVertex
+{
+	uint16_t pos[4];
+	uint16_t texCoord[2];
+};
+
+// Parses "float32", "unorm16_half" or "unorm16". Returns false for anything else.
+bool parseVertexFormat(const std::string& name, VertexFormat& format);
+const char* getVertexFormatName(VertexFormat format);
+// Bytes per vertex in the vertex buffer.
+size_t getVertexSize(VertexFormat format);
+
+// The format packVertices ends up using when format is asked for: unorm16
+// falls back to unorm16_half when a uv lies outside [0, 1] (tiling uvs).
+VertexFormat chooseVertexFormat(const MeshData& mesh, VertexFormat format);
+
+// Stores mesh.vertices in mesh.packedVertices using chooseVertexFormat(mesh, format)
+// and sets mesh.vertexFormat. Positions are quantized within mesh.bounds.
+void packVertices(MeshData& mesh, VertexFormat format);
+// Rebuilds mesh.vertices from mesh.packedVertices, as the vertex shader sees them.
+void unpackVertices(MeshData& mesh);
+
+// Per axis scale and offset that take a UNORM16 position as the input
+// assembler hands it to the shader ([0, 1]) back into the mesh bounds.
+void getPositionDecode(const MeshBounds& bounds, float scale[3], float offset[3]);
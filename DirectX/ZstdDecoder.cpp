@@ -0,0 +1,764 @@
+#include "ZstdDecoder.h"
+
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const uint32_t FRAME_MAGIC = 0xFD2FB528;
+	// 0x184D2A50 to 0x184D2A5F
+	const uint32_t SKIPPABLE_MAGIC = 0x184D2A50;
+	const size_t MAX_BLOCK_SIZE = 128 << 10;
+	const int MAX_HUFFMAN_BITS = 11;
+	const int MAX_HUFFMAN_SYMBOLS = 256;
+
+	// largest symbol and accuracy log of the sequence codes
+	const int MAX_LITERAL_LENGTH_CODE = 35;
+	const int MAX_MATCH_LENGTH_CODE = 52;
+	const int MAX_OFFSET_CODE = 31;
+	const int MAX_LITERAL_LENGTH_LOG = 9;
+	const int MAX_MATCH_LENGTH_LOG = 9;
+	const int MAX_OFFSET_LOG = 8;
+
+	// the distributions of the predefined mode, RFC 8878 3.1.1.3.2.2
+	const int16_t LITERAL_LENGTH_DEFAULTS[36] = {
+		4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+		-1, -1, -1, -1 };
+	const int16_t MATCH_LENGTH_DEFAULTS[53] = {
+		1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+		-1, -1, -1, -1, -1 };
+	const int16_t OFFSET_DEFAULTS[29] = {
+		1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1 };
+
+	// baseline and extra bits of every literal and match length code
+	const uint32_t LITERAL_LENGTH_BASES[36] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+		16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+		8192, 16384, 32768, 65536 };
+	const uint8_t LITERAL_LENGTH_BITS[36] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+		13, 14, 15, 16 };
+	const uint32_t MATCH_LENGTH_BASES[53] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+		19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+		35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+		4099, 8195, 16387, 32771, 65539 };
+	const uint8_t MATCH_LENGTH_BITS[53] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+		12, 13, 14, 15, 16 };
+
+	[[noreturn]] void corrupt(const char* what) {
+		throw runtime_error(string("zstd: ") + what);
+	}
+
+	uint32_t readLe(const uint8_t* data, int bytes) {
+		uint32_t value = 0;
+		for (int i = 0; i < bytes; i++)
+			value |= uint32_t(data[i]) << (8 * i);
+		return value;
+	}
+
+	int highestBit(uint32_t value) {
+		int bit = -1;
+		for (; value; value >>= 1)
+			bit++;
+		return bit;
+	}
+
+	// Bits from the first byte on, lowest bit first (the FSE table descriptions)
+	class ForwardBits {
+	public:
+		ForwardBits(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		uint32_t read(int bits) {
+			uint32_t value = 0;
+			for (int i = 0; i < bits; i++, m_offset++) {
+				if (m_offset >= m_size * 8)
+					corrupt("table description past the end of the block");
+				value |= uint32_t((m_data[m_offset >> 3] >> (m_offset & 7)) & 1) << i;
+			}
+			return value;
+		}
+		void rewind(int bits) { m_offset -= bits; }
+		// whole bytes used
+		size_t getBytes() const { return (m_offset + 7) / 8; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+	};
+
+	// Bits from the last byte backwards (the Huffman and FSE streams). The last
+	// byte marks the end with its highest set bit, bits before the start of the
+	// stream read as 0 so the decoders can tell when they ran over. The reads
+	// come out of 8 bytes loaded at once, which move down as the offset does.
+	class BackwardBits {
+	public:
+		BackwardBits(const uint8_t* data, size_t size) : m_data(data), m_size(size) {
+			if (size == 0 || data[size - 1] == 0)
+				corrupt("bitstream without an end mark");
+			m_offset = int64_t(size - 1) * 8 + highestBit(data[size - 1]);
+			load(m_offset);
+		}
+
+		uint32_t read(int bits) {
+			m_offset -= bits;
+			if (m_offset >= m_windowStart)
+				return static_cast<uint32_t>((m_window >> (m_offset - m_windowStart)) & ((1ull << bits) - 1));
+			if (m_offset < 0)
+				return peek(m_offset, bits);
+			load(m_offset + bits);
+			return static_cast<uint32_t>((m_window >> (m_offset - m_windowStart)) & ((1ull << bits) - 1));
+		}
+		// bits not read yet, negative once the decoder read past the start
+		int64_t getOffset() const { return m_offset; }
+
+	private:
+		// the window ends at the byte holding bit top - 1, or starts at the stream
+		void load(int64_t top) {
+			if (m_size < 8) {
+				m_window = 0;
+				memcpy(&m_window, m_data, m_size);
+				m_windowStart = 0;
+				return;
+			}
+			const size_t end = min(size_t((top + 7) >> 3), m_size);
+			const size_t start = end < 8 ? 0 : end - 8;
+			memcpy(&m_window, m_data + start, 8);
+			m_windowStart = int64_t(start) * 8;
+		}
+
+		uint32_t peek(int64_t offset, int bits) const {
+			if (bits == 0)
+				return 0;
+			if (offset < 0)
+				return offset + bits <= 0 ? 0 : peek(0, int(offset + bits)) << -offset;
+			uint64_t value = 0;
+			for (size_t i = size_t(offset >> 3); i < m_size && i < size_t(offset >> 3) + 8; i++)
+				value |= uint64_t(m_data[i]) << (8 * (i - size_t(offset >> 3)));
+			return static_cast<uint32_t>((value >> (offset & 7)) & ((1ull << bits) - 1));
+		}
+
+		const uint8_t* m_data;
+		size_t m_size;
+		int64_t m_offset;
+		uint64_t m_window = 0;
+		int64_t m_windowStart = 0;
+	};
+
+	struct FseEntry
+	{
+		uint16_t base;
+		uint8_t symbol;
+		uint8_t bits;
+	};
+
+	struct FseTable
+	{
+		int accuracyLog = 0;
+		vector<FseEntry> entries;
+
+		uint8_t peek(uint32_t state) const { return entries[state].symbol; }
+		uint32_t update(uint32_t state, BackwardBits& stream) const { return entries[state].base + stream.read(entries[state].bits); }
+	};
+
+	// the decoding table of a normalized distribution, -1 counts are the "less than 1" ones
+	void buildFseTable(const int16_t* counts, int symbol_count, int accuracy_log, FseTable& table) {
+		const uint32_t size = 1u << accuracy_log;
+		table.accuracyLog = accuracy_log;
+		table.entries.assign(size, FseEntry());
+
+		vector<uint32_t> next(symbol_count);
+		uint32_t highThreshold = size;
+		for (int s = 0; s < symbol_count; s++) {
+			if (counts[s] == -1) {
+				table.entries[--highThreshold].symbol = static_cast<uint8_t>(s);
+				next[s] = 1;
+			}
+		}
+
+		// the step is coprime with the size, so every position below the threshold comes once
+		const uint32_t step = (size >> 1) + (size >> 3) + 3;
+		uint32_t position = 0;
+		for (int s = 0; s < symbol_count; s++) {
+			if (counts[s] <= 0)
+				continue;
+			next[s] = counts[s];
+			for (int i = 0; i < counts[s]; i++) {
+				table.entries[position].symbol = static_cast<uint8_t>(s);
+				do {
+					position = (position + step) & (size - 1);
+				} while (position >= highThreshold);
+			}
+		}
+		if (position != 0)
+			corrupt("bad FSE distribution");
+
+		for (auto& entry : table.entries) {
+			const uint32_t state = next[entry.symbol]++;
+			entry.bits = static_cast<uint8_t>(accuracy_log - highestBit(state));
+			entry.base = static_cast<uint16_t>((state << entry.bits) - size);
+		}
+	}
+
+	// Reads an FSE table description, returns its bytes
+	size_t readFseTable(const uint8_t* data, size_t size, int max_accuracy_log, int max_symbol, FseTable& table) {
+		ForwardBits bits(data, size);
+		const int accuracyLog = 5 + int(bits.read(4));
+		if (accuracyLog > max_accuracy_log)
+			corrupt("FSE accuracy log too large");
+
+		int16_t counts[256];
+		int32_t remaining = 1 << accuracyLog;
+		int symbol = 0;
+		while (remaining > 0) {
+			if (symbol > max_symbol)
+				corrupt("too many FSE symbols");
+			// values below threshold fit into one bit less
+			const int width = highestBit(remaining + 1) + 1;
+			uint32_t value = bits.read(width);
+			const uint32_t lowerMask = (1u << (width - 1)) - 1;
+			const uint32_t threshold = (1u << width) - 1 - (remaining + 1);
+			if ((value & lowerMask) < threshold) {
+				bits.rewind(1);
+				value &= lowerMask;
+			}
+			else if (value > lowerMask) {
+				value -= threshold;
+			}
+
+			const int16_t count = static_cast<int16_t>(value) - 1;
+			remaining -= count < 0 ? -count : count;
+			counts[symbol++] = count;
+			if (count == 0) {
+				// 2-bit repeat flags of more zeros, 3 means another flag follows
+				for (uint32_t repeat = bits.read(2);; repeat = bits.read(2)) {
+					for (uint32_t i = 0; i < repeat; i++) {
+						if (symbol > max_symbol)
+							corrupt("too many FSE symbols");
+						counts[symbol++] = 0;
+					}
+					if (repeat != 3)
+						break;
+				}
+			}
+		}
+		if (remaining != 0)
+			corrupt("bad FSE distribution");
+
+		buildFseTable(counts, symbol, accuracyLog, table);
+		return bits.getBytes();
+	}
+
+	void buildRleTable(uint8_t symbol, FseTable& table) {
+		table.accuracyLog = 0;
+		table.entries.assign(1, FseEntry{ 0, symbol, 0 });
+	}
+
+	struct HuffmanTable
+	{
+		int maxBits = 0;
+		// symbol in the low byte, code bits in the high one
+		vector<uint16_t> entries;
+	};
+
+	// Reads the tree description at the start of compressed literals, returns its bytes
+	size_t readHuffmanTable(const uint8_t* data, size_t size, HuffmanTable& table) {
+		if (size == 0)
+			corrupt("missing Huffman tree");
+		uint8_t weights[MAX_HUFFMAN_SYMBOLS] = {};
+		int count = 0;
+		size_t used;
+		const uint8_t header = data[0];
+		if (header < 128) {
+			// weights compressed with FSE, two interleaved states
+			used = 1 + size_t(header);
+			if (used > size || header == 0)
+				corrupt("Huffman tree past the end of the block");
+			FseTable fse;
+			const size_t tableBytes = readFseTable(data + 1, header, 6, 255, fse);
+			if (tableBytes >= header)
+				corrupt("Huffman weights missing");
+			BackwardBits stream(data + 1 + tableBytes, header - tableBytes);
+			uint32_t first = stream.read(fse.accuracyLog);
+			uint32_t second = stream.read(fse.accuracyLog);
+			for (;;) {
+				if (count + 2 > MAX_HUFFMAN_SYMBOLS - 1)
+					corrupt("too many Huffman weights");
+				weights[count++] = fse.peek(first);
+				first = fse.update(first, stream);
+				if (stream.getOffset() < 0) {
+					weights[count++] = fse.peek(second);
+					break;
+				}
+				weights[count++] = fse.peek(second);
+				second = fse.update(second, stream);
+				if (stream.getOffset() < 0) {
+					weights[count++] = fse.peek(first);
+					break;
+				}
+			}
+		}
+		else {
+			// four bits per weight, the first in the high half
+			count = header - 127;
+			used = 1 + size_t(count + 1) / 2;
+			if (used > size)
+				corrupt("Huffman tree past the end of the block");
+			for (int i = 0; i < count; i++)
+				weights[i] = i % 2 == 0 ? data[1 + i / 2] >> 4 : data[1 + i / 2] & 15;
+		}
+
+		// the weight of the last symbol fills the total up to the next power of 2
+		uint32_t total = 0;
+		for (int i = 0; i < count; i++) {
+			if (weights[i] > MAX_HUFFMAN_BITS)
+				corrupt("Huffman weight too large");
+			total += weights[i] ? 1u << (weights[i] - 1) : 0;
+		}
+		if (total == 0)
+			corrupt("empty Huffman tree");
+		const int maxBits = highestBit(total) + 1;
+		const uint32_t left = (1u << maxBits) - total;
+		if (maxBits > MAX_HUFFMAN_BITS || (left & (left - 1)) != 0)
+			corrupt("incomplete Huffman tree");
+		weights[count++] = static_cast<uint8_t>(highestBit(left) + 1);
+
+		// longest codes first, each symbol covers the states its shorter code leaves open
+		uint32_t rankCounts[MAX_HUFFMAN_BITS + 2] = {};
+		uint8_t codeBits[MAX_HUFFMAN_SYMBOLS];
+		for (int i = 0; i < count; i++) {
+			codeBits[i] = weights[i] ? static_cast<uint8_t>(maxBits + 1 - weights[i]) : 0;
+			rankCounts[codeBits[i]]++;
+		}
+		uint32_t rankStarts[MAX_HUFFMAN_BITS + 2];
+		rankStarts[maxBits] = 0;
+		for (int bits = maxBits; bits >= 1; bits--)
+			rankStarts[bits - 1] = rankStarts[bits] + rankCounts[bits] * (1u << (maxBits - bits));
+
+		table.maxBits = maxBits;
+		table.entries.assign(size_t(1) << maxBits, 0);
+		for (int i = 0; i < count; i++) {
+			if (codeBits[i] == 0)
+				continue;
+			const uint32_t length = 1u << (maxBits - codeBits[i]);
+			const uint32_t start = rankStarts[codeBits[i]];
+			fill_n(table.entries.begin() + start, length, static_cast<uint16_t>(i | (codeBits[i] << 8)));
+			rankStarts[codeBits[i]] += length;
+		}
+		return used;
+	}
+
+	void decodeHuffmanStream(const HuffmanTable& table, const uint8_t* data, size_t size, uint8_t* destination, size_t count) {
+		BackwardBits stream(data, size);
+		const uint32_t mask = (1u << table.maxBits) - 1;
+		uint32_t state = stream.read(table.maxBits);
+		const uint16_t* entries = table.entries.data();
+		for (size_t i = 0; i < count; i++) {
+			const uint16_t entry = entries[state];
+			destination[i] = static_cast<uint8_t>(entry);
+			const int bits = entry >> 8;
+			state = ((state << bits) & mask) | stream.read(bits);
+		}
+		// the last symbol read maxBits past the start
+		if (stream.getOffset() != -table.maxBits)
+			corrupt("Huffman stream doesn't end with its literals");
+	}
+
+	// What the blocks of a frame share: tables for the repeat modes and the repeat offsets
+	struct FrameState
+	{
+		HuffmanTable huffman;
+		bool hasHuffman = false;
+		FseTable literalLengths, offsets, matchLengths;
+		bool hasLiteralLengths = false, hasOffsets = false, hasMatchLengths = false;
+		uint32_t repeats[3] = { 1, 4, 8 };
+		vector<uint8_t> literals;
+	};
+
+	// Decodes the literals section into state.literals, returns its bytes
+	size_t readLiterals(const uint8_t* data, size_t size, FrameState& state) {
+		if (size == 0)
+			corrupt("block without literals");
+		const int type = data[0] & 3;
+		const int sizeFormat = (data[0] >> 2) & 3;
+
+		if (type < 2) {
+			// raw or RLE, 1 to 3 header bytes
+			const int headerBytes = sizeFormat == 1 ? 2 : sizeFormat == 3 ? 3 : 1;
+			if (size_t(headerBytes) > size)
+				corrupt("literals header past the end of the block");
+			const uint32_t header = readLe(data, headerBytes);
+			const size_t regenerated = headerBytes == 1 ? header >> 3 : header >> 4;
+			if (regenerated > MAX_BLOCK_SIZE)
+				corrupt("too many literals");
+			const size_t bytes = type == 0 ? regenerated : 1;
+			if (headerBytes + bytes > size)
+				corrupt("literals past the end of the block");
+			if (type == 0)
+				state.literals.assign(data + headerBytes, data + headerBytes + regenerated);
+			else
+				state.literals.assign(regenerated, data[headerBytes]);
+			return headerBytes + bytes;
+		}
+
+		// Huffman coded, in 1 stream or 4, with a new tree or the last one
+		const int headerBytes = sizeFormat < 2 ? 3 : sizeFormat == 2 ? 4 : 5;
+		if (size_t(headerBytes) > size)
+			corrupt("literals header past the end of the block");
+		const bool fourStreams = sizeFormat != 0;
+		size_t regenerated, compressed;
+		if (headerBytes == 3) {
+			const uint32_t header = readLe(data, 3);
+			regenerated = (header >> 4) & 0x3FF;
+			compressed = (header >> 14) & 0x3FF;
+		}
+		else if (headerBytes == 4) {
+			const uint32_t header = readLe(data, 4);
+			regenerated = (header >> 4) & 0x3FFF;
+			compressed = header >> 18;
+		}
+		else {
+			const uint32_t header = readLe(data, 4);
+			regenerated = (header >> 4) & 0x3FFFF;
+			compressed = (header >> 22) | (size_t(data[4]) << 10);
+		}
+		if (regenerated > MAX_BLOCK_SIZE)
+			corrupt("too many literals");
+		if (headerBytes + compressed > size)
+			corrupt("literals past the end of the block");
+
+		const uint8_t* streams = data + headerBytes;
+		size_t streamBytes = compressed;
+		if (type == 2) {
+			const size_t treeBytes = readHuffmanTable(streams, streamBytes, state.huffman);
+			state.hasHuffman = true;
+			streams += treeBytes;
+			streamBytes -= treeBytes;
+		}
+		else if (!state.hasHuffman) {
+			corrupt("treeless literals without an earlier tree");
+		}
+
+		state.literals.resize(regenerated);
+		if (!fourStreams) {
+			decodeHuffmanStream(state.huffman, streams, streamBytes, state.literals.data(), regenerated);
+		}
+		else {
+			// a jump table of the first three sizes, the fourth stream takes the rest
+			if (streamBytes < 6)
+				corrupt("literals jump table past the end of the block");
+			const size_t sizes[3] = { readLe(streams, 2), readLe(streams + 2, 2), readLe(streams + 4, 2) };
+			if (6 + sizes[0] + sizes[1] + sizes[2] > streamBytes)
+				corrupt("literals streams past the end of the block");
+			const size_t quarter = (regenerated + 3) / 4;
+			if (quarter * 3 > regenerated)
+				corrupt("too few literals for 4 streams");
+			const uint8_t* stream = streams + 6;
+			for (int i = 0; i < 4; i++) {
+				const size_t bytes = i < 3 ? sizes[i] : streamBytes - 6 - sizes[0] - sizes[1] - sizes[2];
+				const size_t count = i < 3 ? quarter : regenerated - 3 * quarter;
+				decodeHuffmanStream(state.huffman, stream, bytes, state.literals.data() + i * quarter, count);
+				stream += bytes;
+			}
+		}
+		return headerBytes + compressed;
+	}
+
+	const FseTable& getDefaultTable(int which) {
+		struct Defaults
+		{
+			FseTable tables[3];
+			Defaults() {
+				buildFseTable(LITERAL_LENGTH_DEFAULTS, 36, 6, tables[0]);
+				buildFseTable(OFFSET_DEFAULTS, 29, 5, tables[1]);
+				buildFseTable(MATCH_LENGTH_DEFAULTS, 53, 6, tables[2]);
+			}
+		};
+		static const Defaults defaults;
+		return defaults.tables[which];
+	}
+
+	// Picks the table of one sequence code for its mode, returns the description bytes
+	size_t readSequenceTable(int mode, int which, const uint8_t* data, size_t size, int max_log, int max_symbol,
+		FseTable& table, bool& has_table) {
+		switch (mode) {
+		case 0:
+			table = getDefaultTable(which);
+			has_table = true;
+			return 0;
+		case 1:
+			if (size == 0 || data[0] > max_symbol)
+				corrupt("bad RLE sequence code");
+			buildRleTable(data[0], table);
+			has_table = true;
+			return 1;
+		case 2: {
+			const size_t bytes = readFseTable(data, size, max_log, max_symbol, table);
+			has_table = true;
+			return bytes;
+		}
+		default:
+			if (!has_table)
+				corrupt("repeated sequence table without an earlier one");
+			return 0;
+		}
+	}
+
+	// Decodes one compressed block into output[position...], returns the bytes written
+	size_t decodeBlock(const uint8_t* data, size_t size, uint8_t* output, size_t position, size_t frame_start, size_t capacity,
+		FrameState& state) {
+		size_t offset = readLiterals(data, size, state);
+		if (offset >= size)
+			corrupt("block without a sequences section");
+
+		size_t sequenceCount = data[offset++];
+		if (sequenceCount >= 128) {
+			if (sequenceCount < 255) {
+				if (offset + 1 > size)
+					corrupt("sequences header past the end of the block");
+				sequenceCount = ((sequenceCount - 128) << 8) + data[offset++];
+			}
+			else {
+				if (offset + 2 > size)
+					corrupt("sequences header past the end of the block");
+				sequenceCount = readLe(data + offset, 2) + 0x7F00;
+				offset += 2;
+			}
+		}
+
+		const uint8_t* literals = state.literals.data();
+		const size_t literalCount = state.literals.size();
+		size_t literal = 0;
+		size_t written = 0;
+		if (sequenceCount > 0) {
+			if (offset >= size)
+				corrupt("sequences header past the end of the block");
+			const uint8_t modes = data[offset++];
+			if (modes & 3)
+				corrupt("reserved sequence mode bits set");
+			offset += readSequenceTable(modes >> 6, 0, data + offset, size - offset, MAX_LITERAL_LENGTH_LOG, MAX_LITERAL_LENGTH_CODE,
+				state.literalLengths, state.hasLiteralLengths);
+			offset += readSequenceTable((modes >> 4) & 3, 1, data + offset, size - offset, MAX_OFFSET_LOG, MAX_OFFSET_CODE,
+				state.offsets, state.hasOffsets);
+			offset += readSequenceTable((modes >> 2) & 3, 2, data + offset, size - offset, MAX_MATCH_LENGTH_LOG, MAX_MATCH_LENGTH_CODE,
+				state.matchLengths, state.hasMatchLengths);
+			if (offset >= size)
+				corrupt("sequences past the end of the block");
+
+			const FseTable& literalLengths = state.literalLengths;
+			const FseTable& offsets = state.offsets;
+			const FseTable& matchLengths = state.matchLengths;
+			BackwardBits stream(data + offset, size - offset);
+			uint32_t literalLengthState = stream.read(literalLengths.accuracyLog);
+			uint32_t offsetState = stream.read(offsets.accuracyLog);
+			uint32_t matchLengthState = stream.read(matchLengths.accuracyLog);
+			uint32_t* repeats = state.repeats;
+
+			for (size_t i = 0; i < sequenceCount; i++) {
+				const uint8_t offsetCode = offsets.peek(offsetState);
+				const uint8_t matchLengthCode = matchLengths.peek(matchLengthState);
+				const uint8_t literalLengthCode = literalLengths.peek(literalLengthState);
+				if (offsetCode > MAX_OFFSET_CODE)
+					corrupt("bad offset code");
+
+				// offset bits first, then the match length, then the literal length
+				uint32_t offsetValue = (1u << offsetCode) + stream.read(offsetCode);
+				const size_t matchLength = MATCH_LENGTH_BASES[matchLengthCode] + stream.read(MATCH_LENGTH_BITS[matchLengthCode]);
+				const size_t literalLength = LITERAL_LENGTH_BASES[literalLengthCode] + stream.read(LITERAL_LENGTH_BITS[literalLengthCode]);
+
+				// values 1 to 3 pick a repeat offset, shifted by one after no literals
+				size_t matchOffset;
+				if (offsetValue > 3) {
+					matchOffset = offsetValue - 3;
+					repeats[2] = repeats[1];
+					repeats[1] = repeats[0];
+					repeats[0] = static_cast<uint32_t>(matchOffset);
+				}
+				else {
+					if (literalLength == 0)
+						offsetValue++;
+					if (offsetValue == 1) {
+						matchOffset = repeats[0];
+					}
+					else {
+						matchOffset = offsetValue == 4 ? repeats[0] - 1 : repeats[offsetValue - 1];
+						if (offsetValue != 2)
+							repeats[2] = repeats[1];
+						repeats[1] = repeats[0];
+						repeats[0] = static_cast<uint32_t>(matchOffset);
+					}
+				}
+
+				if (i + 1 < sequenceCount) {
+					literalLengthState = literalLengths.update(literalLengthState, stream);
+					matchLengthState = matchLengths.update(matchLengthState, stream);
+					offsetState = offsets.update(offsetState, stream);
+				}
+
+				if (literalLength > literalCount - literal)
+					corrupt("sequence past the end of the literals");
+				if (literalLength + matchLength > capacity - position - written)
+					corrupt("content larger than the destination");
+				uint8_t* out = output + position + written;
+				if (literalLength)
+					memcpy(out, literals + literal, literalLength);
+				literal += literalLength;
+				out += literalLength;
+				written += literalLength;
+
+				if (matchOffset == 0 || matchOffset > position + written - frame_start)
+					corrupt("match offset before the start of the frame");
+				const uint8_t* match = out - matchOffset;
+				if (matchOffset >= matchLength) {
+					memcpy(out, match, matchLength);
+				}
+				else if (matchOffset == 1) {
+					memset(out, *match, matchLength);
+				}
+				else {
+					// overlapping, repeats the last matchOffset bytes; 8 at a time when
+					// every chunk only reads bytes written before it
+					size_t k = 0;
+					if (matchOffset >= 8)
+						for (; k + 8 <= matchLength; k += 8)
+							memcpy(out + k, match + k, 8);
+					for (; k < matchLength; k++)
+						out[k] = match[k];
+				}
+				written += matchLength;
+			}
+			if (stream.getOffset() != 0)
+				corrupt("sequence stream doesn't end with its sequences");
+		}
+		else if (offset != size) {
+			corrupt("bytes after a block without sequences");
+		}
+
+		// the literals left over follow the last match
+		const size_t rest = literalCount - literal;
+		if (rest > capacity - position - written)
+			corrupt("content larger than the destination");
+		if (rest)
+			memcpy(output + position + written, literals + literal, rest);
+		written += rest;
+		if (written > MAX_BLOCK_SIZE)
+			corrupt("block larger than 128 KB");
+		return written;
+	}
+}
+
+size_t decompressZstd(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity)
+{
+	size_t in = 0, out = 0;
+	while (in < size) {
+		if (size - in < 4)
+			corrupt("truncated frame");
+		const uint32_t magic = readLe(source + in, 4);
+		if ((magic & 0xFFFFFFF0) == SKIPPABLE_MAGIC) {
+			if (size - in < 8)
+				corrupt("truncated skippable frame");
+			const size_t skipped = readLe(source + in + 4, 4);
+			if (skipped > size - in - 8)
+				corrupt("truncated skippable frame");
+			in += 8 + skipped;
+			continue;
+		}
+		if (magic != FRAME_MAGIC)
+			corrupt("not a Zstandard frame");
+		in += 4;
+
+		// frame header: descriptor, window, dictionary id, content size
+		if (in >= size)
+			corrupt("truncated frame header");
+		const uint8_t descriptor = source[in++];
+		const int contentSizeFlag = descriptor >> 6;
+		const bool singleSegment = (descriptor >> 5) & 1;
+		const bool hasChecksum = (descriptor >> 2) & 1;
+		const int dictionaryFlag = descriptor & 3;
+		if (descriptor & 8)
+			corrupt("reserved frame header bit set");
+		const int dictionaryBytes = dictionaryFlag == 3 ? 4 : dictionaryFlag;
+		const int contentSizeBytes = contentSizeFlag == 0 ? (singleSegment ? 1 : 0) : 1 << contentSizeFlag;
+		const size_t headerBytes = (singleSegment ? 0 : 1) + dictionaryBytes + contentSizeBytes;
+		if (headerBytes > size - in)
+			corrupt("truncated frame header");
+		in += singleSegment ? 0 : 1;
+		if (dictionaryBytes && readLe(source + in, dictionaryBytes) != 0)
+			throw runtime_error("zstd: frames that need a dictionary aren't supported");
+		in += dictionaryBytes;
+		uint64_t contentSize = 0;
+		if (contentSizeBytes == 8)
+			contentSize = readLe(source + in, 4) | (uint64_t(readLe(source + in + 4, 4)) << 32);
+		else if (contentSizeBytes)
+			contentSize = readLe(source + in, contentSizeBytes) + (contentSizeBytes == 2 ? 256 : 0);
+		in += contentSizeBytes;
+		if (contentSizeBytes && contentSize > capacity - out)
+			corrupt("content larger than the destination");
+
+		FrameState state;
+		const size_t frameStart = out;
+		for (bool last = false; !last;) {
+			if (size - in < 3)
+				corrupt("truncated block header");
+			const uint32_t header = readLe(source + in, 3);
+			in += 3;
+			last = header & 1;
+			const int type = (header >> 1) & 3;
+			const size_t blockSize = header >> 3;
+			const size_t blockBytes = type == 1 ? 1 : blockSize;
+			if (blockBytes > size - in)
+				corrupt("truncated block");
+			if (blockSize > MAX_BLOCK_SIZE)
+				corrupt("block larger than 128 KB");
+
+			switch (type) {
+			case 0:
+				if (blockSize > capacity - out)
+					corrupt("content larger than the destination");
+				memcpy(destination + out, source + in, blockSize);
+				out += blockSize;
+				break;
+			case 1:
+				if (blockSize > capacity - out)
+					corrupt("content larger than the destination");
+				memset(destination + out, source[in], blockSize);
+				out += blockSize;
+				break;
+			case 2:
+				out += decodeBlock(source + in, blockSize, destination, out, frameStart, capacity, state);
+				break;
+			default:
+				corrupt("reserved block type");
+			}
+			in += blockBytes;
+		}
+
+		if (contentSizeBytes && out - frameStart != contentSize)
+			corrupt("content size doesn't match the frame header");
+		if (hasChecksum) {
+			if (size - in < 4)
+				corrupt("truncated checksum");
+			const uint32_t checksum = static_cast<uint32_t>(hashContent(destination + frameStart, out - frameStart));
+			if (checksum != readLe(source + in, 4))
+				corrupt("checksum mismatch");
+			in += 4;
+		}
+	}
+	return out;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decompresses Zstandard (RFC 8878) data, the supercompression of KTX2 files.
+// Only decoding, without dictionaries, into a buffer the caller sizes from the
+// container (KTX2 stores the uncompressed length of every level).
+
+// Decompresses the frames in source (skippable frames are skipped) into
+// destination and returns the bytes written. Throws a runtime_error when the
+// data is corrupt, needs a dictionary, fails its checksum or doesn't fit into
+// capacity bytes.
+size_t decompressZstd(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity);
@@ -5,14 +5,17 @@
 
 #include "Window.h"
 #include "Renderer.h"
-#include "Graphics.h"
-#include "Benchmark.h"
+#include "BenchmarkRun.h"
+#include "Profiler.h"
+#include "Tools.h"
+#include "VertexFormat.h"
 #include <iostream>
 
 
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <vector>
 
 using namespace std;
 
@@ -36,54 +39,140 @@ int main(HINSTANCE appInstance, HINSTANCE prevInstance, LPSTR cmdLine, int cmdCo
 	}
 	LocalFree(szArglist);
 
-	int runTime;
-	string name;
-	string MODEL_PATH;
-	string TEXTURE_PATH;
-	if (argc == 1) {
-		runTime = 20;
-		name = "pcName";
-		MODEL_PATH = "models/viking_room.obj";
-		TEXTURE_PATH = "textures/viking_room.png";
+	// tool modes: ./directx.exe --bake models
+	if (argc == 3 && (string)argv[1] == "--bake")
+		return Tools::bakeMeshCaches(argv[2]);
+	if (argc == 4 && (string)argv[1] == "--bake") {
+		VertexFormat vertexFormat;
+		if (!parseVertexFormat(argv[3], vertexFormat)) {
+			cerr << "unknown vertex format " << argv[3] << ", use float32, unorm16_half or unorm16" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::bakeMeshCaches(argv[2], vertexFormat);
+	}
+	if (argc == 3 && (string)argv[1] == "--dds-check")
+		return Tools::checkDdsFiles(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--dds-decode")
+		return Tools::decodeDdsFiles(argv[2]);
+	if (argc >= 3 && argc <= 5 && (string)argv[1] == "--dds-stream") {
+		DdsReadOptions options;
+		try {
+			if (argc >= 4)
+				options.maxSize = stoul(argv[3]);
+			if (argc == 5)
+				options.memoryBudget = stoull(argv[4]) << 20;
+		}
+		catch (const exception&) {
+			cerr << "use --dds-stream <dir> [max size in texels] [budget in MB]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::streamDdsFiles(argv[2], options);
+	}
+	if (argc == 3 && (string)argv[1] == "--ktx2-bench")
+		return Tools::benchmarkKtx2Files(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--bc-bench")
+		return Tools::benchmarkBlockCompression(argv[2]);
+	if (argc >= 4 && argc <= 6 && (string)argv[1] == "--compress-textures") {
+		BlockFormat format;
+		CompressionQuality quality = CompressionQuality::normal;
+		MipFilter filter = MipFilter::kaiser;
+		if (!parseBlockFormat(argv[3], format) || (argc >= 5 && !parseCompressionQuality(argv[4], quality)) ||
+			(argc == 6 && !parseMipFilter(argv[5], filter))) {
+			cerr << "use --compress-textures <dir> <bc1|bc3|bc7> [fast|normal|high] [box|kaiser]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::compressTextures(argv[2], format, quality, filter);
 	}
-	else if (argc == 5) {
-		name = (string)argv[1];
-		runTime = stoi(argv[2]);
-		MODEL_PATH = (string)argv[3];
-		TEXTURE_PATH = (string)argv[4];
+	if ((argc == 3 || argc == 4) && (string)argv[1] == "--mip-textures") {
+		MipFilter filter = MipFilter::kaiser;
+		if (argc == 4 && !parseMipFilter(argv[3], filter)) {
+			cerr << "use --mip-textures <dir> [box|kaiser]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::generateMipTextures(argv[2], filter);
+	}
+	if (argc == 3 && (string)argv[1] == "--mip-bench")
+		return Tools::benchmarkMipGeneration(argv[2]);
+	if ((argc == 2 || argc == 3) && (string)argv[1] == "--pixel-bench") {
+		unsigned long megapixels = 16;
+		try {
+			if (argc == 3)
+				megapixels = stoul(argv[2]);
+		}
+		catch (const exception&) {
+			cerr << "use --pixel-bench [megapixels]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::benchmarkPixelConversions(static_cast<unsigned int>(megapixels));
 	}
-	else
-	{
-		MessageBox(NULL, "Please specifiy at least 4 arguments \n\nExample: ./directx.exe ManfredsPc 20 models\\object.obj textures\\texture.jpg \n\nFirst arg: refference name \nSecond arg: benchmark run time \nThird arg: path of the model \nFourth arg: path of the texture", "Wrong arguments", MB_OK);
+	if (argc == 3 && (string)argv[1] == "--pack-atlas")
+		return Tools::packModelAtlas(argv[2]);
+	if ((argc == 2 || argc == 3) && (string)argv[1] == "--atlas-bench") {
+		unsigned long count = 1024;
+		try {
+			if (argc == 3)
+				count = stoul(argv[2]);
+		}
+		catch (const exception&) {
+			cerr << "use --atlas-bench [rectangles]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::benchmarkAtlasPacking(static_cast<unsigned int>(count));
+	}
+	if ((argc == 2 || argc == 3) && (string)argv[1] == "--profiler-bench") {
+		unsigned long zones = 1000000;
+		try {
+			if (argc == 3)
+				zones = stoul(argv[2]);
+		}
+		catch (const exception&) {
+			cerr << "use --profiler-bench [zones]" << endl;
+			return EXIT_FAILURE;
+		}
+		return Tools::benchmarkProfiler(static_cast<unsigned int>(zones));
+	}
+	if ((argc == 3 || argc == 4) && (string)argv[1] == "--asset-bench")
+		return Tools::benchmarkAssetCache(argv[2], argc == 4 ? argv[3] : "");
+	if (argc == 3 && (string)argv[1] == "--stream-textures")
+		return Tools::streamTextures(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--cluster-bench")
+		return Tools::benchmarkClusterCulling(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--lods")
+		return Tools::analyzeLods(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--vertex-formats")
+		return Tools::analyzeVertexFormats(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--obj-bench")
+		return Tools::benchmarkObjParser(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--mesh-opt")
+		return Tools::analyzeMeshOptimizer(argv[2]);
+	if (argc == 3 && (string)argv[1] == "--dedup-bench")
+		return Tools::benchmarkVertexDedup(argv[2]);
+	if (argc == 4 && (string)argv[1] == "--obj-ingest")
+		return Tools::measureObjIngest(argv[2], argv[3]);
+
+	RunOptions options;
+	string error;
+	if (!parseRunOptions(vector<string>(argv + 1, argv + argc), options, error)) {
+		MessageBox(NULL, error.c_str(), "Wrong arguments", MB_OK);
 		return EXIT_FAILURE;
 	}
 
-	Window window(800, 600, name);
+	// --headless runs the same frame loop without a window or a gpu, against a null renderer
+	if (options.headless)
+		return runHeadlessBenchmark(options);
 
+	Window window(800, 600, options.pcId);
 	Renderer renderer(window);
-	Graphics graphics(renderer, MODEL_PATH, TEXTURE_PATH);
-	Benchmark benchmark(runTime, name, "directx11", MODEL_PATH);
 
 	MSG msg = { 0 };
-
-	// Main message loop:
-	while (WM_QUIT != msg.message && benchmark.run())
-	{
+	runBenchmark(renderer, options, "directx11", [&msg]() {
 		if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
+			PROFILE_ZONE("messages");
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
-
-		const float c = sin(benchmark.PeekTimer()) / 2.0f + 0.5f;
-		renderer.beginFrame(c, c, c);
-
-		graphics.draw(&renderer, -benchmark.PeekTimer(), 0.0f, 1.0f);
-
-		benchmark.UpdateBenchmark();
-
-		renderer.endFrame();
-	}
-
+		return msg.message != WM_QUIT;
+	});
 	return (int)msg.wParam;
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "Check.h"
+
+#include "BcDecoder.h"
+#include "TextureCompressor.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Round trips of the BC encoder through the decoder, and blocks written by
+// hand from the format descriptions that have to decode exactly.
+
+namespace {
+	// smooth color and alpha ramps with a few hard edges, sizes that aren't
+	// a multiple of 4 to get blocks that stick out
+	Image makeImage(uint32_t width, uint32_t height, bool opaque) {
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.resize(size_t(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				uint8_t* pixel = image.getPixel(x, y);
+				const bool stripe = (x / 8 + y / 8) % 2 == 0;
+				pixel[0] = uint8_t(x * 255 / (width - 1));
+				pixel[1] = uint8_t(y * 255 / (height - 1));
+				pixel[2] = stripe ? 200 : uint8_t(128 + 64 * sin(x * 0.1));
+				pixel[3] = opaque ? 255 : uint8_t((x + y) * 255 / (width + height - 2));
+			}
+		}
+		return image;
+	}
+
+	DdsSurface makeSurface(DXGI_FORMAT format, uint32_t width, uint32_t height, const vector<uint8_t>& blocks) {
+		DdsSurface surface;
+		if (!getSurfaceLayout(width, height, format, surface.layout))
+			throw runtime_error("no layout");
+		surface.data = blocks.data();
+		surface.offset = 0;
+		surface.size = surface.layout.slicePitch;
+		surface.width = width;
+		surface.height = height;
+		surface.depth = 1;
+		return surface;
+	}
+
+	double getSquaredError(const Image& a, const Image& b) {
+		double error = 0;
+		for (size_t i = 0; i < a.pixels.size(); i++) {
+			const double difference = double(a.pixels[i]) - b.pixels[i];
+			error += difference * difference;
+		}
+		return error;
+	}
+
+	// the lowest PSNR a format has to reach on the test image, about 1.5 dB
+	// under what every quality gets now (38.2 dB for BC1 and BC3, 38.6 dB to
+	// 38.7 dB for BC7), so a worse encoder or a broken decoder shows up
+	struct RoundTrip
+	{
+		BlockFormat format;
+		CompressionQuality quality;
+		bool opaque;
+		float minPsnr;
+	};
+
+	void testRoundTrip(const RoundTrip& round_trip) {
+		const Image image = makeImage(62, 38, round_trip.opaque);
+		vector<uint8_t> blocks;
+		const double encoderError = compressImage(image, round_trip.format, round_trip.quality, blocks, 1);
+		const DXGI_FORMAT format = getBlockDxgiFormat(round_trip.format);
+		CHECK(blocks.size() == 16 * 10 * getBlockSize(round_trip.format));
+
+		Image decoded;
+		decodeSurface(format, makeSurface(format, image.width, image.height, blocks), 0, decoded);
+		CHECK(decoded.width == image.width && decoded.height == image.height);
+
+		// the encoder measures its error on its own decode
+		const double error = getSquaredError(image, decoded);
+		CHECK(fabs(error - encoderError) <= 1e-6 * error);
+		const float psnr = getPsnr(error, image.pixels.size());
+		if (!CHECK(psnr >= round_trip.minPsnr)) {
+			cerr << "  " << getBlockFormatName(round_trip.format) << " " << getCompressionQualityName(round_trip.quality)
+				<< (round_trip.opaque ? " opaque" : " alpha") << ": " << psnr << " dB" << endl;
+		}
+	}
+
+	void checkPixels(DXGI_FORMAT format, const uint8_t* block, const uint8_t expected[16][4]) {
+		uint8_t pixels[16][4];
+		decodeBlock(format, block, pixels);
+		CHECK(memcmp(pixels, expected, sizeof(pixels)) == 0);
+
+		float values[16][4];
+		decodeBlock(format, block, values);
+		bool same = true;
+		for (int p = 0; p < 16; p++) {
+			for (int c = 0; c < 4; c++)
+				same = same && fabs(values[p][c] - expected[p][c] / 255.0f) <= 1e-6f;
+		}
+		CHECK(same);
+	}
+
+	void testBc1Blocks() {
+		// color0 red > color1 blue with a little red: 4 colors, the thirds rounded
+		// (518 / 3 is 173); indices 0 to 3 in every row
+		const uint8_t fourColors[8] = { 0x00, 0xf8, 0x1f, 0x08, 0xe4, 0xe4, 0xe4, 0xe4 };
+		const uint8_t fourColorPalette[4][4] = { { 255, 0, 0, 255 }, { 8, 0, 255, 255 }, { 173, 0, 85, 255 }, { 90, 0, 170, 255 } };
+		uint8_t expected[16][4];
+		for (int p = 0; p < 16; p++)
+			memcpy(expected[p], fourColorPalette[p % 4], 4);
+		checkPixels(DXGI_FORMAT_BC1_UNORM, fourColors, expected);
+
+		// color0 blue <= color1 red: 3 colors, the half rounded up, and transparent black
+		const uint8_t threeColors[8] = { 0x1f, 0x00, 0x00, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4 };
+		const uint8_t threeColorPalette[4][4] = { { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, { 128, 0, 128, 255 }, { 0, 0, 0, 0 } };
+		for (int p = 0; p < 16; p++)
+			memcpy(expected[p], threeColorPalette[p % 4], 4);
+		checkPixels(DXGI_FORMAT_BC1_UNORM, threeColors, expected);
+
+		// 565 expands by repeating the top bits: 0x4208 is 8, 16, 8
+		const uint8_t grey[8] = { 0x08, 0x42, 0x08, 0x42, 0, 0, 0, 0 };
+		for (int p = 0; p < 16; p++) {
+			const uint8_t pixel[4] = { 66, 65, 66, 255 };
+			memcpy(expected[p], pixel, 4);
+		}
+		checkPixels(DXGI_FORMAT_BC1_UNORM, grey, expected);
+	}
+
+	void testBc7Blocks() {
+		// mode 6: rgba endpoints 0 (p 0) and 127 (p 1, so 255), pixel i has index i,
+		// interpolated with the 4-bit weights as ((64 - w) * e0 + w * e1 + 32) >> 6
+		const uint8_t mode6[16] = { 0x40, 0xc0, 0x1f, 0xf0, 0x07, 0xfc, 0x01, 0x7f, 0x11, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe };
+		const uint8_t ramp[16] = { 0, 16, 36, 52, 68, 84, 104, 120, 135, 151, 171, 187, 203, 219, 239, 255 };
+		uint8_t expected[16][4];
+		for (int p = 0; p < 16; p++)
+			memset(expected[p], ramp[p], 4);
+		checkPixels(DXGI_FORMAT_BC7_UNORM, mode6, expected);
+
+		// the reserved mode 8 decodes to transparent black
+		const uint8_t reserved[16] = {};
+		memset(expected, 0, sizeof(expected));
+		checkPixels(DXGI_FORMAT_BC7_UNORM, reserved, expected);
+	}
+}
+
+int main() {
+	const RoundTrip roundTrips[] = {
+		{ BlockFormat::bc1, CompressionQuality::fast, true, 36.5f },
+		{ BlockFormat::bc1, CompressionQuality::normal, true, 36.5f },
+		{ BlockFormat::bc1, CompressionQuality::high, true, 36.5f },
+		{ BlockFormat::bc3, CompressionQuality::fast, false, 36.5f },
+		{ BlockFormat::bc3, CompressionQuality::normal, false, 36.5f },
+		{ BlockFormat::bc3, CompressionQuality::high, false, 36.5f },
+		{ BlockFormat::bc7, CompressionQuality::fast, false, 37.0f },
+		{ BlockFormat::bc7, CompressionQuality::normal, false, 37.0f },
+		{ BlockFormat::bc7, CompressionQuality::high, false, 37.0f },
+	};
+
+	try {
+		for (const auto& roundTrip : roundTrips)
+			testRoundTrip(roundTrip);
+		testBc1Blocks();
+		testBc7Blocks();
+	}
+	catch (const exception& e) {
+		cerr << "unexpected exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return checkResult();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Checks for the test executables: a failed CHECK prints the expression and
+// where it is and the test goes on, main returns checkResult().
+
+namespace check {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+
+	inline bool report(bool passed, const char* expression, const char* file, int line) {
+		if (!passed) {
+			std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+			failures()++;
+		}
+		return passed;
+	}
+}
+
+#define CHECK(expression) check::report(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+// the expression has to throw an exception of the given type
+#define CHECK_THROWS(expression, type) \
+	do { \
+		bool thrown = false; \
+		try { expression; } \
+		catch (const type&) { thrown = true; } \
+		check::report(thrown, #expression " throws " #type, __FILE__, __LINE__); \
+	} while (false)
+
+inline int checkResult() {
+	if (check::failures() > 0) {
+		std::cerr << check::failures() << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#include "DdsParser.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+// Fuzz target for parseDds: any input has to be rejected with a runtime_error
+// or parse into surfaces that stay inside it. Built with libFuzzer when
+// DIRECTX_LIBFUZZER is on, else with FuzzMain.cpp.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	DdsTexture texture;
+	try {
+		parseDds(data, size, texture);
+	}
+	catch (const std::runtime_error&) {
+		return 0;
+	}
+
+	if (texture.surfaces.size() != size_t(texture.arraySize) * texture.mipCount)
+		abort();
+	for (const auto& surface : texture.surfaces) {
+		if (surface.offset > size || surface.size > size - surface.offset || surface.data != data + surface.offset)
+			abort();
+		if (surface.size != surface.layout.slicePitch * surface.depth)
+			abort();
+	}
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include "Check.h"
+
+#include "DdsParser.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The fixtures, all surface bytes are filler:
+//   rgba8_legacy.dds       8x4 B8G8R8A8_UNORM, legacy header with a pitch, 4 mips
+//   bc1_mips.dds           16x16 DXT1, legacy header, 5 mips
+//   bc1_truncated.dds      bc1_mips.dds without its last 5 bytes
+//   bc7_dx10.dds           12x8 BC7_UNORM, DX10 header, 2 mips
+//   rgba8_dx10_array.dds   4x4 R8G8B8A8_UNORM, DX10 header, 3 array slices
+//   bc1_dx10_cube.dds      4x4 BC1_UNORM cubemap, DX10 header
+
+namespace {
+	string fixtures;
+
+	vector<uint8_t> readFixture(const string& name) {
+		ifstream file(fixtures + "/" + name, ios::binary);
+		if (!file)
+			throw runtime_error("can't open fixture " + name);
+		return vector<uint8_t>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	}
+
+	// the surfaces follow each other from the end of the headers to the end of the file
+	void checkSurfaces(const DdsTexture& texture, const vector<uint8_t>& bytes, size_t header_size) {
+		CHECK(texture.surfaces.size() == size_t(texture.arraySize) * texture.mipCount);
+		size_t offset = header_size;
+		for (const auto& surface : texture.surfaces) {
+			CHECK(surface.offset == offset);
+			CHECK(surface.data == bytes.data() + surface.offset);
+			CHECK(surface.size == surface.layout.slicePitch * surface.depth);
+			offset += surface.size;
+		}
+		CHECK(offset == bytes.size());
+	}
+
+	void testLegacyUncompressed() {
+		const vector<uint8_t> bytes = readFixture("rgba8_legacy.dds");
+		DdsTexture texture;
+		parseDds(bytes.data(), bytes.size(), texture);
+		CHECK(texture.format == DXGI_FORMAT_B8G8R8A8_UNORM);
+		CHECK(texture.dimension == DdsDimension::texture2d);
+		CHECK(texture.width == 8 && texture.height == 4 && texture.depth == 1);
+		CHECK(texture.mipCount == 4);
+		CHECK(texture.arraySize == 1 && !texture.cubemap);
+		checkSurfaces(texture, bytes, 128);
+
+		const uint32_t widths[] = { 8, 4, 2, 1 };
+		const uint32_t heights[] = { 4, 2, 1, 1 };
+		for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+			const DdsSurface& surface = texture.getSurface(0, mip);
+			CHECK(surface.width == widths[mip] && surface.height == heights[mip]);
+			CHECK(surface.layout.rowPitch == widths[mip] * 4);
+			CHECK(surface.layout.rowCount == heights[mip]);
+		}
+	}
+
+	void testBc1() {
+		const vector<uint8_t> bytes = readFixture("bc1_mips.dds");
+		DdsTexture texture;
+		parseDds(bytes.data(), bytes.size(), texture);
+		CHECK(texture.format == DXGI_FORMAT_BC1_UNORM);
+		CHECK(texture.width == 16 && texture.height == 16);
+		CHECK(texture.mipCount == 5);
+		checkSurfaces(texture, bytes, 128);
+
+		// 4x4 blocks of 8 bytes, levels under 4x4 still take a whole block
+		const size_t rowPitches[] = { 32, 16, 8, 8, 8 };
+		const size_t rowCounts[] = { 4, 2, 1, 1, 1 };
+		for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+			CHECK(texture.getSurface(0, mip).layout.rowPitch == rowPitches[mip]);
+			CHECK(texture.getSurface(0, mip).layout.rowCount == rowCounts[mip]);
+		}
+	}
+
+	void testBc7Dx10() {
+		const vector<uint8_t> bytes = readFixture("bc7_dx10.dds");
+		DdsTexture texture;
+		parseDds(bytes.data(), bytes.size(), texture);
+		CHECK(texture.format == DXGI_FORMAT_BC7_UNORM);
+		CHECK(texture.width == 12 && texture.height == 8);
+		CHECK(texture.mipCount == 2);
+		checkSurfaces(texture, bytes, 148);
+		CHECK(texture.getSurface(0, 0).layout.rowPitch == 3 * 16);
+		CHECK(texture.getSurface(0, 0).layout.rowCount == 2);
+		// 6x4 rounds up to 2x1 blocks
+		CHECK(texture.getSurface(0, 1).size == 2 * 16);
+	}
+
+	void testDx10ArrayAndCube() {
+		const vector<uint8_t> array = readFixture("rgba8_dx10_array.dds");
+		DdsTexture texture;
+		parseDds(array.data(), array.size(), texture);
+		CHECK(texture.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+		CHECK(texture.arraySize == 3 && !texture.cubemap);
+		CHECK(texture.mipCount == 1);
+		checkSurfaces(texture, array, 148);
+
+		const vector<uint8_t> cube = readFixture("bc1_dx10_cube.dds");
+		parseDds(cube.data(), cube.size(), texture);
+		CHECK(texture.format == DXGI_FORMAT_BC1_UNORM);
+		CHECK(texture.cubemap);
+		CHECK(texture.arraySize == 6);
+		checkSurfaces(texture, cube, 148);
+	}
+
+	void testTruncated() {
+		const vector<uint8_t> bytes = readFixture("bc1_truncated.dds");
+		DdsTexture texture;
+		CHECK_THROWS(parseDds(bytes.data(), bytes.size(), texture), runtime_error);
+		CHECK_THROWS(DdsFile(fixtures + "/bc1_truncated.dds"), runtime_error);
+
+		// every shorter copy of a valid file is rejected, whatever part it ends in
+		const vector<uint8_t> full = readFixture("bc7_dx10.dds");
+		size_t accepted = 0;
+		for (size_t size = 0; size < full.size(); size++) {
+			try {
+				parseDds(full.data(), size, texture);
+				accepted++;
+			}
+			catch (const runtime_error&) {
+			}
+		}
+		CHECK(accepted == 0);
+	}
+
+	void testBadHeaders() {
+		vector<uint8_t> bytes = readFixture("bc1_mips.dds");
+		DdsTexture texture;
+
+		vector<uint8_t> magic = bytes;
+		magic[0] = 'X';
+		CHECK_THROWS(parseDds(magic.data(), magic.size(), texture), runtime_error);
+
+		// DDS_HEADER::size has to be 124
+		vector<uint8_t> headerSize = bytes;
+		headerSize[4] = 120;
+		CHECK_THROWS(parseDds(headerSize.data(), headerSize.size(), texture), runtime_error);
+
+		// an unknown four character code
+		vector<uint8_t> fourCC = bytes;
+		memcpy(fourCC.data() + 84, "XYZW", 4);
+		CHECK_THROWS(parseDds(fourCC.data(), fourCC.size(), texture), runtime_error);
+
+		// a DX10 header naming DXGI_FORMAT_UNKNOWN
+		vector<uint8_t> dx10 = readFixture("bc7_dx10.dds");
+		memset(dx10.data() + 128, 0, 4);
+		CHECK_THROWS(parseDds(dx10.data(), dx10.size(), texture), runtime_error);
+	}
+
+	void testReadDds() {
+		// a 4 texel limit skips the 16x16 and 8x8 levels and never reads them
+		DdsReadOptions options;
+		options.maxSize = 4;
+		DdsStreamedTexture streamed;
+		readDds(fixtures + "/bc1_mips.dds", options, streamed);
+		CHECK(streamed.skippedMips == 2);
+		CHECK(streamed.texture.width == 4 && streamed.texture.height == 4);
+		CHECK(streamed.texture.mipCount == 3);
+		CHECK(streamed.fileSize == 312);
+		CHECK(streamed.bytesRead == 128 + 3 * 8);
+
+		const vector<uint8_t> bytes = readFixture("bc1_mips.dds");
+		const DdsSurface& top = streamed.texture.getSurface(0, 0);
+		CHECK(top.size == 8 && memcmp(top.data, bytes.data() + 128 + 128 + 32, 8) == 0);
+
+		// a budget under both levels still keeps the smallest
+		options = DdsReadOptions();
+		options.memoryBudget = 16;
+		readDds(fixtures + "/bc7_dx10.dds", options, streamed);
+		CHECK(streamed.skippedMips == 1);
+		CHECK(streamed.texture.width == 6 && streamed.texture.height == 4);
+		CHECK(streamed.bytesRead == 148 + 32);
+
+		CHECK_THROWS(readDds(fixtures + "/bc1_truncated.dds", DdsReadOptions(), streamed), runtime_error);
+		CHECK_THROWS(readDds(fixtures + "/missing.dds", DdsReadOptions(), streamed), runtime_error);
+	}
+
+	void testWriteDds() {
+		const string path = (filesystem::temp_directory_path() / "dds_parser_test.dds").string();
+
+		// BC7 gets a DX10 header
+		const vector<uint8_t> bc7 = readFixture("bc7_dx10.dds");
+		writeDds(path, DXGI_FORMAT_BC7_UNORM, 12, 8, 2, vector<uint8_t>(bc7.begin() + 148, bc7.end()));
+		{
+			DdsFile written(path);
+			CHECK(written.getFileSize() == bc7.size());
+			CHECK(written.getTexture().format == DXGI_FORMAT_BC7_UNORM);
+			CHECK(written.getTexture().mipCount == 2);
+			CHECK(memcmp(written.getData() + 148, bc7.data() + 148, bc7.size() - 148) == 0);
+		}
+
+		// BC1 a legacy one
+		const vector<uint8_t> bc1 = readFixture("bc1_mips.dds");
+		writeDds(path, DXGI_FORMAT_BC1_UNORM, 16, 16, 5, vector<uint8_t>(bc1.begin() + 128, bc1.end()));
+		{
+			DdsFile written(path);
+			CHECK(written.getFileSize() == bc1.size());
+			CHECK(memcmp(written.getData() + 84, "DXT1", 4) == 0);
+			CHECK(written.getTexture().format == DXGI_FORMAT_BC1_UNORM);
+			CHECK(memcmp(written.getData() + 128, bc1.data() + 128, bc1.size() - 128) == 0);
+		}
+
+		// the surfaces have to match the levels
+		CHECK_THROWS(writeDds(path, DXGI_FORMAT_BC1_UNORM, 16, 16, 5, vector<uint8_t>(100)), runtime_error);
+		filesystem::remove(path);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		cerr << "use dds_parser_test <fixtures dir>" << endl;
+		return EXIT_FAILURE;
+	}
+	fixtures = argv[1];
+
+	try {
+		testLegacyUncompressed();
+		testBc1();
+		testBc7Dx10();
+		testDx10ArrayAndCube();
+		testTruncated();
+		testBadHeaders();
+		testReadDds();
+		testWriteDds();
+	}
+	catch (const exception& e) {
+		cerr << "unexpected exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return checkResult();
+}
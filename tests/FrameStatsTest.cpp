@@ -0,0 +1,97 @@
+#include "Check.h"
+
+#include "FrameStats.h"
+#include "HdrHistogram.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// The frame time statistics of a recorded run and of the same run counted in
+// an HdrHistogram, which is what a run past the recorder's capacity falls back
+// to, on frames far shorter than a millisecond like the headless ones.
+
+namespace {
+	// 3 to 6 us frames with a 1% tail up to 200 us and one 8 ms stall
+	vector<float> makeFrameTimes() {
+		mt19937 random(7);
+		uniform_real_distribution<float> usual(0.003f, 0.006f), slow(0.02f, 0.2f);
+		vector<float> times(100000);
+		for (size_t i = 0; i < times.size(); i++)
+			times[i] = i % 100 == 0 ? slow(random) : usual(random);
+		times[times.size() / 2] = 8.0f;
+		return times;
+	}
+
+	bool isClose(float value, float expected, float tolerance) {
+		return fabs(value - expected) <= tolerance * fabs(expected);
+	}
+
+	void testRecorded(const vector<float>& times) {
+		FrameTimeStats stats;
+		computeFrameTimeStats(times.data(), times.size(), stats);
+		CHECK(stats.frames == times.size());
+		CHECK(!stats.fromHistogram);
+		CHECK(stats.minMs >= 0.003f && stats.maxMs == 8.0f);
+		CHECK(stats.p50Ms > 0.004f && stats.p50Ms < 0.005f);
+		CHECK(stats.p50Ms <= stats.p90Ms && stats.p90Ms <= stats.p99Ms && stats.p99Ms <= stats.p999Ms);
+
+		// the bins fit the run: at most 64 of 1, 2 or 5 times a power of ten ms, and more than one
+		CHECK(stats.histogram.size() > 1 && stats.histogram.size() <= 64);
+		uint64_t frames = 0;
+		for (const auto& bin : stats.histogram)
+			frames += bin.frames;
+		CHECK(frames == times.size());
+		CHECK(isClose(stats.histogram[0].toMs - stats.histogram[0].fromMs, 0.2f, 1e-4f));
+
+		// frames of 1.5 us and 40.5 us get forty 1 us bins
+		const float shortTimes[] = { 0.0015f, 0.0405f };
+		computeFrameTimeStats(shortTimes, 2, stats);
+		CHECK(stats.histogram.size() == 40 && stats.histogram.front().frames == 1 && stats.histogram.back().frames == 1);
+	}
+
+	void testHistogram(const vector<float>& times) {
+		FrameTimeStats recorded, counted;
+		computeFrameTimeStats(times.data(), times.size(), recorded);
+
+		HdrHistogram histogram(60000000000, 3);
+		for (float time : times)
+			histogram.record(static_cast<int64_t>(time * 1000000.0f + 0.5f));
+		computeFrameTimeStats(histogram, 0.000001, counted);
+
+		// the same run, to the 3 significant digits of the histogram
+		CHECK(counted.fromHistogram);
+		CHECK(counted.frames == recorded.frames);
+		CHECK(isClose(counted.minMs, recorded.minMs, 2e-3f));
+		CHECK(isClose(counted.maxMs, recorded.maxMs, 2e-3f));
+		CHECK(isClose(counted.meanMs, recorded.meanMs, 2e-3f));
+		CHECK(isClose(counted.stddevMs, recorded.stddevMs, 2e-3f));
+		CHECK(isClose(counted.p50Ms, recorded.p50Ms, 2e-3f));
+		CHECK(isClose(counted.p99Ms, recorded.p99Ms, 2e-3f));
+		CHECK(isClose(counted.p999Ms, recorded.p999Ms, 2e-3f));
+		CHECK(isClose(counted.low1Fps, recorded.low1Fps, 2e-3f));
+		CHECK(isClose(counted.low01Fps, recorded.low01Fps, 2e-3f));
+		CHECK(counted.histogram.size() == recorded.histogram.size());
+
+		// an empty histogram has no statistics
+		computeFrameTimeStats(HdrHistogram(60000000000, 3), 0.000001, counted);
+		CHECK(counted.frames == 0 && counted.histogram.empty());
+	}
+}
+
+int main() {
+	try {
+		const vector<float> times = makeFrameTimes();
+		testRecorded(times);
+		testHistogram(times);
+	}
+	catch (const exception& e) {
+		cerr << "unexpected exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return checkResult();
+}
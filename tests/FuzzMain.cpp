@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Runs a libFuzzer target without libFuzzer, so it builds with any compiler
+// and runs as a test: every seed file as is, cut at every length, with every
+// bit of its first 256 bytes flipped, and then -runs=N random mutations (byte
+// writes, bit flips, inserts, erases and cuts) with a fixed random seed.
+//
+//   <target> [-runs=N] <seed file or dir>...
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+	// a copy, so reads past the end of the input trip the sanitizers
+	void runInput(const vector<uint8_t>& input) {
+		vector<uint8_t> copy(input);
+		LLVMFuzzerTestOneInput(copy.empty() ? nullptr : copy.data(), copy.size());
+	}
+
+	void mutate(vector<uint8_t>& input, mt19937& random) {
+		const int edits = 1 + random() % 4;
+		for (int i = 0; i < edits; i++) {
+			const size_t position = input.empty() ? 0 : random() % input.size();
+			switch (random() % 5) {
+			case 0:
+				if (!input.empty())
+					input[position] = static_cast<uint8_t>(random());
+				break;
+			case 1:
+				if (!input.empty())
+					input[position] ^= static_cast<uint8_t>(1 << (random() % 8));
+				break;
+			case 2:
+				input.insert(input.begin() + position, static_cast<uint8_t>(random()));
+				break;
+			case 3:
+				if (!input.empty())
+					input.erase(input.begin() + position);
+				break;
+			default:
+				input.resize(position);
+				break;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned long runs = 10000;
+	vector<vector<uint8_t>> seeds;
+	for (int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+		if (arg.rfind("-runs=", 0) == 0) {
+			runs = stoul(arg.substr(6));
+			continue;
+		}
+
+		vector<filesystem::path> files;
+		if (filesystem::is_directory(arg)) {
+			for (const auto& entry : filesystem::directory_iterator(arg)) {
+				if (entry.is_regular_file())
+					files.push_back(entry.path());
+			}
+		}
+		else
+			files.push_back(arg);
+		for (const auto& file : files) {
+			ifstream stream(file, ios::binary);
+			if (!stream) {
+				cerr << "can't open " << file.string() << endl;
+				return EXIT_FAILURE;
+			}
+			seeds.emplace_back(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+		}
+	}
+	if (seeds.empty()) {
+		cerr << "use " << argv[0] << " [-runs=N] <seed file or dir>..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t inputs = 0;
+	for (const auto& seed : seeds) {
+		runInput(seed);
+		for (size_t size = 0; size < seed.size(); size++)
+			runInput(vector<uint8_t>(seed.begin(), seed.begin() + size));
+		vector<uint8_t> flipped = seed;
+		for (size_t bit = 0; bit < min<size_t>(seed.size(), 256) * 8; bit++) {
+			flipped[bit / 8] ^= 1 << (bit % 8);
+			runInput(flipped);
+			flipped[bit / 8] ^= 1 << (bit % 8);
+		}
+		inputs += 1 + seed.size() + min<size_t>(seed.size(), 256) * 8;
+	}
+
+	mt19937 random(12345);
+	for (unsigned long run = 0; run < runs; run++) {
+		vector<uint8_t> input = seeds[run % seeds.size()];
+		mutate(input, random);
+		runInput(input);
+	}
+	inputs += runs;
+
+	cout << inputs << " inputs from " << seeds.size() << " seeds" << endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include "Ktx2Parser.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+// Fuzz target for readKtx2, Zstandard levels included: any input has to be
+// rejected with a runtime_error or read into surfaces that stay inside the
+// decompressed data. readKtx2 reads files, so every input is written to a
+// temporary file first. Built with libFuzzer when DIRECTX_LIBFUZZER is on,
+// else with FuzzMain.cpp.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	// a name of its own, for libFuzzer jobs running side by side, removed on exit
+	static const struct TemporaryFile
+	{
+		std::string path = (std::filesystem::temp_directory_path() /
+			("ktx2_parser_fuzz-" + std::to_string(std::random_device()()) + ".ktx2")).string();
+		~TemporaryFile() { std::error_code error; std::filesystem::remove(path, error); }
+	} temporary;
+	const std::string& path = temporary.path;
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+		if (!file)
+			abort();
+	}
+
+	// a header may describe levels of gigabytes that a few bytes of Zstandard expand to
+	DdsReadOptions options;
+	options.memoryBudget = 64 << 20;
+	DdsStreamedTexture streamed;
+	try {
+		readKtx2(path, options, streamed, 1);
+	}
+	catch (const std::runtime_error&) {
+		return 0;
+	}
+
+	const DdsTexture& texture = streamed.texture;
+	if (texture.surfaces.size() != size_t(texture.arraySize) * texture.mipCount || streamed.fileSize != size)
+		abort();
+	const uint8_t* begin = streamed.data.data();
+	const uint8_t* end = begin + streamed.data.size();
+	for (const auto& surface : texture.surfaces) {
+		if (surface.data < begin || surface.size > size_t(end - surface.data))
+			abort();
+		if (surface.size != surface.layout.slicePitch * surface.depth)
+			abort();
+	}
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include "Check.h"
+
+#include "Ktx2Parser.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The fixture:
+//   rgba8_array_zstd.ktx2   16x8 R8G8B8A8_UNORM, 2 layers, 5 levels, every level
+//                           supercompressed with Zstandard (with checksums) and
+//                           stored from the smallest to the largest
+// Its texels are getTexel(layer, level, x, y).
+
+namespace {
+	string fixtures;
+
+	const char* const FIXTURE = "rgba8_array_zstd.ktx2";
+
+	vector<uint8_t> readFixture(const string& name) {
+		ifstream file(fixtures + "/" + name, ios::binary);
+		if (!file)
+			throw runtime_error("can't open fixture " + name);
+		return vector<uint8_t>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	}
+
+	void writeFile(const string& path, const vector<uint8_t>& bytes) {
+		ofstream file(path, ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<streamsize>(bytes.size()));
+	}
+
+	array<uint8_t, 4> getTexel(uint32_t layer, uint32_t level, uint32_t x, uint32_t y) {
+		return { uint8_t(x * 8 + y), uint8_t(level * 32 + layer), uint8_t(255 - x), 255 };
+	}
+
+	// the texels of every surface of streamed, which starts at level first_level
+	bool checkTexels(const DdsStreamedTexture& streamed, uint32_t first_level) {
+		const DdsTexture& texture = streamed.texture;
+		for (uint32_t layer = 0; layer < texture.arraySize; layer++) {
+			for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+				const DdsSurface& surface = texture.getSurface(layer, mip);
+				for (uint32_t y = 0; y < surface.height; y++) {
+					for (uint32_t x = 0; x < surface.width; x++) {
+						const uint8_t* texel = surface.data + y * surface.layout.rowPitch + x * 4;
+						if (memcmp(texel, getTexel(layer, first_level + mip, x, y).data(), 4) != 0)
+							return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	void testLayout() {
+		const vector<uint8_t> bytes = readFixture(FIXTURE);
+		DdsStreamedTexture streamed;
+		readKtx2(fixtures + "/" + FIXTURE, DdsReadOptions(), streamed, 1);
+		const DdsTexture& texture = streamed.texture;
+		CHECK(texture.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+		CHECK(texture.dimension == DdsDimension::texture2d);
+		CHECK(texture.width == 16 && texture.height == 8 && texture.depth == 1);
+		CHECK(texture.mipCount == 5);
+		CHECK(texture.arraySize == 2 && !texture.cubemap);
+		CHECK(texture.alphaMode == DirectX::DDS_ALPHA_MODE_STRAIGHT);
+		CHECK(texture.surfaces.size() == 10);
+		CHECK(streamed.skippedMips == 0);
+		CHECK(streamed.fileSize == bytes.size() && streamed.bytesRead <= bytes.size());
+
+		// the levels decompress one after another into data, layer by layer within a level
+		const uint32_t widths[] = { 16, 8, 4, 2, 1 };
+		const uint32_t heights[] = { 8, 4, 2, 1, 1 };
+		size_t start = 0;
+		for (uint32_t mip = 0; mip < texture.mipCount; mip++) {
+			for (uint32_t layer = 0; layer < texture.arraySize; layer++) {
+				const DdsSurface& surface = texture.getSurface(layer, mip);
+				CHECK(surface.width == widths[mip] && surface.height == heights[mip] && surface.depth == 1);
+				CHECK(surface.layout.rowPitch == widths[mip] * 4);
+				CHECK(surface.layout.rowCount == heights[mip]);
+				CHECK(surface.size == widths[mip] * heights[mip] * 4);
+				CHECK(surface.data == streamed.data.data() + start + layer * surface.size);
+				// both layers point at their compressed level, which is stored after the smaller ones
+				CHECK(surface.offset == texture.getSurface(0, mip).offset);
+				if (mip > 0)
+					CHECK(surface.offset < texture.getSurface(layer, mip - 1).offset);
+			}
+			start += texture.getSurface(0, mip).size * texture.arraySize;
+		}
+		CHECK(start == streamed.data.size());
+		CHECK(checkTexels(streamed, 0));
+	}
+
+	void testSkippedLevels() {
+		// the first level no larger than 4 is level 2, the larger ones are never read
+		DdsReadOptions options;
+		options.maxSize = 4;
+		DdsStreamedTexture streamed;
+		readKtx2(fixtures + "/" + FIXTURE, options, streamed);
+		CHECK(streamed.skippedMips == 2);
+		CHECK(streamed.texture.width == 4 && streamed.texture.height == 2);
+		CHECK(streamed.texture.mipCount == 3 && streamed.texture.surfaces.size() == 6);
+		CHECK(streamed.data.size() == (32 + 8 + 4) * 2);
+		CHECK(streamed.bytesRead < streamed.fileSize);
+		CHECK(checkTexels(streamed, 2));
+	}
+
+	void testBadFiles() {
+		const vector<uint8_t> bytes = readFixture(FIXTURE);
+		const string path = (filesystem::temp_directory_path() / "ktx2_parser_test.ktx2").string();
+		DdsStreamedTexture streamed;
+
+		// level 0 is the last one in the file
+		writeFile(path, vector<uint8_t>(bytes.begin(), bytes.end() - 5));
+		CHECK_THROWS(readKtx2(path, DdsReadOptions(), streamed), runtime_error);
+
+		// the last byte is part of the checksum of level 0
+		vector<uint8_t> checksum = bytes;
+		checksum.back() ^= 1;
+		writeFile(path, checksum);
+		CHECK_THROWS(readKtx2(path, DdsReadOptions(), streamed), runtime_error);
+
+		// the uncompressed length of level 1 no longer matches its size
+		vector<uint8_t> length = bytes;
+		length[80 + 24 + 16]++;
+		writeFile(path, length);
+		CHECK_THROWS(readKtx2(path, DdsReadOptions(), streamed), runtime_error);
+
+		// zlib supercompression
+		vector<uint8_t> zlib = bytes;
+		zlib[44] = 3;
+		writeFile(path, zlib);
+		CHECK_THROWS(readKtx2(path, DdsReadOptions(), streamed), runtime_error);
+
+		filesystem::remove(path);
+		CHECK_THROWS(readKtx2(fixtures + "/missing.ktx2", DdsReadOptions(), streamed), runtime_error);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		cerr << "use ktx2_parser_test <fixtures dir>" << endl;
+		return EXIT_FAILURE;
+	}
+	fixtures = argv[1];
+
+	try {
+		testLayout();
+		testSkippedLevels();
+		testBadFiles();
+	}
+	catch (const exception& e) {
+		cerr << "unexpected exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return checkResult();
+}